@@ -0,0 +1,258 @@
+#include "AnimationBenchmark.hpp"
+
+#include "Core/Types.hpp"
+#include "Graphics/AnimationCompression.hpp"
+#include "Graphics/AnimationSystem.hpp"
+#include "Graphics/VulkanGlTFTypes.hpp"
+#include "JobSystem.hpp"
+#include "Math/Functions.hpp"
+#include "Timer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace AnimationBenchmarkLocal
+{
+	static constexpr Core::uint32 gJointCount = 64;
+	static constexpr Core::uint32 gKeyCount = 120; // Four seconds at 30 keys per second
+	static constexpr float gKeysPerSecond = 30.0f;
+	static constexpr Core::uint32 gInstanceCount = 1024;
+	static constexpr Core::uint32 gIterationCount = 50;
+	static constexpr float gDeltaTime = 1.0f / 60.0f;
+
+	// A binary tree of joints with a translation, a rotation and a scale channel each, like a skeleton only the root moves
+	// and the joints rotate, so most translation and scale keys are removed by the compression
+	static void CreateSkeleton(vkglTF::Model& aModel, std::vector<AnimationCompression::SourceSampler>& aSamplers)
+	{
+		std::mt19937 random{42};
+		std::uniform_real_distribution<float> distribution{-1.0f, 1.0f};
+
+		std::vector<vkglTF::Node*> joints;
+		for (Core::uint32 i = 0; i < gJointCount; i++)
+		{
+			vkglTF::Node* joint = new vkglTF::Node();
+			joint->mIndex = i;
+			joint->mMatrix = Math::Matrix4f{1.0f};
+			if (i == 0)
+			{
+				aModel.nodes.push_back(joint);
+			}
+			else
+			{
+				joint->mParent = joints[(i - 1) / 2];
+				joint->mParent->mChildren.push_back(joint);
+			}
+			joints.push_back(joint);
+		}
+		aModel.linearNodes = joints;
+
+		vkglTF::Animation animation{};
+		animation.mName = "Synthetic";
+		animation.mStart = 0.0f;
+		animation.mEnd = static_cast<float>(gKeyCount - 1) / gKeysPerSecond;
+
+		for (vkglTF::Node* joint : joints)
+		{
+			const Math::Vector3f offset = Math::Vector3f{0.0f, 0.5f, 0.0f} + 0.1f * Math::Vector3f{distribution(random), distribution(random), distribution(random)};
+			const Math::Vector3f axis = Math::Normalize(Math::Vector3f{distribution(random), distribution(random), distribution(random)});
+			const float frequency = 1.0f + 0.5f * distribution(random);
+			const float phase = 3.0f * distribution(random);
+
+			for (const vkglTF::AnimationChannel::PathType path : {vkglTF::AnimationChannel::PathType::TRANSLATION, vkglTF::AnimationChannel::PathType::ROTATION, vkglTF::AnimationChannel::PathType::SCALE})
+			{
+				AnimationCompression::SourceSampler& sampler = aSamplers.emplace_back();
+				sampler.mPath = path;
+				for (Core::uint32 i = 0; i < gKeyCount; i++)
+				{
+					const float time = static_cast<float>(i) / gKeysPerSecond;
+					sampler.mTimes.push_back(time);
+
+					switch (path)
+					{
+						case vkglTF::AnimationChannel::PathType::TRANSLATION:
+						{
+							const Math::Vector3f translation = (joint->mIndex == 0) ? Math::Vector3f{std::sin(time), 0.0f, 0.5f * std::cos(time)} : offset;
+							sampler.mValues.emplace_back(translation, 0.0f);
+							break;
+						}
+						case vkglTF::AnimationChannel::PathType::ROTATION:
+						{
+							const float halfAngle = 0.25f * std::sin(frequency * time + phase);
+							sampler.mValues.emplace_back(std::sin(halfAngle) * axis, std::cos(halfAngle));
+							break;
+						}
+						case vkglTF::AnimationChannel::PathType::SCALE:
+						{
+							sampler.mValues.emplace_back(1.0f, 1.0f, 1.0f, 0.0f);
+							break;
+						}
+					}
+				}
+
+				vkglTF::AnimationChannel channel{};
+				channel.mPathType = path;
+				channel.mNode = joint;
+				channel.mSamplerIndex = static_cast<Core::uint32>(animation.mChannels.size());
+				animation.mChannels.push_back(channel);
+			}
+		}
+
+		AnimationCompression::Compress(aSamplers, animation);
+		aModel.animations.push_back(animation);
+		aModel.mHierarchy.Build(aModel.nodes);
+	}
+
+	// The keyframe search of ModelManager::UpdateAnimation on the uncompressed keys, every interval of every channel is tested
+	static void SampleByScanning(const vkglTF::Animation& aAnimation, const std::vector<AnimationCompression::SourceSampler>& aSamplers, float aTime, vkglTF::NodeHierarchy& aHierarchy)
+	{
+		for (const vkglTF::AnimationChannel& channel : aAnimation.mChannels)
+		{
+			const AnimationCompression::SourceSampler& sampler = aSamplers[channel.mSamplerIndex];
+			for (Core::size i = 0; i < sampler.mTimes.size() - 1; i++)
+			{
+				if ((aTime >= sampler.mTimes[i]) && (aTime <= sampler.mTimes[i + 1]))
+				{
+					const float u = std::max(0.0f, aTime - sampler.mTimes[i]) / (sampler.mTimes[i + 1] - sampler.mTimes[i]);
+					const Core::uint32 node = channel.mNode->mHierarchyIndex;
+					switch (channel.mPathType)
+					{
+						case vkglTF::AnimationChannel::PathType::TRANSLATION:
+							aHierarchy.SetTranslation(node, Math::Vector3f(Math::Mix(sampler.mValues[i], sampler.mValues[i + 1], u)));
+							break;
+						case vkglTF::AnimationChannel::PathType::SCALE:
+							aHierarchy.SetScale(node, Math::Vector3f(Math::Mix(sampler.mValues[i], sampler.mValues[i + 1], u)));
+							break;
+						case vkglTF::AnimationChannel::PathType::ROTATION:
+						{
+							Math::Quaternionf q1{};
+							q1.x = sampler.mValues[i].x;
+							q1.y = sampler.mValues[i].y;
+							q1.z = sampler.mValues[i].z;
+							q1.w = sampler.mValues[i].w;
+
+							Math::Quaternionf q2{};
+							q2.x = sampler.mValues[i + 1].x;
+							q2.y = sampler.mValues[i + 1].y;
+							q2.z = sampler.mValues[i + 1].z;
+							q2.w = sampler.mValues[i + 1].w;
+							aHierarchy.SetRotation(node, Math::Normalize(Math::Slerp(q1, q2, u)));
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		aHierarchy.UpdateWorldMatrices();
+	}
+
+	// Best of all iterations, in nanoseconds per instance
+	static double Measure(const std::function<void()>& aFunction)
+	{
+		double bestMicroseconds = std::numeric_limits<double>::max();
+		Time::Timer timer;
+		for (Core::uint32 i = 0; i < gIterationCount; i++)
+		{
+			timer.StartTimer();
+			aFunction();
+			timer.EndTimer();
+			bestMicroseconds = std::min(bestMicroseconds, timer.GetDurationMicroseconds());
+		}
+
+		return bestMicroseconds * 1000.0 / static_cast<double>(gInstanceCount);
+	}
+
+	static void Print(const std::string& aName, double aNanoseconds, double aBaselineNanoseconds)
+	{
+		std::cout << std::format("{:<32} {:>10.1f} ns/instance {:>7.2f}x", aName, aNanoseconds, aBaselineNanoseconds / aNanoseconds) << std::endl;
+	}
+}
+
+int RunAnimationBenchmark()
+{
+	using namespace AnimationBenchmarkLocal;
+
+	vkglTF::Model model;
+	std::vector<AnimationCompression::SourceSampler> sourceSamplers;
+	CreateSkeleton(model, sourceSamplers);
+	const vkglTF::Animation& animation = model.animations[0];
+	const float duration = animation.mEnd - animation.mStart;
+
+	std::cout << std::format("Animating {} instances of {} joints with {} keys per channel, best of {} iterations", gInstanceCount, gJointCount, gKeyCount, gIterationCount) << std::endl;
+
+	Core::size sourceSize = 0;
+	for (const AnimationCompression::SourceSampler& sampler : sourceSamplers)
+	{
+		sourceSize += sampler.mTimes.size() * sizeof(float) + sampler.mValues.size() * sizeof(Math::Vector4f);
+	}
+	const Core::size compressedSize = animation.mSamplers.size() * sizeof(vkglTF::AnimationSampler) + animation.mTimes.size() * sizeof(float) + animation.mValues.size() * sizeof(Core::uint16);
+	std::cout << std::format("Keys: {} bytes, compressed to {} bytes ({:.1f}x)", sourceSize, compressedSize, static_cast<double>(sourceSize) / static_cast<double>(compressedSize)) << std::endl;
+
+	// The instances are spread over the clip, so they don't all look up the same keys
+	AnimationSystem animationSystem;
+	std::vector<AnimationInstance*> instances;
+	std::vector<vkglTF::NodeHierarchy> scannedHierarchies(gInstanceCount, model.mHierarchy);
+	std::vector<float> scannedTimes(gInstanceCount);
+	for (Core::uint32 i = 0; i < gInstanceCount; i++)
+	{
+		scannedTimes[i] = duration * static_cast<float>(i) / static_cast<float>(gInstanceCount);
+
+		AnimationInstance* instance = animationSystem.CreateInstance(model, false);
+		instance->Play(0);
+		instance->SetTime(0, scannedTimes[i]);
+		instances.push_back(instance);
+	}
+
+	const double baseline = Measure([&]()
+	{
+		for (Core::uint32 i = 0; i < gInstanceCount; i++)
+		{
+			scannedTimes[i] = std::fmod(scannedTimes[i] + gDeltaTime, duration);
+			SampleByScanning(animation, sourceSamplers, scannedTimes[i], scannedHierarchies[i]);
+		}
+	});
+	Print("Key search per channel", baseline, baseline);
+
+	Print("AnimationSystem", Measure([&]() { animationSystem.Update(gDeltaTime, nullptr); }), baseline);
+
+	JobSystem jobSystem;
+	Print(std::format("AnimationSystem on {} threads", jobSystem.GetThreadCount()), Measure([&]() { animationSystem.Update(gDeltaTime, &jobSystem); }), baseline);
+
+	// Both have to arrive at the same world matrices at the same time, up to the error of the compression
+	float maxError = 0.0f;
+	for (Core::uint32 i = 0; i < gInstanceCount; i++)
+	{
+		SampleByScanning(animation, sourceSamplers, instances[i]->GetTime(0), scannedHierarchies[i]);
+
+		const vkglTF::NodeHierarchy& hierarchy = instances[i]->GetHierarchy();
+		for (Core::uint32 j = 0; j < hierarchy.GetNodeCount(); j++)
+		{
+			const Math::Matrix4f& expected = scannedHierarchies[i].GetWorldMatrix(j);
+			const Math::Matrix4f& actual = hierarchy.GetWorldMatrix(j);
+			for (Core::uint32 column = 0; column < 4; column++)
+			{
+				for (Core::uint32 row = 0; row < 4; row++)
+				{
+					maxError = std::max(maxError, std::abs(expected[column][row] - actual[column][row]));
+				}
+			}
+		}
+	}
+	std::cout << std::format("Largest difference of a world matrix element: {}", maxError) << std::endl;
+
+	animationSystem.DestroyInstances(&model);
+	for (vkglTF::Node* node : model.nodes)
+	{
+		delete node;
+	}
+
+	return 0;
+}
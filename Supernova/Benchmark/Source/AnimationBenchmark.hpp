@@ -0,0 +1,6 @@
+#pragma once
+
+// Times AnimationSystem::Update on a crowd of instances of a synthetic skeleton, on one thread and on the job system,
+// against searching the keys of every channel from the start the way ModelManager::UpdateAnimation did, and checks that both find the same poses.
+// The keys of the skeleton go through AnimationCompression, the old search runs on the uncompressed keys
+int RunAnimationBenchmark();
@@ -0,0 +1,52 @@
+#include "AnimationBenchmark.hpp"
+#include "CullingBenchmark.hpp"
+#include "Engine.hpp"
+#include "SimulationBenchmark.hpp"
+
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+// Renders the scene headless along a camera path and writes the statistics of every frame to BenchmarkReport.json
+// Takes the options of Engine::ParseCommandLine, e.g. --scene Instances --benchmark MyPath.txt --benchmark-report Results.json
+// --culling only runs the micro-benchmark of the CPU frustum culling kernels
+// --animation only runs the micro-benchmark of the animation system
+// --simulation only runs the fixed update and interpolation check
+int main(const int argc, const char* argv[])
+{
+	if (argc > 1 && std::string_view{argv[1]} == "--culling")
+	{
+		return RunCullingBenchmark();
+	}
+
+	if (argc > 1 && std::string_view{argv[1]} == "--animation")
+	{
+		return RunAnimationBenchmark();
+	}
+
+	if (argc > 1 && std::string_view{argv[1]} == "--simulation")
+	{
+		return RunSimulationBenchmark();
+	}
+
+	// Later options override earlier ones, so the defaults go first
+	std::vector<const char*> arguments{argv[0], "--headless", "--benchmark", "Flyby.txt"};
+	arguments.insert(arguments.end(), argv + 1, argv + argc);
+
+	Engine engine;
+
+	try
+	{
+		engine.ParseCommandLine(arguments);
+		engine.Start();
+		engine.Run();
+	}
+	catch (const std::runtime_error& aError)
+	{
+		std::cerr << aError.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
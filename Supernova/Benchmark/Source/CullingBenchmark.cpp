@@ -0,0 +1,172 @@
+#include "CullingBenchmark.hpp"
+
+#include "Core/Types.hpp"
+#include "Graphics/FrustumCulling.hpp"
+#include "Graphics/VulkanTypes.hpp"
+#include "JobSystem.hpp"
+#include "Math/Functions.hpp"
+#include "Timer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace CullingBenchmarkLocal
+{
+	static constexpr Core::uint32 gGridSize = 64; // Volumes per axis
+	static constexpr float gGridSpacing = 4.0f;
+	static constexpr float gRadius = 1.0f;
+	static constexpr Core::uint32 gIterationCount = 50;
+	static constexpr std::array<float, 4> gLoDDistances{20.0f, 50.0f, 100.0f, 200.0f};
+
+	struct Result
+	{
+		Result() : mNanosecondsPerVolume{0.0}, mVisibleCount{0} {}
+
+		std::vector<Core::uint8> mVisibility; // LOD plus one, zero when culled
+		double mNanosecondsPerVolume;
+		Core::uint32 mVisibleCount;
+	};
+
+	// Best of all iterations, the first one also warms up the caches
+	static double Measure(const std::function<void()>& aFunction)
+	{
+		double bestMicroseconds = std::numeric_limits<double>::max();
+		Time::Timer timer;
+		for (Core::uint32 i = 0; i < gIterationCount; i++)
+		{
+			timer.StartTimer();
+			aFunction();
+			timer.EndTimer();
+			bestMicroseconds = std::min(bestMicroseconds, timer.GetDurationMicroseconds());
+		}
+
+		return bestMicroseconds * 1000.0;
+	}
+
+	// One volume at a time, with the LOD loop of the cull shader
+	static Result CullOneByOne(const ViewFrustum& aFrustum, const Math::Vector3f& aViewPosition, const std::vector<Math::Vector3f>& aCenters)
+	{
+		Result result;
+		result.mVisibility.resize(aCenters.size());
+
+		const double nanoseconds = Measure([&]()
+		{
+			Core::uint32 visibleCount = 0;
+			for (Core::size i = 0; i < aCenters.size(); i++)
+			{
+				if (!aFrustum.IsInSphere(aCenters[i], gRadius))
+				{
+					result.mVisibility[i] = 0;
+					continue;
+				}
+
+				const float distance = Math::Length(aCenters[i] - aViewPosition);
+				Core::uint8 lod = static_cast<Core::uint8>(gLoDDistances.size());
+				for (Core::uint8 j = 0; j < gLoDDistances.size(); j++)
+				{
+					if (distance < gLoDDistances[j])
+					{
+						lod = j;
+						break;
+					}
+				}
+
+				result.mVisibility[i] = lod + 1;
+				visibleCount++;
+			}
+			result.mVisibleCount = visibleCount;
+		});
+
+		result.mNanosecondsPerVolume = nanoseconds / static_cast<double>(aCenters.size());
+		return result;
+	}
+
+	static Result CullInBatches(const ViewFrustum& aFrustum, const Math::Vector3f& aViewPosition, const FrustumCulling::Bounds& aBounds, FrustumCulling::Kernel aKernel, JobSystem* aJobSystem)
+	{
+		FrustumCulling::DrawList drawList;
+		const double nanoseconds = Measure([&]()
+		{
+			FrustumCulling::Cull(aFrustum, aViewPosition, gLoDDistances, aBounds, drawList, aKernel, aJobSystem);
+		});
+
+		Result result;
+		result.mVisibility.assign(drawList.mVisibility.begin(), drawList.mVisibility.begin() + aBounds.GetCount());
+		result.mNanosecondsPerVolume = nanoseconds / static_cast<double>(aBounds.GetCount());
+		result.mVisibleCount = drawList.GetVisibleCount();
+		return result;
+	}
+
+	static void Print(const char* aName, const Result& aResult, const Result& aBaseline)
+	{
+		Core::uint32 mismatchCount = 0;
+		for (Core::size i = 0; i < aBaseline.mVisibility.size(); i++)
+		{
+			if (aResult.mVisibility[i] != aBaseline.mVisibility[i])
+			{
+				mismatchCount++;
+			}
+		}
+
+		std::cout << std::format("{:<24} {:>8.2f} ns/volume {:>7.2f}x {:>8} visible {:>6} mismatches", aName, aResult.mNanosecondsPerVolume,
+			aBaseline.mNanosecondsPerVolume / aResult.mNanosecondsPerVolume, aResult.mVisibleCount, mismatchCount) << std::endl;
+	}
+}
+
+int RunCullingBenchmark()
+{
+	using namespace CullingBenchmarkLocal;
+
+	// A grid of spheres around the camera, most of them end up outside of the frustum like in a large scene
+	std::vector<Math::Vector3f> centers;
+	centers.reserve(gGridSize * gGridSize * gGridSize);
+	const float gridOffset = 0.5f * gGridSpacing * static_cast<float>(gGridSize - 1);
+	for (Core::uint32 x = 0; x < gGridSize; x++)
+	{
+		for (Core::uint32 y = 0; y < gGridSize; y++)
+		{
+			for (Core::uint32 z = 0; z < gGridSize; z++)
+			{
+				centers.emplace_back(gGridSpacing * static_cast<float>(x) - gridOffset, gGridSpacing * static_cast<float>(y) - gridOffset, gGridSpacing * static_cast<float>(z) - gridOffset);
+			}
+		}
+	}
+
+	FrustumCulling::Bounds bounds{FrustumCulling::VolumeType::Sphere};
+	bounds.Resize(static_cast<Core::uint32>(centers.size()));
+	for (Core::uint32 i = 0; i < centers.size(); i++)
+	{
+		bounds.SetSphere(i, centers[i], gRadius);
+	}
+
+	const Math::Vector3f viewPosition{10.0f, 5.0f, -20.0f};
+	const Math::Matrix4f view = Math::Translate(Math::Rotate(Math::Matrix4f{1.0f}, Math::ToRadians(30.0f), Math::Vector3f{0.0f, 1.0f, 0.0f}), -viewPosition);
+	const Math::Matrix4f projection = Math::Perspective(Math::ToRadians(60.0f), 16.0f / 9.0f, 0.1f, 256.0f);
+	ViewFrustum frustum;
+	frustum.UpdateFrustum(projection * view);
+
+	std::cout << std::format("Culling {} spheres, best of {} iterations", centers.size(), gIterationCount) << std::endl;
+
+	const Result baseline = CullOneByOne(frustum, viewPosition, centers);
+	Print("ViewFrustum::IsInSphere", baseline, baseline);
+
+	for (const FrustumCulling::Kernel kernel : {FrustumCulling::Kernel::Scalar, FrustumCulling::Kernel::SSE, FrustumCulling::Kernel::AVX2})
+	{
+		if (FrustumCulling::IsKernelSupported(kernel))
+		{
+			Print(FrustumCulling::GetKernelName(kernel), CullInBatches(frustum, viewPosition, bounds, kernel, nullptr), baseline);
+		}
+	}
+
+	JobSystem jobSystem;
+	const FrustumCulling::Kernel fastestKernel = FrustumCulling::GetFastestKernel();
+	const std::string name = std::format("{} on {} threads", FrustumCulling::GetKernelName(fastestKernel), jobSystem.GetThreadCount());
+	Print(name.c_str(), CullInBatches(frustum, viewPosition, bounds, fastestKernel, &jobSystem), baseline);
+
+	return 0;
+}
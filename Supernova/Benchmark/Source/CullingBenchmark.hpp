@@ -0,0 +1,5 @@
+#pragma once
+
+// Times FrustumCulling::Cull with every kernel the CPU supports against culling the volumes one by one with ViewFrustum::IsInSphere,
+// the way the renderer did before, and checks that every kernel finds the same visible volumes and LODs
+int RunCullingBenchmark();
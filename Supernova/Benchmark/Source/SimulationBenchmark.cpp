@@ -0,0 +1,153 @@
+#include "SimulationBenchmark.hpp"
+
+#include "Core/Types.hpp"
+#include "ECS/Components.hpp"
+#include "ECS/Entity.hpp"
+#include "ECS/Scene.hpp"
+#include "ECS/Systems.hpp"
+#include "Graphics/InstanceRegistry.hpp"
+#include "Graphics/VulkanTypes.hpp"
+#include "JobSystem.hpp"
+#include "Math/Functions.hpp"
+#include "Timer.hpp"
+#include "UniqueIdentifier.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+namespace SimulationBenchmarkLocal
+{
+	static constexpr Core::uint32 gGridSize = 64; // Instances per axis of the oscillating layer
+	static constexpr Core::uint32 gFrameCount = 600;
+	static constexpr Core::uint32 gRecordBatchCount = 64;
+	static constexpr float gFixedDeltaTime = 1.0f / 60.0f;
+	static constexpr float gAngularFrequency = 2.0f;
+	static constexpr float gTolerance = 1e-3f; // The phase is accumulated in floats, so it drifts slightly from the exact one
+
+	// Frame times around the tick, so frames simulate zero, one or two ticks and draw at every interpolation factor
+	static constexpr float gFrameTimes[] = {1.0f / 144.0f, 1.0f / 30.0f, 1.0f / 90.0f, 1.0f / 45.0f, 1.0f / 240.0f};
+
+	static float GetPhase(Core::uint32 aX, Core::uint32 aZ)
+	{
+		return 0.25f * static_cast<float>(aX + aZ);
+	}
+
+	// Position of an instance after a number of ticks, computed directly instead of tick by tick
+	static Math::Vector3f GetExpectedPosition(const ECS::OscillationComponent& aOscillation, Core::uint64 aTickCount)
+	{
+		const double phase = static_cast<double>(aOscillation.mPhase) + static_cast<double>(gAngularFrequency) * static_cast<double>(gFixedDeltaTime) * static_cast<double>(aTickCount);
+		return aOscillation.mOrigin + aOscillation.mAmplitude * static_cast<float>(std::sin(phase));
+	}
+}
+
+int RunSimulationBenchmark()
+{
+	using namespace SimulationBenchmarkLocal;
+
+	ECS::Scene scene;
+	scene.AddFixedUpdateSystem(&ECS::UpdateOscillations);
+
+	UniqueIdentifier modelIdentifier{};
+	InstanceRegistry instanceRegistry{scene, modelIdentifier};
+
+	// Instances are added in order, so the registry keeps the start state of instance i at index i of this list
+	std::vector<ECS::OscillationComponent> oscillations;
+	for (Core::uint32 x = 0; x < gGridSize; x++)
+	{
+		for (Core::uint32 z = 0; z < gGridSize; z++)
+		{
+			ECS::OscillationComponent oscillation{Math::Vector3f{static_cast<float>(x), 0.5f, static_cast<float>(z)}, Math::Vector3f{0.0f, 0.5f, 0.0f}, gAngularFrequency, GetPhase(x, z)};
+			oscillations.push_back(oscillation);
+
+			ECS::Entity entity = scene.CreateEntity("Oscillator");
+			ECS::TransformComponent& transform = entity.GetComponent<ECS::TransformComponent>();
+			transform.mPosition = GetExpectedPosition(oscillation, 0);
+			entity.AddComponent<ECS::InterpolationComponent>(transform);
+			entity.AddComponent<ECS::OscillationComponent>(oscillation);
+			entity.AddComponent<ECS::InstancedMeshComponent>(modelIdentifier);
+		}
+	}
+
+	JobSystem jobSystem;
+	JobCounter simulationCounter;
+	std::atomic<Core::uint32> mainThreadSimulationCount{0};
+	std::vector<float> batchHeights(gRecordBatchCount);
+
+	Core::uint64 tickCount = 0;
+	float simulationTime = 0.0f;
+	float interpolationFactor = 0.0f;
+	float maxError = 0.0f;
+	double simulationMicroseconds = 0.0;
+	double mainThreadMicroseconds = 0.0;
+	Time::Timer mainThreadTimer;
+
+	std::cout << std::format("Simulating {} oscillating instances for {} frames, on {} threads", oscillations.size(), gFrameCount, jobSystem.GetThreadCount()) << std::endl;
+
+	for (Core::uint32 frame = 0; frame < gFrameCount; frame++)
+	{
+		mainThreadTimer.StartTimer();
+
+		// Same order as Engine::Run, the ticks simulated during the previous frame are drawn with the factor they left behind
+		jobSystem.Wait(simulationCounter);
+		instanceRegistry.Update(interpolationFactor);
+
+		const std::vector<InstanceData>& instanceData = instanceRegistry.GetInstanceData();
+		for (Core::size i = 0; i < instanceData.size(); i++)
+		{
+			const Math::Vector3f previous = GetExpectedPosition(oscillations[i], (tickCount > 0) ? tickCount - 1 : 0);
+			const Math::Vector3f current = GetExpectedPosition(oscillations[i], tickCount);
+			maxError = std::max(maxError, Math::Length(instanceData[i].mPosition - Math::Mix(previous, current, interpolationFactor)));
+		}
+		instanceRegistry.ClearDirtyInstances();
+
+		simulationTime += gFrameTimes[frame % std::size(gFrameTimes)];
+		const Core::uint32 stepCount = static_cast<Core::uint32>(simulationTime / gFixedDeltaTime);
+		simulationTime -= static_cast<float>(stepCount) * gFixedDeltaTime;
+		interpolationFactor = std::clamp(simulationTime / gFixedDeltaTime, 0.0f, 1.0f);
+		tickCount += stepCount;
+
+		jobSystem.RunOnWorker([&scene, &simulationMicroseconds, &mainThreadSimulationCount, stepCount]()
+		{
+			if (JobSystem::GetThreadIndex() == 0)
+			{
+				mainThreadSimulationCount++;
+			}
+
+			Time::Timer timer;
+			timer.StartTimer();
+			for (Core::uint32 i = 0; i < stepCount; i++)
+			{
+				scene.FixedUpdate(gFixedDeltaTime);
+			}
+			timer.EndTimer();
+			simulationMicroseconds += timer.GetDurationMicroseconds();
+		}, &simulationCounter);
+
+		// Stands in for recording the frame, its wait would run the simulation inline if the main thread could pick it up
+		jobSystem.ParallelFor(gRecordBatchCount, [&batchHeights, &instanceData](Core::uint32 aIndex)
+		{
+			float height = 0.0f;
+			for (Core::size i = aIndex; i < instanceData.size(); i += gRecordBatchCount)
+			{
+				height = std::max(height, instanceData[i].mPosition.y);
+			}
+			batchHeights[aIndex] = height;
+		});
+
+		mainThreadTimer.EndTimer();
+		mainThreadMicroseconds += mainThreadTimer.GetDurationMicroseconds();
+	}
+
+	jobSystem.Wait(simulationCounter);
+
+	std::cout << std::format("{} ticks, {:.3f} ms per tick, {:.3f} ms per frame on the main thread", tickCount, simulationMicroseconds / 1000.0 / static_cast<double>(std::max<Core::uint64>(tickCount, 1)), mainThreadMicroseconds / 1000.0 / gFrameCount) << std::endl;
+	std::cout << std::format("Largest distance of a drawn instance from its interpolated position: {}", maxError) << std::endl;
+	std::cout << std::format("Simulation jobs run on the main thread: {}", mainThreadSimulationCount.load()) << std::endl;
+
+	return (maxError <= gTolerance && mainThreadSimulationCount == 0) ? 0 : 1;
+}
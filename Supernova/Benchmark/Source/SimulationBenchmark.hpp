@@ -0,0 +1,5 @@
+#pragma once
+
+// Runs the fixed update of a scene of oscillating instances the way Engine::Run does when the simulation is threaded, and times the ticks.
+// Checks that InstanceRegistry draws every instance between its last two ticks, and that the simulation job never runs on the main thread.
+int RunSimulationBenchmark();
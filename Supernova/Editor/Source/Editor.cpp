@@ -1,14 +1,16 @@
 #include "Engine.hpp"
 
 #include <iostream>
+#include <span>
 #include <stdexcept>
 
-int main(const int /*argc*/, const char* /*argv*/[])
+int main(const int argc, const char* argv[])
 {
 	Engine engine;
 
 	try
 	{
+		engine.ParseCommandLine(std::span<const char* const>(argv, argc));
 		engine.Start();
 		engine.Run();
 	}
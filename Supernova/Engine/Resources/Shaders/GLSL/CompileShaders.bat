@@ -37,12 +37,14 @@ for /R %%f in (*.vert) do (
         %GLSLANG_VALIDATOR% -V "!FRAG_PATH!" -o "!DIR!!BASENAME!_frag.spv"
     )
 
-    set "COMP_PATH=!DIR!!BASENAME!.comp"
+)
 
-    if exist "!COMP_PATH!" (
-        :: Compile comp shader
-        %GLSLANG_VALIDATOR% -V "!COMP_PATH!" -o "!DIR!!BASENAME!_comp.spv"
-    )
+:: Recursively find all .comp files, compute shaders don't need a matching .vert
+for /R %%f in (*.comp) do (
+    echo Compiling compute shader %%~dpnf...
+
+    :: Compile comp shader
+    %GLSLANG_VALIDATOR% -V "%%f" -o "%%~dpnf_comp.spv"
 )
 
 echo Finished compiling shaders.
@@ -1,7 +1,9 @@
 #version 460
 
+#extension GL_GOOGLE_include_directive : require
+
 layout (location = 0) in vec4 inPos;
-layout (location = 1) in vec3 inNormal;
+layout (location = 1) in vec2 inNormal;
 layout (location = 2) in vec3 inColor;
 
 layout (location = 3) in vec3 instancePos;
@@ -28,10 +30,12 @@ out gl_PerVertex
 	vec4 gl_Position;
 };
 
+#include "../Common/Octahedral.glsl"
+
 void main() 
 {
 	outColor = inColor;
-	outNormal = inNormal;
+	outNormal = OctDecode(inNormal);
 	
 	vec4 pos = vec4((inPos.xyz * instanceScale) + instancePos, 1.0);
 
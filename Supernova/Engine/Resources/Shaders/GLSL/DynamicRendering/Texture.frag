@@ -1,18 +1,44 @@
 #version 460
 
-layout (set = 1, binding = 0) uniform sampler2D samplerColor;
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Same layout as vkglTF::MaterialData
+struct Material
+{
+	vec4 baseColorFactor;
+	uint baseColorTexture;
+	uint normalTexture;
+	float alphaCutoff;
+	uint alphaMode;
+};
+
+const uint NO_TEXTURE = 0xFFFFFFFFu;
+
+layout (set = 1, binding = 0) uniform sampler2D textures[];
+
+layout (set = 1, binding = 1, std430) readonly buffer Materials
+{
+	Material materials[];
+};
 
 layout (location = 0) in vec2 inUV;
 layout (location = 1) in vec3 inNormal;
 layout (location = 2) in vec3 inViewVec;
 layout (location = 3) in vec3 inLightVec;
 layout (location = 4) in float inLightIntensity;
+layout (location = 5) flat in uint inMaterialIndex;
 
 layout (location = 0) out vec4 outFragColor;
 
 void main() 
 {
-	vec4 color = texture(samplerColor, inUV) * inLightIntensity;
+	Material material = materials[inMaterialIndex];
+	vec4 color = material.baseColorFactor;
+	if (material.baseColorTexture != NO_TEXTURE)
+	{
+		color *= texture(textures[nonuniformEXT(material.baseColorTexture)], inUV);
+	}
+	color *= inLightIntensity;
 
 	vec3 N = normalize(inNormal);
 	vec3 L = normalize(inLightVec);
@@ -1,7 +1,9 @@
 #version 460
 
+#extension GL_GOOGLE_include_directive : require
+
 layout (location = 0) in vec3 inPos;
-layout (location = 1) in vec3 inNormal;
+layout (location = 1) in vec2 inNormal;
 layout (location = 2) in vec2 inUV;
 
 layout (binding = 0) uniform UBO 
@@ -16,6 +18,7 @@ layout (binding = 0) uniform UBO
 layout (push_constant) uniform Push
 {
 	mat4 model;
+	uint materialIndex; // Slot in the material buffer, pushed before every draw
 } push;
 
 layout (location = 0) out vec2 outUV;
@@ -23,16 +26,20 @@ layout (location = 1) out vec3 outNormal;
 layout (location = 2) out vec3 outViewVec;
 layout (location = 3) out vec3 outLightVec;
 layout (location = 4) out float outLightIntensity;
+layout (location = 5) flat out uint outMaterialIndex;
+
+#include "../Common/Octahedral.glsl"
 
 void main() 
 {
 	outUV = inUV;
+	outMaterialIndex = push.materialIndex;
 
 	mat4 modelView = (ubo.view * push.model);
 	gl_Position = ubo.projection * modelView * vec4(inPos.xyz, 1.0);
 
 	vec4 pos = modelView * vec4(inPos, 1.0);
-	outNormal = mat3(inverse(transpose(modelView))) * inNormal;
+	outNormal = mat3(inverse(transpose(modelView))) * OctDecode(inNormal);
 	vec3 lPos = mat3(modelView) * ubo.lightPos.xyz;
 	outLightVec = lPos - pos.xyz;
 	outViewVec = ubo.viewPos.xyz - pos.xyz;
@@ -1,7 +1,9 @@
 #version 460
 
+#extension GL_GOOGLE_include_directive : require
+
 layout (location = 0) in vec3 inPos;
-layout (location = 1) in vec3 inNormal;
+layout (location = 1) in vec2 inNormal;
 layout (location = 2) in vec2 inUV;
 layout (location = 3) in vec3 inColor;
 
@@ -27,6 +29,8 @@ layout (location = 3) out vec3 outViewVec;
 layout (location = 4) out vec3 outLightVec;
 layout (location = 5) out float outLightIntensity;
 
+#include "../Common/Octahedral.glsl"
+
 void main() 
 {
 	outColor = inColor;
@@ -36,7 +40,7 @@ void main()
 	gl_Position = ubo.projection * modelView * vec4(inPos.xyz, 1.0);
 	
 	vec4 pos = modelView * vec4(inPos, 1.0);
-	outNormal = mat3(modelView) * inNormal;
+	outNormal = mat3(modelView) * OctDecode(inNormal);
 	vec3 lPos = mat3(modelView) * ubo.lightPos.xyz;
 	outLightVec = lPos - pos.xyz;
 	outViewVec = ubo.viewPos.xyz - pos.xyz;
@@ -0,0 +1,183 @@
+#include "BenchmarkReport.hpp"
+
+#include "Core/Types.hpp"
+#include "Graphics/VulkanTypes.hpp"
+#include "Profiler/SimpleSampler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <format>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+
+namespace BenchmarkReportLocal
+{
+	static constexpr std::array<double, 6> gPercentileRanks{0.0, 50.0, 90.0, 95.0, 99.0, 100.0};
+	static constexpr std::array<std::string_view, 6> gPercentileNames{"min", "p50", "p90", "p95", "p99", "max"};
+
+	static void WriteString(std::ostream& aStream, std::string_view aString)
+	{
+		aStream << '"';
+		for (const char c : aString)
+		{
+			if (c == '"' || c == '\\')
+			{
+				aStream << '\\' << c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20u)
+			{
+				aStream << ' ';
+			}
+			else
+			{
+				aStream << c;
+			}
+		}
+		aStream << '"';
+	}
+
+	static Core::uint32 GetInstanceCount(const IndirectDrawInfo& aDrawInfo)
+	{
+		return std::accumulate(std::begin(aDrawInfo.mLoDCount), std::end(aDrawInfo.mLoDCount), 0u);
+	}
+
+	static std::optional<double> GetGpuTimeMs(const FrameStatistics& aFrame)
+	{
+		return aFrame.mHasGpuTime ? std::optional<double>{aFrame.mGpuComputeTimeMs + aFrame.mGpuGraphicsTimeMs} : std::nullopt;
+	}
+
+	// Average and nearest rank percentiles over the frames that have the value, null when none of them has it
+	template<typename GetValueFunction>
+	static void WriteSummary(std::ostream& aStream, std::string_view aName, std::span<const FrameStatistics> aFrames, GetValueFunction aGetValue)
+	{
+		Sampler sampler(std::max<Core::size>(aFrames.size(), 1));
+		for (const FrameStatistics& frame : aFrames)
+		{
+			if (const std::optional<double> value = aGetValue(frame))
+			{
+				sampler.Record(static_cast<float>(*value));
+			}
+		}
+
+		aStream << "\t\t";
+		WriteString(aStream, aName);
+		if (sampler.Size() == 0)
+		{
+			aStream << ": null";
+			return;
+		}
+
+		std::array<double, gPercentileRanks.size()> percentiles{};
+		sampler.GetPercentiles(gPercentileRanks, percentiles);
+
+		aStream << ": {\"avg\": " << sampler.GetAverage();
+		for (Core::size i = 0; i < percentiles.size(); i++)
+		{
+			aStream << ", ";
+			WriteString(aStream, gPercentileNames[i]);
+			aStream << ": " << percentiles[i];
+		}
+		aStream << "}";
+	}
+
+	static void WriteFrame(std::ostream& aStream, const FrameStatistics& aFrame)
+	{
+		aStream << "\t\t{\"frame\": " << aFrame.mFrameNumber
+			<< ", \"frameTimeMs\": " << aFrame.mFrameTimeMs
+			<< ", \"renderCpuTimeMs\": " << aFrame.mRenderCpuTimeMs;
+
+		if (aFrame.mHasGpuTime)
+		{
+			aStream << ", \"gpuComputeTimeMs\": " << aFrame.mGpuComputeTimeMs << ", \"gpuGraphicsTimeMs\": " << aFrame.mGpuGraphicsTimeMs;
+		}
+		else
+		{
+			aStream << ", \"gpuComputeTimeMs\": null, \"gpuGraphicsTimeMs\": null";
+		}
+
+		aStream << ", \"drawCount\": " << aFrame.mEarlyDrawInfo.mDrawCount + aFrame.mLateDrawInfo.mDrawCount
+			<< ", \"lateDrawCount\": " << aFrame.mLateDrawInfo.mDrawCount
+			<< ", \"lodInstanceCounts\": [";
+		for (Core::size lod = 0; lod < std::size(aFrame.mEarlyDrawInfo.mLoDCount); lod++)
+		{
+			aStream << (lod > 0 ? ", " : "") << aFrame.mEarlyDrawInfo.mLoDCount[lod] + aFrame.mLateDrawInfo.mLoDCount[lod];
+		}
+
+		aStream << "], \"visibleMeshlets\": " << aFrame.mVisibleMeshletCount
+			<< ", \"deviceLocalBytes\": " << aFrame.mDeviceLocalBytes
+			<< ", \"hostVisibleBytes\": " << aFrame.mHostVisibleBytes
+			<< ", \"reservedBytes\": " << aFrame.mReservedBytes << "}";
+	}
+}
+
+namespace BenchmarkReport
+{
+	void Write(const std::filesystem::path& aPath, const RunInfo& aRunInfo, std::span<const FrameStatistics> aFrames)
+	{
+		std::ofstream file(aPath);
+		if (!file)
+		{
+			throw std::runtime_error(std::format("Could not write benchmark report {}", aPath.string()));
+		}
+
+		file << std::fixed << std::setprecision(4);
+
+		file << "{\n\t\"scene\": ";
+		BenchmarkReportLocal::WriteString(file, aRunInfo.mSceneName);
+		file << ",\n\t\"cameraPath\": ";
+		BenchmarkReportLocal::WriteString(file, aRunInfo.mCameraPath.filename().string());
+		file << ",\n\t\"device\": ";
+		BenchmarkReportLocal::WriteString(file, aRunInfo.mDeviceName);
+		file << ",\n\t\"width\": " << aRunInfo.mWidth
+			<< ",\n\t\"height\": " << aRunInfo.mHeight
+			<< ",\n\t\"tickRate\": " << aRunInfo.mFixedTickRate
+			<< ",\n\t\"cpuCulling\": " << (aRunInfo.mIsCpuCullingEnabled ? "true" : "false")
+			<< ",\n\t\"frameCount\": " << aFrames.size();
+
+		VkDeviceSize peakDeviceLocalBytes = 0;
+		VkDeviceSize peakHostVisibleBytes = 0;
+		VkDeviceSize peakReservedBytes = 0;
+		for (const FrameStatistics& frame : aFrames)
+		{
+			peakDeviceLocalBytes = std::max(peakDeviceLocalBytes, frame.mDeviceLocalBytes);
+			peakHostVisibleBytes = std::max(peakHostVisibleBytes, frame.mHostVisibleBytes);
+			peakReservedBytes = std::max(peakReservedBytes, frame.mReservedBytes);
+		}
+
+		file << ",\n\t\"summary\": {\n";
+		BenchmarkReportLocal::WriteSummary(file, "frameTimeMs", aFrames, [](const FrameStatistics& aFrame) { return std::optional<double>{aFrame.mFrameTimeMs}; });
+		file << ",\n";
+		BenchmarkReportLocal::WriteSummary(file, "renderCpuTimeMs", aFrames, [](const FrameStatistics& aFrame) { return std::optional<double>{aFrame.mRenderCpuTimeMs}; });
+		file << ",\n";
+		BenchmarkReportLocal::WriteSummary(file, "gpuTimeMs", aFrames, BenchmarkReportLocal::GetGpuTimeMs);
+		file << ",\n";
+		BenchmarkReportLocal::WriteSummary(file, "drawCount", aFrames, [](const FrameStatistics& aFrame) { return std::optional<double>{static_cast<double>(aFrame.mEarlyDrawInfo.mDrawCount + aFrame.mLateDrawInfo.mDrawCount)}; });
+		file << ",\n";
+		BenchmarkReportLocal::WriteSummary(file, "visibleInstances", aFrames, [](const FrameStatistics& aFrame) { return std::optional<double>{static_cast<double>(BenchmarkReportLocal::GetInstanceCount(aFrame.mEarlyDrawInfo) + BenchmarkReportLocal::GetInstanceCount(aFrame.mLateDrawInfo))}; });
+		file << ",\n";
+		BenchmarkReportLocal::WriteSummary(file, "visibleMeshlets", aFrames, [](const FrameStatistics& aFrame) { return std::optional<double>{static_cast<double>(aFrame.mVisibleMeshletCount)}; });
+		file << ",\n\t\t\"peakDeviceLocalBytes\": " << peakDeviceLocalBytes
+			<< ",\n\t\t\"peakHostVisibleBytes\": " << peakHostVisibleBytes
+			<< ",\n\t\t\"peakReservedBytes\": " << peakReservedBytes
+			<< "\n\t},\n\t\"frames\": [\n";
+
+		for (Core::size i = 0; i < aFrames.size(); i++)
+		{
+			BenchmarkReportLocal::WriteFrame(file, aFrames[i]);
+			file << (i + 1 < aFrames.size() ? ",\n" : "\n");
+		}
+
+		file << "\t]\n}\n";
+
+		if (!file)
+		{
+			throw std::runtime_error(std::format("Could not write benchmark report {}", aPath.string()));
+		}
+	}
+}
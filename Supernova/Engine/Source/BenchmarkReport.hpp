@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Core/Types.hpp"
+#include "Graphics/VulkanTypes.hpp"
+
+#include <filesystem>
+#include <span>
+#include <string>
+
+namespace BenchmarkReport
+{
+	// What was benchmarked, so reports of different runs can be told apart
+	struct RunInfo
+	{
+		RunInfo() : mWidth{0}, mHeight{0}, mFixedTickRate{0.0f}, mIsCpuCullingEnabled{false} {}
+
+		std::string mSceneName;
+		std::string mDeviceName;
+		std::filesystem::path mCameraPath;
+		Core::uint32 mWidth;
+		Core::uint32 mHeight;
+		float mFixedTickRate; // The camera path advances by one tick per frame
+		bool mIsCpuCullingEnabled; // Whether the instances were culled on the CPU or by the cull shader
+	};
+
+	// Writes a summary (average and percentiles of every metric) followed by the statistics of each frame as JSON
+	// Throws std::runtime_error when the file can't be written
+	void Write(const std::filesystem::path& aPath, const RunInfo& aRunInfo, std::span<const FrameStatistics> aFrames);
+}
@@ -0,0 +1,77 @@
+#include "CameraPath.hpp"
+
+#include "Math/Functions.hpp"
+#include "Math/Types.hpp"
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+void CameraPath::Load(const std::filesystem::path& aPath)
+{
+	std::ifstream file(aPath);
+	if (!file.is_open())
+	{
+		throw std::runtime_error(std::format("Could not open camera path {}", aPath.string()));
+	}
+
+	mKeyframes.clear();
+
+	std::string line;
+	for (int lineNumber = 1; std::getline(file, line); lineNumber++)
+	{
+		line = line.substr(0, line.find('#'));
+		if (line.find_first_not_of(" \t\r") == std::string::npos)
+		{
+			continue;
+		}
+
+		std::istringstream stream(line);
+		Keyframe keyframe;
+		stream >> keyframe.mTime >> keyframe.mPosition.x >> keyframe.mPosition.y >> keyframe.mPosition.z >> keyframe.mRotation.x >> keyframe.mRotation.y >> keyframe.mRotation.z;
+
+		std::string remainder;
+		if (stream.fail() || (stream >> remainder))
+		{
+			throw std::runtime_error(std::format("{}({}): expected time, position and rotation", aPath.string(), lineNumber));
+		}
+
+		if (!mKeyframes.empty() && keyframe.mTime <= mKeyframes.back().mTime)
+		{
+			throw std::runtime_error(std::format("{}({}): keyframe times have to increase", aPath.string(), lineNumber));
+		}
+
+		mKeyframes.push_back(keyframe);
+	}
+
+	if (mKeyframes.empty())
+	{
+		throw std::runtime_error(std::format("Camera path {} has no keyframes", aPath.string()));
+	}
+}
+
+void CameraPath::Sample(float aTime, Math::Vector3f& aPosition, Math::Vector3f& aRotation) const
+{
+	if (mKeyframes.empty())
+	{
+		return;
+	}
+
+	// First keyframe that lies after the time
+	const auto next = std::upper_bound(mKeyframes.begin(), mKeyframes.end(), aTime, [](float aValue, const Keyframe& aKeyframe) { return aValue < aKeyframe.mTime; });
+	if (next == mKeyframes.begin() || next == mKeyframes.end())
+	{
+		const Keyframe& keyframe = (next == mKeyframes.begin()) ? mKeyframes.front() : mKeyframes.back();
+		aPosition = keyframe.mPosition;
+		aRotation = keyframe.mRotation;
+		return;
+	}
+
+	const Keyframe& previous = *(next - 1);
+	const float factor = (aTime - previous.mTime) / (next->mTime - previous.mTime);
+	aPosition = Math::Mix(previous.mPosition, next->mPosition, factor);
+	aRotation = Math::Mix(previous.mRotation, next->mRotation, factor);
+}
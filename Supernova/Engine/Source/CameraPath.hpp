@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Math/Types.hpp"
+
+#include <filesystem>
+#include <vector>
+
+// Recorded camera positions and rotations, played back through Camera::SetPosition and Camera::SetRotation
+class CameraPath
+{
+public:
+	struct Keyframe
+	{
+		Keyframe() : mTime{0.0f}, mPosition{0.0f}, mRotation{0.0f} {}
+
+		float mTime; // Seconds since the start of the path
+		Math::Vector3f mPosition;
+		Math::Vector3f mRotation; // Euler angles in degrees, as used by Camera
+	};
+
+	// One keyframe per line: time, position x y z, rotation x y z, with '#' starting a comment
+	// Keyframes must be in increasing time order, throws std::runtime_error otherwise or when the file can't be read
+	void Load(const std::filesystem::path& aPath);
+
+	void Sample(float aTime, Math::Vector3f& aPosition, Math::Vector3f& aRotation) const; // Interpolates linearly, holding the first and last keyframe outside of the path
+
+	float GetDuration() const { return mKeyframes.empty() ? 0.0f : mKeyframes.back().mTime; }
+	bool IsEmpty() const { return mKeyframes.empty(); }
+
+private:
+	std::vector<Keyframe> mKeyframes;
+};
@@ -48,11 +48,62 @@ namespace ECS
 		glm::vec3 mScale = {1.0f, 1.0f, 1.0f};
 	};
 
+	// Transform of the previous simulation tick, the renderer draws the entity in between it and the TransformComponent
+	// Scene::FixedUpdate copies the TransformComponent into it before every tick
+	struct InterpolationComponent
+	{
+		InterpolationComponent() = default;
+		InterpolationComponent(const InterpolationComponent&) = default;
+		InterpolationComponent(const TransformComponent& aTransform)
+			: mPreviousPosition(aTransform.mPosition)
+			, mPreviousRotation(aTransform.mRotation)
+			, mPreviousScale(aTransform.mScale)
+		{
+		}
+
+		glm::vec3 mPreviousPosition = {0.0f, 0.0f, 0.0f};
+		glm::vec3 mPreviousRotation = {0.0f, 0.0f, 0.0f};
+		glm::vec3 mPreviousScale = {1.0f, 1.0f, 1.0f};
+	};
+
+	// Swings the entity around mOrigin along mAmplitude, moved by ECS::UpdateOscillations once per simulation tick
+	struct OscillationComponent
+	{
+		OscillationComponent() = default;
+		OscillationComponent(const OscillationComponent&) = default;
+		OscillationComponent(const glm::vec3& aOrigin, const glm::vec3& aAmplitude, float aAngularFrequency, float aPhase)
+			: mOrigin(aOrigin)
+			, mAmplitude(aAmplitude)
+			, mAngularFrequency(aAngularFrequency)
+			, mPhase(aPhase)
+		{
+		}
+
+		glm::vec3 mOrigin = {0.0f, 0.0f, 0.0f};
+		glm::vec3 mAmplitude = {0.0f, 0.0f, 0.0f};
+		float mAngularFrequency = 0.0f; // Radians per second
+		float mPhase = 0.0f; // Radians, advanced every tick
+	};
+
+	// Drawn by the GPU-driven instanced path, which only uses the position and the X scale of the transform
+	// Transform changes are picked up when they are made through Entity::ReplaceComponent
+	struct InstancedMeshComponent
+	{
+		InstancedMeshComponent() = default;
+		InstancedMeshComponent(const InstancedMeshComponent&) = default;
+		InstancedMeshComponent(UniqueIdentifier aModelIdentifier)
+			: mModelIdentifier(aModelIdentifier)
+		{
+		}
+
+		UniqueIdentifier mModelIdentifier;
+	};
+
 	template<typename... Component>
 	struct ComponentGroup
 	{
 	};
 
 	using AllComponents =
-		ComponentGroup<TransformComponent>;
+		ComponentGroup<TransformComponent, InterpolationComponent, OscillationComponent, InstancedMeshComponent>;
 }
@@ -41,6 +41,13 @@ namespace ECS
 		return component;
 	}
 
+	template<typename T>
+	T& Entity::ReplaceComponent(const T& aComponent)
+	{
+		assert(HasComponent<T>());
+		return mScene->GetEntityContainer()->mRegistry.replace<T>(mEntityHandle, aComponent);
+	}
+
 	template<typename T>
 	T& Entity::GetComponent()
 	{
@@ -92,4 +99,27 @@ namespace ECS
 	{
 		return mEntityHandle == aOther.mEntityHandle && mScene == aOther.mScene;
 	}
+
+	// The templates are defined in this file, so the ones used by other files are instantiated here
+	template IdentifierComponent& Entity::AddComponent<IdentifierComponent, UniqueIdentifier&>(UniqueIdentifier&);
+	template TransformComponent& Entity::AddComponent<TransformComponent>();
+	template TagComponent& Entity::AddComponent<TagComponent>();
+	template InstancedMeshComponent& Entity::AddComponent<InstancedMeshComponent, UniqueIdentifier&>(UniqueIdentifier&);
+	template InterpolationComponent& Entity::AddComponent<InterpolationComponent, TransformComponent&>(TransformComponent&);
+	template OscillationComponent& Entity::AddComponent<OscillationComponent, OscillationComponent&>(OscillationComponent&);
+	template TransformComponent& Entity::AddOrReplaceComponent<TransformComponent, TransformComponent&>(TransformComponent&);
+	template InstancedMeshComponent& Entity::AddOrReplaceComponent<InstancedMeshComponent, InstancedMeshComponent&>(InstancedMeshComponent&);
+	template InterpolationComponent& Entity::AddOrReplaceComponent<InterpolationComponent, InterpolationComponent&>(InterpolationComponent&);
+	template OscillationComponent& Entity::AddOrReplaceComponent<OscillationComponent, OscillationComponent&>(OscillationComponent&);
+	template TransformComponent& Entity::ReplaceComponent<TransformComponent>(const TransformComponent&);
+	template TransformComponent& Entity::GetComponent<TransformComponent>();
+	template const TransformComponent& Entity::GetComponent<TransformComponent>() const;
+	template InstancedMeshComponent& Entity::GetComponent<InstancedMeshComponent>();
+	template InterpolationComponent& Entity::GetComponent<InterpolationComponent>();
+	template const InterpolationComponent& Entity::GetComponent<InterpolationComponent>() const;
+	template OscillationComponent& Entity::GetComponent<OscillationComponent>();
+	template const bool Entity::HasComponent<TransformComponent>() const;
+	template const bool Entity::HasComponent<InstancedMeshComponent>() const;
+	template const bool Entity::HasComponent<InterpolationComponent>() const;
+	template const bool Entity::HasComponent<OscillationComponent>() const;
 }
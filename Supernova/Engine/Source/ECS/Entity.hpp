@@ -28,6 +28,9 @@ namespace ECS
 		template<typename T, typename... Args>
 		T& AddOrReplaceComponent(Args&&... aArgs);
 
+		template<typename T>
+		T& ReplaceComponent(const T& aComponent);
+
 		template<typename T>
 		T& GetComponent();
 
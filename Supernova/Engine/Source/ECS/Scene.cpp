@@ -6,6 +6,7 @@
 #include "UniqueIdentifier.hpp"
 
 #include <string>
+#include <utility>
 
 namespace SceneLocal
 {
@@ -84,6 +85,27 @@ namespace ECS
 		return {};
 	}
 
+	void Scene::AddFixedUpdateSystem(FixedUpdateSystem aSystem)
+	{
+		mFixedUpdateSystems.push_back(std::move(aSystem));
+	}
+
+	void Scene::FixedUpdate(float aFixedDeltaTime)
+	{
+		// Interpolated entities are drawn between the transform the tick starts from and the one it ends with
+		for (auto [entity, transform, interpolation] : mEntityContainer->mRegistry.view<const TransformComponent, InterpolationComponent>().each())
+		{
+			interpolation.mPreviousPosition = transform.mPosition;
+			interpolation.mPreviousRotation = transform.mRotation;
+			interpolation.mPreviousScale = transform.mScale;
+		}
+
+		for (const FixedUpdateSystem& system : mFixedUpdateSystems)
+		{
+			system(*this, aFixedDeltaTime);
+		}
+	}
+
 	EntityContainer* Scene::GetEntityContainer()
 	{
 		return mEntityContainer;
@@ -116,6 +138,21 @@ namespace ECS
 	{
 	}
 
+	template<>
+	void Scene::OnComponentAdded<InterpolationComponent>(Entity /*aEntity*/, InterpolationComponent& /*aComponent*/)
+	{
+	}
+
+	template<>
+	void Scene::OnComponentAdded<OscillationComponent>(Entity /*aEntity*/, OscillationComponent& /*aComponent*/)
+	{
+	}
+
+	template<>
+	void Scene::OnComponentAdded<InstancedMeshComponent>(Entity /*aEntity*/, InstancedMeshComponent& /*aComponent*/)
+	{
+	}
+
 	template<>
 	void Scene::OnComponentAdded<TagComponent>(Entity /*aEntityaEntity*/, TagComponent& /*aComponent*/)
 	{
@@ -2,7 +2,9 @@
 
 #include "UniqueIdentifier.hpp"
 
+#include <functional>
 #include <string>
+#include <vector>
 
 namespace ECS
 {
@@ -14,6 +16,8 @@ namespace ECS
 		friend class Entity;
 
 	public:
+		using FixedUpdateSystem = std::function<void(Scene& aScene, float aFixedDeltaTime)>;
+
 		Scene();
 		~Scene();
 
@@ -23,6 +27,9 @@ namespace ECS
 		Entity DuplicateEntity(Entity aEntity);
 		Entity FindEntityByName(std::string_view aName);
 
+		void AddFixedUpdateSystem(FixedUpdateSystem aSystem); // Systems run once per simulation tick, in the order they were added
+		void FixedUpdate(float aFixedDeltaTime); // Runs one simulation tick, possibly on a job system thread, nothing else may use the scene meanwhile
+
 		template<typename... Components>
 		auto GetAllEntitiesWith();
 
@@ -35,5 +42,6 @@ namespace ECS
 
 	private:
 		EntityContainer* mEntityContainer;
+		std::vector<FixedUpdateSystem> mFixedUpdateSystems;
 	};
 }
@@ -0,0 +1,28 @@
+#include "Systems.hpp"
+
+#include "Components.hpp"
+#include "EntityContainer.hpp"
+#include "Scene.hpp"
+
+#include <cmath>
+#include <entt.hpp>
+#include <glm/gtc/constants.hpp>
+
+namespace ECS
+{
+	void UpdateOscillations(Scene& aScene, float aFixedDeltaTime)
+	{
+		entt::registry& registry = aScene.GetEntityContainer()->mRegistry;
+		const auto view = registry.view<TransformComponent, OscillationComponent>();
+		for (const entt::entity entity : view)
+		{
+			OscillationComponent& oscillation = view.get<OscillationComponent>(entity);
+
+			// Wrapped, so the phase keeps its precision however long the simulation runs
+			oscillation.mPhase = std::fmod(oscillation.mPhase + oscillation.mAngularFrequency * aFixedDeltaTime, glm::two_pi<float>());
+
+			const glm::vec3 position = oscillation.mOrigin + oscillation.mAmplitude * std::sin(oscillation.mPhase);
+			registry.patch<TransformComponent>(entity, [&position](TransformComponent& aTransform) { aTransform.mPosition = position; });
+		}
+	}
+}
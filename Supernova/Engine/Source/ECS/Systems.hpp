@@ -0,0 +1,10 @@
+#pragma once
+
+namespace ECS
+{
+	class Scene;
+
+	// Fixed update system, see Scene::AddFixedUpdateSystem
+	// Moves the entities with an OscillationComponent, their transforms are patched so the registry observers see the change
+	void UpdateOscillations(Scene& aScene, float aFixedDeltaTime);
+}
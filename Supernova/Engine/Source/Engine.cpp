@@ -1,29 +1,50 @@
 #include "Engine.hpp"
 
+#include "BenchmarkReport.hpp"
+#include "CameraPath.hpp"
+#include "Core/Types.hpp"
+#include "ECS/Scene.hpp"
+#include "ECS/Systems.hpp"
 #include "EngineProperties.hpp"
 #include "FileLoader.hpp"
 #include "Graphics/VulkanRenderer.hpp"
 #include "Graphics/Window.hpp"
+#include "JobSystem.hpp"
 #include "Profiler/SimpleProfiler.hpp"
 #include "Timer.hpp"
 
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <filesystem>
 #include <format>
 #include <iostream>
 #include <memory>
+#include <span>
+#include <stdexcept>
+#include <string_view>
 
 Engine::Engine()
 	: mEngineProperties{nullptr}
 	, mVulkanWindow{nullptr}
+	, mScene{nullptr}
+	, mJobSystem{nullptr}
 	, mVulkanRenderer{nullptr}
 	, mTimer{nullptr}
-	, mFixedDeltaTime{0.0f}
-	, mTimeScale{0.25f}
+	, mSimulationCounter{nullptr}
+	, mFrameCount{0}
 	, mDeltaTime{0.0f}
+	, mSimulationTime{0.0f}
+	, mInterpolationFactor{0.0f}
+	, mTimeScale{1.0f}
 {
 	mEngineProperties = std::make_shared<EngineProperties>();
 	mVulkanWindow = std::make_shared<Window>();
-	mVulkanRenderer = std::make_unique<VulkanRenderer>(mEngineProperties, mVulkanWindow);
+	mScene = std::make_shared<ECS::Scene>();
+	mJobSystem = std::make_shared<JobSystem>();
+	mVulkanRenderer = std::make_unique<VulkanRenderer>(mEngineProperties, mVulkanWindow, mScene, mJobSystem);
 	mTimer = std::make_unique<Time::Timer>();
+	mSimulationCounter = std::make_unique<JobCounter>();
 
 	mEngineProperties->mApplicationName = "Supernova Editor";
 	mEngineProperties->mEngineName = "Supernova Engine";
@@ -34,41 +55,237 @@ Engine::~Engine()
 {
 }
 
+namespace EngineLocal
+{
+	static std::string_view ParseString(std::string_view aOption, std::span<const char* const> aArguments, Core::size& aIndex)
+	{
+		if (aIndex + 1 >= aArguments.size())
+		{
+			throw std::runtime_error(std::format("Missing value for {}", aOption));
+		}
+
+		return aArguments[++aIndex];
+	}
+
+	static Core::uint32 ParseUnsigned(std::string_view aOption, std::span<const char* const> aArguments, Core::size& aIndex)
+	{
+		const std::string_view value = ParseString(aOption, aArguments, aIndex);
+		Core::uint32 result = 0;
+		const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+		if (error != std::errc{} || end != value.data() + value.size())
+		{
+			throw std::runtime_error(std::format("Invalid value {} for {}", value, aOption));
+		}
+
+		return result;
+	}
+}
+
+// --headless                  Render offscreen, without a window, needs --frames or --benchmark to ever stop
+// --width <pixels>            Resolution of the window or of the offscreen images
+// --height <pixels>
+// --frames <count>            Stop after this many frames
+// --dump-frames <directory>   Write the headless frames to the directory
+// --scene <name>              Scene to load, see VulkanRenderer::LoadAssets
+// --benchmark <camera path>   Play the camera path and report the statistics of every frame, the file is looked up in the engine resources when it doesn't exist
+// --benchmark-report <file>   Where the JSON report of the benchmark is written
+// --cpu-culling               Cull the instances on the CPU instead of with the cull shader
+void Engine::ParseCommandLine(std::span<const char* const> aArguments)
+{
+	int width = mVulkanWindow->GetWindowProperties().mWindowWidth;
+	int height = mVulkanWindow->GetWindowProperties().mWindowHeight;
+
+	// The first argument is the executable
+	for (Core::size i = 1; i < aArguments.size(); i++)
+	{
+		const std::string_view option = aArguments[i];
+		if (option == "--headless")
+		{
+			mEngineProperties->mIsHeadless = true;
+		}
+		else if (option == "--width")
+		{
+			width = static_cast<int>(EngineLocal::ParseUnsigned(option, aArguments, i));
+		}
+		else if (option == "--height")
+		{
+			height = static_cast<int>(EngineLocal::ParseUnsigned(option, aArguments, i));
+		}
+		else if (option == "--frames")
+		{
+			mEngineProperties->mFrameLimit = EngineLocal::ParseUnsigned(option, aArguments, i);
+		}
+		else if (option == "--dump-frames")
+		{
+			mEngineProperties->mFrameDumpDirectory = EngineLocal::ParseString(option, aArguments, i);
+		}
+		else if (option == "--scene")
+		{
+			mEngineProperties->mSceneName = EngineLocal::ParseString(option, aArguments, i);
+		}
+		else if (option == "--benchmark")
+		{
+			mEngineProperties->mBenchmarkCameraPath = EngineLocal::ParseString(option, aArguments, i);
+		}
+		else if (option == "--benchmark-report")
+		{
+			mEngineProperties->mBenchmarkReportPath = EngineLocal::ParseString(option, aArguments, i);
+		}
+		else if (option == "--cpu-culling")
+		{
+			mEngineProperties->mIsCpuCullingEnabled = true;
+		}
+		else
+		{
+			throw std::runtime_error(std::format("Unknown option {}", option));
+		}
+	}
+
+	// There is no window to close, so a headless run without either would never return
+	if (mEngineProperties->mIsHeadless && mEngineProperties->mFrameLimit == 0 && mEngineProperties->mBenchmarkCameraPath.empty())
+	{
+		throw std::runtime_error("--headless needs --frames or --benchmark");
+	}
+
+	mVulkanWindow->SetWindowSize(width, height);
+}
+
 void Engine::Start()
 {
 	std::cout << std::format("{} v{}.{}.{}", mEngineProperties->mEngineName, mEngineProperties->mEngineMajorVersion, mEngineProperties->mEngineMinorVersion, mEngineProperties->mEnginePatchVersion) << std::endl;
 
 	FileLoader::PrintWorkingDirectory();
 
-	mVulkanWindow->InitializeWindow(mEngineProperties->mApplicationName);
+	if (mEngineProperties->mIsHeadless)
+	{
+		mVulkanWindow->InitializeHeadless();
+	}
+	else
+	{
+		mVulkanWindow->InitializeWindow(mEngineProperties->mApplicationName);
+	}
+
+	mScene->AddFixedUpdateSystem(&ECS::UpdateOscillations);
 	mVulkanRenderer->InitializeRenderer();
+
+	if (!mEngineProperties->mBenchmarkCameraPath.empty())
+	{
+		std::filesystem::path cameraPathFile = mEngineProperties->mBenchmarkCameraPath;
+		if (!std::filesystem::exists(cameraPathFile))
+		{
+			cameraPathFile = FileLoader::GetEngineResourcesPath() / FileLoader::gCameraPathsPath / cameraPathFile;
+		}
+
+		std::unique_ptr<CameraPath> cameraPath = std::make_unique<CameraPath>();
+		cameraPath->Load(cameraPathFile);
+		mVulkanRenderer->StartBenchmark(std::move(cameraPath));
+	}
 }
 
 void Engine::Run()
 {
+	const bool isBenchmarking = !mEngineProperties->mBenchmarkCameraPath.empty();
+
 	mVulkanRenderer->PrepareUpdate();
+	mTimer->StartTimer();
 
 	while (!mVulkanWindow->ShouldClose())
 	{
+		// Collects the scopes of the previous frame from every thread, before this frame opens its own
+		SimpleProfiler::NewFrame();
 		SIMPLE_PROFILER_PROFILE_SCOPE("Engine::Run");
 
+		// The frame time spans the whole loop, including the wait for the simulation
+		mTimer->EndTimer();
+		mDeltaTime = static_cast<float>(mTimer->GetDurationSeconds());
 		mTimer->StartTimer();
 
-		mVulkanRenderer->UpdateRenderer(mDeltaTime);
+		// Benchmarks simulate one tick per frame, so the scene moves the same way on every run
+		const float fixedDeltaTime = 1.0f / mEngineProperties->mFixedTickRate;
+		const float simulationDeltaTime = isBenchmarking ? fixedDeltaTime : mDeltaTime;
+		if (mEngineProperties->mIsSimulationThreaded)
+		{
+			// The frame draws the ticks simulated during the previous frame, and the scene is simulated further while it renders
+			mJobSystem->Wait(*mSimulationCounter);
+			mVulkanRenderer->ExtractScene(mInterpolationFactor);
 
-		mTimer->EndTimer();
+			// Kept off this thread, otherwise the renderer's own waits could pick it up and run the whole simulation inline
+			const Core::uint32 stepCount = AdvanceSimulationTime(simulationDeltaTime);
+			mJobSystem->RunOnWorker([this, stepCount, fixedDeltaTime]() { Simulate(stepCount, fixedDeltaTime); }, mSimulationCounter.get());
+		}
+		else
+		{
+			Simulate(AdvanceSimulationTime(simulationDeltaTime), fixedDeltaTime);
+			mVulkanRenderer->ExtractScene(mInterpolationFactor);
+		}
 
-		mDeltaTime = static_cast<float>(mTimer->GetDurationSeconds());
+		mVulkanRenderer->UpdateRenderer(mDeltaTime);
 
-		if (!mEngineProperties->mIsPaused)
+		mFrameCount++;
+		if ((mEngineProperties->mFrameLimit > 0 && mFrameCount >= mEngineProperties->mFrameLimit) || mVulkanRenderer->IsBenchmarkFinished())
 		{
-			mFixedDeltaTime += mTimeScale * mDeltaTime;
-			if (mFixedDeltaTime > 1.0f)
-			{
-				mFixedDeltaTime -= 1.0f;
-			}
+			mVulkanWindow->Close();
 		}
 	}
 
+	mJobSystem->Wait(*mSimulationCounter);
 	mVulkanRenderer->EndUpdate();
+
+	if (isBenchmarking)
+	{
+		WriteBenchmarkReport();
+	}
+}
+
+void Engine::WriteBenchmarkReport() const
+{
+	BenchmarkReport::RunInfo runInfo;
+	runInfo.mSceneName = mEngineProperties->mSceneName;
+	runInfo.mDeviceName = mVulkanRenderer->GetDeviceName();
+	runInfo.mCameraPath = mEngineProperties->mBenchmarkCameraPath;
+	runInfo.mWidth = static_cast<Core::uint32>(mVulkanWindow->GetWindowProperties().mWindowWidth);
+	runInfo.mHeight = static_cast<Core::uint32>(mVulkanWindow->GetWindowProperties().mWindowHeight);
+	runInfo.mFixedTickRate = mEngineProperties->mFixedTickRate;
+	runInfo.mIsCpuCullingEnabled = mEngineProperties->mIsCpuCullingEnabled;
+
+	const std::span<const FrameStatistics> frames = mVulkanRenderer->GetFrameStatistics();
+	BenchmarkReport::Write(mEngineProperties->mBenchmarkReportPath, runInfo, frames);
+
+	std::cout << std::format("Wrote the statistics of {} frames to {}", frames.size(), mEngineProperties->mBenchmarkReportPath.string()) << std::endl;
+}
+
+Core::uint32 Engine::AdvanceSimulationTime(float aDeltaTime)
+{
+	if (mEngineProperties->mIsPaused)
+	{
+		return 0;
+	}
+
+	const float fixedDeltaTime = 1.0f / mEngineProperties->mFixedTickRate;
+	mSimulationTime += mTimeScale * aDeltaTime;
+
+	Core::uint32 stepCount = static_cast<Core::uint32>(mSimulationTime / fixedDeltaTime);
+	if (stepCount > mEngineProperties->mMaxFixedStepsPerFrame)
+	{
+		// Time the simulation can't catch up on is dropped, it runs slower instead of taking longer every frame
+		stepCount = mEngineProperties->mMaxFixedStepsPerFrame;
+		mSimulationTime = std::fmod(mSimulationTime, fixedDeltaTime);
+	}
+	else
+	{
+		mSimulationTime -= static_cast<float>(stepCount) * fixedDeltaTime;
+	}
+
+	mInterpolationFactor = std::clamp(mSimulationTime / fixedDeltaTime, 0.0f, 1.0f);
+	return stepCount;
+}
+
+void Engine::Simulate(Core::uint32 aStepCount, float aFixedDeltaTime)
+{
+	SIMPLE_PROFILER_PROFILE_SCOPE("Engine::Simulate");
+
+	for (Core::uint32 i = 0; i < aStepCount; i++)
+	{
+		mScene->FixedUpdate(aFixedDeltaTime);
+	}
 }
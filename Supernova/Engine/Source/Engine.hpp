@@ -1,6 +1,14 @@
 #pragma once
 
+#include "Core/Types.hpp"
+
 #include <memory>
+#include <span>
+
+namespace ECS
+{
+	class Scene;
+}
 
 namespace Time
 {
@@ -8,6 +16,8 @@ namespace Time
 }
 
 struct EngineProperties;
+class JobCounter;
+class JobSystem;
 class Window;
 class VulkanRenderer;
 
@@ -17,15 +27,25 @@ public:
 	Engine();
 	~Engine();
 
+	void ParseCommandLine(std::span<const char* const> aArguments); // Throws std::runtime_error on unknown options and on headless runs without an end, see Engine.cpp for the options
 	void Start();
 	void Run();
 
 private:
+	Core::uint32 AdvanceSimulationTime(float aDeltaTime); // Returns the number of simulation ticks the frame time adds up to
+	void Simulate(Core::uint32 aStepCount, float aFixedDeltaTime);
+	void WriteBenchmarkReport() const;
+
 	std::shared_ptr<EngineProperties> mEngineProperties;
 	std::shared_ptr<Window> mVulkanWindow;
+	std::shared_ptr<ECS::Scene> mScene; // Declared before the renderer, which observes it until it's destroyed
+	std::shared_ptr<JobSystem> mJobSystem; // Outlives the renderer as well, which records its command buffers on it
 	std::unique_ptr<VulkanRenderer> mVulkanRenderer;
 	std::unique_ptr<Time::Timer> mTimer;
+	std::unique_ptr<JobCounter> mSimulationCounter; // Simulation of the next frame, when it runs alongside rendering
+	Core::uint32 mFrameCount; // Frames rendered by Run
 	float mDeltaTime;
-	float mFixedDeltaTime;
+	float mSimulationTime; // Time not simulated yet, always less than one tick
+	float mInterpolationFactor; // How far the rendered transforms are between the last two ticks
 	float mTimeScale;
 };
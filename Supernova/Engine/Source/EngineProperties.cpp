@@ -5,9 +5,17 @@ EngineProperties::EngineProperties()
 	, mEngineMajorVersion{0}
 	, mEngineMinorVersion{0}
 	, mEnginePatchVersion{0}
+	, mFixedTickRate{60.0f}
+	, mMaxFixedStepsPerFrame{5}
+	, mFrameLimit{0}
+	, mBenchmarkReportPath{"BenchmarkReport.json"}
+	, mSceneName{"Default"}
 	, mIsPaused{false}
 	, mIsRendererPrepared{false}
 	, mIsVSyncEnabled{false}
 	, mIsValidationEnabled{false}
+	, mIsSimulationThreaded{true}
+	, mIsHeadless{false}
+	, mIsCpuCullingEnabled{false}
 {
 }
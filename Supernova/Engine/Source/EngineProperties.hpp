@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <filesystem>
 #include <string>
 
 struct EngineProperties
@@ -14,8 +15,18 @@ struct EngineProperties
 	std::uint32_t mEngineMajorVersion;
 	std::uint32_t mEngineMinorVersion;
 	std::uint32_t mEnginePatchVersion;
+	float mFixedTickRate; // Simulation steps per second
+	std::uint32_t mMaxFixedStepsPerFrame; // Simulation time beyond this is dropped, so a slow frame can't make the next one slower
+	std::uint32_t mFrameLimit; // Frames Engine::Run renders before it returns, zero keeps it running until the window is closed
+	std::filesystem::path mFrameDumpDirectory; // Headless frames are written here as PPM images, nothing is written when it's empty
+	std::filesystem::path mBenchmarkCameraPath; // Camera path a benchmark plays back, no benchmark runs when it's empty
+	std::filesystem::path mBenchmarkReportPath; // JSON report of the benchmark, written when Engine::Run returns
+	std::string mSceneName; // Set of assets the renderer loads, see VulkanRenderer::LoadAssets
 	bool mIsPaused;
 	bool mIsRendererPrepared;
 	bool mIsVSyncEnabled;
 	bool mIsValidationEnabled;
+	bool mIsSimulationThreaded; // Simulates the next frame while the current one is rendered
+	bool mIsHeadless; // Renders into offscreen images, without a window, a surface or presentation
+	bool mIsCpuCullingEnabled; // Culls the instances on the CPU instead of with the cull shader
 };
@@ -41,4 +41,9 @@ namespace FileLoader
 	{
 		return std::filesystem::current_path().parent_path() / gEnginePath / gResourcesPath;
 	}
+
+	std::filesystem::path GetEngineCachePath()
+	{
+		return std::filesystem::current_path().parent_path() / gEnginePath / gCachePath;
+	}
 }
@@ -9,10 +9,13 @@ namespace FileLoader
 	void PrintWorkingDirectory();
 
 	std::filesystem::path GetEngineResourcesPath();
+	std::filesystem::path GetEngineCachePath();
 	static std::filesystem::path gEnginePath = "Engine/";
 	static std::filesystem::path gResourcesPath = "Resources/";
+	static std::filesystem::path gCachePath = "Cache/";
 	static std::filesystem::path gShadersPath = "Shaders/GLSL/";
 	static std::filesystem::path gFontPath = "Fonts/";
 	static std::filesystem::path gModelsPath = "Models/";
 	static std::filesystem::path gTexturesPath = "Textures/";
+	static std::filesystem::path gCameraPathsPath = "CameraPaths/";
 }
@@ -0,0 +1,223 @@
+#include "AnimationCompression.hpp"
+
+#include "Math/Functions.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+
+namespace AnimationCompressionLocal
+{
+	using InterpolationType = vkglTF::AnimationSampler::InterpolationType;
+	using PathType = vkglTF::AnimationChannel::PathType;
+
+	static float GetMaxError(PathType aPath)
+	{
+		switch (aPath)
+		{
+			case PathType::TRANSLATION:
+				return AnimationCompression::gMaxTranslationError;
+			case PathType::ROTATION:
+				return AnimationCompression::gMaxRotationError;
+			default:
+				return AnimationCompression::gMaxScaleError;
+		}
+	}
+
+	static Math::Quaternionf MakeQuaternion(const Math::Vector4f& aValue)
+	{
+		Math::Quaternionf quaternion{};
+		quaternion.x = aValue.x;
+		quaternion.y = aValue.y;
+		quaternion.z = aValue.z;
+		quaternion.w = aValue.w;
+		return quaternion;
+	}
+
+	// Distance between two values, the angle between two rotations
+	static float GetError(PathType aPath, const Math::Vector4f& aX, const Math::Vector4f& aY)
+	{
+		if (aPath == PathType::ROTATION)
+		{
+			const float dot = std::abs(Math::Dot(Math::Normalize(aX), Math::Normalize(aY)));
+			return 2.0f * std::acos(std::min(dot, 1.0f));
+		}
+
+		return Math::Length(Math::Vector3f{aX - aY});
+	}
+
+	// The way AnimationClip::Sample interpolates linear keys
+	static Math::Vector4f Interpolate(PathType aPath, const Math::Vector4f& aX, const Math::Vector4f& aY, float aFactor)
+	{
+		if (aPath == PathType::ROTATION)
+		{
+			const Math::Quaternionf rotation = Math::Slerp(MakeQuaternion(aX), MakeQuaternion(aY), aFactor);
+			return Math::Vector4f{rotation.x, rotation.y, rotation.z, rotation.w};
+		}
+
+		return Math::Mix(aX, aY, aFactor);
+	}
+
+	// Indices of the keys that are kept, tracks that don't change keep a single key
+	static std::vector<Core::uint32> ReduceKeys(const AnimationCompression::SourceSampler& aSampler)
+	{
+		const Core::uint32 keyCount = static_cast<Core::uint32>(aSampler.mTimes.size());
+		std::vector<Core::uint32> keys;
+		if (aSampler.mInterpolation == InterpolationType::CUBICSPLINE)
+		{
+			for (Core::uint32 i = 0; i < keyCount; i++)
+			{
+				keys.push_back(i);
+			}
+			return keys;
+		}
+
+		const PathType path = aSampler.mPath;
+		const float maxError = GetMaxError(path);
+		const std::vector<float>& times = aSampler.mTimes;
+		const std::vector<Math::Vector4f>& values = aSampler.mValues;
+
+		keys.push_back(0);
+		for (Core::uint32 i = 1; i + 1 < keyCount; i++)
+		{
+			const Core::uint32 previous = keys.back();
+			bool isNeeded = false;
+			if (aSampler.mInterpolation == InterpolationType::STEP)
+			{
+				isNeeded = GetError(path, values[i], values[previous]) > maxError;
+			}
+			else
+			{
+				// Without the key, the last kept key and the next key have to interpolate every key in between
+				for (Core::uint32 j = previous + 1; j <= i && !isNeeded; j++)
+				{
+					const float factor = (times[j] - times[previous]) / (times[i + 1] - times[previous]);
+					isNeeded = GetError(path, Interpolate(path, values[previous], values[i + 1], factor), values[j]) > maxError;
+				}
+			}
+
+			if (isNeeded)
+			{
+				keys.push_back(i);
+			}
+		}
+
+		if (keyCount > 1 && (keys.size() > 1 || GetError(path, values[keyCount - 1], values[0]) > maxError))
+		{
+			keys.push_back(keyCount - 1);
+		}
+
+		return keys;
+	}
+
+	static void EncodeSmallestThree(const Math::Vector4f& aRotation, std::vector<Core::uint16>& aValues)
+	{
+		Math::Vector4f rotation = Math::Normalize(aRotation);
+		Core::uint32 largest = 0;
+		for (Core::uint32 i = 1; i < 4; i++)
+		{
+			if (std::abs(rotation[i]) > std::abs(rotation[largest]))
+			{
+				largest = i;
+			}
+		}
+
+		// q and -q are the same rotation, so the largest component can always be positive
+		if (rotation[largest] < 0.0f)
+		{
+			rotation = -rotation;
+		}
+
+		Core::uint16 encoded[3];
+		for (Core::uint32 i = 0, j = 0; i < 4; i++)
+		{
+			if (i != largest)
+			{
+				const float normalized = std::clamp((rotation[i] + 0.70710678f) / 1.41421356f, 0.0f, 1.0f);
+				encoded[j++] = static_cast<Core::uint16>(std::lround(normalized * 32767.0f));
+			}
+		}
+
+		encoded[0] |= static_cast<Core::uint16>((largest & 1) << 15);
+		encoded[1] |= static_cast<Core::uint16>((largest >> 1) << 15);
+		aValues.insert(aValues.end(), std::begin(encoded), std::end(encoded));
+	}
+
+	static void EncodeRange(vkglTF::AnimationSampler& aSampler, const std::vector<Math::Vector4f>& aSource, std::vector<Core::uint16>& aValues)
+	{
+		Math::Vector4f min{std::numeric_limits<float>::max()};
+		Math::Vector4f max{std::numeric_limits<float>::lowest()};
+		for (const Math::Vector4f& value : aSource)
+		{
+			min = Math::Min(min, value);
+			max = Math::Max(max, value);
+		}
+
+		aSampler.mMin = min;
+		aSampler.mStep = (max - min) / 65535.0f;
+		for (const Math::Vector4f& value : aSource)
+		{
+			for (Core::uint32 i = 0; i < aSampler.mComponentCount; i++)
+			{
+				const float quantized = (aSampler.mStep[i] > 0.0f) ? (value[i] - min[i]) / aSampler.mStep[i] : 0.0f;
+				aValues.push_back(static_cast<Core::uint16>(std::lround(std::clamp(quantized, 0.0f, 65535.0f))));
+			}
+		}
+	}
+}
+
+namespace AnimationCompression
+{
+	void Compress(const std::vector<SourceSampler>& aSamplers, vkglTF::Animation& aAnimation)
+	{
+		using namespace AnimationCompressionLocal;
+
+		std::map<std::vector<float>, Core::uint32> timeOffsets;
+		for (const SourceSampler& source : aSamplers)
+		{
+			vkglTF::AnimationSampler& sampler = aAnimation.mSamplers.emplace_back();
+			sampler.mInterpolation = source.mInterpolation;
+			sampler.mComponentCount = (source.mPath == PathType::ROTATION) ? 4 : 3;
+
+			// Samplers without keys are kept so the channels can still index them, clips skip them
+			const Core::size valuesPerKey = (source.mInterpolation == InterpolationType::CUBICSPLINE) ? 3 : 1;
+			if (source.mTimes.empty() || source.mValues.size() < source.mTimes.size() * valuesPerKey)
+			{
+				continue;
+			}
+
+			std::vector<float> times;
+			std::vector<Math::Vector4f> values;
+			for (const Core::uint32 key : ReduceKeys(source))
+			{
+				times.push_back(source.mTimes[key]);
+				values.insert(values.end(), source.mValues.begin() + key * valuesPerKey, source.mValues.begin() + (key + 1) * valuesPerKey);
+			}
+
+			sampler.mKeyCount = static_cast<Core::uint32>(times.size());
+			const auto [timeOffset, isNewTimes] = timeOffsets.try_emplace(times, static_cast<Core::uint32>(aAnimation.mTimes.size()));
+			if (isNewTimes)
+			{
+				aAnimation.mTimes.insert(aAnimation.mTimes.end(), times.begin(), times.end());
+			}
+			sampler.mFirstTime = timeOffset->second;
+
+			// Tangents of cubic splines are no unit quaternions
+			sampler.mFirstValue = static_cast<Core::uint32>(aAnimation.mValues.size());
+			if (source.mPath == PathType::ROTATION && source.mInterpolation != InterpolationType::CUBICSPLINE)
+			{
+				sampler.mEncoding = vkglTF::AnimationSampler::Encoding::SmallestThree;
+				for (const Math::Vector4f& value : values)
+				{
+					EncodeSmallestThree(value, aAnimation.mValues);
+				}
+			}
+			else
+			{
+				sampler.mEncoding = vkglTF::AnimationSampler::Encoding::Range;
+				EncodeRange(sampler, values, aAnimation.mValues);
+			}
+		}
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Core/Types.hpp"
+#include "Math/Types.hpp"
+#include "VulkanGlTFTypes.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Load time compression of glTF animations into vkglTF::Animation.
+// Linear keys that the neighbouring keys interpolate to within an error are removed, and so are step keys that repeat the previous value.
+// Rotations are stored as the three smallest components of the quaternion in 15 bits each, the two bits left over name the largest one.
+// Every other value, including the tangents of cubic splines, is quantized to 16 bits within the range of its sampler.
+// Samplers whose remaining keys are at the same times share them.
+namespace AnimationCompression
+{
+	static constexpr float gMaxTranslationError = 0.0001f; // In model units
+	static constexpr float gMaxRotationError = 0.0001f; // In radians
+	static constexpr float gMaxScaleError = 0.0001f;
+
+	// Keyframes of a glTF sampler as they are stored in the file
+	struct SourceSampler
+	{
+		SourceSampler() : mInterpolation{vkglTF::AnimationSampler::InterpolationType::LINEAR}, mPath{vkglTF::AnimationChannel::PathType::TRANSLATION} {}
+
+		std::vector<float> mTimes;
+		std::vector<Math::Vector4f> mValues; // Three values per key for cubic splines, in tangent, value and out tangent
+		vkglTF::AnimationSampler::InterpolationType mInterpolation;
+		vkglTF::AnimationChannel::PathType mPath; // Of the channels that use the sampler
+	};
+
+	void Compress(const std::vector<SourceSampler>& aSamplers, vkglTF::Animation& aAnimation);
+
+	inline Core::uint32 GetEncodedSize(const vkglTF::AnimationSampler& aSampler) // In 16 bit words per value
+	{
+		return (aSampler.mEncoding == vkglTF::AnimationSampler::Encoding::SmallestThree) ? 3 : aSampler.mComponentCount;
+	}
+
+	inline void Decode(const vkglTF::AnimationSampler& aSampler, const Core::uint16* aData, float* aValue)
+	{
+		if (aSampler.mEncoding == vkglTF::AnimationSampler::Encoding::Range)
+		{
+			for (Core::uint32 i = 0; i < aSampler.mComponentCount; i++)
+			{
+				aValue[i] = aSampler.mMin[i] + aSampler.mStep[i] * static_cast<float>(aData[i]);
+			}
+			return;
+		}
+
+		// The components are in [-1/sqrt(2), 1/sqrt(2)], the largest one is positive and follows from the unit length
+		static constexpr float scale = 1.41421356f / 32767.0f;
+		static constexpr float offset = -0.70710678f;
+		const Core::uint32 largest = (aData[0] >> 15) | ((aData[1] >> 15) << 1);
+		const float components[3]{offset + scale * static_cast<float>(aData[0] & 0x7FFF), offset + scale * static_cast<float>(aData[1] & 0x7FFF), offset + scale * static_cast<float>(aData[2] & 0x7FFF)};
+		const float largestComponent = std::sqrt(std::max(1.0f - components[0] * components[0] - components[1] * components[1] - components[2] * components[2], 0.0f));
+		for (Core::uint32 i = 0, j = 0; i < 4; i++)
+		{
+			aValue[i] = (i == largest) ? largestComponent : components[j++];
+		}
+	}
+}
@@ -0,0 +1,409 @@
+#include "AnimationSystem.hpp"
+
+#include "AnimationCompression.hpp"
+#include "JobSystem.hpp"
+#include "Math/Functions.hpp"
+#include "Profiler/SimpleProfiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace AnimationSystemLocal
+{
+	static constexpr Core::uint32 gMinInstancesPerJob = 4;
+
+	static Math::Quaternionf MakeQuaternion(const float* aData)
+	{
+		Math::Quaternionf quaternion{};
+		quaternion.x = aData[0];
+		quaternion.y = aData[1];
+		quaternion.z = aData[2];
+		quaternion.w = aData[3];
+		return quaternion;
+	}
+
+	static void Normalize4(float* aValue)
+	{
+		const float length = std::sqrt(aValue[0] * aValue[0] + aValue[1] * aValue[1] + aValue[2] * aValue[2] + aValue[3] * aValue[3]);
+		if (length > 0.0f)
+		{
+			for (Core::uint32 i = 0; i < 4; i++)
+			{
+				aValue[i] /= length;
+			}
+		}
+	}
+}
+
+AnimationClip::AnimationClip(const vkglTF::Animation& aAnimation)
+	: mAnimation{&aAnimation}
+{
+	for (const vkglTF::AnimationChannel& channel : aAnimation.mChannels)
+	{
+		const Core::uint32 componentCount = (channel.mPathType == PathType::ROTATION) ? 4 : 3;
+		if (channel.mSamplerIndex >= aAnimation.mSamplers.size() || aAnimation.mSamplers[channel.mSamplerIndex].mKeyCount == 0 || aAnimation.mSamplers[channel.mSamplerIndex].mComponentCount != componentCount)
+		{
+			continue;
+		}
+
+		mTargets.push_back(channel.mNode->mHierarchyIndex);
+		mPaths.push_back(channel.mPathType);
+		mSamplers.push_back(channel.mSamplerIndex);
+	}
+}
+
+Core::uint32 AnimationClip::FindKey(const vkglTF::AnimationSampler& aSampler, float aTime, Core::uint32 aCursor) const
+{
+	const float* times = &mAnimation->mTimes[aSampler.mFirstTime];
+	const Core::uint32 keyCount = aSampler.mKeyCount;
+	const Core::uint32 lastKey = keyCount - 2; // Key at the start of the last interval
+	const Core::uint32 cursor = std::min(aCursor, lastKey);
+
+	// Still in the interval of the previous evaluation or in the next one
+	if (aTime >= times[cursor])
+	{
+		if (cursor == lastKey || aTime < times[cursor + 1])
+		{
+			return cursor;
+		}
+
+		if (cursor + 1 == lastKey || aTime < times[cursor + 2])
+		{
+			return cursor + 1;
+		}
+	}
+	else if (cursor == 0)
+	{
+		return 0;
+	}
+
+	// Looped around or jumped, the last key at or before the time
+	const Core::size key = static_cast<Core::size>(std::upper_bound(times, times + keyCount, aTime) - times);
+	return static_cast<Core::uint32>(std::clamp<Core::size>(key, 1, lastKey + 1) - 1);
+}
+
+void AnimationClip::Sample(Core::uint32 aTrack, float aTime, Core::uint32& aCursor, float* aValue) const
+{
+	const vkglTF::AnimationSampler& sampler = mAnimation->mSamplers[mSamplers[aTrack]];
+	const PathType path = mPaths[aTrack];
+	const Core::uint32 componentCount = sampler.mComponentCount;
+	const bool isCubic = (sampler.mInterpolation == InterpolationType::CUBICSPLINE);
+	const Core::uint32 valueSize = AnimationCompression::GetEncodedSize(sampler);
+	const Core::uint32 keySize = isCubic ? 3 * valueSize : valueSize;
+	const Core::uint32 valueOffset = isCubic ? valueSize : 0; // Skips the in tangent
+	const Core::uint16* values = &mAnimation->mValues[sampler.mFirstValue];
+
+	if (sampler.mKeyCount == 1)
+	{
+		AnimationCompression::Decode(sampler, values + valueOffset, aValue);
+		return;
+	}
+
+	aCursor = FindKey(sampler, aTime, aCursor);
+	const float* times = &mAnimation->mTimes[sampler.mFirstTime];
+	const Core::uint16* key0 = values + aCursor * keySize;
+	const Core::uint16* key1 = key0 + keySize;
+	const float interval = times[aCursor + 1] - times[aCursor];
+	const float factor = (interval > 0.0f) ? std::clamp((aTime - times[aCursor]) / interval, 0.0f, 1.0f) : 1.0f;
+
+	switch (sampler.mInterpolation)
+	{
+		case InterpolationType::STEP:
+		{
+			AnimationCompression::Decode(sampler, (factor < 1.0f) ? key0 : key1, aValue);
+			break;
+		}
+		case InterpolationType::LINEAR:
+		{
+			float value0[4];
+			float value1[4];
+			AnimationCompression::Decode(sampler, key0, value0);
+			AnimationCompression::Decode(sampler, key1, value1);
+
+			if (path == PathType::ROTATION)
+			{
+				const Math::Quaternionf rotation = Math::Slerp(AnimationSystemLocal::MakeQuaternion(value0), AnimationSystemLocal::MakeQuaternion(value1), factor);
+				aValue[0] = rotation.x;
+				aValue[1] = rotation.y;
+				aValue[2] = rotation.z;
+				aValue[3] = rotation.w;
+				break;
+			}
+
+			for (Core::uint32 i = 0; i < componentCount; i++)
+			{
+				aValue[i] = Math::Mix(value0[i], value1[i], factor);
+			}
+			break;
+		}
+		case InterpolationType::CUBICSPLINE:
+		{
+			float value0[4];
+			float outTangent0[4];
+			float inTangent1[4];
+			float value1[4];
+			AnimationCompression::Decode(sampler, key0 + valueSize, value0);
+			AnimationCompression::Decode(sampler, key0 + 2 * valueSize, outTangent0);
+			AnimationCompression::Decode(sampler, key1, inTangent1);
+			AnimationCompression::Decode(sampler, key1 + valueSize, value1);
+
+			// Hermite spline between the values, the tangents are per second so they are scaled by the interval
+			const float factor2 = factor * factor;
+			const float factor3 = factor2 * factor;
+			const float value0Weight = 2.0f * factor3 - 3.0f * factor2 + 1.0f;
+			const float outTangent0Weight = (factor3 - 2.0f * factor2 + factor) * interval;
+			const float value1Weight = -2.0f * factor3 + 3.0f * factor2;
+			const float inTangent1Weight = (factor3 - factor2) * interval;
+			for (Core::uint32 i = 0; i < componentCount; i++)
+			{
+				aValue[i] = value0Weight * value0[i] + outTangent0Weight * outTangent0[i] + value1Weight * value1[i] + inTangent1Weight * inTangent1[i];
+			}
+
+			if (path == PathType::ROTATION)
+			{
+				AnimationSystemLocal::Normalize4(aValue);
+			}
+			break;
+		}
+	}
+}
+
+AnimationInstance::AnimationInstance(const ModelAnimations& aAnimations, vkglTF::Model& aModel, bool aIsDrivingModel)
+	: mAnimations{aAnimations}
+	, mModel{&aModel}
+	, mHierarchy{&aModel.mHierarchy}
+	, mOwnHierarchy{}
+	, mLayers{}
+{
+	if (!aIsDrivingModel)
+	{
+		mOwnHierarchy = aModel.mHierarchy;
+		mHierarchy = &mOwnHierarchy;
+	}
+
+	const Core::uint32 nodeCount = mHierarchy->GetNodeCount();
+	mTranslations.resize(nodeCount);
+	mRotations.resize(nodeCount);
+	mScales.resize(nodeCount);
+	mTranslationWeights.resize(nodeCount);
+	mRotationWeights.resize(nodeCount);
+	mScaleWeights.resize(nodeCount);
+}
+
+void AnimationInstance::Play(Core::uint32 aClip, Core::uint32 aLayer, float aWeight, bool aIsLooping)
+{
+	Layer& layer = mLayers[aLayer];
+	layer.mClip = &mAnimations.mClips[aClip];
+	layer.mCursors.assign(layer.mClip->GetTrackCount(), 0);
+	layer.mTime = layer.mClip->GetStart();
+	layer.mWeight = aWeight;
+	layer.mIsLooping = aIsLooping;
+}
+
+void AnimationInstance::Stop(Core::uint32 aLayer)
+{
+	mLayers[aLayer].mClip = nullptr;
+}
+
+void AnimationInstance::SetWeight(Core::uint32 aLayer, float aWeight)
+{
+	mLayers[aLayer].mWeight = aWeight;
+}
+
+void AnimationInstance::SetSpeed(Core::uint32 aLayer, float aSpeed)
+{
+	mLayers[aLayer].mSpeed = aSpeed;
+}
+
+void AnimationInstance::SetTime(Core::uint32 aLayer, float aTime)
+{
+	// The cursors find the new keys with a search on the next update
+	mLayers[aLayer].mTime = aTime;
+}
+
+void AnimationInstance::Update(float aDeltaTime)
+{
+	std::fill(mTranslations.begin(), mTranslations.end(), Math::Vector3f{0.0f});
+	std::fill(mRotations.begin(), mRotations.end(), Math::Vector4f{0.0f});
+	std::fill(mScales.begin(), mScales.end(), Math::Vector3f{0.0f});
+	std::fill(mTranslationWeights.begin(), mTranslationWeights.end(), 0.0f);
+	std::fill(mRotationWeights.begin(), mRotationWeights.end(), 0.0f);
+	std::fill(mScaleWeights.begin(), mScaleWeights.end(), 0.0f);
+
+	for (Layer& layer : mLayers)
+	{
+		if (!layer.mClip)
+		{
+			continue;
+		}
+
+		// Layers without weight keep playing, so they stay in step with the others when they are faded in
+		const float start = layer.mClip->GetStart();
+		const float duration = layer.mClip->GetEnd() - start;
+		layer.mTime += aDeltaTime * layer.mSpeed;
+		if (layer.mIsLooping && duration > 0.0f)
+		{
+			layer.mTime = start + std::fmod(layer.mTime - start, duration);
+			if (layer.mTime < start)
+			{
+				layer.mTime += duration;
+			}
+		}
+		else
+		{
+			layer.mTime = std::clamp(layer.mTime, start, layer.mClip->GetEnd());
+		}
+
+		if (layer.mWeight > 0.0f)
+		{
+			Accumulate(layer);
+		}
+	}
+
+	ApplyPose();
+
+	if (IsDrivingModel())
+	{
+		mModel->UpdateNodes();
+	}
+	else
+	{
+		mHierarchy->UpdateWorldMatrices();
+	}
+}
+
+void AnimationInstance::Accumulate(Layer& aLayer)
+{
+	const AnimationClip& clip = *aLayer.mClip;
+	const float weight = aLayer.mWeight;
+	float value[4];
+
+	for (Core::uint32 i = 0; i < clip.GetTrackCount(); i++)
+	{
+		clip.Sample(i, aLayer.mTime, aLayer.mCursors[i], value);
+
+		const Core::uint32 node = clip.GetTarget(i);
+		switch (clip.GetPath(i))
+		{
+			case AnimationClip::PathType::TRANSLATION:
+			{
+				mTranslations[node] += weight * Math::MakeVector3f(value);
+				mTranslationWeights[node] += weight;
+				break;
+			}
+			case AnimationClip::PathType::ROTATION:
+			{
+				// q and -q are the same rotation, the one closer to the sum so far blends along the shorter arc
+				const Math::Vector4f rotation = Math::MakeVector4f(value);
+				mRotations[node] += weight * (Math::Dot(mRotations[node], rotation) < 0.0f ? -rotation : rotation);
+				mRotationWeights[node] += weight;
+				break;
+			}
+			case AnimationClip::PathType::SCALE:
+			{
+				mScales[node] += weight * Math::MakeVector3f(value);
+				mScaleWeights[node] += weight;
+				break;
+			}
+		}
+	}
+}
+
+void AnimationInstance::ApplyPose()
+{
+	// Weights that sum to less than one blend with the rest pose, above one they are normalized
+	for (Core::uint32 i = 0; i < mHierarchy->GetNodeCount(); i++)
+	{
+		if (const float weight = mTranslationWeights[i]; weight > 0.0f)
+		{
+			mHierarchy->SetTranslation(i, (mTranslations[i] + std::max(1.0f - weight, 0.0f) * mAnimations.mRestTranslations[i]) / std::max(weight, 1.0f));
+		}
+
+		if (const float weight = mRotationWeights[i]; weight > 0.0f)
+		{
+			Math::Vector4f rotation = mRotations[i];
+			if (weight < 1.0f)
+			{
+				const Math::Vector4f& restRotation = mAnimations.mRestRotations[i];
+				rotation += (1.0f - weight) * (Math::Dot(rotation, restRotation) < 0.0f ? -restRotation : restRotation);
+			}
+			rotation = Math::Normalize(rotation);
+			mHierarchy->SetRotation(i, AnimationSystemLocal::MakeQuaternion(&rotation.x));
+		}
+
+		if (const float weight = mScaleWeights[i]; weight > 0.0f)
+		{
+			mHierarchy->SetScale(i, (mScales[i] + std::max(1.0f - weight, 0.0f) * mAnimations.mRestScales[i]) / std::max(weight, 1.0f));
+		}
+	}
+}
+
+AnimationInstance* AnimationSystem::CreateInstance(vkglTF::Model& aModel, bool aIsDrivingModel)
+{
+	if (aIsDrivingModel && IsDriven(&aModel))
+	{
+		throw std::runtime_error("The model is already driven by an animation instance");
+	}
+
+	if (aIsDrivingModel && aModel.mIsPreTransformed)
+	{
+		throw std::runtime_error("A model loaded with PreTransformVertices can't be driven, its pose is baked into the vertices");
+	}
+
+	std::unique_ptr<ModelAnimations>& animations = mModelAnimations[&aModel];
+	if (!animations)
+	{
+		animations = std::make_unique<ModelAnimations>();
+		for (const vkglTF::Animation& animation : aModel.animations)
+		{
+			animations->mClips.emplace_back(animation);
+		}
+
+		const vkglTF::NodeHierarchy& hierarchy = aModel.mHierarchy;
+		for (Core::uint32 i = 0; i < hierarchy.GetNodeCount(); i++)
+		{
+			const Math::Quaternionf& rotation = hierarchy.GetRotation(i);
+			animations->mRestTranslations.push_back(hierarchy.GetTranslation(i));
+			animations->mRestRotations.emplace_back(rotation.x, rotation.y, rotation.z, rotation.w);
+			animations->mRestScales.push_back(hierarchy.GetScale(i));
+		}
+	}
+
+	mInstances.push_back(std::make_unique<AnimationInstance>(*animations, aModel, aIsDrivingModel));
+	return mInstances.back().get();
+}
+
+void AnimationSystem::DestroyInstance(AnimationInstance* aInstance)
+{
+	std::erase_if(mInstances, [aInstance](const std::unique_ptr<AnimationInstance>& aOther) { return aOther.get() == aInstance; });
+}
+
+void AnimationSystem::DestroyInstances(const vkglTF::Model* aModel)
+{
+	std::erase_if(mInstances, [aModel](const std::unique_ptr<AnimationInstance>& aInstance) { return aInstance->GetModel() == aModel; });
+	mModelAnimations.erase(aModel);
+}
+
+void AnimationSystem::Update(float aDeltaTime, JobSystem* aJobSystem)
+{
+	SIMPLE_PROFILER_PROFILE_SCOPE("AnimationSystem::Update");
+
+	// Instances only write their own hierarchy and at most one instance writes the buffers of a model
+	if (aJobSystem)
+	{
+		aJobSystem->ParallelFor(GetInstanceCount(), [this, aDeltaTime](Core::uint32 aIndex) { mInstances[aIndex]->Update(aDeltaTime); }, AnimationSystemLocal::gMinInstancesPerJob);
+	}
+	else
+	{
+		for (const std::unique_ptr<AnimationInstance>& instance : mInstances)
+		{
+			instance->Update(aDeltaTime);
+		}
+	}
+}
+
+bool AnimationSystem::IsDriven(const vkglTF::Model* aModel) const
+{
+	return std::any_of(mInstances.begin(), mInstances.end(), [aModel](const std::unique_ptr<AnimationInstance>& aInstance) { return aInstance->GetModel() == aModel && aInstance->IsDrivingModel(); });
+}
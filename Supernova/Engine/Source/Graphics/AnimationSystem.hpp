@@ -0,0 +1,131 @@
+#pragma once
+
+#include "Core/Types.hpp"
+#include "Math/Types.hpp"
+#include "VulkanGlTFTypes.hpp"
+
+#include <array>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+// Tracks of one glTF animation as a structure of arrays, a track animates one property of one node.
+// The keys stay in the compressed vkglTF::Animation of the model and are decoded while they are sampled,
+// the clip only adds the node and the sampler of every track.
+class AnimationClip
+{
+public:
+	using PathType = vkglTF::AnimationChannel::PathType;
+	using InterpolationType = vkglTF::AnimationSampler::InterpolationType;
+
+	explicit AnimationClip(const vkglTF::Animation& aAnimation); // Has to outlive the clip, channels whose sampler has no keys are skipped
+
+	// Writes the value of a track at the time into aValue, aCursor is the key the previous evaluation found and is moved to the key of this one
+	void Sample(Core::uint32 aTrack, float aTime, Core::uint32& aCursor, float* aValue) const;
+
+	const std::string& GetName() const { return mAnimation->mName; }
+	float GetStart() const { return mAnimation->mStart; }
+	float GetEnd() const { return mAnimation->mEnd; }
+	Core::uint32 GetTrackCount() const { return static_cast<Core::uint32>(mTargets.size()); }
+	Core::uint32 GetTarget(Core::uint32 aTrack) const { return mTargets[aTrack]; } // Node in the model's NodeHierarchy
+	PathType GetPath(Core::uint32 aTrack) const { return mPaths[aTrack]; }
+
+private:
+	Core::uint32 FindKey(const vkglTF::AnimationSampler& aSampler, float aTime, Core::uint32 aCursor) const;
+
+	const vkglTF::Animation* mAnimation;
+	std::vector<Core::uint32> mTargets;
+	std::vector<PathType> mPaths;
+	std::vector<Core::uint32> mSamplers;
+};
+
+// Clips of one model and the pose its nodes were loaded with, shared by all instances of the model
+struct ModelAnimations
+{
+	std::vector<AnimationClip> mClips;
+	std::vector<Math::Vector3f> mRestTranslations;
+	std::vector<Math::Vector4f> mRestRotations; // x, y, z, w like the clips store them
+	std::vector<Math::Vector3f> mRestScales;
+};
+
+// Plays up to gMaxLayerCount clips of a model at once and blends them into a node hierarchy.
+// Every layer keeps the key each track was at during the previous update, playback moves forward by at most a key per track
+// and frame in practice, so finding the keys takes constant time instead of a search through all keys of every track.
+class AnimationInstance
+{
+public:
+	static constexpr Core::uint32 gMaxLayerCount = 4;
+
+	AnimationInstance(const ModelAnimations& aAnimations, vkglTF::Model& aModel, bool aIsDrivingModel);
+
+	void Play(Core::uint32 aClip, Core::uint32 aLayer = 0, float aWeight = 1.0f, bool aIsLooping = true); // Starts the clip from its beginning
+	void Stop(Core::uint32 aLayer);
+	void SetWeight(Core::uint32 aLayer, float aWeight);
+	void SetSpeed(Core::uint32 aLayer, float aSpeed);
+	void SetTime(Core::uint32 aLayer, float aTime);
+
+	// Advances the layers, blends their samples and updates the world matrices, and the mesh matrices of the model when the instance drives it
+	void Update(float aDeltaTime);
+
+	vkglTF::Model* GetModel() const { return mModel; }
+	bool IsDrivingModel() const { return mHierarchy == &mModel->mHierarchy; }
+	const vkglTF::NodeHierarchy& GetHierarchy() const { return *mHierarchy; }
+	float GetTime(Core::uint32 aLayer) const { return mLayers[aLayer].mTime; }
+
+private:
+	struct Layer
+	{
+		Layer() : mClip{nullptr}, mTime{0.0f}, mSpeed{1.0f}, mWeight{0.0f}, mIsLooping{true} {}
+
+		const AnimationClip* mClip; // Stopped when nullptr
+		std::vector<Core::uint32> mCursors; // Key of every track at the last update
+		float mTime;
+		float mSpeed;
+		float mWeight;
+		bool mIsLooping;
+	};
+
+	void Accumulate(Layer& aLayer);
+	void ApplyPose();
+
+	const ModelAnimations& mAnimations;
+	vkglTF::Model* mModel;
+	vkglTF::NodeHierarchy* mHierarchy; // The model's own or mOwnHierarchy
+	vkglTF::NodeHierarchy mOwnHierarchy;
+	std::array<Layer, gMaxLayerCount> mLayers;
+
+	// Weighted sums of the layer samples per node, rotations are summed in the hemisphere of the sum so far
+	std::vector<Math::Vector3f> mTranslations;
+	std::vector<Math::Vector4f> mRotations;
+	std::vector<Math::Vector3f> mScales;
+	std::vector<float> mTranslationWeights;
+	std::vector<float> mRotationWeights;
+	std::vector<float> mScaleWeights;
+};
+
+// Builds the clips of every animated model once and updates all animation instances, in parallel when a job system is passed.
+// A model is drawn with the pose of the single instance that drives it, other instances pose a copy of its hierarchy,
+// their world matrices can be read with GetHierarchy, e.g. to skin a crowd of the model.
+class AnimationSystem
+{
+public:
+	AnimationSystem() {}
+
+	AnimationSystem(const AnimationSystem&) = delete;
+	AnimationSystem& operator=(const AnimationSystem&) = delete;
+
+	AnimationInstance* CreateInstance(vkglTF::Model& aModel, bool aIsDrivingModel); // Throws when the model is already driven by another instance, or when it is driven and was loaded with PreTransformVertices
+	void DestroyInstance(AnimationInstance* aInstance);
+	void DestroyInstances(const vkglTF::Model* aModel); // Has to be called before the model is destroyed
+	void Update(float aDeltaTime, JobSystem* aJobSystem);
+
+	bool IsDriven(const vkglTF::Model* aModel) const;
+	Core::uint32 GetInstanceCount() const { return static_cast<Core::uint32>(mInstances.size()); }
+
+private:
+	std::map<const vkglTF::Model*, std::unique_ptr<ModelAnimations>> mModelAnimations;
+	std::vector<std::unique_ptr<AnimationInstance>> mInstances;
+};
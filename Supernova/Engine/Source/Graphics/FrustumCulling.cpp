@@ -0,0 +1,539 @@
+#include "FrustumCulling.hpp"
+
+#include "JobSystem.hpp"
+#include "VulkanTypes.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define FRUSTUM_CULLING_X64
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC compiles intrinsics of any instruction set, GCC and Clang only inside functions that target it
+#if defined(__GNUC__) || defined(__clang__)
+#define FRUSTUM_CULLING_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define FRUSTUM_CULLING_TARGET_AVX2
+#endif
+
+namespace FrustumCullingLocal
+{
+	using namespace FrustumCulling;
+
+	static constexpr Core::uint32 gBatchSize = 4096; // Volumes per job, a multiple of gLaneCount
+	static constexpr float gNeverVisibleExtent = std::numeric_limits<float>::lowest(); // Behind every plane, wherever the center is
+
+	// Uniform inputs of the kernels
+	struct CullingParameters
+	{
+		std::array<Math::Vector4f, 6> mPlanes;
+		Math::Vector3f mViewPosition;
+		std::array<float, gMaxLoDCount - 1> mLoDDistancesSquared;
+		Core::uint32 mLoDDistanceCount;
+	};
+
+	// Writes the visibility of the volumes in [aBegin, aEnd) and adds them to aCounts, which is indexed by visibility
+	using KernelFunction = void(*)(const CullingParameters& aParameters, const Bounds& aBounds, Core::uint32 aBegin, Core::uint32 aEnd, Core::uint8* aVisibility, Core::uint32* aCounts);
+
+	// The kernels evaluate the same expressions in the same order, so every kernel culls and selects LODs alike
+	template<VolumeType Type>
+	static void CullScalar(const CullingParameters& aParameters, const Bounds& aBounds, Core::uint32 aBegin, Core::uint32 aEnd, Core::uint8* aVisibility, Core::uint32* aCounts)
+	{
+		for (Core::uint32 i = aBegin; i < aEnd; i++)
+		{
+			const float x = aBounds.GetCenterX()[i];
+			const float y = aBounds.GetCenterY()[i];
+			const float z = aBounds.GetCenterZ()[i];
+
+			bool isVisible = true;
+			for (const Math::Vector4f& plane : aParameters.mPlanes)
+			{
+				const float distance = plane.x * x + plane.y * y + plane.z * z + plane.w;
+
+				// Boxes reach as far towards the plane as their extents projected onto its normal
+				float radius;
+				if constexpr (Type == VolumeType::Sphere)
+				{
+					radius = aBounds.GetRadius()[i];
+				}
+				else
+				{
+					radius = std::abs(plane.x) * aBounds.GetExtentX()[i] + std::abs(plane.y) * aBounds.GetExtentY()[i] + std::abs(plane.z) * aBounds.GetExtentZ()[i];
+				}
+
+				if (!(distance + radius >= 0.0f))
+				{
+					isVisible = false;
+					break;
+				}
+			}
+
+			if (!isVisible)
+			{
+				aVisibility[i] = 0;
+				aCounts[0]++;
+				continue;
+			}
+
+			const float dx = x - aParameters.mViewPosition.x;
+			const float dy = y - aParameters.mViewPosition.y;
+			const float dz = z - aParameters.mViewPosition.z;
+			const float distanceSquared = dx * dx + dy * dy + dz * dz;
+
+			Core::uint32 lod = 0;
+			for (Core::uint32 j = 0; j < aParameters.mLoDDistanceCount; j++)
+			{
+				lod += (distanceSquared >= aParameters.mLoDDistancesSquared[j]) ? 1 : 0;
+			}
+
+			aVisibility[i] = static_cast<Core::uint8>(lod + 1);
+			aCounts[lod + 1]++;
+		}
+	}
+
+#ifdef FRUSTUM_CULLING_X64
+	template<VolumeType Type>
+	static void CullSSE(const CullingParameters& aParameters, const Bounds& aBounds, Core::uint32 aBegin, Core::uint32 aEnd, Core::uint8* aVisibility, Core::uint32* aCounts)
+	{
+		static constexpr Core::uint32 laneCount = 4;
+
+		__m128 planeX[6];
+		__m128 planeY[6];
+		__m128 planeZ[6];
+		__m128 planeW[6];
+		__m128 planeAbsoluteX[6]; // Boxes only
+		__m128 planeAbsoluteY[6];
+		__m128 planeAbsoluteZ[6];
+		for (Core::size i = 0; i < aParameters.mPlanes.size(); i++)
+		{
+			planeX[i] = _mm_set1_ps(aParameters.mPlanes[i].x);
+			planeY[i] = _mm_set1_ps(aParameters.mPlanes[i].y);
+			planeZ[i] = _mm_set1_ps(aParameters.mPlanes[i].z);
+			planeW[i] = _mm_set1_ps(aParameters.mPlanes[i].w);
+			planeAbsoluteX[i] = _mm_set1_ps(std::abs(aParameters.mPlanes[i].x));
+			planeAbsoluteY[i] = _mm_set1_ps(std::abs(aParameters.mPlanes[i].y));
+			planeAbsoluteZ[i] = _mm_set1_ps(std::abs(aParameters.mPlanes[i].z));
+		}
+
+		const __m128 viewX = _mm_set1_ps(aParameters.mViewPosition.x);
+		const __m128 viewY = _mm_set1_ps(aParameters.mViewPosition.y);
+		const __m128 viewZ = _mm_set1_ps(aParameters.mViewPosition.z);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128i one = _mm_set1_epi32(1);
+
+		alignas(16) std::array<Core::int32, laneCount> visibility;
+		for (Core::uint32 i = aBegin; i < aEnd; i += laneCount)
+		{
+			const __m128 x = _mm_loadu_ps(aBounds.GetCenterX() + i);
+			const __m128 y = _mm_loadu_ps(aBounds.GetCenterY() + i);
+			const __m128 z = _mm_loadu_ps(aBounds.GetCenterZ() + i);
+
+			__m128 radius{};
+			__m128 extentX{};
+			__m128 extentY{};
+			__m128 extentZ{};
+			if constexpr (Type == VolumeType::Sphere)
+			{
+				radius = _mm_loadu_ps(aBounds.GetRadius() + i);
+			}
+			else
+			{
+				extentX = _mm_loadu_ps(aBounds.GetExtentX() + i);
+				extentY = _mm_loadu_ps(aBounds.GetExtentY() + i);
+				extentZ = _mm_loadu_ps(aBounds.GetExtentZ() + i);
+			}
+
+			__m128 isVisible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (Core::size j = 0; j < std::size(planeX); j++)
+			{
+				const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[j], x), _mm_mul_ps(planeY[j], y)), _mm_mul_ps(planeZ[j], z)), planeW[j]);
+
+				if constexpr (Type == VolumeType::Box)
+				{
+					radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeAbsoluteX[j], extentX), _mm_mul_ps(planeAbsoluteY[j], extentY)), _mm_mul_ps(planeAbsoluteZ[j], extentZ));
+				}
+
+				isVisible = _mm_and_ps(isVisible, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+			}
+
+			// Most groups of a large set are completely outside the frustum
+			if (_mm_movemask_ps(isVisible) == 0)
+			{
+				std::memset(aVisibility + i, 0, laneCount);
+				aCounts[0] += laneCount;
+				continue;
+			}
+
+			const __m128 dx = _mm_sub_ps(x, viewX);
+			const __m128 dy = _mm_sub_ps(y, viewY);
+			const __m128 dz = _mm_sub_ps(z, viewZ);
+			const __m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+			// The comparison masks are all bits set, subtracting them counts the distances the volumes are beyond
+			__m128i lod = one;
+			for (Core::uint32 j = 0; j < aParameters.mLoDDistanceCount; j++)
+			{
+				lod = _mm_sub_epi32(lod, _mm_castps_si128(_mm_cmpge_ps(distanceSquared, _mm_set1_ps(aParameters.mLoDDistancesSquared[j]))));
+			}
+
+			_mm_store_si128(reinterpret_cast<__m128i*>(visibility.data()), _mm_and_si128(lod, _mm_castps_si128(isVisible)));
+			for (Core::uint32 lane = 0; lane < laneCount; lane++)
+			{
+				aVisibility[i + lane] = static_cast<Core::uint8>(visibility[lane]);
+				aCounts[visibility[lane]]++;
+			}
+		}
+	}
+
+	template<VolumeType Type>
+	FRUSTUM_CULLING_TARGET_AVX2 static void CullAVX2(const CullingParameters& aParameters, const Bounds& aBounds, Core::uint32 aBegin, Core::uint32 aEnd, Core::uint8* aVisibility, Core::uint32* aCounts)
+	{
+		static constexpr Core::uint32 laneCount = 8;
+
+		__m256 planeX[6];
+		__m256 planeY[6];
+		__m256 planeZ[6];
+		__m256 planeW[6];
+		__m256 planeAbsoluteX[6]; // Boxes only
+		__m256 planeAbsoluteY[6];
+		__m256 planeAbsoluteZ[6];
+		for (Core::size i = 0; i < aParameters.mPlanes.size(); i++)
+		{
+			planeX[i] = _mm256_set1_ps(aParameters.mPlanes[i].x);
+			planeY[i] = _mm256_set1_ps(aParameters.mPlanes[i].y);
+			planeZ[i] = _mm256_set1_ps(aParameters.mPlanes[i].z);
+			planeW[i] = _mm256_set1_ps(aParameters.mPlanes[i].w);
+			planeAbsoluteX[i] = _mm256_set1_ps(std::abs(aParameters.mPlanes[i].x));
+			planeAbsoluteY[i] = _mm256_set1_ps(std::abs(aParameters.mPlanes[i].y));
+			planeAbsoluteZ[i] = _mm256_set1_ps(std::abs(aParameters.mPlanes[i].z));
+		}
+
+		const __m256 viewX = _mm256_set1_ps(aParameters.mViewPosition.x);
+		const __m256 viewY = _mm256_set1_ps(aParameters.mViewPosition.y);
+		const __m256 viewZ = _mm256_set1_ps(aParameters.mViewPosition.z);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256i one = _mm256_set1_epi32(1);
+
+		alignas(32) std::array<Core::int32, laneCount> visibility;
+		for (Core::uint32 i = aBegin; i < aEnd; i += laneCount)
+		{
+			const __m256 x = _mm256_loadu_ps(aBounds.GetCenterX() + i);
+			const __m256 y = _mm256_loadu_ps(aBounds.GetCenterY() + i);
+			const __m256 z = _mm256_loadu_ps(aBounds.GetCenterZ() + i);
+
+			__m256 radius{};
+			__m256 extentX{};
+			__m256 extentY{};
+			__m256 extentZ{};
+			if constexpr (Type == VolumeType::Sphere)
+			{
+				radius = _mm256_loadu_ps(aBounds.GetRadius() + i);
+			}
+			else
+			{
+				extentX = _mm256_loadu_ps(aBounds.GetExtentX() + i);
+				extentY = _mm256_loadu_ps(aBounds.GetExtentY() + i);
+				extentZ = _mm256_loadu_ps(aBounds.GetExtentZ() + i);
+			}
+
+			__m256 isVisible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (Core::size j = 0; j < std::size(planeX); j++)
+			{
+				const __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[j], x), _mm256_mul_ps(planeY[j], y)), _mm256_mul_ps(planeZ[j], z)), planeW[j]);
+
+				if constexpr (Type == VolumeType::Box)
+				{
+					radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeAbsoluteX[j], extentX), _mm256_mul_ps(planeAbsoluteY[j], extentY)), _mm256_mul_ps(planeAbsoluteZ[j], extentZ));
+				}
+
+				isVisible = _mm256_and_ps(isVisible, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+			}
+
+			if (_mm256_movemask_ps(isVisible) == 0)
+			{
+				std::memset(aVisibility + i, 0, laneCount);
+				aCounts[0] += laneCount;
+				continue;
+			}
+
+			const __m256 dx = _mm256_sub_ps(x, viewX);
+			const __m256 dy = _mm256_sub_ps(y, viewY);
+			const __m256 dz = _mm256_sub_ps(z, viewZ);
+			const __m256 distanceSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+
+			__m256i lod = one;
+			for (Core::uint32 j = 0; j < aParameters.mLoDDistanceCount; j++)
+			{
+				lod = _mm256_sub_epi32(lod, _mm256_castps_si256(_mm256_cmp_ps(distanceSquared, _mm256_set1_ps(aParameters.mLoDDistancesSquared[j]), _CMP_GE_OQ)));
+			}
+
+			_mm256_store_si256(reinterpret_cast<__m256i*>(visibility.data()), _mm256_and_si256(lod, _mm256_castps_si256(isVisible)));
+			for (Core::uint32 lane = 0; lane < laneCount; lane++)
+			{
+				aVisibility[i + lane] = static_cast<Core::uint8>(visibility[lane]);
+				aCounts[visibility[lane]]++;
+			}
+		}
+	}
+
+	static bool IsAVX2Supported()
+	{
+#if defined(_MSC_VER)
+		std::array<int, 4> info{};
+		__cpuid(info.data(), 0);
+		if (info[0] < 7)
+		{
+			return false;
+		}
+
+		// The OS has to save the upper halves of the YMM registers on context switches
+		__cpuid(info.data(), 1);
+		const bool isAVXSupported = (info[2] & (1 << 28)) != 0;
+		const bool isXSaveEnabled = (info[2] & (1 << 27)) != 0;
+		if (!isAVXSupported || !isXSaveEnabled || (_xgetbv(0) & 0x6) != 0x6)
+		{
+			return false;
+		}
+
+		__cpuidex(info.data(), 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+#endif
+
+	template<VolumeType Type>
+	static KernelFunction GetKernelFunction(Kernel aKernel)
+	{
+		switch (aKernel)
+		{
+#ifdef FRUSTUM_CULLING_X64
+			case Kernel::SSE:
+				return &CullSSE<Type>;
+			case Kernel::AVX2:
+				return &CullAVX2<Type>;
+#endif
+			default:
+				return &CullScalar<Type>;
+		}
+	}
+
+	static void RunBatches(Core::uint32 aBatchCount, const std::function<void(Core::uint32 aBatch)>& aFunction, JobSystem* aJobSystem)
+	{
+		if (aJobSystem && aBatchCount > 1)
+		{
+			aJobSystem->ParallelFor(aBatchCount, aFunction);
+			return;
+		}
+
+		for (Core::uint32 batch = 0; batch < aBatchCount; batch++)
+		{
+			aFunction(batch);
+		}
+	}
+}
+
+namespace FrustumCulling
+{
+	bool IsKernelSupported(Kernel aKernel)
+	{
+		switch (aKernel)
+		{
+			case Kernel::Scalar:
+				return true;
+#ifdef FRUSTUM_CULLING_X64
+			case Kernel::SSE:
+				return true; // Part of x64
+			case Kernel::AVX2:
+			{
+				static const bool isSupported = FrustumCullingLocal::IsAVX2Supported();
+				return isSupported;
+			}
+#endif
+			default:
+				return false;
+		}
+	}
+
+	Kernel GetFastestKernel()
+	{
+		for (const Kernel kernel : {Kernel::AVX2, Kernel::SSE})
+		{
+			if (IsKernelSupported(kernel))
+			{
+				return kernel;
+			}
+		}
+
+		return Kernel::Scalar;
+	}
+
+	const char* GetKernelName(Kernel aKernel)
+	{
+		switch (aKernel)
+		{
+			case Kernel::SSE:
+				return "SSE";
+			case Kernel::AVX2:
+				return "AVX2";
+			default:
+				return "Scalar";
+		}
+	}
+
+	Bounds::Bounds(VolumeType aType)
+		: mCount{0}
+		, mType{aType}
+	{
+	}
+
+	void Bounds::Resize(Core::uint32 aCount)
+	{
+		const Core::uint32 paddedCount = (aCount + gLaneCount - 1) / gLaneCount * gLaneCount;
+
+		mCenterX.resize(paddedCount);
+		mCenterY.resize(paddedCount);
+		mCenterZ.resize(paddedCount);
+		mExtentX.resize(paddedCount);
+		if (mType == VolumeType::Box)
+		{
+			mExtentY.resize(paddedCount);
+			mExtentZ.resize(paddedCount);
+		}
+
+		// Volumes that were removed turn into padding, added ones start out as padding
+		for (Core::uint32 i = std::min(mCount, aCount); i < paddedCount; i++)
+		{
+			Clear(i);
+		}
+
+		mCount = aCount;
+	}
+
+	void Bounds::SetSphere(Core::uint32 aIndex, const Math::Vector3f& aCenter, float aRadius)
+	{
+		assert(mType == VolumeType::Sphere && aIndex < mCount);
+
+		mCenterX[aIndex] = aCenter.x;
+		mCenterY[aIndex] = aCenter.y;
+		mCenterZ[aIndex] = aCenter.z;
+		mExtentX[aIndex] = aRadius;
+	}
+
+	void Bounds::SetBox(Core::uint32 aIndex, const Math::Vector3f& aMin, const Math::Vector3f& aMax)
+	{
+		assert(mType == VolumeType::Box && aIndex < mCount);
+
+		const Math::Vector3f center = (aMin + aMax) * 0.5f;
+		const Math::Vector3f extent = (aMax - aMin) * 0.5f;
+		mCenterX[aIndex] = center.x;
+		mCenterY[aIndex] = center.y;
+		mCenterZ[aIndex] = center.z;
+		mExtentX[aIndex] = extent.x;
+		mExtentY[aIndex] = extent.y;
+		mExtentZ[aIndex] = extent.z;
+	}
+
+	void Bounds::Clear(Core::uint32 aIndex)
+	{
+		mCenterX[aIndex] = 0.0f;
+		mCenterY[aIndex] = 0.0f;
+		mCenterZ[aIndex] = 0.0f;
+		mExtentX[aIndex] = FrustumCullingLocal::gNeverVisibleExtent;
+		if (mType == VolumeType::Box)
+		{
+			mExtentY[aIndex] = FrustumCullingLocal::gNeverVisibleExtent;
+			mExtentZ[aIndex] = FrustumCullingLocal::gNeverVisibleExtent;
+		}
+	}
+
+	void Cull(const ViewFrustum& aFrustum, const Math::Vector3f& aViewPosition, std::span<const float> aLoDDistances, const Bounds& aBounds, DrawList& aDrawList, Kernel aKernel, JobSystem* aJobSystem)
+	{
+		assert(aLoDDistances.size() < gMaxLoDCount && std::is_sorted(aLoDDistances.begin(), aLoDDistances.end()));
+
+		// The distances are compared squared, so no square root has to be taken per volume
+		FrustumCullingLocal::CullingParameters parameters{};
+		parameters.mPlanes = aFrustum.mPlanes;
+		parameters.mViewPosition = aViewPosition;
+		parameters.mLoDDistanceCount = static_cast<Core::uint32>(aLoDDistances.size());
+		for (Core::size i = 0; i < aLoDDistances.size(); i++)
+		{
+			parameters.mLoDDistancesSquared[i] = aLoDDistances[i] * aLoDDistances[i];
+		}
+
+		const FrustumCullingLocal::KernelFunction kernel = (aBounds.GetType() == VolumeType::Sphere)
+			? FrustumCullingLocal::GetKernelFunction<VolumeType::Sphere>(IsKernelSupported(aKernel) ? aKernel : Kernel::Scalar)
+			: FrustumCullingLocal::GetKernelFunction<VolumeType::Box>(IsKernelSupported(aKernel) ? aKernel : Kernel::Scalar);
+
+		const Core::uint32 paddedCount = aBounds.GetPaddedCount();
+		const Core::uint32 batchCount = (paddedCount + FrustumCullingLocal::gBatchSize - 1) / FrustumCullingLocal::gBatchSize;
+		aDrawList.mVisibility.resize(paddedCount);
+		aDrawList.mBatchCounts.assign(batchCount, {});
+
+		FrustumCullingLocal::RunBatches(batchCount, [&](Core::uint32 aBatch)
+		{
+			const Core::uint32 begin = aBatch * FrustumCullingLocal::gBatchSize;
+			const Core::uint32 end = std::min(begin + FrustumCullingLocal::gBatchSize, paddedCount);
+			kernel(parameters, aBounds, begin, end, aDrawList.mVisibility.data(), aDrawList.mBatchCounts[aBatch].data());
+		}, aJobSystem);
+
+		// Same layout as the compaction of the cull shader, the LODs follow each other and the batches follow each other within a LOD
+		// The counts of every batch are replaced by the offsets its volumes are written to
+		Core::uint32 visibleCount = 0;
+		aDrawList.mFirstIndex.fill(0);
+		aDrawList.mCount.fill(0);
+		for (Core::uint32 lod = 0; lod <= parameters.mLoDDistanceCount; lod++)
+		{
+			aDrawList.mFirstIndex[lod] = visibleCount;
+			for (std::array<Core::uint32, gMaxLoDCount + 1>& batchCounts : aDrawList.mBatchCounts)
+			{
+				const Core::uint32 count = batchCounts[lod + 1];
+				batchCounts[lod + 1] = visibleCount;
+				visibleCount += count;
+			}
+			aDrawList.mCount[lod] = visibleCount - aDrawList.mFirstIndex[lod];
+		}
+
+		aDrawList.mIndices.resize(visibleCount);
+		if (visibleCount == 0)
+		{
+			return;
+		}
+
+		FrustumCullingLocal::RunBatches(batchCount, [&](Core::uint32 aBatch)
+		{
+			std::array<Core::uint32, gMaxLoDCount + 1>& offsets = aDrawList.mBatchCounts[aBatch];
+			const Core::uint32 begin = aBatch * FrustumCullingLocal::gBatchSize;
+			const Core::uint32 end = std::min(begin + FrustumCullingLocal::gBatchSize, paddedCount);
+			for (Core::uint32 i = begin; i < end; i += gLaneCount)
+			{
+				// Skips a whole group of culled volumes with a single test
+				Core::uint64 group;
+				std::memcpy(&group, aDrawList.mVisibility.data() + i, sizeof(group));
+				if (group == 0)
+				{
+					continue;
+				}
+
+				for (Core::uint32 j = i; j < i + gLaneCount; j++)
+				{
+					const Core::uint8 visibility = aDrawList.mVisibility[j];
+					if (visibility != 0)
+					{
+						aDrawList.mIndices[offsets[visibility]++] = j;
+					}
+				}
+			}
+		}, aJobSystem);
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Core/Types.hpp"
+#include "Math/Types.hpp"
+
+#include <array>
+#include <span>
+#include <vector>
+
+class JobSystem;
+class ViewFrustum;
+
+// Frustum culling and distance based LOD selection of many bounding volumes at once on the CPU.
+// The volumes are stored as a structure of arrays, so the SSE and AVX2 kernels test four or eight of them against the six planes per iteration.
+// Results match the instance cull shader: a volume is culled when it lies completely behind one of the planes,
+// and its LOD is the number of LOD distances its center is at or beyond.
+namespace FrustumCulling
+{
+	static constexpr Core::uint32 gLaneCount = 8; // Volumes are padded to a multiple of the widest kernel
+	static constexpr Core::uint32 gMaxLoDCount = 8;
+
+	enum class Kernel : Core::uint8
+	{
+		Scalar,
+		SSE,
+		AVX2
+	};
+
+	enum class VolumeType : Core::uint8
+	{
+		Sphere,
+		Box // Axis aligned
+	};
+
+	bool IsKernelSupported(Kernel aKernel);
+	Kernel GetFastestKernel(); // Widest kernel the CPU and the OS support
+	const char* GetKernelName(Kernel aKernel);
+
+	// Bounding volumes of a single type, padded with volumes that are never visible
+	class Bounds
+	{
+	public:
+		explicit Bounds(VolumeType aType);
+
+		void Resize(Core::uint32 aCount); // Added volumes are never visible until they are set
+		void SetSphere(Core::uint32 aIndex, const Math::Vector3f& aCenter, float aRadius);
+		void SetBox(Core::uint32 aIndex, const Math::Vector3f& aMin, const Math::Vector3f& aMax);
+
+		VolumeType GetType() const { return mType; }
+		Core::uint32 GetCount() const { return mCount; }
+		Core::uint32 GetPaddedCount() const { return static_cast<Core::uint32>(mCenterX.size()); }
+
+		const float* GetCenterX() const { return mCenterX.data(); }
+		const float* GetCenterY() const { return mCenterY.data(); }
+		const float* GetCenterZ() const { return mCenterZ.data(); }
+		const float* GetRadius() const { return mExtentX.data(); } // Spheres only
+		const float* GetExtentX() const { return mExtentX.data(); } // Half sizes, boxes only
+		const float* GetExtentY() const { return mExtentY.data(); }
+		const float* GetExtentZ() const { return mExtentZ.data(); }
+
+	private:
+		void Clear(Core::uint32 aIndex);
+
+		std::vector<float> mCenterX;
+		std::vector<float> mCenterY;
+		std::vector<float> mCenterZ;
+		std::vector<float> mExtentX; // Radius of the spheres
+		std::vector<float> mExtentY;
+		std::vector<float> mExtentZ;
+		Core::uint32 mCount;
+		VolumeType mType;
+	};
+
+	// Visible volumes grouped by LOD, every LOD can be drawn as a single instanced draw
+	struct DrawList
+	{
+		Core::uint32 GetVisibleCount() const { return static_cast<Core::uint32>(mIndices.size()); }
+
+		std::vector<Core::uint32> mIndices; // Volume indices in increasing order within each LOD, the ones of LOD i start at mFirstIndex[i]
+		std::array<Core::uint32, gMaxLoDCount> mFirstIndex{};
+		std::array<Core::uint32, gMaxLoDCount> mCount{};
+		std::vector<Core::uint8> mVisibility; // LOD plus one per padded volume, zero when culled
+		std::vector<std::array<Core::uint32, gMaxLoDCount + 1>> mBatchCounts; // Visibility counts of every batch, kept so culling doesn't allocate every frame
+	};
+
+	// aLoDDistances have to increase and hold less than gMaxLoDCount distances, volumes at or beyond the last one get the last LOD.
+	// The batches run on the job system when one is passed, otherwise on the calling thread.
+	void Cull(const ViewFrustum& aFrustum, const Math::Vector3f& aViewPosition, std::span<const float> aLoDDistances, const Bounds& aBounds, DrawList& aDrawList, Kernel aKernel, JobSystem* aJobSystem = nullptr);
+}
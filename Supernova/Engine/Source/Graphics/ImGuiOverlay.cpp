@@ -189,7 +189,6 @@ ImGuiOverlay::ImGuiOverlay()
 	, mDescriptorSet{VK_NULL_HANDLE}
 	, mPipelineLayout{VK_NULL_HANDLE}
 	, mPipeline{VK_NULL_HANDLE}
-	, mFontMemory{VK_NULL_HANDLE}
 	, mFontImage{VK_NULL_HANDLE}
 	, mFontImageView{VK_NULL_HANDLE}
 	, mSampler{VK_NULL_HANDLE}
@@ -244,16 +243,7 @@ void ImGuiOverlay::PrepareResources()
 	};
 	VK_CHECK_RESULT(vkCreateImage(mVulkanDevice->mLogicalVkDevice, &imageCreateInfo, nullptr, &mFontImage));
 
-	VkMemoryRequirements memoryRequirements;
-	vkGetImageMemoryRequirements(mVulkanDevice->mLogicalVkDevice, mFontImage, &memoryRequirements);
-
-	const VkMemoryAllocateInfo memoryAllocateInfo{
-		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-		.allocationSize = memoryRequirements.size,
-		.memoryTypeIndex = mVulkanDevice->GetMemoryTypeIndex(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
-	};
-	VK_CHECK_RESULT(vkAllocateMemory(mVulkanDevice->mLogicalVkDevice, &memoryAllocateInfo, nullptr, &mFontMemory));
-	VK_CHECK_RESULT(vkBindImageMemory(mVulkanDevice->mLogicalVkDevice, mFontImage, mFontMemory, 0));
+	mFontAllocation = mVulkanDevice->AllocateImageMemory(mFontImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
 	const VkImageViewCreateInfo imageViewCreateInfo{
 		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
@@ -564,7 +554,7 @@ void ImGuiOverlay::FreeResources()
 
 	vkDestroyImageView(mVulkanDevice->mLogicalVkDevice, mFontImageView, nullptr);
 	vkDestroyImage(mVulkanDevice->mLogicalVkDevice, mFontImage, nullptr);
-	vkFreeMemory(mVulkanDevice->mLogicalVkDevice, mFontMemory, nullptr);
+	mVulkanDevice->mMemoryAllocator->Free(mFontAllocation);
 	vkDestroySampler(mVulkanDevice->mLogicalVkDevice, mSampler, nullptr);
 	vkDestroyDescriptorSetLayout(mVulkanDevice->mLogicalVkDevice, mDescriptorSetLayout, nullptr);
 	vkDestroyDescriptorPool(mVulkanDevice->mLogicalVkDevice, mDescriptorPool, nullptr);
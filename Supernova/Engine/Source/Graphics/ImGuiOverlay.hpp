@@ -66,7 +66,7 @@ private:
 	VkDescriptorSet mDescriptorSet;
 	VkPipelineLayout mPipelineLayout;
 	VkPipeline mPipeline;
-	VkDeviceMemory mFontMemory;
+	VulkanAllocation mFontAllocation;
 	VkImage mFontImage;
 	VkImageView mFontImageView;
 	VkSampler mSampler;
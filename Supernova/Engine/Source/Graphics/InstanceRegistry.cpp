@@ -0,0 +1,206 @@
+#include "InstanceRegistry.hpp"
+
+#include "Core/Types.hpp"
+#include "ECS/Components.hpp"
+#include "ECS/EntityContainer.hpp"
+#include "ECS/Scene.hpp"
+#include "Math/Functions.hpp"
+#include "UniqueIdentifier.hpp"
+#include "VulkanTypes.hpp"
+
+#include <algorithm>
+#include <entt.hpp>
+#include <vector>
+
+InstanceRegistry::InstanceRegistry(ECS::Scene& aScene, UniqueIdentifier aModelIdentifier)
+	: mScene{aScene}
+	, mModelIdentifier{aModelIdentifier}
+{
+	entt::registry& registry = mScene.GetEntityContainer()->mRegistry;
+	registry.on_construct<ECS::InstancedMeshComponent>().connect<&InstanceRegistry::OnInstanceConstructed>(*this);
+	registry.on_update<ECS::InstancedMeshComponent>().connect<&InstanceRegistry::OnInstanceUpdated>(*this);
+	registry.on_destroy<ECS::InstancedMeshComponent>().connect<&InstanceRegistry::OnInstanceDestroyed>(*this);
+	registry.on_construct<ECS::TransformComponent>().connect<&InstanceRegistry::OnTransformConstructed>(*this);
+	registry.on_update<ECS::TransformComponent>().connect<&InstanceRegistry::OnTransformUpdated>(*this);
+	registry.on_destroy<ECS::TransformComponent>().connect<&InstanceRegistry::OnTransformDestroyed>(*this);
+
+	// Pick up the instances that already exist
+	for (const entt::entity entity : registry.view<ECS::TransformComponent, ECS::InstancedMeshComponent>())
+	{
+		OnInstanceConstructed(registry, entity);
+	}
+
+	Update(1.0f);
+}
+
+InstanceRegistry::~InstanceRegistry()
+{
+	entt::registry& registry = mScene.GetEntityContainer()->mRegistry;
+	registry.on_construct<ECS::InstancedMeshComponent>().disconnect(this);
+	registry.on_update<ECS::InstancedMeshComponent>().disconnect(this);
+	registry.on_destroy<ECS::InstancedMeshComponent>().disconnect(this);
+	registry.on_construct<ECS::TransformComponent>().disconnect(this);
+	registry.on_update<ECS::TransformComponent>().disconnect(this);
+	registry.on_destroy<ECS::TransformComponent>().disconnect(this);
+}
+
+void InstanceRegistry::Update(float aInterpolationFactor)
+{
+	const Core::uint32 instanceCount = static_cast<Core::uint32>(mInstanceEntities.size());
+	mInstanceData.resize(instanceCount);
+	mIsInstanceInterpolated.resize(instanceCount, false);
+
+	// Instances that have been removed after they were marked can be left in the lists
+	std::erase_if(mDirtyInstances, [instanceCount](Core::uint32 aInstanceIndex) { return aInstanceIndex >= instanceCount; });
+	std::erase_if(mInterpolatedInstances, [instanceCount](Core::uint32 aInstanceIndex) { return aInstanceIndex >= instanceCount; });
+
+	const entt::registry& registry = mScene.GetEntityContainer()->mRegistry;
+	for (const Core::uint32 instanceIndex : mDirtyInstances)
+	{
+		mIsInstanceDirty[instanceIndex] = false;
+		if (mIsInstanceInterpolated[instanceIndex])
+		{
+			continue;
+		}
+
+		if (registry.all_of<ECS::InterpolationComponent>(mInstanceEntities[instanceIndex]))
+		{
+			mIsInstanceInterpolated[instanceIndex] = true;
+			mInterpolatedInstances.push_back(instanceIndex);
+			continue;
+		}
+
+		const ECS::TransformComponent& transform = registry.get<ECS::TransformComponent>(mInstanceEntities[instanceIndex]);
+		mInstanceData[instanceIndex].mPosition = transform.mPosition;
+		mInstanceData[instanceIndex].mScale = transform.mScale.x;
+		mUploadInstances.push_back(instanceIndex);
+	}
+
+	mDirtyInstances.clear();
+
+	// Moving instances change between ticks as well, they are dropped once their last two ticks are the same
+	std::erase_if(mInterpolatedInstances, [this, &registry, aInterpolationFactor](Core::uint32 aInstanceIndex)
+	{
+		const entt::entity entity = mInstanceEntities[aInstanceIndex];
+		const ECS::TransformComponent& transform = registry.get<ECS::TransformComponent>(entity);
+		const ECS::InterpolationComponent* interpolation = registry.try_get<ECS::InterpolationComponent>(entity);
+		mUploadInstances.push_back(aInstanceIndex);
+
+		// The slot may have been taken over by another entity, or the component removed
+		if (!interpolation)
+		{
+			mInstanceData[aInstanceIndex].mPosition = transform.mPosition;
+			mInstanceData[aInstanceIndex].mScale = transform.mScale.x;
+			mIsInstanceInterpolated[aInstanceIndex] = false;
+			return true;
+		}
+
+		mInstanceData[aInstanceIndex].mPosition = Math::Mix(interpolation->mPreviousPosition, transform.mPosition, aInterpolationFactor);
+		mInstanceData[aInstanceIndex].mScale = Math::Mix(interpolation->mPreviousScale.x, transform.mScale.x, aInterpolationFactor);
+
+		const bool isAtRest = (interpolation->mPreviousPosition == transform.mPosition) && (interpolation->mPreviousScale.x == transform.mScale.x);
+		mIsInstanceInterpolated[aInstanceIndex] = !isAtRest;
+		return isAtRest;
+	});
+}
+
+void InstanceRegistry::MarkAllDirty()
+{
+	mUploadInstances.resize(mInstanceData.size());
+	for (Core::uint32 i = 0; i < mUploadInstances.size(); i++)
+	{
+		mUploadInstances[i] = i;
+	}
+}
+
+void InstanceRegistry::ClearDirtyInstances()
+{
+	mUploadInstances.clear();
+}
+
+void InstanceRegistry::OnInstanceConstructed(entt::registry& aRegistry, entt::entity aEntity)
+{
+	if (aRegistry.get<ECS::InstancedMeshComponent>(aEntity).mModelIdentifier != mModelIdentifier || !aRegistry.all_of<ECS::TransformComponent>(aEntity) || mInstanceIndices.contains(aEntity))
+	{
+		return;
+	}
+
+	const Core::uint32 instanceIndex = static_cast<Core::uint32>(mInstanceEntities.size());
+	mInstanceIndices[aEntity] = instanceIndex;
+	mInstanceEntities.push_back(aEntity);
+	mIsInstanceDirty.push_back(false);
+	MarkDirty(instanceIndex);
+}
+
+void InstanceRegistry::OnInstanceUpdated(entt::registry& aRegistry, entt::entity aEntity)
+{
+	// The model of the entity may have changed
+	const bool isTracked = mInstanceIndices.contains(aEntity);
+	const bool isInstanceOfModel = aRegistry.get<ECS::InstancedMeshComponent>(aEntity).mModelIdentifier == mModelIdentifier;
+	if (isTracked && !isInstanceOfModel)
+	{
+		OnInstanceDestroyed(aRegistry, aEntity);
+	}
+	else if (!isTracked && isInstanceOfModel)
+	{
+		OnInstanceConstructed(aRegistry, aEntity);
+	}
+}
+
+void InstanceRegistry::OnInstanceDestroyed(entt::registry& /*aRegistry*/, entt::entity aEntity)
+{
+	const auto iterator = mInstanceIndices.find(aEntity);
+	if (iterator == mInstanceIndices.end())
+	{
+		return;
+	}
+
+	// Keep the array dense by moving the last instance into the freed slot
+	const Core::uint32 instanceIndex = iterator->second;
+	const Core::uint32 lastInstanceIndex = static_cast<Core::uint32>(mInstanceEntities.size()) - 1;
+	mInstanceIndices.erase(iterator);
+	if (instanceIndex != lastInstanceIndex)
+	{
+		// Update reads the moved instance from its entity
+		const entt::entity lastEntity = mInstanceEntities[lastInstanceIndex];
+		mInstanceEntities[instanceIndex] = lastEntity;
+		mInstanceIndices[lastEntity] = instanceIndex;
+		MarkDirty(instanceIndex);
+	}
+
+	mInstanceEntities.pop_back();
+	mIsInstanceDirty.pop_back();
+}
+
+void InstanceRegistry::OnTransformConstructed(entt::registry& aRegistry, entt::entity aEntity)
+{
+	// The instance component may have been added first
+	if (aRegistry.all_of<ECS::InstancedMeshComponent>(aEntity))
+	{
+		OnInstanceConstructed(aRegistry, aEntity);
+	}
+}
+
+void InstanceRegistry::OnTransformUpdated(entt::registry& /*aRegistry*/, entt::entity aEntity)
+{
+	const auto iterator = mInstanceIndices.find(aEntity);
+	if (iterator != mInstanceIndices.end())
+	{
+		MarkDirty(iterator->second);
+	}
+}
+
+void InstanceRegistry::OnTransformDestroyed(entt::registry& aRegistry, entt::entity aEntity)
+{
+	// Update reads every instance's transform, so the entity stops being an instance with it
+	OnInstanceDestroyed(aRegistry, aEntity);
+}
+
+void InstanceRegistry::MarkDirty(Core::uint32 aInstanceIndex)
+{
+	if (!mIsInstanceDirty[aInstanceIndex])
+	{
+		mIsInstanceDirty[aInstanceIndex] = true;
+		mDirtyInstances.push_back(aInstanceIndex);
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Core/Types.hpp"
+#include "UniqueIdentifier.hpp"
+#include "VulkanTypes.hpp"
+
+#include <entt.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace ECS
+{
+	class Scene;
+}
+
+// Mirrors the entities with an ECS::InstancedMeshComponent of one model into a dense array of InstanceData.
+// Registry signals keep the instance slots up to date: new instances are appended, removed ones are swapped with the last instance,
+// and transform replacements mark their instance dirty, so only the instances that changed have to be uploaded.
+// An entity is an instance while it has both components, whichever of the two is added last or removed first.
+// The signals fire on the thread that simulates the scene and only touch the slots, the instance data is read from the scene by Update.
+// Instances with an ECS::InterpolationComponent are drawn between their last two simulation ticks, and uploaded every frame while they move.
+class InstanceRegistry
+{
+public:
+	InstanceRegistry(ECS::Scene& aScene, UniqueIdentifier aModelIdentifier);
+	~InstanceRegistry();
+
+	InstanceRegistry(const InstanceRegistry&) = delete;
+	InstanceRegistry& operator=(const InstanceRegistry&) = delete;
+
+	void Update(float aInterpolationFactor); // Copies the dirty and moving instances out of the scene, which must not be simulated meanwhile
+	void MarkAllDirty(); // Uploads every instance again, without reading the scene
+	void ClearDirtyInstances();
+
+	const std::vector<InstanceData>& GetInstanceData() const { return mInstanceData; }
+	const std::vector<Core::uint32>& GetDirtyInstances() const { return mUploadInstances; } // Indices changed since the last ClearDirtyInstances
+	Core::uint32 GetInstanceCount() const { return static_cast<Core::uint32>(mInstanceData.size()); } // As of the last Update
+
+private:
+	void OnInstanceConstructed(entt::registry& aRegistry, entt::entity aEntity);
+	void OnInstanceUpdated(entt::registry& aRegistry, entt::entity aEntity);
+	void OnInstanceDestroyed(entt::registry& aRegistry, entt::entity aEntity);
+	void OnTransformConstructed(entt::registry& aRegistry, entt::entity aEntity);
+	void OnTransformUpdated(entt::registry& aRegistry, entt::entity aEntity);
+	void OnTransformDestroyed(entt::registry& aRegistry, entt::entity aEntity);
+	void MarkDirty(Core::uint32 aInstanceIndex);
+
+	ECS::Scene& mScene;
+	UniqueIdentifier mModelIdentifier;
+
+	// Written by the signals
+	std::vector<entt::entity> mInstanceEntities; // Entity of every instance, to move the last instance into the slot of a removed one
+	std::vector<Core::uint32> mDirtyInstances;
+	std::vector<bool> mIsInstanceDirty;
+	std::unordered_map<entt::entity, Core::uint32> mInstanceIndices;
+
+	// Written by Update, read by the renderer while the scene is simulated
+	std::vector<InstanceData> mInstanceData;
+	std::vector<Core::uint32> mUploadInstances;
+	std::vector<Core::uint32> mInterpolatedInstances; // Instances that haven't come to rest since their last tick
+	std::vector<bool> mIsInstanceInterpolated;
+};
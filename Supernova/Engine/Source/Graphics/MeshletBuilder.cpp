@@ -0,0 +1,285 @@
+#include "MeshletBuilder.hpp"
+
+#include "Core/Types.hpp"
+#include "Math/Functions.hpp"
+#include "Math/Types.hpp"
+#include "VulkanGlTFTypes.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace MeshletBuilderLocal
+{
+	static constexpr Core::uint32 gNoMeshlet = std::numeric_limits<Core::uint32>::max();
+	static constexpr Core::uint32 gNoTriangle = std::numeric_limits<Core::uint32>::max();
+	static constexpr float gMinConeDot = 0.1f; // Cones wider than this are close to a hemisphere and are back facing from almost nowhere
+	static constexpr float gEpsilon = 1e-12f;
+
+	// Triangles referencing each vertex of a primitive, vertices are relative to the smallest index of the primitive
+	struct TriangleAdjacency
+	{
+		std::vector<Core::uint32> mOffsets;
+		std::vector<Core::uint32> mTriangles;
+	};
+
+	static TriangleAdjacency BuildAdjacency(std::span<const Core::uint32> aIndices, Core::uint32 aBaseVertex, Core::uint32 aVertexCount)
+	{
+		TriangleAdjacency adjacency;
+		adjacency.mOffsets.assign(aVertexCount + 1, 0);
+		for (const Core::uint32 index : aIndices)
+		{
+			adjacency.mOffsets[index - aBaseVertex + 1]++;
+		}
+
+		for (Core::size i = 1; i < adjacency.mOffsets.size(); i++)
+		{
+			adjacency.mOffsets[i] += adjacency.mOffsets[i - 1];
+		}
+
+		std::vector<Core::uint32> cursors(adjacency.mOffsets.begin(), adjacency.mOffsets.end() - 1);
+		adjacency.mTriangles.resize(aIndices.size());
+		for (Core::size i = 0; i < aIndices.size(); i++)
+		{
+			adjacency.mTriangles[cursors[aIndices[i] - aBaseVertex]++] = static_cast<Core::uint32>(i / 3);
+		}
+
+		return adjacency;
+	}
+
+	static void ComputeBounds(vkglTF::Meshlet& aMeshlet, std::span<const Core::uint32> aIndices, std::span<const vkglTF::Vertex> aVertices, bool aCanBeBackFaceCulled)
+	{
+		Math::Vector3f min{std::numeric_limits<float>::max()};
+		Math::Vector3f max{std::numeric_limits<float>::lowest()};
+		for (const Core::uint32 index : aIndices)
+		{
+			min = Math::Min(min, aVertices[index].mPosition);
+			max = Math::Max(max, aVertices[index].mPosition);
+		}
+
+		const Math::Vector3f center = (min + max) * 0.5f;
+		float radius = 0.0f;
+		for (const Core::uint32 index : aIndices)
+		{
+			radius = std::max(radius, Math::Distance(center, aVertices[index].mPosition));
+		}
+
+		aMeshlet.mCenter = center;
+		aMeshlet.mRadius = radius;
+		aMeshlet.mConeApex = center;
+		aMeshlet.mConeAxis = Math::Vector3f{0.0f, 0.0f, 1.0f};
+		aMeshlet.mConeCutoff = 1.0f;
+
+		if (!aCanBeBackFaceCulled)
+		{
+			return;
+		}
+
+		std::vector<Math::Vector3f> normals;
+		std::vector<Math::Vector3f> centroids;
+		normals.reserve(aIndices.size() / 3);
+		centroids.reserve(aIndices.size() / 3);
+		Math::Vector3f normalSum{0.0f};
+		for (Core::size i = 0; i + 2 < aIndices.size(); i += 3)
+		{
+			const vkglTF::Vertex& vertex0 = aVertices[aIndices[i]];
+			const vkglTF::Vertex& vertex1 = aVertices[aIndices[i + 1]];
+			const vkglTF::Vertex& vertex2 = aVertices[aIndices[i + 2]];
+
+			Math::Vector3f normal = Math::Cross(vertex1.mPosition - vertex0.mPosition, vertex2.mPosition - vertex0.mPosition);
+			const float area = Math::Length(normal);
+			if (area <= gEpsilon)
+			{
+				continue;
+			}
+
+			normal /= area;
+
+			// Positions can be mirrored by FlipY without changing the winding, the vertex normals tell which side is the front
+			if (Math::Dot(normal, vertex0.mNormal + vertex1.mNormal + vertex2.mNormal) < 0.0f)
+			{
+				normal = -normal;
+			}
+
+			normals.push_back(normal);
+			centroids.push_back((vertex0.mPosition + vertex1.mPosition + vertex2.mPosition) / 3.0f);
+			normalSum += normal;
+		}
+
+		const float normalSumLength = Math::Length(normalSum);
+		if (normals.empty() || normalSumLength <= gEpsilon)
+		{
+			return;
+		}
+
+		const Math::Vector3f axis = normalSum / normalSumLength;
+		float minDot = 1.0f;
+		for (const Math::Vector3f& normal : normals)
+		{
+			minDot = std::min(minDot, Math::Dot(axis, normal));
+		}
+
+		if (minDot <= gMinConeDot)
+		{
+			return;
+		}
+
+		// Move the apex back along the axis until it lies behind every triangle plane, a camera inside the cone behind it then sees only back faces
+		float apexDistance = 0.0f;
+		for (Core::size i = 0; i < normals.size(); i++)
+		{
+			apexDistance = std::max(apexDistance, Math::Dot(centroids[i] - center, normals[i]) / Math::Dot(axis, normals[i]));
+		}
+
+		aMeshlet.mConeApex = center - axis * apexDistance;
+		aMeshlet.mConeAxis = axis;
+		aMeshlet.mConeCutoff = std::sqrt(1.0f - minDot * minDot);
+	}
+
+	// Greedily grows each meshlet with the unemitted triangle that adds the fewest new vertices, which keeps meshlets spatially compact and their bounds tight
+	static void BuildPrimitiveMeshlets(vkglTF::Meshlets& aMeshlets, vkglTF::Primitive& aPrimitive, Core::uint32 aMaterialIndex, std::span<Core::uint32> aIndices, std::span<const vkglTF::Vertex> aVertices)
+	{
+		const std::span<Core::uint32> primitiveIndices = aIndices.subspan(aPrimitive.firstIndex, aPrimitive.indexCount - aPrimitive.indexCount % 3);
+		const Core::uint32 triangleCount = static_cast<Core::uint32>(primitiveIndices.size() / 3);
+		const auto [minIndex, maxIndex] = std::minmax_element(primitiveIndices.begin(), primitiveIndices.end());
+		const Core::uint32 baseVertex = *minIndex;
+		const TriangleAdjacency adjacency = BuildAdjacency(primitiveIndices, baseVertex, *maxIndex - baseVertex + 1);
+
+		const Core::uint32 firstMeshlet = static_cast<Core::uint32>(aMeshlets.mData.size());
+		const Core::uint32 drawIndex = aMeshlets.mDrawCount;
+		std::vector<bool> isTriangleEmitted(triangleCount, false);
+		std::vector<Core::uint32> vertexMeshlets(*maxIndex - baseVertex + 1, gNoMeshlet); // Meshlet each vertex was last added to
+		std::vector<Core::uint32> meshletVertices;
+		std::vector<Core::uint32> reorderedIndices;
+		meshletVertices.reserve(MeshletBuilder::gMaxMeshletVertices);
+		reorderedIndices.reserve(primitiveIndices.size());
+		Core::uint32 meshletIndex = 0;
+		Core::uint32 meshletTriangleCount = 0;
+		Core::uint32 emittedTriangleCount = 0;
+		Core::uint32 nextSeedTriangle = 0;
+
+		const auto countNewVertices = [&](Core::uint32 aTriangle)
+		{
+			Core::uint32 newVertexCount = 0;
+			for (Core::uint32 i = 0; i < 3; i++)
+			{
+				newVertexCount += vertexMeshlets[primitiveIndices[aTriangle * 3 + i] - baseVertex] != meshletIndex ? 1 : 0;
+			}
+
+			return newVertexCount;
+		};
+
+		const auto finishMeshlet = [&]()
+		{
+			const Core::size firstReorderedIndex = reorderedIndices.size() - meshletTriangleCount * 3;
+			vkglTF::Meshlet meshlet{};
+			meshlet.mFirstIndex = aPrimitive.firstIndex + static_cast<Core::uint32>(firstReorderedIndex);
+			meshlet.mIndexCount = meshletTriangleCount * 3;
+			meshlet.mDrawIndex = drawIndex;
+			meshlet.mFirstDrawMeshlet = firstMeshlet;
+			meshlet.mMaterialIndex = aMaterialIndex;
+			ComputeBounds(meshlet, std::span<const Core::uint32>{reorderedIndices}.subspan(firstReorderedIndex), aVertices, !aPrimitive.material.mIsDoubleSided);
+			aMeshlets.mData.push_back(meshlet);
+
+			meshletVertices.clear();
+			meshletTriangleCount = 0;
+			meshletIndex++;
+		};
+
+		while (emittedTriangleCount < triangleCount)
+		{
+			Core::uint32 bestTriangle = gNoTriangle;
+			Core::uint32 bestNewVertexCount = 4;
+			for (const Core::uint32 vertex : meshletVertices)
+			{
+				for (Core::uint32 i = adjacency.mOffsets[vertex - baseVertex]; i < adjacency.mOffsets[vertex - baseVertex + 1] && bestNewVertexCount > 0; i++)
+				{
+					const Core::uint32 triangle = adjacency.mTriangles[i];
+					if (isTriangleEmitted[triangle])
+					{
+						continue;
+					}
+
+					const Core::uint32 newVertexCount = countNewVertices(triangle);
+					if (newVertexCount < bestNewVertexCount)
+					{
+						bestTriangle = triangle;
+						bestNewVertexCount = newVertexCount;
+					}
+				}
+			}
+
+			// Nothing connected is left, continue with the next triangle in index order
+			if (bestTriangle == gNoTriangle)
+			{
+				while (isTriangleEmitted[nextSeedTriangle])
+				{
+					nextSeedTriangle++;
+				}
+
+				bestTriangle = nextSeedTriangle;
+				bestNewVertexCount = countNewVertices(bestTriangle);
+			}
+
+			if (meshletVertices.size() + bestNewVertexCount > MeshletBuilder::gMaxMeshletVertices || meshletTriangleCount == MeshletBuilder::gMaxMeshletTriangles)
+			{
+				finishMeshlet();
+			}
+
+			for (Core::uint32 i = 0; i < 3; i++)
+			{
+				const Core::uint32 index = primitiveIndices[bestTriangle * 3 + i];
+				if (vertexMeshlets[index - baseVertex] != meshletIndex)
+				{
+					vertexMeshlets[index - baseVertex] = meshletIndex;
+					meshletVertices.push_back(index);
+				}
+
+				reorderedIndices.push_back(index);
+			}
+
+			isTriangleEmitted[bestTriangle] = true;
+			emittedTriangleCount++;
+			meshletTriangleCount++;
+		}
+
+		if (meshletTriangleCount > 0)
+		{
+			finishMeshlet();
+		}
+
+		std::copy(reorderedIndices.begin(), reorderedIndices.end(), primitiveIndices.begin());
+
+		aPrimitive.mFirstMeshlet = firstMeshlet;
+		aPrimitive.mMeshletCount = static_cast<Core::uint32>(aMeshlets.mData.size()) - firstMeshlet;
+		aPrimitive.mMeshletDrawIndex = drawIndex;
+		aMeshlets.mDrawCount++;
+	}
+}
+
+namespace MeshletBuilder
+{
+	void BuildMeshlets(vkglTF::Model& aModel, std::span<Core::uint32> aIndices, std::span<const vkglTF::Vertex> aVertices)
+	{
+		aModel.meshlets.mData.clear();
+		aModel.meshlets.mDrawCount = 0;
+
+		for (vkglTF::Node* node : aModel.linearNodes)
+		{
+			if (!node->mMesh)
+			{
+				continue;
+			}
+
+			for (vkglTF::Primitive* primitive : node->mMesh->mPrimitives)
+			{
+				if (primitive->indexCount >= 3)
+				{
+					MeshletBuilderLocal::BuildPrimitiveMeshlets(aModel.meshlets, *primitive, static_cast<Core::uint32>(&primitive->material - aModel.materials.data()), aIndices, aVertices);
+				}
+			}
+		}
+	}
+}
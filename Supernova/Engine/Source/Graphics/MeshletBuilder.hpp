@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Core/Types.hpp"
+#include "VulkanGlTFTypes.hpp"
+
+#include <span>
+
+// Splits the triangles of large meshes into small clusters with a bounding sphere and a normal cone each, so they can be culled on the GPU
+namespace MeshletBuilder
+{
+	static constexpr Core::uint32 gMaxMeshletVertices = 64;
+	static constexpr Core::uint32 gMaxMeshletTriangles = 124;
+
+	// Builds the meshlets of every primitive of the model into aModel.meshlets and reorders the triangles inside each primitive's index range so every meshlet is contiguous.
+	// Bounds are computed from the positions as they are stored in aVertices.
+	void BuildMeshlets(vkglTF::Model& aModel, std::span<Core::uint32> aIndices, std::span<const vkglTF::Vertex> aVertices);
+}
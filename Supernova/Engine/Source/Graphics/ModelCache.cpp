@@ -0,0 +1,670 @@
+#include "ModelCache.hpp"
+
+#include "Core/BitmaskOperators.hpp"
+#include "Core/Types.hpp"
+#include "FileLoader.hpp"
+#include "MappedFile.hpp"
+#include "Math/Types.hpp"
+#include "ModelFlags.hpp"
+#include "VulkanGlTFTypes.hpp"
+
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace ModelCacheLocal
+{
+	static constexpr Core::int32 gNoTexture = -1;
+	static constexpr Core::int32 gEmptyTexture = -2; // Material points at vkglTF::Model::mEmptyTexture
+	static constexpr Core::int32 gNoNode = -1;
+
+	class BinaryWriter
+	{
+	public:
+		template<typename T>
+		void Write(const T& aValue)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&aValue);
+			mData.insert(mData.end(), bytes, bytes + sizeof(T));
+		}
+
+		template<typename T>
+		void WriteArray(std::span<const T> aValues)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			Write<Core::uint64>(aValues.size());
+			const unsigned char* bytes = reinterpret_cast<const unsigned char*>(aValues.data());
+			mData.insert(mData.end(), bytes, bytes + aValues.size_bytes());
+		}
+
+		void WriteString(const std::string& aValue)
+		{
+			WriteArray(std::span<const char>{aValue});
+		}
+
+		const std::vector<unsigned char>& GetData() const { return mData; }
+
+	private:
+		std::vector<unsigned char> mData;
+	};
+
+	class BinaryReader
+	{
+	public:
+		explicit BinaryReader(std::span<const unsigned char> aData) : mData{aData}, mOffset{0} {}
+
+		template<typename T>
+		T Read()
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			T value;
+			std::memcpy(&value, Consume(sizeof(T)), sizeof(T));
+			return value;
+		}
+
+		template<typename T>
+		std::vector<T> ReadArray()
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			const Core::uint64 count = Read<Core::uint64>();
+			if (count > (mData.size() - mOffset) / sizeof(T))
+			{
+				throw std::runtime_error("Cooked model array exceeds the metadata");
+			}
+
+			std::vector<T> values(count);
+			if (count > 0)
+			{
+				std::memcpy(values.data(), Consume(count * sizeof(T)), count * sizeof(T));
+			}
+
+			return values;
+		}
+
+		std::string ReadString()
+		{
+			const std::vector<char> characters = ReadArray<char>();
+			return std::string{characters.begin(), characters.end()};
+		}
+
+	private:
+		const unsigned char* Consume(Core::size aSize)
+		{
+			if (aSize > mData.size() - mOffset)
+			{
+				throw std::runtime_error("Unexpected end of cooked model metadata");
+			}
+
+			const unsigned char* data = mData.data() + mOffset;
+			mOffset += aSize;
+			return data;
+		}
+
+		std::span<const unsigned char> mData;
+		Core::size mOffset;
+	};
+
+	static Core::uint64 AlignUp(Core::uint64 aValue, Core::uint64 aAlignment)
+	{
+		return (aValue + aAlignment - 1) & ~(aAlignment - 1);
+	}
+
+	static bool GetSourceStamp(const std::filesystem::path& aSourcePath, Core::uint64& aSize, Core::int64& aWriteTime)
+	{
+		std::error_code error;
+		aSize = std::filesystem::file_size(aSourcePath, error);
+		if (error)
+		{
+			return false;
+		}
+
+		aWriteTime = static_cast<Core::int64>(std::filesystem::last_write_time(aSourcePath, error).time_since_epoch().count());
+		return !error;
+	}
+
+	static Core::int32 GetTextureIndex(const vkglTF::Model& aModel, const vkglTF::Texture* aTexture)
+	{
+		if (!aTexture)
+		{
+			return gNoTexture;
+		}
+
+		if (aTexture == &aModel.mEmptyTexture)
+		{
+			return gEmptyTexture;
+		}
+
+		return static_cast<Core::int32>(aTexture - aModel.textures.data());
+	}
+
+	static vkglTF::Texture* GetTexture(vkglTF::Model& aModel, Core::int32 aIndex)
+	{
+		if (aIndex == gEmptyTexture)
+		{
+			return &aModel.mEmptyTexture;
+		}
+
+		if (aIndex < 0 || static_cast<Core::size>(aIndex) >= aModel.textures.size())
+		{
+			return nullptr;
+		}
+
+		return &aModel.textures[aIndex];
+	}
+
+	static vkglTF::Node* FindNode(const std::unordered_map<Core::uint32, vkglTF::Node*>& aNodes, Core::int32 aIndex)
+	{
+		const std::unordered_map<Core::uint32, vkglTF::Node*>::const_iterator it = aNodes.find(static_cast<Core::uint32>(aIndex));
+		return aIndex != gNoNode && it != aNodes.end() ? it->second : nullptr;
+	}
+
+	static void WriteVertexLayout(BinaryWriter& aWriter, const vkglTF::VertexLayout& aVertexLayout)
+	{
+		aWriter.Write<Core::uint8>(aVertexLayout.mIsQuantized);
+		aWriter.WriteArray(std::span<const vkglTF::VertexComponent>{aVertexLayout.mComponents});
+	}
+
+	static vkglTF::VertexLayout ReadVertexLayout(BinaryReader& aReader)
+	{
+		const bool isQuantized = aReader.Read<Core::uint8>() != 0;
+		return vkglTF::VertexLayout{aReader.ReadArray<vkglTF::VertexComponent>(), isQuantized};
+	}
+
+	static void WriteImages(BinaryWriter& aWriter, const std::vector<vkglTF::Image>& aImages)
+	{
+		aWriter.Write<Core::uint64>(aImages.size());
+		for (const vkglTF::Image& image : aImages)
+		{
+			aWriter.WriteString(image.uri.generic_string());
+			aWriter.WriteString(image.name);
+			aWriter.Write(image.layers);
+			aWriter.Write(image.width);
+			aWriter.Write(image.height);
+			aWriter.Write(image.component);
+			aWriter.WriteArray(std::span<const unsigned char>{image.image});
+		}
+	}
+
+	static void ReadImages(BinaryReader& aReader, std::vector<vkglTF::Image>& aImages)
+	{
+		aImages.resize(aReader.Read<Core::uint64>());
+		for (vkglTF::Image& image : aImages)
+		{
+			image.uri = aReader.ReadString();
+			image.name = aReader.ReadString();
+			image.layers = aReader.Read<unsigned int>();
+			image.width = aReader.Read<unsigned int>();
+			image.height = aReader.Read<unsigned int>();
+			image.component = aReader.Read<unsigned int>();
+			image.image = aReader.ReadArray<unsigned char>();
+		}
+	}
+
+	static void WriteMaterials(BinaryWriter& aWriter, const vkglTF::Model& aModel)
+	{
+		aWriter.Write<Core::uint64>(aModel.materials.size());
+		for (const vkglTF::Material& material : aModel.materials)
+		{
+			aWriter.Write(material.mAlphaMode);
+			aWriter.Write(material.mAlphaCutoff);
+			aWriter.Write<Core::uint8>(material.mIsDoubleSided);
+			aWriter.Write(material.mMetallicFactor);
+			aWriter.Write(material.mRoughnessFactor);
+			aWriter.Write(material.mBaseColorFactor);
+			aWriter.Write(GetTextureIndex(aModel, material.mBaseColorTexture));
+			aWriter.Write(GetTextureIndex(aModel, material.mMetallicRoughnessTexture));
+			aWriter.Write(GetTextureIndex(aModel, material.mNormalTexture));
+			aWriter.Write(GetTextureIndex(aModel, material.mOcclusionTexture));
+			aWriter.Write(GetTextureIndex(aModel, material.mEmissiveTexture));
+			aWriter.Write(GetTextureIndex(aModel, material.mSpecularGlossinessTexture));
+			aWriter.Write(GetTextureIndex(aModel, material.mDiffuseTexture));
+		}
+	}
+
+	static void ReadMaterials(BinaryReader& aReader, vkglTF::Model& aModel, VulkanDevice* aDevice)
+	{
+		const Core::uint64 materialCount = aReader.Read<Core::uint64>();
+		aModel.materials.reserve(materialCount);
+		for (Core::uint64 i = 0; i < materialCount; i++)
+		{
+			vkglTF::Material material(aDevice);
+			material.mAlphaMode = aReader.Read<vkglTF::Material::AlphaMode>();
+			material.mAlphaCutoff = aReader.Read<float>();
+			material.mIsDoubleSided = aReader.Read<Core::uint8>() != 0;
+			material.mMetallicFactor = aReader.Read<float>();
+			material.mRoughnessFactor = aReader.Read<float>();
+			material.mBaseColorFactor = aReader.Read<Math::Vector4f>();
+			material.mBaseColorTexture = GetTexture(aModel, aReader.Read<Core::int32>());
+			material.mMetallicRoughnessTexture = GetTexture(aModel, aReader.Read<Core::int32>());
+			material.mNormalTexture = GetTexture(aModel, aReader.Read<Core::int32>());
+			material.mOcclusionTexture = GetTexture(aModel, aReader.Read<Core::int32>());
+			material.mEmissiveTexture = GetTexture(aModel, aReader.Read<Core::int32>());
+			material.mSpecularGlossinessTexture = GetTexture(aModel, aReader.Read<Core::int32>());
+			material.mDiffuseTexture = GetTexture(aModel, aReader.Read<Core::int32>());
+			aModel.materials.push_back(material);
+		}
+	}
+
+	// Nodes are stored in linearNodes order, which lists every child before its parent and keeps siblings in order
+	static void WriteNodes(BinaryWriter& aWriter, const vkglTF::Model& aModel)
+	{
+		std::unordered_map<const vkglTF::Node*, Core::int32> nodePositions;
+		for (Core::size i = 0; i < aModel.linearNodes.size(); i++)
+		{
+			nodePositions.emplace(aModel.linearNodes[i], static_cast<Core::int32>(i));
+		}
+
+		aWriter.Write<Core::uint64>(aModel.linearNodes.size());
+		for (const vkglTF::Node* node : aModel.linearNodes)
+		{
+			aWriter.Write(node->mParent ? nodePositions.at(node->mParent) : gNoNode);
+			aWriter.Write(node->mIndex);
+			aWriter.WriteString(node->mName);
+			aWriter.Write(node->mSkinIndex);
+			aWriter.Write(node->mMatrix);
+			aWriter.Write(node->mTranslation);
+			aWriter.Write(node->mScale);
+			aWriter.Write(node->mRotation);
+			aWriter.Write<Core::uint8>(node->mMesh != nullptr);
+
+			if (node->mMesh)
+			{
+				aWriter.WriteString(node->mMesh->mName);
+				aWriter.Write<Core::uint64>(node->mMesh->mPrimitives.size());
+				for (const vkglTF::Primitive* primitive : node->mMesh->mPrimitives)
+				{
+					aWriter.Write(primitive->firstIndex);
+					aWriter.Write(primitive->indexCount);
+					aWriter.Write(primitive->firstVertex);
+					aWriter.Write(primitive->vertexCount);
+					aWriter.Write(primitive->mFirstMeshlet);
+					aWriter.Write(primitive->mMeshletCount);
+					aWriter.Write(primitive->mMeshletDrawIndex);
+					aWriter.Write(static_cast<Core::uint32>(&primitive->material - aModel.materials.data()));
+					aWriter.Write(primitive->mDimensions.mMin);
+					aWriter.Write(primitive->mDimensions.mMax);
+				}
+			}
+		}
+	}
+
+	static void ReadNodes(BinaryReader& aReader, vkglTF::Model& aModel, VulkanDevice* aDevice)
+	{
+		const Core::uint64 nodeCount = aReader.Read<Core::uint64>();
+		std::vector<Core::int32> parentPositions;
+		parentPositions.reserve(nodeCount);
+		aModel.linearNodes.reserve(nodeCount);
+		for (Core::uint64 i = 0; i < nodeCount; i++)
+		{
+			vkglTF::Node* newNode = new vkglTF::Node{};
+			aModel.linearNodes.push_back(newNode);
+			parentPositions.push_back(aReader.Read<Core::int32>());
+			newNode->mIndex = aReader.Read<Core::uint32>();
+			newNode->mName = aReader.ReadString();
+			newNode->mSkinIndex = aReader.Read<Core::int32>();
+			newNode->mMatrix = aReader.Read<Math::Matrix4f>();
+			newNode->mTranslation = aReader.Read<Math::Vector3f>();
+			newNode->mScale = aReader.Read<Math::Vector3f>();
+			newNode->mRotation = aReader.Read<Math::Quaternionf>();
+
+			if (aReader.Read<Core::uint8>() != 0)
+			{
+				vkglTF::Mesh* newMesh = new vkglTF::Mesh(aDevice, newNode->mMatrix);
+				newNode->mMesh = newMesh;
+				newMesh->mName = aReader.ReadString();
+				const Core::uint64 primitiveCount = aReader.Read<Core::uint64>();
+				for (Core::uint64 j = 0; j < primitiveCount; j++)
+				{
+					const Core::uint32 firstIndex = aReader.Read<Core::uint32>();
+					const Core::uint32 indexCount = aReader.Read<Core::uint32>();
+					const Core::uint32 firstVertex = aReader.Read<Core::uint32>();
+					const Core::uint32 vertexCount = aReader.Read<Core::uint32>();
+					const Core::uint32 firstMeshlet = aReader.Read<Core::uint32>();
+					const Core::uint32 meshletCount = aReader.Read<Core::uint32>();
+					const Core::uint32 meshletDrawIndex = aReader.Read<Core::uint32>();
+					const Core::uint32 materialIndex = aReader.Read<Core::uint32>();
+					const Math::Vector3f min = aReader.Read<Math::Vector3f>();
+					const Math::Vector3f max = aReader.Read<Math::Vector3f>();
+
+					vkglTF::Primitive* newPrimitive = new vkglTF::Primitive(firstIndex, indexCount, aModel.materials.at(materialIndex));
+					newPrimitive->firstVertex = firstVertex;
+					newPrimitive->vertexCount = vertexCount;
+					newPrimitive->mFirstMeshlet = firstMeshlet;
+					newPrimitive->mMeshletCount = meshletCount;
+					newPrimitive->mMeshletDrawIndex = meshletDrawIndex;
+					newPrimitive->SetDimensions(min, max);
+					newMesh->mPrimitives.push_back(newPrimitive);
+				}
+			}
+		}
+
+		for (Core::uint64 i = 0; i < nodeCount; i++)
+		{
+			vkglTF::Node* node = aModel.linearNodes[i];
+			if (parentPositions[i] == gNoNode)
+			{
+				aModel.nodes.push_back(node);
+				continue;
+			}
+
+			node->mParent = aModel.linearNodes.at(parentPositions[i]);
+			node->mParent->mChildren.push_back(node);
+		}
+	}
+
+	static void WriteSkins(BinaryWriter& aWriter, const vkglTF::Model& aModel)
+	{
+		aWriter.Write<Core::uint64>(aModel.skins.size());
+		for (const vkglTF::Skin* skin : aModel.skins)
+		{
+			std::vector<Core::uint32> joints;
+			for (const vkglTF::Node* joint : skin->joints)
+			{
+				joints.push_back(joint->mIndex);
+			}
+
+			aWriter.WriteString(skin->mName);
+			aWriter.Write(skin->mSkeletonRoot ? static_cast<Core::int32>(skin->mSkeletonRoot->mIndex) : gNoNode);
+			aWriter.WriteArray(std::span<const Core::uint32>{joints});
+			aWriter.WriteArray(std::span<const Math::Matrix4f>{skin->inverseBindMatrices});
+		}
+	}
+
+	static void ReadSkins(BinaryReader& aReader, vkglTF::Model& aModel, const std::unordered_map<Core::uint32, vkglTF::Node*>& aNodes)
+	{
+		const Core::uint64 skinCount = aReader.Read<Core::uint64>();
+		for (Core::uint64 i = 0; i < skinCount; i++)
+		{
+			vkglTF::Skin* newSkin = new vkglTF::Skin{};
+			aModel.skins.push_back(newSkin);
+			newSkin->mName = aReader.ReadString();
+			newSkin->mSkeletonRoot = FindNode(aNodes, aReader.Read<Core::int32>());
+
+			for (const Core::uint32 joint : aReader.ReadArray<Core::uint32>())
+			{
+				newSkin->joints.push_back(FindNode(aNodes, static_cast<Core::int32>(joint)));
+			}
+
+			newSkin->inverseBindMatrices = aReader.ReadArray<Math::Matrix4f>();
+		}
+	}
+
+	static void WriteAnimations(BinaryWriter& aWriter, const vkglTF::Model& aModel)
+	{
+		aWriter.Write<Core::uint64>(aModel.animations.size());
+		for (const vkglTF::Animation& animation : aModel.animations)
+		{
+			aWriter.WriteString(animation.mName);
+			aWriter.Write(animation.mStart);
+			aWriter.Write(animation.mEnd);
+
+			aWriter.WriteArray(std::span<const vkglTF::AnimationSampler>{animation.mSamplers});
+			aWriter.WriteArray(std::span<const float>{animation.mTimes});
+			aWriter.WriteArray(std::span<const Core::uint16>{animation.mValues});
+
+			aWriter.Write<Core::uint64>(animation.mChannels.size());
+			for (const vkglTF::AnimationChannel& channel : animation.mChannels)
+			{
+				aWriter.Write(channel.mPathType);
+				aWriter.Write(channel.mNode->mIndex);
+				aWriter.Write(channel.mSamplerIndex);
+			}
+		}
+	}
+
+	static void ReadAnimations(BinaryReader& aReader, vkglTF::Model& aModel, const std::unordered_map<Core::uint32, vkglTF::Node*>& aNodes)
+	{
+		aModel.animations.resize(aReader.Read<Core::uint64>());
+		for (vkglTF::Animation& animation : aModel.animations)
+		{
+			animation.mName = aReader.ReadString();
+			animation.mStart = aReader.Read<float>();
+			animation.mEnd = aReader.Read<float>();
+
+			animation.mSamplers = aReader.ReadArray<vkglTF::AnimationSampler>();
+			animation.mTimes = aReader.ReadArray<float>();
+			animation.mValues = aReader.ReadArray<Core::uint16>();
+
+			animation.mChannels.resize(aReader.Read<Core::uint64>());
+			for (vkglTF::AnimationChannel& channel : animation.mChannels)
+			{
+				channel.mPathType = aReader.Read<vkglTF::AnimationChannel::PathType>();
+				channel.mNode = FindNode(aNodes, static_cast<Core::int32>(aReader.Read<Core::uint32>()));
+				channel.mSamplerIndex = aReader.Read<Core::uint32>();
+			}
+		}
+	}
+
+	// Frees whatever a failed read has allocated, nodes may not be linked to their parents yet so every node is deleted on its own
+	static void DiscardModel(vkglTF::Model& aModel)
+	{
+		for (vkglTF::Node* node : aModel.linearNodes)
+		{
+			node->mChildren.clear();
+			delete node;
+		}
+
+		for (vkglTF::Skin* skin : aModel.skins)
+		{
+			delete skin;
+		}
+
+		aModel.nodes.clear();
+		aModel.linearNodes.clear();
+		aModel.skins.clear();
+		aModel.textures.clear();
+		aModel.materials.clear();
+		aModel.animations.clear();
+		aModel.meshlets.mData.clear();
+		aModel.meshlets.mDrawCount = 0;
+		aModel.mHierarchy = vkglTF::NodeHierarchy{};
+		aModel.mDimensions = vkglTF::Dimensions{};
+		aModel.mVertexLayout = vkglTF::VertexLayout{};
+	}
+
+	static bool ReadModel(const std::filesystem::path& aSourcePath, FileLoadingFlags aFileLoadingFlags, float aScale, const vkglTF::VertexLayout& aVertexLayout, VulkanDevice* aDevice, vkglTF::Model& aModel, std::vector<vkglTF::Image>& aImages, ModelCache::CookedModel& aCookedModel)
+	{
+		Core::uint64 sourceSize = 0;
+		Core::int64 sourceWriteTime = 0;
+		const std::filesystem::path cookedPath = ModelCache::GetCookedModelPath(aSourcePath, aFileLoadingFlags, aScale);
+		if (!GetSourceStamp(aSourcePath, sourceSize, sourceWriteTime) || !std::filesystem::exists(cookedPath))
+		{
+			return false;
+		}
+
+		MappedFile file{cookedPath};
+		if (file.GetSize() < sizeof(ModelCache::CookedModelHeader))
+		{
+			return false;
+		}
+
+		ModelCache::CookedModelHeader header;
+		std::memcpy(&header, file.GetData().data(), sizeof(header));
+
+		const bool isUpToDate = header.mMagic == ModelCache::gCookedModelMagic
+			&& header.mVersion == ModelCache::gCookedModelVersion
+			&& header.mFileLoadingFlags == static_cast<Core::uint32>(aFileLoadingFlags)
+			&& header.mScale == aScale
+			&& header.mSourceSize == sourceSize
+			&& header.mSourceWriteTime == sourceWriteTime;
+		if (!isUpToDate)
+		{
+			return false;
+		}
+
+		const Core::uint64 vertexBytes = header.mVertexCount * header.mVertexStride;
+		const Core::uint64 indexBytes = header.mIndexCount * sizeof(Core::uint32);
+		const bool isInBounds = header.mVertexOffset + vertexBytes <= file.GetSize()
+			&& header.mIndexOffset + indexBytes <= file.GetSize()
+			&& header.mMetadataOffset + header.mMetadataSize <= file.GetSize();
+		if (!isInBounds)
+		{
+			return false;
+		}
+
+		const std::span<const unsigned char> data = file.GetData();
+		BinaryReader reader{data.subspan(header.mMetadataOffset, header.mMetadataSize)};
+
+		// A layout without components accepts whatever attributes the model was cooked with
+		const vkglTF::VertexLayout vertexLayout = ReadVertexLayout(reader);
+		const bool isLayoutMatching = vertexLayout.mIsQuantized == aVertexLayout.mIsQuantized
+			&& (aVertexLayout.mComponents.empty() || vertexLayout.mComponents == aVertexLayout.mComponents)
+			&& vertexLayout.mStride == header.mVertexStride;
+		if (!isLayoutMatching)
+		{
+			return false;
+		}
+
+		aModel.mVertexLayout = vertexLayout;
+		ReadImages(reader, aImages);
+		aModel.textures.resize(aImages.size());
+		ReadMaterials(reader, aModel, aDevice);
+		ReadNodes(reader, aModel, aDevice);
+
+		std::unordered_map<Core::uint32, vkglTF::Node*> nodes;
+		for (vkglTF::Node* node : aModel.linearNodes)
+		{
+			nodes.emplace(node->mIndex, node);
+		}
+
+		ReadSkins(reader, aModel, nodes);
+		ReadAnimations(reader, aModel, nodes);
+		aModel.mDimensions = reader.Read<vkglTF::Dimensions>();
+		aModel.meshlets.mData = reader.ReadArray<vkglTF::Meshlet>();
+		aModel.meshlets.mDrawCount = reader.Read<Core::uint32>();
+
+		for (vkglTF::Node* node : aModel.linearNodes)
+		{
+			if (node->mSkinIndex > -1)
+			{
+				node->mSkin = aModel.skins.at(node->mSkinIndex);
+			}
+		}
+
+		// Initial pose
+		aModel.mHierarchy.Build(aModel.nodes);
+		aModel.UpdateNodes();
+
+		// The streams are only read when they are copied into the staging ring
+		aCookedModel.mVertices = data.subspan(header.mVertexOffset, vertexBytes);
+		aCookedModel.mIndices = std::span<const Core::uint32>{reinterpret_cast<const Core::uint32*>(data.data() + header.mIndexOffset), header.mIndexCount};
+		aCookedModel.mFile = std::move(file);
+
+		return true;
+	}
+}
+
+namespace ModelCache
+{
+	std::filesystem::path GetCookedModelPath(const std::filesystem::path& aSourcePath, FileLoadingFlags aFileLoadingFlags, float aScale)
+	{
+		// Models with the same name can live in different directories, so the full source path is part of the name.
+		// Vertices are scaled while cooking, so every scale a model is loaded at gets its own file
+		const Core::size pathHash = std::hash<std::string>{}(std::filesystem::absolute(aSourcePath).generic_string());
+		return FileLoader::GetEngineCachePath() / std::format("{}_{:016x}_{:x}_{:08x}.smodel", aSourcePath.stem().string(), pathHash, static_cast<unsigned int>(aFileLoadingFlags), std::bit_cast<Core::uint32>(aScale));
+	}
+
+	bool ReadCookedModel(const std::filesystem::path& aSourcePath, FileLoadingFlags aFileLoadingFlags, float aScale, const vkglTF::VertexLayout& aVertexLayout, VulkanDevice* aDevice, vkglTF::Model& aModel, std::vector<vkglTF::Image>& aImages, CookedModel& aCookedModel)
+	{
+		// A truncated or corrupt file is cooked again from the source instead of failing the load
+		try
+		{
+			return ModelCacheLocal::ReadModel(aSourcePath, aFileLoadingFlags, aScale, aVertexLayout, aDevice, aModel, aImages, aCookedModel);
+		}
+		catch (const std::exception& exception)
+		{
+			std::cerr << "Discarded cooked model of " << aSourcePath << ": " << exception.what() << std::endl;
+			ModelCacheLocal::DiscardModel(aModel);
+			aImages.clear();
+			aCookedModel = CookedModel{};
+			return false;
+		}
+	}
+
+	void WriteCookedModel(const std::filesystem::path& aSourcePath, FileLoadingFlags aFileLoadingFlags, float aScale, const vkglTF::Model& aModel, const std::vector<vkglTF::Image>& aImages, std::span<const unsigned char> aVertices, std::span<const Core::uint32> aIndices)
+	{
+		CookedModelHeader header{};
+		header.mMagic = gCookedModelMagic;
+		header.mVersion = gCookedModelVersion;
+		header.mFileLoadingFlags = static_cast<Core::uint32>(aFileLoadingFlags);
+		header.mScale = aScale;
+		header.mVertexStride = aModel.mVertexLayout.mStride;
+		if (!ModelCacheLocal::GetSourceStamp(aSourcePath, header.mSourceSize, header.mSourceWriteTime))
+		{
+			return;
+		}
+
+		ModelCacheLocal::BinaryWriter writer;
+		ModelCacheLocal::WriteVertexLayout(writer, aModel.mVertexLayout);
+		ModelCacheLocal::WriteImages(writer, aImages);
+		ModelCacheLocal::WriteMaterials(writer, aModel);
+		ModelCacheLocal::WriteNodes(writer, aModel);
+		ModelCacheLocal::WriteSkins(writer, aModel);
+		ModelCacheLocal::WriteAnimations(writer, aModel);
+		writer.Write(aModel.mDimensions);
+		writer.WriteArray(std::span<const vkglTF::Meshlet>{aModel.meshlets.mData});
+		writer.Write(aModel.meshlets.mDrawCount);
+
+		header.mVertexCount = aVertices.size() / header.mVertexStride;
+		header.mVertexOffset = ModelCacheLocal::AlignUp(sizeof(CookedModelHeader), gCookedStreamAlignment);
+		header.mIndexCount = aIndices.size();
+		header.mIndexOffset = ModelCacheLocal::AlignUp(header.mVertexOffset + aVertices.size_bytes(), gCookedStreamAlignment);
+		header.mMetadataOffset = ModelCacheLocal::AlignUp(header.mIndexOffset + aIndices.size_bytes(), gCookedStreamAlignment);
+		header.mMetadataSize = writer.GetData().size();
+
+		const std::filesystem::path cookedPath = GetCookedModelPath(aSourcePath, aFileLoadingFlags, aScale);
+		std::error_code error;
+		std::filesystem::create_directories(cookedPath.parent_path(), error);
+
+		// Several loads of the same model may cook at the same time, each writes its own file and the last rename wins
+		std::filesystem::path temporaryPath = cookedPath;
+		temporaryPath += std::format(".{:x}.tmp", std::hash<std::thread::id>{}(std::this_thread::get_id()));
+
+		{
+			std::ofstream stream{temporaryPath, std::ios::binary | std::ios::trunc};
+			const auto writeAt = [&stream](Core::uint64 aOffset, const void* aData, Core::size aSize)
+			{
+				// Zero padding up to the aligned offset
+				static constexpr char padding[gCookedStreamAlignment]{};
+				stream.write(padding, static_cast<std::streamsize>(aOffset - static_cast<Core::uint64>(stream.tellp())));
+				stream.write(static_cast<const char*>(aData), static_cast<std::streamsize>(aSize));
+			};
+
+			writeAt(0, &header, sizeof(header));
+			writeAt(header.mVertexOffset, aVertices.data(), aVertices.size_bytes());
+			writeAt(header.mIndexOffset, aIndices.data(), aIndices.size_bytes());
+			writeAt(header.mMetadataOffset, writer.GetData().data(), writer.GetData().size());
+
+			if (!stream)
+			{
+				std::cerr << "Could not write cooked model " << temporaryPath << std::endl;
+				stream.close();
+				std::filesystem::remove(temporaryPath, error);
+				return;
+			}
+		}
+
+		std::filesystem::rename(temporaryPath, cookedPath, error);
+		if (error)
+		{
+			std::cerr << "Could not write cooked model " << cookedPath << ": " << error.message() << std::endl;
+			std::filesystem::remove(temporaryPath, error);
+			return;
+		}
+
+		std::cout << "Cooked model " << aSourcePath.filename() << " to " << cookedPath.filename() << std::endl;
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Core/Types.hpp"
+#include "MappedFile.hpp"
+#include "ModelFlags.hpp"
+#include "VulkanGlTFTypes.hpp"
+
+#include <filesystem>
+#include <span>
+#include <vector>
+
+struct VulkanDevice;
+
+// Cooked models are the fully converted result of a glTF load, written once and memory-mapped on every following load.
+// The blob starts with a CookedModelHeader, followed by the vertex and index streams and the serialized nodes, materials, images, skins, animations and meshlets.
+namespace ModelCache
+{
+	static constexpr Core::uint32 gCookedModelMagic = 0x444D4E53; // "SNMD"
+	static constexpr Core::uint32 gCookedModelVersion = 6; // Bump whenever the layout of the blob or the packing of vertex components changes
+	static constexpr Core::size gCookedStreamAlignment = 16;
+
+	struct CookedModelHeader
+	{
+		Core::uint32 mMagic;
+		Core::uint32 mVersion;
+		Core::uint32 mFileLoadingFlags;
+		float mScale;
+		Core::uint64 mSourceSize; // Size and write time of the source file, a cooked model is stale once either changes
+		Core::int64 mSourceWriteTime;
+		Core::uint32 mVertexStride; // Stride of the model's vkglTF::VertexLayout
+		Core::uint32 mReserved;
+		Core::uint64 mVertexCount;
+		Core::uint64 mVertexOffset;
+		Core::uint64 mIndexCount;
+		Core::uint64 mIndexOffset;
+		Core::uint64 mMetadataOffset;
+		Core::uint64 mMetadataSize;
+	};
+
+	// Vertex and index streams of a cooked model, both point into the mapped file
+	struct CookedModel
+	{
+		MappedFile mFile;
+		std::span<const unsigned char> mVertices;
+		std::span<const Core::uint32> mIndices;
+	};
+
+	std::filesystem::path GetCookedModelPath(const std::filesystem::path& aSourcePath, FileLoadingFlags aFileLoadingFlags, float aScale);
+
+	// Returns false if there is no cooked model for these settings, if it is out of date, if it was cooked with another vertex layout or if it can't be read.
+	// The model is left empty in that case, so it can be converted and cooked again.
+	bool ReadCookedModel(const std::filesystem::path& aSourcePath, FileLoadingFlags aFileLoadingFlags, float aScale, const vkglTF::VertexLayout& aVertexLayout, VulkanDevice* aDevice, vkglTF::Model& aModel, std::vector<vkglTF::Image>& aImages, CookedModel& aCookedModel);
+	void WriteCookedModel(const std::filesystem::path& aSourcePath, FileLoadingFlags aFileLoadingFlags, float aScale, const vkglTF::Model& aModel, const std::vector<vkglTF::Image>& aImages, std::span<const unsigned char> aVertices, std::span<const Core::uint32> aIndices);
+}
@@ -8,7 +8,8 @@ enum class FileLoadingFlags : unsigned int
 	PreTransformVertices = 1 << 0,
 	PreMultiplyVertexColors = 1 << 1,
 	FlipY = 1 << 2,
-	DontLoadImages = 1 << 3
+	DontLoadImages = 1 << 3,
+	BuildMeshlets = 1 << 4 // Split primitives into meshlets for GPU culling, only applied together with PreTransformVertices so their bounds are in model space
 };
 
 template<>
@@ -20,7 +21,6 @@ struct BitmaskOperators<FileLoadingFlags>
 enum class RenderFlags : unsigned int
 {
 	None = 0,
-	BindImages = 1 << 0,
 	RenderOpaqueNodes = 1 << 1,
 	RenderAlphaMaskedNodes = 1 << 2,
 	RenderAlphaBlendedNodes = 1 << 3
@@ -31,15 +31,3 @@ struct BitmaskOperators<RenderFlags>
 {
 	static constexpr bool mIsEnabled = true;
 };
-
-enum DescriptorBindingFlags
-{
-	ImageBaseColor = 0,
-	ImageNormalMap = 1 << 1
-};
-
-template<>
-struct BitmaskOperators<DescriptorBindingFlags>
-{
-	static constexpr bool mIsEnabled = true;
-};
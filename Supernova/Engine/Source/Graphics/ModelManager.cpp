@@ -1,14 +1,21 @@
 #include "ModelManager.hpp"
 
+#include "AnimationCompression.hpp"
 #include "Core/BitmaskOperators.hpp"
 #include "Core/Types.hpp"
+#include "JobSystem.hpp"
+#include "MappedFile.hpp"
 #include "Math/Functions.hpp"
 #include "Math/Types.hpp"
+#include "MeshletBuilder.hpp"
+#include "ModelCache.hpp"
 #include "ModelFlags.hpp"
+#include "Profiler/SimpleProfiler.hpp"
 #include "TextureManager.hpp"
 #include "Timer.hpp"
 #include "UniqueIdentifier.hpp"
 #include "VulkanDevice.hpp"
+#include "VulkanStagingRing.hpp"
 #include "VulkanTools.hpp"
 
 #define TINYGLTF_IMPLEMENTATION
@@ -25,25 +32,212 @@
 #include <vector>
 #include <cstring>
 #include <algorithm>
+#include <array>
 #include <limits>
 #include <memory>
+#include <span>
+#include <string_view>
 #include <utility>
 
 namespace VulkanGlTFModelLocal
 {
-	// We use a custom image loading function with tinyglTF, so we can do custom stuff loading ktx textures
-	static bool loadImageDataFunc(tinygltf::Image* aImage, const int aImageIndex, std::string* aError, std::string* aWarning, int aReqWidth, int aReqHeight, const unsigned char* aBytes, int aSize, void* aUserData)
+	static constexpr Core::uint32 gGlbMagic = 0x46546C67; // "glTF"
+	static constexpr Core::uint32 gGlbVersion = 2;
+	static constexpr Core::uint32 gGlbChunkTypeJson = 0x4E4F534A; // "JSON"
+	static constexpr Core::uint32 gGlbChunkTypeBinary = 0x004E4942; // "BIN\0"
+	static constexpr Core::size gGlbHeaderSize = 12;
+	static constexpr Core::size gGlbChunkHeaderSize = 8;
+
+	// Smallest payload tinygltf accepts for a buffer or an image, stands in for data that is read from a mapped file instead
+	static constexpr const char* gPlaceholderDataUri = "data:application/octet-stream;base64,AA==";
+
+	// Encoded image bytes, pointing either into a mapped file or into a copy of the bytes tinygltf has read
+	struct EncodedImages
+	{
+		std::vector<std::span<const unsigned char>> mViews;
+		std::vector<std::vector<unsigned char>> mCopies;
+	};
+
+	static Core::uint32 ReadUint32(const unsigned char* aData)
+	{
+		Core::uint32 value;
+		std::memcpy(&value, aData, sizeof(value));
+		return value;
+	}
+
+	static bool IsDataUri(const std::string& aUri)
+	{
+		return aUri.starts_with("data:");
+	}
+
+	static bool IsKtxImage(const std::string& aUri)
 	{
 		// KTX files will be handled by our own code
-		if (aImage->uri.find_last_of(".") != std::string::npos)
+		if (aUri.find_last_of(".") != std::string::npos)
+		{
+			return aUri.substr(aUri.find_last_of(".") + 1) == "ktx";
+		}
+
+		return false;
+	}
+
+	static bool IsGlb(std::span<const unsigned char> aFile)
+	{
+		return aFile.size() >= sizeof(Core::uint32) && ReadUint32(aFile.data()) == gGlbMagic;
+	}
+
+	// Splits a binary glTF into its JSON and BIN chunks, both point into the mapped file
+	static void ParseGlb(std::span<const unsigned char> aFile, const std::filesystem::path& aPath, std::string_view& aJson, std::span<const unsigned char>& aBinaryChunk)
+	{
+		if (aFile.size() < gGlbHeaderSize + gGlbChunkHeaderSize || ReadUint32(aFile.data() + 4) != gGlbVersion)
+		{
+			throw std::runtime_error(std::format("Unsupported binary glTF file: {}", aPath.generic_string()));
+		}
+
+		const Core::size length = std::min<Core::size>(ReadUint32(aFile.data() + 8), aFile.size());
+		Core::size offset = gGlbHeaderSize;
+		while (offset + gGlbChunkHeaderSize <= length)
+		{
+			const Core::size chunkLength = ReadUint32(aFile.data() + offset);
+			const Core::uint32 chunkType = ReadUint32(aFile.data() + offset + 4);
+			offset += gGlbChunkHeaderSize;
+
+			if (chunkLength > length - offset)
+			{
+				throw std::runtime_error(std::format("Truncated chunk in binary glTF file: {}", aPath.generic_string()));
+			}
+
+			if (chunkType == gGlbChunkTypeJson && aJson.empty())
+			{
+				aJson = std::string_view{reinterpret_cast<const char*>(aFile.data() + offset), chunkLength};
+			}
+			else if (chunkType == gGlbChunkTypeBinary && aBinaryChunk.empty())
+			{
+				aBinaryChunk = aFile.subspan(offset, chunkLength);
+			}
+
+			// Unknown chunks have to be skipped, chunk lengths are already padded to 4 bytes
+			offset += chunkLength;
+		}
+
+		if (aJson.empty())
+		{
+			throw std::runtime_error(std::format("Missing JSON chunk in binary glTF file: {}", aPath.generic_string()));
+		}
+	}
+
+	static std::filesystem::path GetExternalFilePath(const std::string& aUri, const std::filesystem::path& aBaseDirectory)
+	{
+		std::string decodedUri;
+		tinygltf::URIDecode(aUri, &decodedUri, nullptr);
+		return aBaseDirectory / decodedUri;
+	}
+
+	static std::span<const unsigned char> MapExternalFile(const std::filesystem::path& aPath, std::vector<MappedFile>& aMappedFiles)
+	{
+		// Moving a mapped file doesn't move the mapping itself, so views stay valid while the vector grows
+		aMappedFiles.emplace_back(aPath);
+		return aMappedFiles.back().GetData();
+	}
+
+	// Points the buffers and images stored in the BIN chunk or in external files at their mapped bytes and replaces them with placeholders in the document,
+	// so tinygltf only parses the JSON and the accessors read straight from the mappings. Buffers embedded as data URIs are left to tinygltf.
+	// Returns whether the document has been modified.
+	static bool MapBinaryData(nlohmann::json& aDocument, const std::filesystem::path& aPath, std::span<const unsigned char> aBinaryChunk, bool aShouldMapImages, std::vector<MappedFile>& aMappedFiles, std::vector<std::span<const unsigned char>>& aBuffers, EncodedImages& aEncodedImages)
+	{
+		bool isDocumentModified = false;
+		const std::filesystem::path baseDirectory = aPath.parent_path();
+
+		// Look up the arrays instead of using operator[], which would add null members tinygltf doesn't accept
+		const nlohmann::json::iterator buffers = aDocument.find("buffers");
+		aBuffers.resize(buffers != aDocument.end() && buffers->is_array() ? buffers->size() : 0);
+		for (Core::size i = 0; i < aBuffers.size(); i++)
+		{
+			nlohmann::json& buffer = (*buffers)[i];
+			const Core::size byteLength = buffer.value("byteLength", Core::size{0});
+			const std::string uri = buffer.value("uri", std::string{});
+			if (IsDataUri(uri))
+			{
+				continue;
+			}
+
+			const std::span<const unsigned char> data = uri.empty() ? aBinaryChunk : MapExternalFile(GetExternalFilePath(uri, baseDirectory), aMappedFiles);
+			if (data.size() < byteLength)
+			{
+				throw std::runtime_error(std::format("Buffer {} is smaller than its byteLength in glTF file: {}", i, aPath.generic_string()));
+			}
+
+			aBuffers[i] = data.first(byteLength);
+			buffer["uri"] = gPlaceholderDataUri;
+			buffer["byteLength"] = 1;
+			isDocumentModified = true;
+		}
+
+		const nlohmann::json::iterator images = aDocument.find("images");
+		const Core::size imageCount = images != aDocument.end() && images->is_array() ? images->size() : 0;
+		aEncodedImages.mViews.resize(imageCount);
+		aEncodedImages.mCopies.resize(imageCount);
+		if (!aShouldMapImages)
 		{
-			if (aImage->uri.substr(aImage->uri.find_last_of(".") + 1) == "ktx")
+			return isDocumentModified;
+		}
+
+		for (Core::size i = 0; i < imageCount; i++)
+		{
+			nlohmann::json& image = (*images)[i];
+			if (image.contains("bufferView"))
+			{
+				const nlohmann::json& bufferView = aDocument.at("bufferViews").at(image["bufferView"].get<Core::size>());
+				const std::span<const unsigned char> buffer = aBuffers.at(bufferView.value("buffer", Core::size{0}));
+				if (buffer.empty())
+				{
+					continue;
+				}
+
+				const Core::size byteOffset = bufferView.value("byteOffset", Core::size{0});
+				const Core::size byteLength = bufferView.value("byteLength", Core::size{0});
+				if (byteOffset > buffer.size() || byteLength > buffer.size() - byteOffset)
+				{
+					throw std::runtime_error(std::format("Image {} is out of bounds of its buffer in glTF file: {}", i, aPath.generic_string()));
+				}
+
+				aEncodedImages.mViews[i] = buffer.subspan(byteOffset, byteLength);
+				image.erase("bufferView");
+			}
+			else
 			{
-				return true;
+				// Missing files are left to tinygltf, which only warns about them
+				const std::string uri = image.value("uri", std::string{});
+				if (uri.empty() || IsDataUri(uri) || IsKtxImage(uri) || !std::filesystem::exists(GetExternalFilePath(uri, baseDirectory)))
+				{
+					continue;
+				}
+
+				aEncodedImages.mViews[i] = MapExternalFile(GetExternalFilePath(uri, baseDirectory), aMappedFiles);
 			}
+
+			image["uri"] = gPlaceholderDataUri;
+			isDocumentModified = true;
 		}
 
-		return tinygltf::LoadImageData(aImage, aImageIndex, aError, aWarning, aReqWidth, aReqHeight, aBytes, aSize, aUserData);
+		return isDocumentModified;
+	}
+
+	// We use a custom image loading function with tinyglTF, which only keeps the encoded bytes so the images can be decoded in parallel after parsing
+	static bool LoadImageDataFuncDeferred(tinygltf::Image* aImage, const int aImageIndex, std::string* /*aError*/, std::string* /*aWarning*/, int /*aReqWidth*/, int /*aReqHeight*/, const unsigned char* aBytes, int aSize, void* aUserData)
+	{
+		EncodedImages& encodedImages = *static_cast<EncodedImages*>(aUserData);
+
+		// Mapped images only pass their placeholder through here
+		if (IsKtxImage(aImage->uri) || static_cast<Core::size>(aImageIndex) >= encodedImages.mViews.size() || !encodedImages.mViews[aImageIndex].empty())
+		{
+			return true;
+		}
+
+		encodedImages.mCopies[aImageIndex].assign(aBytes, aBytes + aSize);
+		encodedImages.mViews[aImageIndex] = encodedImages.mCopies[aImageIndex];
+
+		return true;
 	}
 
 	static bool LoadImageDataFuncEmpty(tinygltf::Image* /*aImage*/, const int /*aImageIndex*/, std::string* /*aError*/, std::string* /*aWarning*/, int /*aReqWidth*/, int /*aReqHeight*/, const unsigned char* /*aBytes*/, int /*aSize*/, void* /*aUserData*/)
@@ -51,43 +245,154 @@ namespace VulkanGlTFModelLocal
 		// This function will be used for samples that don't require images to be loaded
 		return true;
 	}
+
+	static void DecodeImages(JobSystem& aJobSystem, tinygltf::Model* aGltfModel, const EncodedImages& aEncodedImages)
+	{
+		// One job per image, stb_image only touches its own output so the images of a model can be decoded side by side
+		// Like the load itself they stay off thread zero, whose waits would otherwise decode images in the middle of a frame
+		std::vector<std::string> decodeErrors(aEncodedImages.mViews.size());
+		JobCounter decodeCounter;
+		for (Core::size i = 0; i < aEncodedImages.mViews.size(); i++)
+		{
+			if (aEncodedImages.mViews[i].empty())
+			{
+				continue;
+			}
+
+			aJobSystem.RunOnWorker([aGltfModel, &aEncodedImages, &decodeErrors, i]()
+			{
+				SIMPLE_PROFILER_PROFILE_SCOPE("ModelManager::DecodeImage");
+
+				std::string error;
+				std::string warning;
+				const std::span<const unsigned char> encodedImage = aEncodedImages.mViews[i];
+				if (!tinygltf::LoadImageData(&aGltfModel->images[i], static_cast<int>(i), &error, &warning, 0, 0, encodedImage.data(), static_cast<int>(encodedImage.size()), nullptr))
+				{
+					decodeErrors[i] = error.empty() ? std::format("Could not decode image {}", i) : error;
+				}
+			}, &decodeCounter);
+		}
+
+		aJobSystem.Wait(decodeCounter);
+
+		std::string errors;
+		for (const std::string& decodeError : decodeErrors)
+		{
+			errors += decodeError;
+		}
+
+		if (!errors.empty())
+		{
+			throw std::runtime_error(errors);
+		}
+	}
+
+	// Every attribute at least one primitive provides, in VertexComponent order
+	static std::vector<vkglTF::VertexComponent> GetVertexComponents(const tinygltf::Model* aGltfModel, FileLoadingFlags aFileLoadingFlags)
+	{
+		// Pre-multiplied colors carry the material base color even if the file has no vertex colors
+		bool hasNormals = false;
+		bool hasUVs = false;
+		bool hasColors = HasFlag(aFileLoadingFlags, FileLoadingFlags::PreMultiplyVertexColors);
+		bool hasTangents = false;
+		bool hasSkin = false;
+		for (const tinygltf::Mesh& mesh : aGltfModel->meshes)
+		{
+			for (const tinygltf::Primitive& primitive : mesh.primitives)
+			{
+				hasNormals |= primitive.attributes.contains("NORMAL");
+				hasUVs |= primitive.attributes.contains("TEXCOORD_0");
+				hasColors |= primitive.attributes.contains("COLOR_0");
+				hasTangents |= primitive.attributes.contains("TANGENT");
+				hasSkin |= primitive.attributes.contains("JOINTS_0") && primitive.attributes.contains("WEIGHTS_0");
+			}
+		}
+
+		std::vector<vkglTF::VertexComponent> components{vkglTF::VertexComponent::Position};
+		if (hasNormals)
+		{
+			components.push_back(vkglTF::VertexComponent::Normal);
+		}
+
+		if (hasUVs)
+		{
+			components.push_back(vkglTF::VertexComponent::UV);
+		}
+
+		if (hasColors)
+		{
+			components.push_back(vkglTF::VertexComponent::Color);
+		}
+
+		if (hasTangents)
+		{
+			components.push_back(vkglTF::VertexComponent::Tangent);
+		}
+
+		if (hasSkin)
+		{
+			components.push_back(vkglTF::VertexComponent::Joint0);
+			components.push_back(vkglTF::VertexComponent::Weight0);
+		}
+
+		return components;
+	}
+
+	// Slots of destroyed models are reused before the unused tail of the pool
+	static Core::uint32 AcquireSlot(std::vector<Core::uint32>& aFreeSlots, Core::uint32& aSlotCount)
+	{
+		if (!aFreeSlots.empty())
+		{
+			const Core::uint32 slot = aFreeSlots.back();
+			aFreeSlots.pop_back();
+			return slot;
+		}
+
+		return aSlotCount++;
+	}
 }
 
-ModelManager::ModelManager(const std::shared_ptr<TextureManager>& aTextureManager)
+ModelManager::ModelManager(const std::shared_ptr<TextureManager>& aTextureManager, const std::shared_ptr<JobSystem>& aJobSystem)
 	: mTextureManager{aTextureManager}
+	, mJobSystem{aJobSystem}
 	, mVulkanDevice{nullptr}
 	, mDescriptorPool{VK_NULL_HANDLE}
 	, mDescriptorSetLayoutUbo{VK_NULL_HANDLE}
-	, mDescriptorSetLayoutImage{VK_NULL_HANDLE}
-	, mDescriptorBindingFlags{DescriptorBindingFlags::ImageBaseColor}
+	, mBindlessDescriptorSetLayout{VK_NULL_HANDLE}
+	, mBindlessDescriptorPool{VK_NULL_HANDLE}
+	, mBindlessDescriptorSet{VK_NULL_HANDLE}
+	, mMaterialBuffer{VK_NULL_HANDLE}
+	, mBindlessTextureCount{0}
+	, mMaterialCount{0}
 {
 }
 
 ModelManager::~ModelManager()
 {
-	for (const std::pair<UniqueIdentifier, vkglTF::Model*>& pair : mModels)
+	for (std::pair<const UniqueIdentifier, PendingModelLoad>& pair : mPendingLoads)
 	{
-		vkDestroyBuffer(mVulkanDevice->mLogicalVkDevice, pair.second->vertices.mBuffer, nullptr);
-		vkFreeMemory(mVulkanDevice->mLogicalVkDevice, pair.second->vertices.mMemory, nullptr);
-		vkDestroyBuffer(mVulkanDevice->mLogicalVkDevice, pair.second->indices.mBuffer, nullptr);
-		vkFreeMemory(mVulkanDevice->mLogicalVkDevice, pair.second->indices.mMemory, nullptr);
-
-		for (vkglTF::Node*& node : pair.second->nodes)
+		PendingModelLoad& pendingLoad = pair.second;
+		if (pendingLoad.mModel)
 		{
-			delete node;
+			DestroyModel(pendingLoad.mModel);
+			continue;
 		}
 
-		for (vkglTF::Skin*& skin : pair.second->skins)
+		// Load jobs still hold a pointer to this manager, so they have to finish before it goes away
+		try
 		{
-			delete skin;
+			mJobSystem.lock()->Wait(*pendingLoad.mLoadCounter);
+			DestroyModelData(pendingLoad.mResult.mModel);
 		}
-
-		for (vkglTF::Texture& texture : pair.second->textures)
+		catch (const std::exception& exception)
 		{
-			texture.Destroy();
+			std::cerr << "Discarded failed load of " << pendingLoad.mPath << ": " << exception.what() << std::endl;
 		}
+	}
 
-		pair.second->mEmptyTexture.Destroy();
+	for (const std::pair<const UniqueIdentifier, vkglTF::Model*>& pair : mModels)
+	{
+		DestroyModel(pair.second);
 	}
 
 	if (mDescriptorSetLayoutUbo != VK_NULL_HANDLE)
@@ -96,16 +401,70 @@ ModelManager::~ModelManager()
 		mDescriptorSetLayoutUbo = VK_NULL_HANDLE;
 	}
 
-	if (mDescriptorSetLayoutImage != VK_NULL_HANDLE)
+	vkDestroyDescriptorPool(mVulkanDevice->mLogicalVkDevice, mDescriptorPool, nullptr);
+
+	vkDestroyDescriptorPool(mVulkanDevice->mLogicalVkDevice, mBindlessDescriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(mVulkanDevice->mLogicalVkDevice, mBindlessDescriptorSetLayout, nullptr);
+	if (mMaterialBuffer != VK_NULL_HANDLE)
 	{
-		vkDestroyDescriptorSetLayout(mVulkanDevice->mLogicalVkDevice, mDescriptorSetLayoutImage, nullptr);
-		mDescriptorSetLayoutImage = VK_NULL_HANDLE;
+		vkDestroyBuffer(mVulkanDevice->mLogicalVkDevice, mMaterialBuffer, nullptr);
+		mVulkanDevice->mMemoryAllocator->Free(mMaterialAllocation);
 	}
+}
 
-	vkDestroyDescriptorPool(mVulkanDevice->mLogicalVkDevice, mDescriptorPool, nullptr);
+void ModelManager::DestroyModel(vkglTF::Model* aModel)
+{
+	vkDestroyBuffer(mVulkanDevice->mLogicalVkDevice, aModel->vertices.mBuffer, nullptr);
+	mVulkanDevice->mMemoryAllocator->Free(aModel->vertices.mAllocation);
+	vkDestroyBuffer(mVulkanDevice->mLogicalVkDevice, aModel->indices.mBuffer, nullptr);
+	mVulkanDevice->mMemoryAllocator->Free(aModel->indices.mAllocation);
+
+	if (aModel->meshlets.mBuffer != VK_NULL_HANDLE)
+	{
+		vkDestroyBuffer(mVulkanDevice->mLogicalVkDevice, aModel->meshlets.mBuffer, nullptr);
+		mVulkanDevice->mMemoryAllocator->Free(aModel->meshlets.mAllocation);
+	}
+
+	// Nothing is drawn from a destroyed model anymore, so its slots can be handed to the next load
+	for (vkglTF::Texture& texture : aModel->textures)
+	{
+		if (texture.mBindlessIndex != vkglTF::gNoBindlessIndex)
+		{
+			mFreeBindlessTextures.push_back(texture.mBindlessIndex);
+		}
+
+		texture.Destroy();
+	}
+
+	for (const vkglTF::Material& material : aModel->materials)
+	{
+		if (material.mBindlessIndex != vkglTF::gNoBindlessIndex)
+		{
+			mFreeMaterials.push_back(material.mBindlessIndex);
+		}
+	}
+
+	aModel->mEmptyTexture.Destroy();
+
+	DestroyModelData(aModel);
+}
+
+void ModelManager::DestroyModelData(vkglTF::Model* aModel)
+{
+	for (vkglTF::Node*& node : aModel->nodes)
+	{
+		delete node;
+	}
+
+	for (vkglTF::Skin*& skin : aModel->skins)
+	{
+		delete skin;
+	}
+
+	delete aModel;
 }
 
-void ModelManager::LoadNode(vkglTF::Model& aModel, tinygltf::Model* aGltfModel, vkglTF::Node* aParent, const tinygltf::Node* aNode, Core::uint32 aNodeIndex, std::vector<Core::uint32>& aIndexBuffer, std::vector<vkglTF::Vertex>& aVertexBuffer, float aGlobalscale)
+void ModelManager::LoadNode(vkglTF::Model& aModel, tinygltf::Model* aGltfModel, const BufferData& aBuffers, vkglTF::Node* aParent, const tinygltf::Node* aNode, Core::uint32 aNodeIndex, std::vector<Core::uint32>& aIndexBuffer, std::vector<vkglTF::Vertex>& aVertexBuffer, float aGlobalscale)
 {
 	vkglTF::Node* newNode = new vkglTF::Node{};
 	newNode->mIndex = aNodeIndex;
@@ -149,7 +508,7 @@ void ModelManager::LoadNode(vkglTF::Model& aModel, tinygltf::Model* aGltfModel,
 	{
 		for (Core::size i = 0; i < aNode->children.size(); i++)
 		{
-			LoadNode(aModel, aGltfModel, newNode, &aGltfModel->nodes[aNode->children[i]], aNode->children[i], aIndexBuffer, aVertexBuffer, aGlobalscale);
+			LoadNode(aModel, aGltfModel, aBuffers, newNode, &aGltfModel->nodes[aNode->children[i]], aNode->children[i], aIndexBuffer, aVertexBuffer, aGlobalscale);
 		}
 	}
 
@@ -189,7 +548,7 @@ void ModelManager::LoadNode(vkglTF::Model& aModel, tinygltf::Model* aGltfModel,
 
 				const tinygltf::Accessor& posAccessor = aGltfModel->accessors[primitive.attributes.find("POSITION")->second];
 				const tinygltf::BufferView& posView = aGltfModel->bufferViews[posAccessor.bufferView];
-				bufferPos = reinterpret_cast<const float*>(&(aGltfModel->buffers[posView.buffer].data[posAccessor.byteOffset + posView.byteOffset]));
+				bufferPos = reinterpret_cast<const float*>(aBuffers[posView.buffer].data() + posAccessor.byteOffset + posView.byteOffset);
 				posMin = Math::Vector3f(posAccessor.minValues[0], posAccessor.minValues[1], posAccessor.minValues[2]);
 				posMax = Math::Vector3f(posAccessor.maxValues[0], posAccessor.maxValues[1], posAccessor.maxValues[2]);
 
@@ -197,14 +556,14 @@ void ModelManager::LoadNode(vkglTF::Model& aModel, tinygltf::Model* aGltfModel,
 				{
 					const tinygltf::Accessor& normAccessor = aGltfModel->accessors[primitive.attributes.find("NORMAL")->second];
 					const tinygltf::BufferView& normView = aGltfModel->bufferViews[normAccessor.bufferView];
-					bufferNormals = reinterpret_cast<const float*>(&(aGltfModel->buffers[normView.buffer].data[normAccessor.byteOffset + normView.byteOffset]));
+					bufferNormals = reinterpret_cast<const float*>(aBuffers[normView.buffer].data() + normAccessor.byteOffset + normView.byteOffset);
 				}
 
 				if (primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end())
 				{
 					const tinygltf::Accessor& uvAccessor = aGltfModel->accessors[primitive.attributes.find("TEXCOORD_0")->second];
 					const tinygltf::BufferView& uvView = aGltfModel->bufferViews[uvAccessor.bufferView];
-					bufferTexCoords = reinterpret_cast<const float*>(&(aGltfModel->buffers[uvView.buffer].data[uvAccessor.byteOffset + uvView.byteOffset]));
+					bufferTexCoords = reinterpret_cast<const float*>(aBuffers[uvView.buffer].data() + uvAccessor.byteOffset + uvView.byteOffset);
 				}
 
 				if (primitive.attributes.find("COLOR_0") != primitive.attributes.end())
@@ -213,14 +572,14 @@ void ModelManager::LoadNode(vkglTF::Model& aModel, tinygltf::Model* aGltfModel,
 					const tinygltf::BufferView& colorView = aGltfModel->bufferViews[colorAccessor.bufferView];
 					// Color buffer are either of type vec3 or vec4
 					numColorComponents = colorAccessor.type == TINYGLTF_PARAMETER_TYPE_FLOAT_VEC3 ? 3 : 4;
-					bufferColors = reinterpret_cast<const float*>(&(aGltfModel->buffers[colorView.buffer].data[colorAccessor.byteOffset + colorView.byteOffset]));
+					bufferColors = reinterpret_cast<const float*>(aBuffers[colorView.buffer].data() + colorAccessor.byteOffset + colorView.byteOffset);
 				}
 
 				if (primitive.attributes.find("TANGENT") != primitive.attributes.end())
 				{
 					const tinygltf::Accessor& tangentAccessor = aGltfModel->accessors[primitive.attributes.find("TANGENT")->second];
 					const tinygltf::BufferView& tangentView = aGltfModel->bufferViews[tangentAccessor.bufferView];
-					bufferTangents = reinterpret_cast<const float*>(&(aGltfModel->buffers[tangentView.buffer].data[tangentAccessor.byteOffset + tangentView.byteOffset]));
+					bufferTangents = reinterpret_cast<const float*>(aBuffers[tangentView.buffer].data() + tangentAccessor.byteOffset + tangentView.byteOffset);
 				}
 
 				// Skinning
@@ -229,14 +588,14 @@ void ModelManager::LoadNode(vkglTF::Model& aModel, tinygltf::Model* aGltfModel,
 				{
 					const tinygltf::Accessor& jointAccessor = aGltfModel->accessors[primitive.attributes.find("JOINTS_0")->second];
 					const tinygltf::BufferView& jointView = aGltfModel->bufferViews[jointAccessor.bufferView];
-					bufferJoints = reinterpret_cast<const Core::uint16*>(&(aGltfModel->buffers[jointView.buffer].data[jointAccessor.byteOffset + jointView.byteOffset]));
+					bufferJoints = reinterpret_cast<const Core::uint16*>(aBuffers[jointView.buffer].data() + jointAccessor.byteOffset + jointView.byteOffset);
 				}
 
 				if (primitive.attributes.find("WEIGHTS_0") != primitive.attributes.end())
 				{
 					const tinygltf::Accessor& uvAccessor = aGltfModel->accessors[primitive.attributes.find("WEIGHTS_0")->second];
 					const tinygltf::BufferView& uvView = aGltfModel->bufferViews[uvAccessor.bufferView];
-					bufferWeights = reinterpret_cast<const float*>(&(aGltfModel->buffers[uvView.buffer].data[uvAccessor.byteOffset + uvView.byteOffset]));
+					bufferWeights = reinterpret_cast<const float*>(aBuffers[uvView.buffer].data() + uvAccessor.byteOffset + uvView.byteOffset);
 				}
 
 				hasSkin = (bufferJoints && bufferWeights);
@@ -275,7 +634,7 @@ void ModelManager::LoadNode(vkglTF::Model& aModel, tinygltf::Model* aGltfModel,
 			{
 				const tinygltf::Accessor& accessor = aGltfModel->accessors[primitive.indices];
 				const tinygltf::BufferView& bufferView = aGltfModel->bufferViews[accessor.bufferView];
-				const tinygltf::Buffer& buffer = aGltfModel->buffers[bufferView.buffer];
+				const unsigned char* bufferData = aBuffers[bufferView.buffer].data() + accessor.byteOffset + bufferView.byteOffset;
 
 				indexCount = static_cast<Core::uint32>(accessor.count);
 
@@ -283,41 +642,32 @@ void ModelManager::LoadNode(vkglTF::Model& aModel, tinygltf::Model* aGltfModel,
 				{
 					case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT:
 					{
-						Core::uint32* buf = new Core::uint32[accessor.count];
-						std::memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(Core::uint32));
+						const Core::uint32* buf = reinterpret_cast<const Core::uint32*>(bufferData);
 						for (Core::size index = 0; index < accessor.count; index++)
 						{
 							aIndexBuffer.push_back(buf[index] + vertexStart);
 						}
 
-						delete[] buf;
-
 						break;
 					}
 					case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT:
 					{
-						Core::uint16* buf = new Core::uint16[accessor.count];
-						std::memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(Core::uint16));
+						const Core::uint16* buf = reinterpret_cast<const Core::uint16*>(bufferData);
 						for (Core::size index = 0; index < accessor.count; index++)
 						{
 							aIndexBuffer.push_back(buf[index] + vertexStart);
 						}
 
-						delete[] buf;
-
 						break;
 					}
 					case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE:
 					{
-						Core::uint8* buf = new Core::uint8[accessor.count];
-						std::memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(Core::uint8));
+						const Core::uint8* buf = reinterpret_cast<const Core::uint8*>(bufferData);
 						for (Core::size index = 0; index < accessor.count; index++)
 						{
 							aIndexBuffer.push_back(buf[index] + vertexStart);
 						}
 
-						delete[] buf;
-
 						break;
 					}
 					default:
@@ -348,7 +698,7 @@ void ModelManager::LoadNode(vkglTF::Model& aModel, tinygltf::Model* aGltfModel,
 	aModel.linearNodes.push_back(newNode);
 }
 
-void ModelManager::LoadSkins(vkglTF::Model& aModel, tinygltf::Model* aGltfModel)
+void ModelManager::LoadSkins(vkglTF::Model& aModel, tinygltf::Model* aGltfModel, const BufferData& aBuffers)
 {
 	for (const tinygltf::Skin& source : aGltfModel->skins)
 	{
@@ -376,18 +726,17 @@ void ModelManager::LoadSkins(vkglTF::Model& aModel, tinygltf::Model* aGltfModel)
 		{
 			const tinygltf::Accessor& accessor = aGltfModel->accessors[source.inverseBindMatrices];
 			const tinygltf::BufferView& bufferView = aGltfModel->bufferViews[accessor.bufferView];
-			const tinygltf::Buffer& buffer = aGltfModel->buffers[bufferView.buffer];
 			newSkin->inverseBindMatrices.resize(accessor.count);
-			std::memcpy(newSkin->inverseBindMatrices.data(), &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(Math::Matrix4f));
+			std::memcpy(newSkin->inverseBindMatrices.data(), aBuffers[bufferView.buffer].data() + accessor.byteOffset + bufferView.byteOffset, accessor.count * sizeof(Math::Matrix4f));
 		}
 
 		aModel.skins.push_back(newSkin);
 	}
 }
 
-void ModelManager::LoadImages(vkglTF::Model& aModel, tinygltf::Model* aGltfModel)
+void ModelManager::LoadImages(ModelLoadResult& aResult, tinygltf::Model* aGltfModel)
 {
-	for (const tinygltf::Image& gltfImage : aGltfModel->images)
+	for (tinygltf::Image& gltfImage : aGltfModel->images)
 	{
 		vkglTF::Image image;
 		image.component = gltfImage.component;
@@ -395,7 +744,7 @@ void ModelManager::LoadImages(vkglTF::Model& aModel, tinygltf::Model* aGltfModel
 		image.height = gltfImage.height;
 		image.uri = gltfImage.uri;
 		image.name = gltfImage.name;
-		image.image = gltfImage.image;
+		image.image = std::move(gltfImage.image);
 
 		if (gltfImage.extensions.find("KHR_texture_basisu") != gltfImage.extensions.end())
 		{
@@ -405,9 +754,19 @@ void ModelManager::LoadImages(vkglTF::Model& aModel, tinygltf::Model* aGltfModel
 			}
 		}
 
-		vkglTF::Texture texture = mTextureManager.lock()->CreateTexture(aModel.path.relative_path(), image);
-		texture.mIndex = static_cast<Core::uint32>(aModel.textures.size());
-		aModel.textures.push_back(texture);
+		aResult.mImages.push_back(std::move(image));
+	}
+
+	// Reserve the texture slots up front, materials point into this vector before the textures are created on the render thread
+	aResult.mModel->textures.resize(aResult.mImages.size());
+}
+
+void ModelManager::CreateTextures(vkglTF::Model& aModel, std::vector<vkglTF::Image>& aImages)
+{
+	for (Core::size i = 0; i < aImages.size(); i++)
+	{
+		aModel.textures[i] = mTextureManager.lock()->CreateTexture(aModel.path.relative_path(), aImages[i]);
+		aModel.textures[i].mIndex = static_cast<Core::uint32>(i);
 	}
 
 	// Create an empty texture to be used for empty material images
@@ -476,6 +835,7 @@ void ModelManager::LoadMaterials(vkglTF::Model& aModel, tinygltf::Model* aGltfMo
 		}
 
 		material.mAlphaCutoff = static_cast<float>(gltfMaterial.alphaCutoff);
+		material.mIsDoubleSided = gltfMaterial.doubleSided;
 
 		aModel.materials.push_back(material);
 	}
@@ -484,7 +844,7 @@ void ModelManager::LoadMaterials(vkglTF::Model& aModel, tinygltf::Model* aGltfMo
 	aModel.materials.push_back(vkglTF::Material(mVulkanDevice));
 }
 
-void ModelManager::LoadAnimations(vkglTF::Model& aModel, tinygltf::Model* aGltfModel)
+void ModelManager::LoadAnimations(vkglTF::Model& aModel, tinygltf::Model* aGltfModel, const BufferData& aBuffers)
 {
 	for (const tinygltf::Animation& gltfAnimation : aGltfModel->animations)
 	{
@@ -496,9 +856,11 @@ void ModelManager::LoadAnimations(vkglTF::Model& aModel, tinygltf::Model* aGltfM
 			animation.mName = std::to_string(aModel.animations.size());
 		}
 
+		// Kept as they are in the file until the channels tell which property every sampler animates
+		std::vector<AnimationCompression::SourceSampler> sourceSamplers;
 		for (const tinygltf::AnimationSampler& gltfAnimationSampler : gltfAnimation.samplers)
 		{
-			vkglTF::AnimationSampler sampler{};
+			AnimationCompression::SourceSampler& sampler = sourceSamplers.emplace_back();
 
 			if (gltfAnimationSampler.interpolation == "LINEAR")
 			{
@@ -517,20 +879,14 @@ void ModelManager::LoadAnimations(vkglTF::Model& aModel, tinygltf::Model* aGltfM
 			{
 				const tinygltf::Accessor& gltfAccessor = aGltfModel->accessors[gltfAnimationSampler.input];
 				const tinygltf::BufferView& gltfBufferView = aGltfModel->bufferViews[gltfAccessor.bufferView];
-				const tinygltf::Buffer& gltfBuffer = aGltfModel->buffers[gltfBufferView.buffer];
+				const unsigned char* bufferData = aBuffers[gltfBufferView.buffer].data() + gltfAccessor.byteOffset + gltfBufferView.byteOffset;
 
 				assert(gltfAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
 
-				float* buffer = new float[gltfAccessor.count];
-				std::memcpy(buffer, &gltfBuffer.data[gltfAccessor.byteOffset + gltfBufferView.byteOffset], gltfAccessor.count * sizeof(float));
-				for (Core::size index = 0; index < gltfAccessor.count; index++)
-				{
-					sampler.mInputs.push_back(buffer[index]);
-				}
-
-				delete[] buffer;
+				const float* buffer = reinterpret_cast<const float*>(bufferData);
+				sampler.mTimes.assign(buffer, buffer + gltfAccessor.count);
 
-				for (float input : sampler.mInputs)
+				for (float input : sampler.mTimes)
 				{
 					if (input < animation.mStart)
 					{
@@ -548,7 +904,7 @@ void ModelManager::LoadAnimations(vkglTF::Model& aModel, tinygltf::Model* aGltfM
 			{
 				const tinygltf::Accessor& gltfAccessor = aGltfModel->accessors[gltfAnimationSampler.output];
 				const tinygltf::BufferView& gltfBufferView = aGltfModel->bufferViews[gltfAccessor.bufferView];
-				const tinygltf::Buffer& gltfBuffer = aGltfModel->buffers[gltfBufferView.buffer];
+				const unsigned char* bufferData = aBuffers[gltfBufferView.buffer].data() + gltfAccessor.byteOffset + gltfBufferView.byteOffset;
 
 				assert(gltfAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
 
@@ -556,24 +912,20 @@ void ModelManager::LoadAnimations(vkglTF::Model& aModel, tinygltf::Model* aGltfM
 				{
 					case TINYGLTF_TYPE_VEC3:
 					{
-						Math::Vector3f* buffer = new Math::Vector3f[gltfAccessor.count];
-						std::memcpy(buffer, &gltfBuffer.data[gltfAccessor.byteOffset + gltfBufferView.byteOffset], gltfAccessor.count * sizeof(Math::Vector3f));
+						const float* buffer = reinterpret_cast<const float*>(bufferData);
 						for (Core::size index = 0; index < gltfAccessor.count; index++)
 						{
-							sampler.mOutputsVec4.push_back(Math::Vector4f(buffer[index], 0.0f));
+							sampler.mValues.push_back(Math::Vector4f(Math::MakeVector3f(&buffer[index * 3]), 0.0f));
 						}
-						delete[] buffer;
 						break;
 					}
 					case TINYGLTF_TYPE_VEC4:
 					{
-						Math::Vector4f* buf = new Math::Vector4f[gltfAccessor.count];
-						std::memcpy(buf, &gltfBuffer.data[gltfAccessor.byteOffset + gltfBufferView.byteOffset], gltfAccessor.count * sizeof(Math::Vector4f));
+						const float* buffer = reinterpret_cast<const float*>(bufferData);
 						for (Core::size index = 0; index < gltfAccessor.count; index++)
 						{
-							sampler.mOutputsVec4.push_back(buf[index]);
+							sampler.mValues.push_back(Math::MakeVector4f(&buffer[index * 4]));
 						}
-						delete[] buf;
 						break;
 					}
 					default:
@@ -583,8 +935,6 @@ void ModelManager::LoadAnimations(vkglTF::Model& aModel, tinygltf::Model* aGltfM
 					}
 				}
 			}
-
-			animation.mSamplers.push_back(sampler);
 		}
 
 		// Channels
@@ -612,23 +962,181 @@ void ModelManager::LoadAnimations(vkglTF::Model& aModel, tinygltf::Model* aGltfM
 
 			channel.mSamplerIndex = gltfAnimationChhannel.sampler;
 			channel.mNode = NodeFromIndex(aModel, gltfAnimationChhannel.target_node);
-			if (!channel.mNode)
+			if (!channel.mNode || channel.mSamplerIndex >= sourceSamplers.size())
 			{
 				continue;
 			}
 
+			// The path decides how the keys of the sampler are compressed
+			sourceSamplers[channel.mSamplerIndex].mPath = channel.mPathType;
 			animation.mChannels.push_back(channel);
 		}
 
+		AnimationCompression::Compress(sourceSamplers, animation);
+
 		aModel.animations.push_back(animation);
 	}
 }
 
-UniqueIdentifier ModelManager::LoadModel(const std::filesystem::path& aPath, VulkanDevice* aDevice, VkQueue aTransferQueue, FileLoadingFlags aFileLoadingFlags, float aScale)
+UniqueIdentifier ModelManager::LoadModel(const std::filesystem::path& aPath, VulkanDevice* aDevice, VulkanStagingRing* aStagingRing, FileLoadingFlags aFileLoadingFlags, float aScale, const vkglTF::VertexLayout& aVertexLayout)
 {
 	Time::Timer loadTimer;
 	loadTimer.StartTimer();
 
+	mVulkanDevice = aDevice;
+
+	ModelLoadResult result = LoadModelData(aPath, aFileLoadingFlags, aScale, aVertexLayout);
+
+	// Like a failed async load, a model that doesn't fit is never published and GetModel returns nullptr for it
+	UniqueIdentifier identifier{};
+	if (!CreateModelResources(result, aDevice, aStagingRing, aFileLoadingFlags))
+	{
+		DestroyModelData(result.mModel);
+		return identifier;
+	}
+
+	loadTimer.EndTimer();
+
+	std::cout << "Loaded GLTF model " << aPath.filename() << " " << std::format("({:.2f}s)", loadTimer.GetDurationSeconds()) << std::endl;
+
+	mModels.emplace(identifier, result.mModel);
+
+	return identifier;
+}
+
+UniqueIdentifier ModelManager::LoadModelAsync(const std::filesystem::path& aPath, VulkanDevice* aDevice, VulkanStagingRing* aStagingRing, FileLoadingFlags aFileLoadingFlags, float aScale, const vkglTF::VertexLayout& aVertexLayout)
+{
+	// Workers read the device while converting, so it is only written when it actually changes
+	if (mVulkanDevice != aDevice)
+	{
+		assert(mPendingLoads.empty());
+		mVulkanDevice = aDevice;
+	}
+
+	UniqueIdentifier identifier{};
+	PendingModelLoad& pendingLoad = mPendingLoads[identifier];
+	pendingLoad.mVulkanDevice = aDevice;
+	pendingLoad.mStagingRing = aStagingRing;
+	pendingLoad.mFileLoadingFlags = aFileLoadingFlags;
+	pendingLoad.mPath = aPath;
+	pendingLoad.mLoadTimer.StartTimer();
+	// Kept off thread zero, otherwise the renderer's waits could pick up the job and convert the whole model inside a frame
+	ModelLoadResult* result = &pendingLoad.mResult;
+	mJobSystem.lock()->RunOnWorker([this, result, aPath, aFileLoadingFlags, aScale, aVertexLayout]()
+	{
+		*result = LoadModelData(aPath, aFileLoadingFlags, aScale, aVertexLayout);
+	}, pendingLoad.mLoadCounter.get());
+
+	return identifier;
+}
+
+void ModelManager::ProcessPendingLoads()
+{
+	SIMPLE_PROFILER_PROFILE_SCOPE("ModelManager::ProcessPendingLoads");
+
+	if (mPendingLoads.empty())
+	{
+		return;
+	}
+
+	// The staging ring and the texture manager are single threaded, so the GPU side of every finished load is created here
+	for (std::map<UniqueIdentifier, PendingModelLoad>::iterator it = mPendingLoads.begin(); it != mPendingLoads.end();)
+	{
+		PendingModelLoad& pendingLoad = it->second;
+		if (pendingLoad.mModel || !pendingLoad.mLoadCounter->IsDone())
+		{
+			++it;
+			continue;
+		}
+
+		// A file that fails to load is dropped, the worker has already freed its model and GetModel keeps returning nullptr for it
+		// The load job is done, so the wait returns right away and only passes on its exception
+		try
+		{
+			mJobSystem.lock()->Wait(*pendingLoad.mLoadCounter);
+		}
+		catch (const std::exception& exception)
+		{
+			std::cerr << "Could not load GLTF model " << pendingLoad.mPath << ": " << exception.what() << std::endl;
+			it = mPendingLoads.erase(it);
+			continue;
+		}
+
+		ModelLoadResult result = std::move(pendingLoad.mResult);
+		if (!CreateModelResources(result, pendingLoad.mVulkanDevice, pendingLoad.mStagingRing, pendingLoad.mFileLoadingFlags))
+		{
+			DestroyModelData(result.mModel);
+			it = mPendingLoads.erase(it);
+			continue;
+		}
+
+		pendingLoad.mModel = result.mModel;
+		++it;
+	}
+
+	// Submit after all loads were recorded, so the models that finished this frame share one staging batch
+	for (std::pair<const UniqueIdentifier, PendingModelLoad>& pair : mPendingLoads)
+	{
+		PendingModelLoad& pendingLoad = pair.second;
+		if (pendingLoad.mModel && pendingLoad.mUploadTimelineValue == 0)
+		{
+			pendingLoad.mUploadTimelineValue = pendingLoad.mStagingRing->Submit();
+		}
+	}
+
+	for (std::map<UniqueIdentifier, PendingModelLoad>::iterator it = mPendingLoads.begin(); it != mPendingLoads.end();)
+	{
+		PendingModelLoad& pendingLoad = it->second;
+		if (!pendingLoad.mModel || !pendingLoad.mStagingRing->IsComplete(pendingLoad.mUploadTimelineValue))
+		{
+			++it;
+			continue;
+		}
+
+		pendingLoad.mLoadTimer.EndTimer();
+
+		std::cout << "Loaded GLTF model " << pendingLoad.mPath.filename() << " " << std::format("({:.2f}s)", pendingLoad.mLoadTimer.GetDurationSeconds()) << std::endl;
+
+		mModels.emplace(it->first, pendingLoad.mModel);
+		it = mPendingLoads.erase(it);
+	}
+}
+
+ModelManager::ModelLoadResult ModelManager::LoadModelData(const std::filesystem::path& aPath, FileLoadingFlags aFileLoadingFlags, float aScale, const vkglTF::VertexLayout& aVertexLayout)
+{
+	SIMPLE_PROFILER_PROFILE_SCOPE("ModelManager::LoadModelData");
+
+	ModelLoadResult result;
+	result.mModel = new vkglTF::Model();
+	result.mModel->path = aPath;
+	result.mModel->mIsPreTransformed = HasFlag(aFileLoadingFlags, FileLoadingFlags::PreTransformVertices);
+
+	// Nothing of a failed load is published, so its model is freed before the exception is passed on
+	try
+	{
+		ConvertModelData(aPath, aFileLoadingFlags, aScale, aVertexLayout, result);
+	}
+	catch (...)
+	{
+		DestroyModelData(result.mModel);
+		throw;
+	}
+
+	return result;
+}
+
+void ModelManager::ConvertModelData(const std::filesystem::path& aPath, FileLoadingFlags aFileLoadingFlags, float aScale, const vkglTF::VertexLayout& aVertexLayout, ModelLoadResult& aResult)
+{
+	// A cooked model skips the whole glTF conversion, its streams are copied straight from the mapping into staging memory
+	if (ModelCache::ReadCookedModel(aPath, aFileLoadingFlags, aScale, aVertexLayout, mVulkanDevice, *aResult.mModel, aResult.mImages, aResult.mCookedModel))
+	{
+		aResult.mIndices = aResult.mCookedModel.mIndices;
+		aResult.mVertices = aResult.mCookedModel.mVertices;
+		return;
+	}
+
+	VulkanGlTFModelLocal::EncodedImages encodedImages;
+
 	tinygltf::TinyGLTF gltfContext;
 	if (HasFlag(aFileLoadingFlags, FileLoadingFlags::DontLoadImages))
 	{
@@ -636,23 +1144,58 @@ UniqueIdentifier ModelManager::LoadModel(const std::filesystem::path& aPath, Vul
 	}
 	else
 	{
-		gltfContext.SetImageLoader(VulkanGlTFModelLocal::loadImageDataFunc, nullptr);
+		gltfContext.SetImageLoader(VulkanGlTFModelLocal::LoadImageDataFuncDeferred, &encodedImages);
 	}
 
-	vkglTF::Model* newModel = new vkglTF::Model();
-	newModel->path = aPath;
-	mVulkanDevice = aDevice;
+	// The file and its external buffers stay mapped until the model data has been converted
+	const MappedFile mappedFile{aPath};
+	std::string_view json;
+	std::span<const unsigned char> binaryChunk;
+	if (VulkanGlTFModelLocal::IsGlb(mappedFile.GetData()))
+	{
+		VulkanGlTFModelLocal::ParseGlb(mappedFile.GetData(), aPath, json, binaryChunk);
+	}
+	else
+	{
+		json = std::string_view{reinterpret_cast<const char*>(mappedFile.GetData().data()), mappedFile.GetSize()};
+	}
+
+	nlohmann::json document = nlohmann::json::parse(json.begin(), json.end(), nullptr, false);
+	if (document.is_discarded())
+	{
+		throw std::runtime_error(std::format("Could not parse glTF file: {}", aPath.generic_string()));
+	}
+
+	std::vector<MappedFile> mappedFiles;
+	BufferData buffers;
+	const bool shouldMapImages = !HasFlag(aFileLoadingFlags, FileLoadingFlags::DontLoadImages);
+	const bool isDocumentModified = VulkanGlTFModelLocal::MapBinaryData(document, aPath, binaryChunk, shouldMapImages, mappedFiles, buffers, encodedImages);
+
+	// Only serialize the document again if payloads have been replaced by placeholders
+	const std::string modifiedJson = isDocumentModified ? document.dump() : std::string{};
+	const std::string_view gltfJson = isDocumentModified ? std::string_view{modifiedJson} : json;
 
 	std::string error;
 	std::string warning;
 
-	tinygltf::Model* sourceGltfModel = new tinygltf::Model();
-	const bool isFileLoaded = gltfContext.LoadASCIIFromFile(sourceGltfModel, &error, &warning, aPath.generic_string());
+	// Owned for the exceptions below, it is released as soon as the conversion is done
+	std::unique_ptr<tinygltf::Model> sourceGltfModelOwner = std::make_unique<tinygltf::Model>();
+	tinygltf::Model* sourceGltfModel = sourceGltfModelOwner.get();
+	const bool isFileLoaded = gltfContext.LoadASCIIFromString(sourceGltfModel, &error, &warning, gltfJson.data(), static_cast<unsigned int>(gltfJson.size()), aPath.parent_path().generic_string());
 	if (!isFileLoaded)
 	{
 		throw std::runtime_error(std::format("Could not load glTF file: {} {}", aPath.generic_string(), error));
 	}
 
+	// Buffers embedded as data URIs have been decoded by tinygltf
+	for (Core::size i = 0; i < buffers.size(); i++)
+	{
+		if (buffers[i].empty())
+		{
+			buffers[i] = sourceGltfModel->buffers[i].data;
+		}
+	}
+
 	if (!warning.empty())
 	{
 		std::cout << "Warning for " << aPath << ": " << warning << std::endl;
@@ -668,12 +1211,14 @@ UniqueIdentifier ModelManager::LoadModel(const std::filesystem::path& aPath, Vul
 		std::cout << " Used extension: " << extension;
 	}
 
-	std::vector<Core::uint32> indexBuffer;
+	std::vector<Core::uint32>& indexBuffer = aResult.mIndexBuffer;
 	std::vector<vkglTF::Vertex> vertexBuffer;
+	vkglTF::Model* newModel = aResult.mModel;
 
 	if (!HasFlag(aFileLoadingFlags, FileLoadingFlags::DontLoadImages))
 	{
-		LoadImages(*newModel, sourceGltfModel);
+		VulkanGlTFModelLocal::DecodeImages(*mJobSystem.lock(), sourceGltfModel, encodedImages);
+		LoadImages(aResult, sourceGltfModel);
 	}
 
 	LoadMaterials(*newModel, sourceGltfModel);
@@ -682,15 +1227,15 @@ UniqueIdentifier ModelManager::LoadModel(const std::filesystem::path& aPath, Vul
 	for (Core::size i = 0; i < scene.nodes.size(); i++)
 	{
 		const tinygltf::Node node = sourceGltfModel->nodes[scene.nodes[i]];
-		LoadNode(*newModel, sourceGltfModel, nullptr, &node, scene.nodes[i], indexBuffer, vertexBuffer, aScale);
+		LoadNode(*newModel, sourceGltfModel, buffers, nullptr, &node, scene.nodes[i], indexBuffer, vertexBuffer, aScale);
 	}
 
 	if (!sourceGltfModel->animations.empty())
 	{
-		LoadAnimations(*newModel, sourceGltfModel);
+		LoadAnimations(*newModel, sourceGltfModel, buffers);
 	}
 
-	LoadSkins(*newModel, sourceGltfModel);
+	LoadSkins(*newModel, sourceGltfModel, buffers);
 
 	for (vkglTF::Node*& node : newModel->linearNodes)
 	{
@@ -699,14 +1244,12 @@ UniqueIdentifier ModelManager::LoadModel(const std::filesystem::path& aPath, Vul
 		{
 			node->mSkin = newModel->skins[node->mSkinIndex];
 		}
-
-		// Initial pose
-		if (node->mMesh)
-		{
-			node->update();
-		}
 	}
 
+	// Initial pose
+	newModel->mHierarchy.Build(newModel->nodes);
+	newModel->UpdateNodes();
+
 	// Pre-Calculations for requested features
 	const bool preTransform = HasFlag(aFileLoadingFlags, FileLoadingFlags::PreTransformVertices);
 	const bool preMultiplyColor = HasFlag(aFileLoadingFlags, FileLoadingFlags::PreMultiplyVertexColors);
@@ -748,15 +1291,48 @@ UniqueIdentifier ModelManager::LoadModel(const std::filesystem::path& aPath, Vul
 		}
 	}
 
-	const Core::size vertexBufferSize = vertexBuffer.size() * sizeof(vkglTF::Vertex);
-	const Core::size indexBufferSize = indexBuffer.size() * sizeof(Core::uint32);
-	CreateBuffers(*newModel, indexBuffer, vertexBuffer, vertexBufferSize, indexBufferSize, aDevice, aTransferQueue);
-
 	GetSceneDimensions(*newModel);
 
-	// Setup descriptors
+	// Meshlet bounds are taken from the stored positions, so they are only in model space for pre-transformed vertices
+	if (HasFlag(aFileLoadingFlags, FileLoadingFlags::BuildMeshlets) && preTransform)
+	{
+		MeshletBuilder::BuildMeshlets(*newModel, indexBuffer, vertexBuffer);
+	}
+
+	// Only the attributes the model is drawn with are uploaded
+	newModel->mVertexLayout = aVertexLayout.mComponents.empty() ? vkglTF::VertexLayout{VulkanGlTFModelLocal::GetVertexComponents(sourceGltfModel, aFileLoadingFlags), aVertexLayout.mIsQuantized} : aVertexLayout;
+	aResult.mVertexData = newModel->mVertexLayout.PackVertices(vertexBuffer);
+
+	sourceGltfModelOwner.reset();
+
+	aResult.mIndices = indexBuffer;
+	aResult.mVertices = aResult.mVertexData;
+	ModelCache::WriteCookedModel(aPath, aFileLoadingFlags, aScale, *newModel, aResult.mImages, aResult.mVertices, aResult.mIndices);
+}
+
+bool ModelManager::CreateModelResources(ModelLoadResult& aResult, VulkanDevice* aDevice, VulkanStagingRing* aStagingRing, FileLoadingFlags aFileLoadingFlags)
+{
+	vkglTF::Model* newModel = aResult.mModel;
+
+	// Checked before anything is created or uploaded, so a model that doesn't fit leaves nothing behind but its CPU side
+	const Core::size freeTextureSlots = mFreeBindlessTextures.size() + (gMaxBindlessTextures - mBindlessTextureCount);
+	const Core::size freeMaterialSlots = mFreeMaterials.size() + (gMaxMaterials - mMaterialCount);
+	if (newModel->textures.size() > freeTextureSlots || newModel->materials.size() > freeMaterialSlots)
+	{
+		std::cerr << "Could not load GLTF model " << newModel->path << ": " << std::format("needs {} textures and {} materials, only {} and {} slots are free", newModel->textures.size(), newModel->materials.size(), freeTextureSlots, freeMaterialSlots) << std::endl;
+		return false;
+	}
+
+	if (!HasFlag(aFileLoadingFlags, FileLoadingFlags::DontLoadImages))
+	{
+		CreateTextures(*newModel, aResult.mImages);
+	}
+
+	CreateBuffers(*newModel, aResult.mIndices, aResult.mVertices, aDevice, aStagingRing);
+	RegisterMaterials(*newModel, aStagingRing);
+
+	// Setup descriptors, images are bound through the bindless set instead of per material
 	Core::uint32 uboCount{0};
-	Core::uint32 imageCount{0};
 	for (const vkglTF::Node* node : newModel->linearNodes)
 	{
 		if (node->mMesh)
@@ -765,27 +1341,10 @@ UniqueIdentifier ModelManager::LoadModel(const std::filesystem::path& aPath, Vul
 		}
 	}
 
-	for (const vkglTF::Material& material : newModel->materials)
-	{
-		if (material.mBaseColorTexture != nullptr)
-		{
-			imageCount++;
-		}
-	}
-
-	CreateDescriptorPool(uboCount, imageCount, aDevice);
+	CreateDescriptorPool(uboCount, aDevice);
 	CreateDescriptorSets(*newModel, aDevice);
 
-	loadTimer.EndTimer();
-
-	std::cout << "Loaded GLTF model " << aPath.filename() << " " << std::format("({:.2f}s)", loadTimer.GetDurationSeconds()) << std::endl;
-
-	delete sourceGltfModel;
-
-	UniqueIdentifier identifier{};
-	mModels.emplace(identifier, newModel);
-
-	return identifier;
+	return true;
 }
 
 vkglTF::Model* ModelManager::GetModel(const UniqueIdentifier aIdentifier) const
@@ -810,147 +1369,148 @@ void ModelManager::CreateDescriptorSets(vkglTF::Model& aModel, VulkanDevice* aDe
 			CreateNodeDescriptorSets(node, mDescriptorSetLayoutUbo);
 		}
 	}
+}
 
-	// Descriptors for per-material images
-	{
-		// Layout is global, so only create if it hasn't already been created before
-		if (mDescriptorSetLayoutImage == VK_NULL_HANDLE)
-		{
-			std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
-			if (HasFlag(mDescriptorBindingFlags, DescriptorBindingFlags::ImageBaseColor))
-			{
-				setLayoutBindings.push_back({.binding = static_cast<Core::uint32>(setLayoutBindings.size()), .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT});
-			}
-
-			if (HasFlag(mDescriptorBindingFlags, DescriptorBindingFlags::ImageNormalMap))
-			{
-				setLayoutBindings.push_back({.binding = static_cast<Core::uint32>(setLayoutBindings.size()), .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT});
-			}
+void ModelManager::CreateBindlessResources(VulkanDevice* aDevice)
+{
+	mVulkanDevice = aDevice;
 
-			const VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo{
-				.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-				.bindingCount = static_cast<Core::uint32>(setLayoutBindings.size()),
-				.pBindings = setLayoutBindings.data(),
-			};
-			VK_CHECK_RESULT(vkCreateDescriptorSetLayout(aDevice->mLogicalVkDevice, &descriptorSetLayoutCreateInfo, nullptr, &mDescriptorSetLayoutImage));
-		}
+	// Textures of models that are still streaming in are written while frames using the set are in flight
+	const std::array<VkDescriptorSetLayoutBinding, 2> setLayoutBindings{{
+		{.binding = 0, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = gMaxBindlessTextures, .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT},
+		{.binding = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT},
+	}};
+	const std::array<VkDescriptorBindingFlags, 2> bindingFlags = {
+		VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT,
+		0
+	};
+	const VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+		.bindingCount = static_cast<Core::uint32>(bindingFlags.size()),
+		.pBindingFlags = bindingFlags.data()
+	};
+	const VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.pNext = &bindingFlagsCreateInfo,
+		.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+		.bindingCount = static_cast<Core::uint32>(setLayoutBindings.size()),
+		.pBindings = setLayoutBindings.data(),
+	};
+	VK_CHECK_RESULT(vkCreateDescriptorSetLayout(aDevice->mLogicalVkDevice, &descriptorSetLayoutCreateInfo, nullptr, &mBindlessDescriptorSetLayout));
 
-		for (vkglTF::Material& material : aModel.materials)
-		{
-			if (material.mBaseColorTexture != nullptr)
-			{
-				CreateMaterialDescriptorSets(material);
-			}
-		}
-	}
-}
+	const std::array<VkDescriptorPoolSize, 2> poolSizes{{
+		{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, gMaxBindlessTextures},
+		{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1},
+	}};
+	const VkDescriptorPoolCreateInfo descriptorPoolCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+		.maxSets = 1,
+		.poolSizeCount = static_cast<Core::uint32>(poolSizes.size()),
+		.pPoolSizes = poolSizes.data()
+	};
+	VK_CHECK_RESULT(vkCreateDescriptorPool(aDevice->mLogicalVkDevice, &descriptorPoolCreateInfo, nullptr, &mBindlessDescriptorPool));
 
-void ModelManager::CreateMaterialDescriptorSets(vkglTF::Material& material)
-{
 	const VkDescriptorSetAllocateInfo descriptorSetAllocateInfo{
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-		.descriptorPool = mDescriptorPool,
+		.descriptorPool = mBindlessDescriptorPool,
 		.descriptorSetCount = 1,
-		.pSetLayouts = &mDescriptorSetLayoutImage,
+		.pSetLayouts = &mBindlessDescriptorSetLayout,
 	};
-	VK_CHECK_RESULT(vkAllocateDescriptorSets(mVulkanDevice->mLogicalVkDevice, &descriptorSetAllocateInfo, &material.mDescriptorSet));
+	VK_CHECK_RESULT(vkAllocateDescriptorSets(aDevice->mLogicalVkDevice, &descriptorSetAllocateInfo, &mBindlessDescriptorSet));
 
-	std::vector<VkDescriptorImageInfo> imageDescriptors{};
-	std::vector<VkWriteDescriptorSet> writeDescriptorSets{};
-	if (HasFlag(mDescriptorBindingFlags, DescriptorBindingFlags::ImageBaseColor))
-	{
-		imageDescriptors.push_back(material.mBaseColorTexture->mDescriptorImageInfo);
+	const VkDeviceSize materialBufferSize = gMaxMaterials * sizeof(vkglTF::MaterialData);
+	VK_CHECK_RESULT(aDevice->CreateBuffer(
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		materialBufferSize,
+		&mMaterialBuffer,
+		&mMaterialAllocation));
+
+	const VkDescriptorBufferInfo materialBufferInfo{mMaterialBuffer, 0, materialBufferSize};
+	const VkWriteDescriptorSet writeDescriptorSet{
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.dstSet = mBindlessDescriptorSet,
+		.dstBinding = 1,
+		.descriptorCount = 1,
+		.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		.pBufferInfo = &materialBufferInfo
+	};
+	vkUpdateDescriptorSets(aDevice->mLogicalVkDevice, 1, &writeDescriptorSet, 0, nullptr);
+}
 
-		const VkWriteDescriptorSet writeDescriptorSet{
-			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-			.dstSet = material.mDescriptorSet,
-			.dstBinding = static_cast<Core::uint32>(writeDescriptorSets.size()),
-			.descriptorCount = 1,
-			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-			.pImageInfo = &material.mBaseColorTexture->mDescriptorImageInfo
-		};
-		writeDescriptorSets.push_back(writeDescriptorSet);
+void ModelManager::RegisterMaterials(vkglTF::Model& aModel, VulkanStagingRing* aStagingRing)
+{
+	for (vkglTF::Texture& texture : aModel.textures)
+	{
+		AddBindlessTexture(texture);
 	}
 
-	if (material.mNormalTexture && HasFlag(mDescriptorBindingFlags, DescriptorBindingFlags::ImageNormalMap))
+	// Slots come from the free list, so the materials of a model aren't contiguous and each one is uploaded to its own slot
+	for (vkglTF::Material& material : aModel.materials)
 	{
-		imageDescriptors.push_back(material.mNormalTexture->mDescriptorImageInfo);
+		material.mBindlessIndex = VulkanGlTFModelLocal::AcquireSlot(mFreeMaterials, mMaterialCount);
 
-		const VkWriteDescriptorSet writeDescriptorSet{
-			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-			.dstSet = material.mDescriptorSet,
-			.dstBinding = static_cast<Core::uint32>(writeDescriptorSets.size()),
-			.descriptorCount = 1,
-			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-			.pImageInfo = &material.mNormalTexture->mDescriptorImageInfo
-		};
-		writeDescriptorSets.push_back(writeDescriptorSet);
-	}
+		vkglTF::MaterialData materialData;
+		materialData.mBaseColorFactor = material.mBaseColorFactor;
+		materialData.mBaseColorTexture = material.mBaseColorTexture ? material.mBaseColorTexture->mBindlessIndex : vkglTF::gNoBindlessIndex;
+		materialData.mNormalTexture = material.mNormalTexture ? material.mNormalTexture->mBindlessIndex : vkglTF::gNoBindlessIndex;
+		materialData.mAlphaCutoff = material.mAlphaCutoff;
+		materialData.mAlphaMode = static_cast<Core::uint32>(material.mAlphaMode);
 
-	vkUpdateDescriptorSets(mVulkanDevice->mLogicalVkDevice, static_cast<Core::uint32>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+		aStagingRing->UploadBuffer(mMaterialBuffer, &materialData, sizeof(vkglTF::MaterialData), material.mBindlessIndex * sizeof(vkglTF::MaterialData), VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	}
 }
 
-void ModelManager::CreateDescriptorPool(Core::uint32 uboCount, Core::uint32 imageCount, VulkanDevice* aDevice)
+Core::uint32 ModelManager::AddBindlessTexture(vkglTF::Texture& aTexture)
 {
-	std::vector<VkDescriptorPoolSize> poolSizes = {
-		{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uboCount},
+	// Images are skipped with FileLoadingFlags::DontLoadImages, materials then sample no texture
+	if (aTexture.mImageView == VK_NULL_HANDLE || aTexture.mBindlessIndex != vkglTF::gNoBindlessIndex)
+	{
+		return aTexture.mBindlessIndex;
+	}
+
+	// CreateModelResources has made sure the array has room for every texture of the model
+	aTexture.mBindlessIndex = VulkanGlTFModelLocal::AcquireSlot(mFreeBindlessTextures, mBindlessTextureCount);
+
+	const VkWriteDescriptorSet writeDescriptorSet{
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.dstSet = mBindlessDescriptorSet,
+		.dstBinding = 0,
+		.dstArrayElement = aTexture.mBindlessIndex,
+		.descriptorCount = 1,
+		.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		.pImageInfo = &aTexture.mDescriptorImageInfo
 	};
+	vkUpdateDescriptorSets(mVulkanDevice->mLogicalVkDevice, 1, &writeDescriptorSet, 0, nullptr);
 
-	if (imageCount > 0)
-	{
-		if (HasFlag(mDescriptorBindingFlags, DescriptorBindingFlags::ImageBaseColor))
-		{
-			poolSizes.push_back({VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, imageCount});
-		}
+	return aTexture.mBindlessIndex;
+}
 
-		if (HasFlag(mDescriptorBindingFlags, DescriptorBindingFlags::ImageNormalMap))
-		{
-			poolSizes.push_back({VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, imageCount});
-		}
-	}
+void ModelManager::CreateDescriptorPool(Core::uint32 uboCount, VulkanDevice* aDevice)
+{
+	const std::vector<VkDescriptorPoolSize> poolSizes = {
+		{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uboCount},
+	};
 
 	const VkDescriptorPoolCreateInfo descriptorPoolCreateInfo{
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-		.maxSets = uboCount + imageCount,
+		.maxSets = uboCount,
 		.poolSizeCount = static_cast<Core::uint32>(poolSizes.size()),
 		.pPoolSizes = poolSizes.data()
 	};
 	VK_CHECK_RESULT(vkCreateDescriptorPool(aDevice->mLogicalVkDevice, &descriptorPoolCreateInfo, nullptr, &mDescriptorPool));
 }
 
-void ModelManager::CreateBuffers(vkglTF::Model& aModel, std::vector<Core::uint32>& indexBuffer, std::vector<vkglTF::Vertex>& vertexBuffer, Core::size vertexBufferSize, Core::size indexBufferSize, VulkanDevice* aDevice, VkQueue aTransferQueue)
+void ModelManager::CreateBuffers(vkglTF::Model& aModel, std::span<const Core::uint32> aIndices, std::span<const unsigned char> aVertices, VulkanDevice* aDevice, VulkanStagingRing* aStagingRing)
 {
-	aModel.indices.mCount = static_cast<Core::uint32>(indexBuffer.size());
-	aModel.vertices.mCount = static_cast<Core::uint32>(vertexBuffer.size());
+	aModel.indices.mCount = static_cast<Core::uint32>(aIndices.size());
+	aModel.vertices.mCount = static_cast<Core::uint32>(aVertices.size() / aModel.mVertexLayout.mStride);
 
-	assert((vertexBufferSize > 0) && (indexBufferSize > 0));
+	const Core::size vertexBufferSize = aVertices.size_bytes();
+	const Core::size indexBufferSize = aIndices.size_bytes();
 
-	struct StagingBuffer
-	{
-		VkBuffer buffer;
-		VkDeviceMemory memory;
-	};
-	StagingBuffer vertexStaging{};
-	StagingBuffer indexStaging{};
-
-	// Create staging buffers
-	// Vertex data
-	VK_CHECK_RESULT(aDevice->CreateBuffer(
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		vertexBufferSize,
-		&vertexStaging.buffer,
-		&vertexStaging.memory,
-		vertexBuffer.data()));
-
-	// Index data
-	VK_CHECK_RESULT(aDevice->CreateBuffer(
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		indexBufferSize,
-		&indexStaging.buffer,
-		&indexStaging.memory,
-		indexBuffer.data()));
+	assert((vertexBufferSize > 0) && (indexBufferSize > 0));
 
 	// Create device local buffers
 	// Vertex buffer
@@ -959,7 +1519,7 @@ void ModelManager::CreateBuffers(vkglTF::Model& aModel, std::vector<Core::uint32
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 		vertexBufferSize,
 		&aModel.vertices.mBuffer,
-		&aModel.vertices.mMemory, nullptr));
+		&aModel.vertices.mAllocation, nullptr));
 
 	// Index buffer
 	VK_CHECK_RESULT(aDevice->CreateBuffer(
@@ -967,25 +1527,25 @@ void ModelManager::CreateBuffers(vkglTF::Model& aModel, std::vector<Core::uint32
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 		indexBufferSize,
 		&aModel.indices.mBuffer,
-		&aModel.indices.mMemory, nullptr));
-
-	// Copy from staging buffers
-	VkCommandBuffer copyCmd = aDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		&aModel.indices.mAllocation, nullptr));
 
-	VkBufferCopy copyRegion = {};
+	// Copy through the staging ring, submitted together with the other uploads of this load
+	aStagingRing->UploadBuffer(aModel.vertices.mBuffer, aVertices.data(), vertexBufferSize);
+	aStagingRing->UploadBuffer(aModel.indices.mBuffer, aIndices.data(), indexBufferSize);
 
-	copyRegion.size = vertexBufferSize;
-	vkCmdCopyBuffer(copyCmd, vertexStaging.buffer, aModel.vertices.mBuffer, 1, &copyRegion);
-
-	copyRegion.size = indexBufferSize;
-	vkCmdCopyBuffer(copyCmd, indexStaging.buffer, aModel.indices.mBuffer, 1, &copyRegion);
-
-	aDevice->FlushCommandBuffer(copyCmd, aTransferQueue, true);
-
-	vkDestroyBuffer(aDevice->mLogicalVkDevice, vertexStaging.buffer, nullptr);
-	vkFreeMemory(aDevice->mLogicalVkDevice, vertexStaging.memory, nullptr);
-	vkDestroyBuffer(aDevice->mLogicalVkDevice, indexStaging.buffer, nullptr);
-	vkFreeMemory(aDevice->mLogicalVkDevice, indexStaging.memory, nullptr);
+	// Meshlet bounds are read by the meshlet culling compute shader
+	if (!aModel.meshlets.mData.empty())
+	{
+		const Core::size meshletBufferSize = aModel.meshlets.mData.size() * sizeof(vkglTF::Meshlet);
+		VK_CHECK_RESULT(aDevice->CreateBuffer(
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			meshletBufferSize,
+			&aModel.meshlets.mBuffer,
+			&aModel.meshlets.mAllocation, nullptr));
+
+		aStagingRing->UploadBuffer(aModel.meshlets.mBuffer, aModel.meshlets.mData.data(), meshletBufferSize);
+	}
 }
 
 void ModelManager::GetNodeDimensions(const vkglTF::Node* aNode, Math::Vector3f& aMin, Math::Vector3f& aMax)
@@ -1026,78 +1586,6 @@ void ModelManager::GetSceneDimensions(vkglTF::Model& aModel)
 	aModel.mDimensions.mRadius = Math::Distance(aModel.mDimensions.mMin, aModel.mDimensions.mMax) / 2.0f;
 }
 
-void ModelManager::UpdateAnimation(vkglTF::Model& aModel, Core::uint32 aIndex, float aTime)
-{
-	if (aIndex > static_cast<Core::uint32>(aModel.animations.size()) - 1)
-	{
-		std::cout << "No animation with index " << aIndex << std::endl;
-		return;
-	}
-
-	vkglTF::Animation& animation = aModel.animations[aIndex];
-
-	bool updated = false;
-	for (vkglTF::AnimationChannel& channel : animation.mChannels)
-	{
-		vkglTF::AnimationSampler& sampler = animation.mSamplers[channel.mSamplerIndex];
-		if (sampler.mInputs.size() > sampler.mOutputsVec4.size())
-		{
-			continue;
-		}
-
-		for (Core::size i = 0; i < sampler.mInputs.size() - 1; i++)
-		{
-			if ((aTime >= sampler.mInputs[i]) && (aTime <= sampler.mInputs[i + 1]))
-			{
-				float u = std::max(0.0f, aTime - sampler.mInputs[i]) / (sampler.mInputs[i + 1] - sampler.mInputs[i]);
-				if (u <= 1.0f)
-				{
-					switch (channel.mPathType)
-					{
-						case vkglTF::AnimationChannel::PathType::TRANSLATION:
-						{
-							Math::Vector4f trans = Math::Mix(sampler.mOutputsVec4[i], sampler.mOutputsVec4[i + 1], u);
-							channel.mNode->mTranslation = Math::Vector3f(trans);
-							break;
-						}
-						case vkglTF::AnimationChannel::PathType::SCALE:
-						{
-							Math::Vector4f trans = Math::Mix(sampler.mOutputsVec4[i], sampler.mOutputsVec4[i + 1], u);
-							channel.mNode->mScale = Math::Vector3f(trans);
-							break;
-						}
-						case vkglTF::AnimationChannel::PathType::ROTATION:
-						{
-							Math::Quaternionf q1{};
-							q1.x = sampler.mOutputsVec4[i].x;
-							q1.y = sampler.mOutputsVec4[i].y;
-							q1.z = sampler.mOutputsVec4[i].z;
-							q1.w = sampler.mOutputsVec4[i].w;
-
-							Math::Quaternionf q2{};
-							q2.x = sampler.mOutputsVec4[i + 1].x;
-							q2.y = sampler.mOutputsVec4[i + 1].y;
-							q2.z = sampler.mOutputsVec4[i + 1].z;
-							q2.w = sampler.mOutputsVec4[i + 1].w;
-							channel.mNode->mRotation = Math::Normalize(Math::Slerp(q1, q2, u));
-							break;
-						}
-					}
-					updated = true;
-				}
-			}
-		}
-	}
-
-	if (updated)
-	{
-		for (vkglTF::Node*& node : aModel.nodes)
-		{
-			node->update();
-		}
-	}
-}
-
 vkglTF::Node* ModelManager::FindNode(vkglTF::Node* aParent, Core::uint32 aIndex)
 {
 	vkglTF::Node* nodeFound = nullptr;
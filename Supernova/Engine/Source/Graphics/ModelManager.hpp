@@ -1,19 +1,24 @@
 #pragma once
 
 #include "Core/Types.hpp"
+#include "JobSystem.hpp"
 #include "Math/Types.hpp"
+#include "ModelCache.hpp"
 #include "ModelFlags.hpp"
+#include "Timer.hpp"
 #include "UniqueIdentifier.hpp"
 #include "VulkanGlTFTypes.hpp"
 
 #include <filesystem>
 #include <map>
 #include <memory>
+#include <span>
 #include <vector>
 #include <vulkan/vulkan_core.h>
 
 struct VulkanDevice;
 class TextureManager;
+class VulkanStagingRing;
 
 namespace tinygltf
 {
@@ -24,38 +29,99 @@ namespace tinygltf
 class ModelManager
 {
 public:
-	ModelManager(const std::shared_ptr<TextureManager>& aTextureManager);
+	static constexpr Core::uint32 gMaxBindlessTextures = 4096;
+	static constexpr Core::uint32 gMaxMaterials = 1024;
+
+	ModelManager(const std::shared_ptr<TextureManager>& aTextureManager, const std::shared_ptr<JobSystem>& aJobSystem);
 	~ModelManager();
 
-	UniqueIdentifier LoadModel(const std::filesystem::path& aPath, VulkanDevice* aDevice, VkQueue aTransferQueue, FileLoadingFlags aFileLoadingFlags = FileLoadingFlags::None, float aScale = 1.0f);
+	// Creates the texture array and material buffer shared by all models, has to be called before the first model is loaded
+	void CreateBindlessResources(VulkanDevice* aDevice);
+
+	// A vertex layout without components stores every attribute the file provides, otherwise exactly the requested components are stored
+	UniqueIdentifier LoadModel(const std::filesystem::path& aPath, VulkanDevice* aDevice, VulkanStagingRing* aStagingRing, FileLoadingFlags aFileLoadingFlags = FileLoadingFlags::None, float aScale = 1.0f, const vkglTF::VertexLayout& aVertexLayout = {});
+	// Parses and converts the file in a job on a worker thread and returns right away, GetModel returns nullptr until ProcessPendingLoads has published the model
+	UniqueIdentifier LoadModelAsync(const std::filesystem::path& aPath, VulkanDevice* aDevice, VulkanStagingRing* aStagingRing, FileLoadingFlags aFileLoadingFlags = FileLoadingFlags::None, float aScale = 1.0f, const vkglTF::VertexLayout& aVertexLayout = {});
+	// Creates the GPU resources of finished loads and publishes models whose uploads have completed, call once per frame from the render thread
+	void ProcessPendingLoads();
 	vkglTF::Model* GetModel(const UniqueIdentifier aIdentifier) const;
-	VkDescriptorSetLayout GetDescriptorSetLayoutImage() const { return mDescriptorSetLayoutImage; }
+	bool IsModelLoaded(const UniqueIdentifier aIdentifier) const { return mModels.contains(aIdentifier); }
+	Core::size GetPendingLoadCount() const { return mPendingLoads.size(); }
+	VkDescriptorSetLayout GetBindlessDescriptorSetLayout() const { return mBindlessDescriptorSetLayout; }
+	VkDescriptorSet GetBindlessDescriptorSet() const { return mBindlessDescriptorSet; }
 	VkDescriptorSetLayout GetDescriptorSetLayoutUbo() const { return mDescriptorSetLayoutUbo; }
 
 private:
-	void LoadNode(vkglTF::Model& aModel, tinygltf::Model* aGltfModel, vkglTF::Node* aParent, const tinygltf::Node* aNode, Core::uint32 aNodeIndex, std::vector<Core::uint32>& aIndexBuffer, std::vector<vkglTF::Vertex>& aVertexBuffer, float aGlobalscale);
-	void LoadSkins(vkglTF::Model& aModel, tinygltf::Model* aGltfModel);
-	void LoadImages(vkglTF::Model& aModel, tinygltf::Model* aGltfModel);
+	// Binary data of every glTF buffer, either a view into a mapped file or into a buffer decoded by tinygltf
+	using BufferData = std::vector<std::span<const unsigned char>>;
+
+	// Output of the worker stage, everything the render thread needs to create the GPU resources
+	struct ModelLoadResult
+	{
+		ModelLoadResult() : mModel{nullptr} {}
+
+		vkglTF::Model* mModel;
+		std::vector<vkglTF::Image> mImages; // Decoded images, textures are created from these on the render thread
+		std::vector<Core::uint32> mIndexBuffer;
+		std::vector<unsigned char> mVertexData; // Vertices packed into the model's vertex layout
+		ModelCache::CookedModel mCookedModel; // Keeps the cooked model mapped until its streams have been uploaded
+		std::span<const Core::uint32> mIndices; // Streams to upload, views into either the buffers above or the cooked model
+		std::span<const unsigned char> mVertices;
+	};
+
+	struct PendingModelLoad
+	{
+		PendingModelLoad() : mLoadCounter{std::make_unique<JobCounter>()}, mModel{nullptr}, mVulkanDevice{nullptr}, mStagingRing{nullptr}, mUploadTimelineValue{0}, mFileLoadingFlags{FileLoadingFlags::None} {}
+
+		std::unique_ptr<JobCounter> mLoadCounter; // Done once the load job has written mResult
+		ModelLoadResult mResult;
+		vkglTF::Model* mModel; // Set once the GPU resources have been created
+		VulkanDevice* mVulkanDevice;
+		VulkanStagingRing* mStagingRing;
+		Core::uint64 mUploadTimelineValue; // Staging ring value the model becomes drawable at, 0 until its uploads have been submitted
+		FileLoadingFlags mFileLoadingFlags;
+		std::filesystem::path mPath;
+		Time::Timer mLoadTimer;
+	};
+
+	ModelLoadResult LoadModelData(const std::filesystem::path& aPath, FileLoadingFlags aFileLoadingFlags, float aScale, const vkglTF::VertexLayout& aVertexLayout);
+	void ConvertModelData(const std::filesystem::path& aPath, FileLoadingFlags aFileLoadingFlags, float aScale, const vkglTF::VertexLayout& aVertexLayout, ModelLoadResult& aResult);
+	bool CreateModelResources(ModelLoadResult& aResult, VulkanDevice* aDevice, VulkanStagingRing* aStagingRing, FileLoadingFlags aFileLoadingFlags); // Returns false if the bindless texture array or the material buffer can't hold the model
+	void DestroyModel(vkglTF::Model* aModel);
+	void DestroyModelData(vkglTF::Model* aModel); // Frees the CPU side only, for models whose GPU resources were never created
+	void LoadNode(vkglTF::Model& aModel, tinygltf::Model* aGltfModel, const BufferData& aBuffers, vkglTF::Node* aParent, const tinygltf::Node* aNode, Core::uint32 aNodeIndex, std::vector<Core::uint32>& aIndexBuffer, std::vector<vkglTF::Vertex>& aVertexBuffer, float aGlobalscale);
+	void LoadSkins(vkglTF::Model& aModel, tinygltf::Model* aGltfModel, const BufferData& aBuffers);
+	void LoadImages(ModelLoadResult& aResult, tinygltf::Model* aGltfModel);
+	void CreateTextures(vkglTF::Model& aModel, std::vector<vkglTF::Image>& aImages);
 	void LoadMaterials(vkglTF::Model& aModel, tinygltf::Model* aGltfModel);
-	void LoadAnimations(vkglTF::Model& aModel, tinygltf::Model* aGltfModel);
+	void LoadAnimations(vkglTF::Model& aModel, tinygltf::Model* aGltfModel, const BufferData& aBuffers);
 	void GetNodeDimensions(const vkglTF::Node* aNode, Math::Vector3f& aMin, Math::Vector3f& aMax);
 	void GetSceneDimensions(vkglTF::Model& aModel);
-	void UpdateAnimation(vkglTF::Model& aModel, Core::uint32 aIndex, float aTime);
 	void CreateDescriptorSets(vkglTF::Model& aModel, VulkanDevice* aDevice);
-	void CreateMaterialDescriptorSets(vkglTF::Material& material);
-	void CreateDescriptorPool(Core::uint32 uboCount, Core::uint32 imageCount, VulkanDevice* aDevice);
+	void RegisterMaterials(vkglTF::Model& aModel, VulkanStagingRing* aStagingRing);
+	Core::uint32 AddBindlessTexture(vkglTF::Texture& aTexture);
+	void CreateDescriptorPool(Core::uint32 uboCount, VulkanDevice* aDevice);
 	void CreateNodeDescriptorSets(vkglTF::Node* aNode, const VkDescriptorSetLayout aDescriptorSetLayout);
-	void CreateBuffers(vkglTF::Model& aModel, std::vector<Core::uint32>& indexBuffer, std::vector<vkglTF::Vertex>& vertexBuffer, Core::size vertexBufferSize, Core::size indexBufferSize, VulkanDevice* aDevice, VkQueue aTransferQueue);
+	void CreateBuffers(vkglTF::Model& aModel, std::span<const Core::uint32> aIndices, std::span<const unsigned char> aVertices, VulkanDevice* aDevice, VulkanStagingRing* aStagingRing);
 
 	vkglTF::Node* FindNode(vkglTF::Node* aParent, Core::uint32 aIndex);
 	vkglTF::Node* NodeFromIndex(vkglTF::Model& aModel, Core::uint32 aIndex);
 	vkglTF::Texture* GetTexture(vkglTF::Model& aModel, Core::uint32 aIndex);
 
 	VkDescriptorSetLayout mDescriptorSetLayoutUbo;
-	VkDescriptorSetLayout mDescriptorSetLayoutImage;
 	VkDescriptorPool mDescriptorPool;
-	DescriptorBindingFlags mDescriptorBindingFlags;
+	VkDescriptorSetLayout mBindlessDescriptorSetLayout; // Binding 0: texture array, binding 1: material buffer
+	VkDescriptorPool mBindlessDescriptorPool;
+	VkDescriptorSet mBindlessDescriptorSet;
+	VkBuffer mMaterialBuffer; // vkglTF::MaterialData of every loaded material
+	VulkanAllocation mMaterialAllocation;
+	Core::uint32 mBindlessTextureCount; // Slots in use or freed, the rest of the pool has never been handed out
+	Core::uint32 mMaterialCount;
+	std::vector<Core::uint32> mFreeBindlessTextures; // Slots released by destroyed models
+	std::vector<Core::uint32> mFreeMaterials;
 	std::weak_ptr<TextureManager> mTextureManager;
+	std::weak_ptr<JobSystem> mJobSystem; // Runs the load jobs and the image decodes within them
 	VulkanDevice* mVulkanDevice;
 	std::map<UniqueIdentifier, vkglTF::Model*> mModels;
+	std::map<UniqueIdentifier, PendingModelLoad> mPendingLoads;
 };
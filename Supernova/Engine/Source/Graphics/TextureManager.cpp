@@ -5,6 +5,7 @@
 #include "Timer.hpp"
 #include "VulkanDevice.hpp"
 #include "VulkanGlTFTypes.hpp"
+#include "VulkanStagingRing.hpp"
 #include "VulkanTools.hpp"
 
 #include <algorithm>
@@ -19,9 +20,15 @@
 #include <vector>
 #include <vulkan/vulkan_core.h>
 
+namespace TextureManagerLocal
+{
+	// Buffer to image copies need offsets aligned to the texel block size, 16 covers every uncompressed and block compressed format
+	static constexpr VkDeviceSize gImageCopyOffsetAlignment = 16;
+}
+
 TextureManager::TextureManager()
 	: mVulkanDevice{nullptr}
-	, mTransferQueue{VK_NULL_HANDLE}
+	, mStagingRing{nullptr}
 {
 }
 
@@ -29,10 +36,10 @@ TextureManager::~TextureManager()
 {
 }
 
-void TextureManager::SetContext(VulkanDevice* aDevice, VkQueue aTransferQueue)
+void TextureManager::SetContext(VulkanDevice* aDevice, VulkanStagingRing* aStagingRing)
 {
 	mVulkanDevice = aDevice;
-	mTransferQueue = aTransferQueue;
+	mStagingRing = aStagingRing;
 }
 
 vkglTF::Texture TextureManager::CreateEmptyTexture()
@@ -46,35 +53,10 @@ vkglTF::Texture TextureManager::CreateEmptyTexture()
 	texture.mMipLevels = 1;
 
 	const Core::size bufferSize = static_cast<Core::size>(texture.mWidth * texture.mHeight * 4);
-	unsigned char* buffer = new unsigned char[bufferSize];
-	std::memset(buffer, 0, bufferSize);
-
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingMemory;
-	const VkBufferCreateInfo bufferCreateInfo{
-		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-		.size = bufferSize,
-		.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-	};
-	VK_CHECK_RESULT(vkCreateBuffer(mVulkanDevice->mLogicalVkDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-	VkMemoryRequirements hostMemoryRequirements;
-	vkGetBufferMemoryRequirements(mVulkanDevice->mLogicalVkDevice, stagingBuffer, &hostMemoryRequirements);
 
-	const VkMemoryAllocateInfo hostMemoryAllocateInfo{
-		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-		.allocationSize = hostMemoryRequirements.size,
-		.memoryTypeIndex = mVulkanDevice->GetMemoryTypeIndex(hostMemoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
-	};
-	VK_CHECK_RESULT(vkAllocateMemory(mVulkanDevice->mLogicalVkDevice, &hostMemoryAllocateInfo, nullptr, &stagingMemory));
-	VK_CHECK_RESULT(vkBindBufferMemory(mVulkanDevice->mLogicalVkDevice, stagingBuffer, stagingMemory, 0));
-
-	// Copy texture data into staging buffer
-	Core::uint8* data{nullptr};
-	VK_CHECK_RESULT(vkMapMemory(mVulkanDevice->mLogicalVkDevice, stagingMemory, 0, hostMemoryRequirements.size, 0, (void**)&data));
-
-	std::memcpy(data, buffer, bufferSize);
-	vkUnmapMemory(mVulkanDevice->mLogicalVkDevice, stagingMemory);
+	// Write texture data straight into the staging ring
+	const StagingAllocation stagingAllocation = mStagingRing->Allocate(bufferSize, TextureManagerLocal::gImageCopyOffsetAlignment);
+	std::memset(stagingAllocation.mMappedData, 0, bufferSize);
 
 	// Create optimal tiled target image
 	const VkImageCreateInfo imageCreateInfo{
@@ -92,33 +74,20 @@ vkglTF::Texture TextureManager::CreateEmptyTexture()
 	};
 	VK_CHECK_RESULT(vkCreateImage(mVulkanDevice->mLogicalVkDevice, &imageCreateInfo, nullptr, &texture.mImage));
 
-	VkMemoryRequirements localMemoryRequirements;
-	vkGetImageMemoryRequirements(mVulkanDevice->mLogicalVkDevice, texture.mImage, &localMemoryRequirements);
-
-	const VkMemoryAllocateInfo localMemoryAllocateInfo{
-		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-		.allocationSize = localMemoryRequirements.size,
-		.memoryTypeIndex = mVulkanDevice->GetMemoryTypeIndex(localMemoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
-	};
-	VK_CHECK_RESULT(vkAllocateMemory(mVulkanDevice->mLogicalVkDevice, &localMemoryAllocateInfo, nullptr, &texture.mDeviceMemory));
-	VK_CHECK_RESULT(vkBindImageMemory(mVulkanDevice->mLogicalVkDevice, texture.mImage, texture.mDeviceMemory, 0));
+	texture.mAllocation = mVulkanDevice->AllocateImageMemory(texture.mImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
 	const VkBufferImageCopy bufferCopyRegion{
+		.bufferOffset = stagingAllocation.mOffset,
 		.imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .layerCount = 1 },
 		.imageExtent = {.width = texture.mWidth, .height = texture.mHeight, .depth = 1 }
 	};
 	const VkImageSubresourceRange subresourceRange{.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = 1, .layerCount = 1};
-	VkCommandBuffer copyCommandBuffer = mVulkanDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+	VkCommandBuffer copyCommandBuffer = mStagingRing->GetCommandBuffer();
 	VulkanTools::SetImageLayout(copyCommandBuffer, texture.mImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
-	vkCmdCopyBufferToImage(copyCommandBuffer, stagingBuffer, texture.mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
-	VulkanTools::SetImageLayout(copyCommandBuffer, texture.mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange);
-	mVulkanDevice->FlushCommandBuffer(copyCommandBuffer, mTransferQueue, true);
+	vkCmdCopyBufferToImage(copyCommandBuffer, stagingAllocation.mVkBuffer, texture.mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
+	mStagingRing->TransferImageOwnership(texture.mImage, subresourceRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
 	texture.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-	// Clean up staging resources
-	vkDestroyBuffer(mVulkanDevice->mLogicalVkDevice, stagingBuffer, nullptr);
-	vkFreeMemory(mVulkanDevice->mLogicalVkDevice, stagingMemory, nullptr);
-
 	const VkSamplerCreateInfo samplerCreateInfo{
 		.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
 		.magFilter = VK_FILTER_LINEAR,
@@ -239,32 +208,8 @@ void TextureManager::CreateFromKtxTexture(const std::filesystem::path& aPath, vk
 	const ktx_size_t ktxTextureSize = ktxTexture_GetDataSize(ktxTexture);
 	aFormat = ktxTexture_GetVkFormat(ktxTexture);
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingMemory;
-
-	const VkBufferCreateInfo bufferCreateInfo{
-		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-		.size = ktxTextureSize,
-		.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		.sharingMode = VK_SHARING_MODE_EXCLUSIVE
-	};
-	VK_CHECK_RESULT(vkCreateBuffer(mVulkanDevice->mLogicalVkDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-	VkMemoryRequirements hostMemoryRequirements;
-	vkGetBufferMemoryRequirements(mVulkanDevice->mLogicalVkDevice, stagingBuffer, &hostMemoryRequirements);
-
-	const VkMemoryAllocateInfo hostMemoryAllocateInfo{
-		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-		.allocationSize = hostMemoryRequirements.size,
-		.memoryTypeIndex = mVulkanDevice->GetMemoryTypeIndex(hostMemoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
-	};
-	VK_CHECK_RESULT(vkAllocateMemory(mVulkanDevice->mLogicalVkDevice, &hostMemoryAllocateInfo, nullptr, &stagingMemory));
-	VK_CHECK_RESULT(vkBindBufferMemory(mVulkanDevice->mLogicalVkDevice, stagingBuffer, stagingMemory, 0));
-
-	Core::uint8* data{nullptr};
-	VK_CHECK_RESULT(vkMapMemory(mVulkanDevice->mLogicalVkDevice, stagingMemory, 0, hostMemoryRequirements.size, 0, reinterpret_cast<void**>(&data)));
-	std::memcpy(data, ktxTextureData, ktxTextureSize);
-	vkUnmapMemory(mVulkanDevice->mLogicalVkDevice, stagingMemory);
+	const StagingAllocation stagingAllocation = mStagingRing->Allocate(ktxTextureSize, TextureManagerLocal::gImageCopyOffsetAlignment);
+	std::memcpy(stagingAllocation.mMappedData, ktxTextureData, ktxTextureSize);
 
 	std::vector<VkBufferImageCopy> bufferCopyRegions;
 	for (Core::uint32 layer = 0; layer < aTexture.mLayerCount; layer++)
@@ -279,7 +224,7 @@ void TextureManager::CreateFromKtxTexture(const std::filesystem::path& aPath, vk
 			}
 
 			const VkBufferImageCopy bufferCopyRegion{
-				.bufferOffset = offset,
+				.bufferOffset = stagingAllocation.mOffset + offset,
 				.imageSubresource = {
 					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
 					.mipLevel = mipLevel,
@@ -312,18 +257,9 @@ void TextureManager::CreateFromKtxTexture(const std::filesystem::path& aPath, vk
 	};
 	VK_CHECK_RESULT(vkCreateImage(mVulkanDevice->mLogicalVkDevice, &imageCreateInfo, nullptr, &aTexture.mImage));
 
-	VkMemoryRequirements localMemoryRequirements;
-	vkGetImageMemoryRequirements(mVulkanDevice->mLogicalVkDevice, aTexture.mImage, &localMemoryRequirements);
-
-	const VkMemoryAllocateInfo localMemoryAllocateInfo{
-		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-		.allocationSize = localMemoryRequirements.size,
-		.memoryTypeIndex = mVulkanDevice->GetMemoryTypeIndex(localMemoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
-	};
-	VK_CHECK_RESULT(vkAllocateMemory(mVulkanDevice->mLogicalVkDevice, &localMemoryAllocateInfo, nullptr, &aTexture.mDeviceMemory));
-	VK_CHECK_RESULT(vkBindImageMemory(mVulkanDevice->mLogicalVkDevice, aTexture.mImage, aTexture.mDeviceMemory, 0));
+	aTexture.mAllocation = mVulkanDevice->AllocateImageMemory(aTexture.mImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-	VkCommandBuffer copyCommandBuffer = mVulkanDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+	VkCommandBuffer copyCommandBuffer = mStagingRing->GetCommandBuffer();
 
 	const VkImageSubresourceRange subresourceRange
 	{
@@ -341,62 +277,30 @@ void TextureManager::CreateFromKtxTexture(const std::filesystem::path& aPath, vk
 
 	vkCmdCopyBufferToImage(
 		copyCommandBuffer,
-		stagingBuffer,
+		stagingAllocation.mVkBuffer,
 		aTexture.mImage,
 		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 		static_cast<Core::uint32>(bufferCopyRegions.size()),
 		bufferCopyRegions.data());
 
-	VulkanTools::SetImageLayout(
-		copyCommandBuffer,
+	// Hands the image over to the graphics queue if uploads run on a dedicated transfer queue
+	mStagingRing->TransferImageOwnership(
 		aTexture.mImage,
+		subresourceRange,
 		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		subresourceRange);
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		VK_ACCESS_SHADER_READ_BIT);
 
 	aTexture.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-	mVulkanDevice->FlushCommandBuffer(copyCommandBuffer, mTransferQueue, true);
-
-	vkDestroyBuffer(mVulkanDevice->mLogicalVkDevice, stagingBuffer, nullptr);
-	vkFreeMemory(mVulkanDevice->mLogicalVkDevice, stagingMemory, nullptr);
-
 	ktxTexture_Destroy(ktxTexture);
 }
 
 void TextureManager::CreateFromEmbeddedTexture(vkglTF::Image& aImage, vkglTF::Texture& aTexture, VkFormat& aFormat)
 {
 	// Texture was loaded using STB_Image
-	unsigned char* buffer = nullptr;
-	VkDeviceSize bufferSize = 0;
-	bool deleteBuffer = false;
-	if (aImage.component == 3)
-	{
-		// Most devices don't support RGB only on Vulkan so convert if necessary
-		// TODO: Check actual format support and transform only if required
-		bufferSize = static_cast<VkDeviceSize>(aImage.width * aImage.height * 4);
-		buffer = new unsigned char[bufferSize];
-		unsigned char* rgba = buffer;
-		unsigned char* rgb = &aImage.image[0];
-		const Core::size size = static_cast<Core::size>(aImage.width * aImage.height);
-		for (Core::size i = 0; i < size; ++i)
-		{
-			for (Core::int32 j = 0; j < 3; ++j)
-			{
-				rgba[j] = rgb[j];
-			}
-			rgba += 4;
-			rgb += 3;
-		}
-		deleteBuffer = true;
-	}
-	else
-	{
-		buffer = &aImage.image[0];
-		bufferSize = aImage.image.size();
-	}
-
-	if (!buffer)
+	if (aImage.image.empty())
 	{
 		throw std::runtime_error("Buffer is invalid");
 	}
@@ -410,10 +314,6 @@ void TextureManager::CreateFromEmbeddedTexture(vkglTF::Image& aImage, vkglTF::Te
 
 	VkFormatProperties formatProperties;
 	vkGetPhysicalDeviceFormatProperties(mVulkanDevice->mPhysicalDevice, aFormat, &formatProperties);
-	if (!buffer)
-	{
-		throw std::runtime_error("Buffer is invalid");
-	}
 
 	if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_SRC_BIT))
 	{
@@ -425,31 +325,31 @@ void TextureManager::CreateFromEmbeddedTexture(vkglTF::Image& aImage, vkglTF::Te
 		throw std::runtime_error("optimalTilingFeatures is invalid");
 	}
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingMemory;
-
-	const VkBufferCreateInfo bufferCreateInfo{
-		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-		.size = bufferSize,
-		.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT
-	};
-	VK_CHECK_RESULT(vkCreateBuffer(mVulkanDevice->mLogicalVkDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-	VkMemoryRequirements hostMemoryRequirements{};
-	vkGetBufferMemoryRequirements(mVulkanDevice->mLogicalVkDevice, stagingBuffer, &hostMemoryRequirements);
-
-	const VkMemoryAllocateInfo hostMemoryAllocateInfo{
-		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-		.allocationSize = hostMemoryRequirements.size,
-		.memoryTypeIndex = mVulkanDevice->GetMemoryTypeIndex(hostMemoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
-	};
-	VK_CHECK_RESULT(vkAllocateMemory(mVulkanDevice->mLogicalVkDevice, &hostMemoryAllocateInfo, nullptr, &stagingMemory));
-	VK_CHECK_RESULT(vkBindBufferMemory(mVulkanDevice->mLogicalVkDevice, stagingBuffer, stagingMemory, 0));
-
-	Core::uint8* data{nullptr};
-	VK_CHECK_RESULT(vkMapMemory(mVulkanDevice->mLogicalVkDevice, stagingMemory, 0, hostMemoryRequirements.size, 0, (void**)&data));
-	std::memcpy(data, buffer, bufferSize);
-	vkUnmapMemory(mVulkanDevice->mLogicalVkDevice, stagingMemory);
+	StagingAllocation stagingAllocation;
+	if (aImage.component == 3)
+	{
+		// Most devices don't support RGB only on Vulkan so convert if necessary, directly into the staging ring
+		// TODO: Check actual format support and transform only if required
+		const VkDeviceSize bufferSize = static_cast<VkDeviceSize>(aImage.width * aImage.height * 4);
+		stagingAllocation = mStagingRing->Allocate(bufferSize, TextureManagerLocal::gImageCopyOffsetAlignment);
+		unsigned char* rgba = static_cast<unsigned char*>(stagingAllocation.mMappedData);
+		const unsigned char* rgb = &aImage.image[0];
+		const Core::size size = static_cast<Core::size>(aImage.width * aImage.height);
+		for (Core::size i = 0; i < size; ++i)
+		{
+			for (Core::int32 j = 0; j < 3; ++j)
+			{
+				rgba[j] = rgb[j];
+			}
+			rgba += 4;
+			rgb += 3;
+		}
+	}
+	else
+	{
+		stagingAllocation = mStagingRing->Allocate(aImage.image.size(), TextureManagerLocal::gImageCopyOffsetAlignment);
+		std::memcpy(stagingAllocation.mMappedData, aImage.image.data(), aImage.image.size());
+	}
 
 	const VkImageCreateInfo imageCreateInfo{
 		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
@@ -466,18 +366,10 @@ void TextureManager::CreateFromEmbeddedTexture(vkglTF::Image& aImage, vkglTF::Te
 	};
 	VK_CHECK_RESULT(vkCreateImage(mVulkanDevice->mLogicalVkDevice, &imageCreateInfo, nullptr, &aTexture.mImage));
 
-	VkMemoryRequirements localMemoryRequirements{};
-	vkGetImageMemoryRequirements(mVulkanDevice->mLogicalVkDevice, aTexture.mImage, &localMemoryRequirements);
+	aTexture.mAllocation = mVulkanDevice->AllocateImageMemory(aTexture.mImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-	const VkMemoryAllocateInfo localMemoryAllocateInfo{
-		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-		.allocationSize = localMemoryRequirements.size,
-		.memoryTypeIndex = mVulkanDevice->GetMemoryTypeIndex(localMemoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
-	};
-	VK_CHECK_RESULT(vkAllocateMemory(mVulkanDevice->mLogicalVkDevice, &localMemoryAllocateInfo, nullptr, &aTexture.mDeviceMemory));
-	VK_CHECK_RESULT(vkBindImageMemory(mVulkanDevice->mLogicalVkDevice, aTexture.mImage, aTexture.mDeviceMemory, 0));
-
-	VkCommandBuffer copyCommandBuffer = mVulkanDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+	// The copy runs on the transfer queue, mip chain generation needs blits and runs on the graphics side of the same batch
+	VkCommandBuffer copyCommandBuffer = mStagingRing->GetCommandBuffer();
 	const VkImageSubresourceRange subresourceRange{.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .levelCount = 1, .layerCount = 1};
 
 	{
@@ -494,6 +386,7 @@ void TextureManager::CreateFromEmbeddedTexture(vkglTF::Image& aImage, vkglTF::Te
 	}
 
 	const VkBufferImageCopy bufferCopyRegion{
+		.bufferOffset = stagingAllocation.mOffset,
 		.imageSubresource = {
 			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
 			.mipLevel = 0,
@@ -506,28 +399,13 @@ void TextureManager::CreateFromEmbeddedTexture(vkglTF::Image& aImage, vkglTF::Te
 			.depth = 1
 		}
 	};
-	vkCmdCopyBufferToImage(copyCommandBuffer, stagingBuffer, aTexture.mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
-
-	{
-		const VkImageMemoryBarrier imageMemoryBarrier{
-			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-			.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
-			.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-			.image = aTexture.mImage,
-			.subresourceRange = subresourceRange,
-		};
-		vkCmdPipelineBarrier(copyCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
-	}
+	vkCmdCopyBufferToImage(copyCommandBuffer, stagingAllocation.mVkBuffer, aTexture.mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
 
-	mVulkanDevice->FlushCommandBuffer(copyCommandBuffer, mTransferQueue, true);
-
-	vkDestroyBuffer(mVulkanDevice->mLogicalVkDevice, stagingBuffer, nullptr);
-	vkFreeMemory(mVulkanDevice->mLogicalVkDevice, stagingMemory, nullptr);
+	mStagingRing->TransferImageOwnership(aTexture.mImage, subresourceRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
 
 	// Generate the mip chain (glTF uses jpg and png, so we need to create this manually)
-	VkCommandBuffer blitCommandBuffer = mVulkanDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+	// The remaining levels have undefined contents, so the graphics queue can use them without an ownership transfer
+	VkCommandBuffer blitCommandBuffer = mStagingRing->GetGraphicsCommandBuffer();
 	for (Core::uint32 i = 1; i < aTexture.mMipLevels; i++)
 	{
 		VkImageBlit imageBlit{};
@@ -597,13 +475,6 @@ void TextureManager::CreateFromEmbeddedTexture(vkglTF::Image& aImage, vkglTF::Te
 		};
 		vkCmdPipelineBarrier(blitCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
 	}
-
-	if (deleteBuffer)
-	{
-		delete[] buffer;
-	}
-
-	mVulkanDevice->FlushCommandBuffer(blitCommandBuffer, mTransferQueue, true);
 }
 
 void TextureManager::CreateResources(vkglTF::Texture& aTexture, const VkFormat& aFormat)
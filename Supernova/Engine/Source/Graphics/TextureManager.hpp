@@ -6,6 +6,7 @@
 #include <vulkan/vulkan_core.h>
 
 struct VulkanDevice;
+class VulkanStagingRing;
 
 class TextureManager
 {
@@ -13,7 +14,7 @@ public:
 	TextureManager();
 	~TextureManager();
 
-	void SetContext(VulkanDevice* aDevice, VkQueue aTransferQueue);
+	void SetContext(VulkanDevice* aDevice, VulkanStagingRing* aStagingRing);
 
 	[[nodiscard]] vkglTF::Texture CreateEmptyTexture();
 	[[nodiscard]] vkglTF::Texture CreateTexture(const std::filesystem::path& aPath);
@@ -25,5 +26,5 @@ private:
 	void CreateResources(vkglTF::Texture& aTexture, const VkFormat& aFormat);
 
 	VulkanDevice* mVulkanDevice;
-	VkQueue mTransferQueue;
+	VulkanStagingRing* mStagingRing; // Shared upload ring, copies are batched and submitted by the owner
 };
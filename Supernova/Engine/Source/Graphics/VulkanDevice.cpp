@@ -10,6 +10,7 @@
 #include <cstring>
 #include <format>
 #include <iostream>
+#include <mutex>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -24,6 +25,8 @@ VulkanDevice::VulkanDevice()
 
 VulkanDevice::~VulkanDevice()
 {
+	mMemoryAllocator.reset();
+
 	if (mDefaultGraphicsCommandPool)
 		vkDestroyCommandPool(mLogicalVkDevice, mDefaultGraphicsCommandPool, nullptr);
 
@@ -139,7 +142,7 @@ void VulkanDevice::CreateLogicalDevice(const std::vector<const char*>& aEnabledE
 	// Get queue family indices for the requested queue family types
 	// Note that the indices may overlap depending on the implementation
 
-	const float defaultQueuePriority = 0.0f;
+	const float defaultQueuePriorities[2]{0.0f, 0.0f};
 
 	// Graphics queue
 	if (aRequestedQueueTypes & VK_QUEUE_GRAPHICS_BIT)
@@ -150,7 +153,7 @@ void VulkanDevice::CreateLogicalDevice(const std::vector<const char*>& aEnabledE
 			.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
 			.queueFamilyIndex = mQueueFamilyIndices.mGraphics,
 			.queueCount = 1,
-			.pQueuePriorities = &defaultQueuePriority
+			.pQueuePriorities = defaultQueuePriorities
 		};
 		queueCreateInfos.push_back(deviceQueueCreateInfo);
 	}
@@ -170,7 +173,7 @@ void VulkanDevice::CreateLogicalDevice(const std::vector<const char*>& aEnabledE
 				.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
 				.queueFamilyIndex = mQueueFamilyIndices.mCompute,
 				.queueCount = 1,
-				.pQueuePriorities = &defaultQueuePriority
+				.pQueuePriorities = defaultQueuePriorities
 			};
 			queueCreateInfos.push_back(deviceQueueCreateInfo);
 		}
@@ -192,10 +195,22 @@ void VulkanDevice::CreateLogicalDevice(const std::vector<const char*>& aEnabledE
 				.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
 				.queueFamilyIndex = mQueueFamilyIndices.mTransfer,
 				.queueCount = 1,
-				.pQueuePriorities = &defaultQueuePriority
+				.pQueuePriorities = defaultQueuePriorities
 			};
 			queueCreateInfos.push_back(deviceQueueCreateInfo);
 		}
+		else
+		{
+			// Uploads get their own queue of the shared family if it has one to spare, so they don't contend with the frame submissions
+			for (VkDeviceQueueCreateInfo& deviceQueueCreateInfo : queueCreateInfos)
+			{
+				if ((deviceQueueCreateInfo.queueFamilyIndex == mQueueFamilyIndices.mTransfer) && (mQueueFamilyProperties[mQueueFamilyIndices.mTransfer].queueCount > 1))
+				{
+					deviceQueueCreateInfo.queueCount = 2;
+					mQueueFamilyIndices.mTransferQueueIndex = 1;
+				}
+			}
+		}
 	}
 	else
 	{
@@ -246,6 +261,8 @@ void VulkanDevice::CreateLogicalDevice(const std::vector<const char*>& aEnabledE
 
 	VK_CHECK_RESULT(vkCreateDevice(mPhysicalDevice, &deviceCreateInfo, nullptr, &mLogicalVkDevice));
 
+	mMemoryAllocator = std::make_unique<VulkanMemoryAllocator>(mLogicalVkDevice, mPhysicalDeviceProperties, mPhysicalDeviceMemoryProperties);
+
 	const VkCommandPoolCreateInfo commandPoolInfo{
 		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
 		.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
@@ -348,7 +365,7 @@ void VulkanDevice::FlushCommandBuffer(VkCommandBuffer aCommandBuffer, VkQueue aQ
 	VkFence fence;
 	VK_CHECK_RESULT(vkCreateFence(mLogicalVkDevice, &fenceCreateInfo, nullptr, &fence));
 	// Submit to the queue
-	VK_CHECK_RESULT(vkQueueSubmit(aQueue, 1, &submitInfo, fence));
+	QueueSubmit(aQueue, submitInfo, fence);
 	// Wait for the fence to signal that command buffer has finished executing
 	VK_CHECK_RESULT(vkWaitForFences(mLogicalVkDevice, 1, &fence, VK_TRUE, gDefaultFenceTimeoutNS));
 	vkDestroyFence(mLogicalVkDevice, fence, nullptr);
@@ -363,6 +380,18 @@ void VulkanDevice::FlushCommandBuffer(VkCommandBuffer aCommandBuffer, VkQueue aQ
 	return FlushCommandBuffer(aCommandBuffer, aQueue, mDefaultGraphicsCommandPool, aIsFree);
 }
 
+void VulkanDevice::QueueSubmit(VkQueue aQueue, const VkSubmitInfo& aSubmitInfo, VkFence aFence) const
+{
+	const std::lock_guard lock(mQueueMutex);
+	VK_CHECK_RESULT(vkQueueSubmit(aQueue, 1, &aSubmitInfo, aFence));
+}
+
+VkResult VulkanDevice::QueuePresent(VkQueue aQueue, const VkPresentInfoKHR& aPresentInfo) const
+{
+	const std::lock_guard lock(mQueueMutex);
+	return vkQueuePresentKHR(aQueue, &aPresentInfo);
+}
+
 /**
 * Copy buffer data from src to dst using VkCmdCopyBuffer
 *
@@ -446,59 +475,40 @@ VkFormat VulkanDevice::GetSupportedDepthFormat(bool aCheckSamplingSupport) const
 	* @param memoryPropertyFlags Memory properties for this buffer (i.e. device local, host visible, coherent)
 	* @param size Size of the buffer in byes
 	* @param buffer Pointer to the buffer handle acquired by the function
-	* @param memory Pointer to the memory handle acquired by the function
+	* @param allocation Pointer to the memory allocation acquired by the function
 	* @param data Pointer to the data that should be copied to the buffer after creation (optional, if not set, no data is copied over)
+	* @param strategy (Optional) Sub-allocation strategy, linear packs buffers that are released together
 	*
 	* @return VK_SUCCESS if buffer handle and memory have been created and (optionally passed) data has been copied
 	*/
-VkResult VulkanDevice::CreateBuffer(VkBufferUsageFlags aUsageFlags, VkMemoryPropertyFlags aMemoryPropertyFlags, VkDeviceSize aSize, VkBuffer* aBuffer, VkDeviceMemory* aMemory, void* aData)
+VkResult VulkanDevice::CreateBuffer(VkBufferUsageFlags aUsageFlags, VkMemoryPropertyFlags aMemoryPropertyFlags, VkDeviceSize aSize, VkBuffer* aBuffer, VulkanAllocation* aAllocation, void* aData, AllocationStrategy aStrategy) const
 {
 	VkBufferCreateInfo bufferCreateInfo = VulkanInitializers::BufferCreateInfo(aUsageFlags, aSize);
 	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 	VK_CHECK_RESULT(vkCreateBuffer(mLogicalVkDevice, &bufferCreateInfo, nullptr, aBuffer));
 
-	// Create the memory backing up the buffer handle
+	// Sub-allocate the memory backing up the buffer handle
 	VkMemoryRequirements memoryRequirements;
-	VkMemoryAllocateInfo memoryAllocateInfo = VulkanInitializers::MemoryAllocateInfo();
 	vkGetBufferMemoryRequirements(mLogicalVkDevice, *aBuffer, &memoryRequirements);
 
-	memoryAllocateInfo.allocationSize = memoryRequirements.size;
-	memoryAllocateInfo.memoryTypeIndex = GetMemoryTypeIndex(memoryRequirements.memoryTypeBits, aMemoryPropertyFlags); // Find a memory type index that fits the properties of the buffer
-	
-	if (aUsageFlags & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT)
-	{
-		// If the buffer has VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT set we also need to enable the appropriate flag during allocation
-		const VkMemoryAllocateFlagsInfoKHR memoryAllocateFlagsInfo{
-			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO_KHR,
-			.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR
-		};
-		memoryAllocateInfo.pNext = &memoryAllocateFlagsInfo;
-	}
-	VK_CHECK_RESULT(vkAllocateMemory(mLogicalVkDevice, &memoryAllocateInfo, nullptr, aMemory));
+	// If the buffer has VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT set we also need to enable the appropriate flag during allocation
+	const bool isDeviceAddress = (aUsageFlags & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) != 0;
+	*aAllocation = mMemoryAllocator->Allocate(memoryRequirements, aMemoryPropertyFlags, AllocationResourceType::Buffer, aStrategy, isDeviceAddress);
 
-	// If a pointer to the buffer data has been passed, map the buffer and copy over the data
+	// If a pointer to the buffer data has been passed, copy it over through the persistent mapping
 	if (aData != nullptr)
 	{
-		void* mapped;
-		VK_CHECK_RESULT(vkMapMemory(mLogicalVkDevice, *aMemory, 0, aSize, 0, &mapped));
-
-		std::memcpy(mapped, aData, aSize);
+		std::memcpy(aAllocation->mMappedData, aData, aSize);
 
 		// If host coherency hasn't been requested, do a manual flush to make writes visible
 		if ((aMemoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0)
 		{
-			const VkMappedMemoryRange mappedMemoryRange{
-				.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
-				.memory = *aMemory,
-				.size = aSize
-			};
-			vkFlushMappedMemoryRanges(mLogicalVkDevice, 1, &mappedMemoryRange);
+			VK_CHECK_RESULT(mMemoryAllocator->Flush(*aAllocation, aSize, 0));
 		}
-		vkUnmapMemory(mLogicalVkDevice, *aMemory);
 	}
 
 	// Attach the memory to the buffer object
-	VK_CHECK_RESULT(vkBindBufferMemory(mLogicalVkDevice, *aBuffer, *aMemory, 0));
+	VK_CHECK_RESULT(vkBindBufferMemory(mLogicalVkDevice, *aBuffer, aAllocation->mVkDeviceMemory, aAllocation->mOffset));
 
 	return VK_SUCCESS;
 }
@@ -506,28 +516,18 @@ VkResult VulkanDevice::CreateBuffer(VkBufferUsageFlags aUsageFlags, VkMemoryProp
 VkResult VulkanDevice::CreateBuffer(VkBufferUsageFlags aUsageFlags, VkMemoryPropertyFlags aMemoryPropertyFlags, Buffer* aBuffer, VkDeviceSize aSize, void* aData) const
 {
 	aBuffer->mLogicalVkDevice = mLogicalVkDevice;
+	aBuffer->mMemoryAllocator = mMemoryAllocator.get();
 
 	const VkBufferCreateInfo bufferCreateInfo = VulkanInitializers::BufferCreateInfo(aUsageFlags, aSize);
 	VK_CHECK_RESULT(vkCreateBuffer(mLogicalVkDevice, &bufferCreateInfo, nullptr, &aBuffer->mVkBuffer));
 
-	// Create the memory backing up the buffer handle
+	// Sub-allocate the memory backing up the buffer handle
 	VkMemoryRequirements memoryRequirements;
-	VkMemoryAllocateInfo memoryAllocateInfo = VulkanInitializers::MemoryAllocateInfo();
 	vkGetBufferMemoryRequirements(mLogicalVkDevice, aBuffer->mVkBuffer, &memoryRequirements);
 
-	memoryAllocateInfo.allocationSize = memoryRequirements.size;
-	memoryAllocateInfo.memoryTypeIndex = GetMemoryTypeIndex(memoryRequirements.memoryTypeBits, aMemoryPropertyFlags); // Find a memory type index that fits the properties of the buffer
-	
-	if (aUsageFlags & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT)
-	{
-		// If the buffer has VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT set we also need to enable the appropriate flag during allocation
-		const VkMemoryAllocateFlagsInfoKHR memoryAllocateFlagsInfo{
-			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO_KHR,
-			.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR
-		};
-		memoryAllocateInfo.pNext = &memoryAllocateFlagsInfo;
-	}
-	VK_CHECK_RESULT(vkAllocateMemory(mLogicalVkDevice, &memoryAllocateInfo, nullptr, &aBuffer->mVkDeviceMemory));
+	// If the buffer has VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT set we also need to enable the appropriate flag during allocation
+	const bool isDeviceAddress = (aUsageFlags & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) != 0;
+	aBuffer->mAllocation = mMemoryAllocator->Allocate(memoryRequirements, aMemoryPropertyFlags, AllocationResourceType::Buffer, AllocationStrategy::Buddy, isDeviceAddress);
 
 	aBuffer->mVkDeviceAlignment = memoryRequirements.alignment;
 	aBuffer->mVkDeviceSize = aSize;
@@ -553,3 +553,22 @@ VkResult VulkanDevice::CreateBuffer(VkBufferUsageFlags aUsageFlags, VkMemoryProp
 	// Attach the memory to the buffer object
 	return aBuffer->Bind(0);
 }
+
+/**
+* Sub-allocate device memory for an image and bind it
+*
+* @param image Image to allocate the memory for
+* @param memoryPropertyFlags Memory properties for this image (usually device local)
+*
+* @return The allocation backing the image, release it with mMemoryAllocator->Free after destroying the image
+*/
+VulkanAllocation VulkanDevice::AllocateImageMemory(VkImage aImage, VkMemoryPropertyFlags aMemoryPropertyFlags) const
+{
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(mLogicalVkDevice, aImage, &memoryRequirements);
+
+	const VulkanAllocation allocation = mMemoryAllocator->Allocate(memoryRequirements, aMemoryPropertyFlags, AllocationResourceType::Image);
+	VK_CHECK_RESULT(vkBindImageMemory(mLogicalVkDevice, aImage, allocation.mVkDeviceMemory, allocation.mOffset));
+
+	return allocation;
+}
@@ -1,8 +1,11 @@
 #pragma once
 
 #include "Core/Types.hpp"
+#include "VulkanMemoryAllocator.hpp"
 #include "VulkanTypes.hpp"
 
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <vulkan/vulkan_core.h>
@@ -15,12 +18,14 @@ struct VulkanDevice
 			: mGraphics{0}
 			, mCompute{0}
 			, mTransfer{0}
+			, mTransferQueueIndex{0}
 		{
 		}
 
 		Core::uint32 mGraphics;
 		Core::uint32 mCompute;
 		Core::uint32 mTransfer;
+		Core::uint32 mTransferQueueIndex; // Second queue of the family when the transfer family is shared with graphics or compute and has one to spare
 	};
 
 	VulkanDevice();
@@ -32,10 +37,15 @@ struct VulkanDevice
 	void FlushCommandBuffer(VkCommandBuffer aCommandBuffer, VkQueue aQueue, bool aIsFree = true) const;
 	void CopyBuffer(Buffer* aSource, Buffer* aDestination, VkQueue aQueue, VkBufferCopy* aCopyRegion = nullptr) const;
 
+	// Queues can be shared between the graphics, compute and transfer paths, every submission and present goes through these
+	void QueueSubmit(VkQueue aQueue, const VkSubmitInfo& aSubmitInfo, VkFence aFence) const;
+	VkResult QueuePresent(VkQueue aQueue, const VkPresentInfoKHR& aPresentInfo) const;
+
 	VkCommandBuffer CreateCommandBuffer(VkCommandBufferLevel aLevel, VkCommandPool aPool, bool aIsBeginBuffer = false) const;
 	VkCommandBuffer CreateCommandBuffer(VkCommandBufferLevel aLevel, bool aIsBeginBuffer = false) const;
-	VkResult CreateBuffer(VkBufferUsageFlags aUsageFlags, VkMemoryPropertyFlags aMemoryPropertyFlags, VkDeviceSize aSize, VkBuffer* aBuffer, VkDeviceMemory* aMemory, void* aData = nullptr);
+	VkResult CreateBuffer(VkBufferUsageFlags aUsageFlags, VkMemoryPropertyFlags aMemoryPropertyFlags, VkDeviceSize aSize, VkBuffer* aBuffer, VulkanAllocation* aAllocation, void* aData = nullptr, AllocationStrategy aStrategy = AllocationStrategy::Buddy) const;
 	VkResult CreateBuffer(VkBufferUsageFlags aUsageFlags, VkMemoryPropertyFlags aMemoryPropertyFlags, Buffer* aBuffer, VkDeviceSize aSize, void* aData = nullptr) const;
+	VulkanAllocation AllocateImageMemory(VkImage aImage, VkMemoryPropertyFlags aMemoryPropertyFlags) const;
 
 	Core::uint32 GetMemoryTypeIndex(Core::uint32 aTypeBits, VkMemoryPropertyFlags aProperties, VkBool32* aMemTypeFound = nullptr) const;
 	Core::uint32 GetQueueFamilyIndex(VkQueueFlags aVkQueueFlags) const;
@@ -52,4 +62,6 @@ struct VulkanDevice
 	std::vector<VkQueueFamilyProperties> mQueueFamilyProperties{};
 	std::vector<std::string> mSupportedExtensions{};
 	QueueFamilyIndices mQueueFamilyIndices;
+	std::unique_ptr<VulkanMemoryAllocator> mMemoryAllocator; // Sub-allocates device memory for all buffers and images created on this device
+	mutable std::mutex mQueueMutex; // vkQueueSubmit and vkQueuePresentKHR require external synchronization of the queue
 };
@@ -6,17 +6,28 @@
 #include "VulkanDevice.hpp"
 #include "VulkanTools.hpp"
 
+#include <algorithm>
+#include <cassert>
 #include <cstddef>
 #include <cstring>
+#include <span>
 #include <vector>
 #include <vulkan/vulkan_core.h>
 
+namespace VulkanGlTFTypesLocal
+{
+	template<typename T>
+	static void WriteComponent(unsigned char* aDestination, const T& aValue)
+	{
+		std::memcpy(aDestination, &aValue, sizeof(T));
+	}
+}
+
 namespace vkglTF
 {
 	Texture::Texture()
 		: mVulkanDevice{nullptr}
 		, mImage{VK_NULL_HANDLE}
-		, mDeviceMemory{VK_NULL_HANDLE}
 		, mImageView{VK_NULL_HANDLE}
 		, mWidth{0}
 		, mHeight{0}
@@ -24,6 +35,7 @@ namespace vkglTF
 		, mLayerCount{0}
 		, mSampler{VK_NULL_HANDLE}
 		, mIndex{0}
+		, mBindlessIndex{gNoBindlessIndex}
 	{
 	}
 
@@ -31,6 +43,7 @@ namespace vkglTF
 		: mVulkanDevice{aDevice}
 		, mAlphaMode{AlphaMode::Opaque}
 		, mAlphaCutoff{1.0f}
+		, mIsDoubleSided{false}
 		, mMetallicFactor{1.0f}
 		, mRoughnessFactor{1.0f}
 		, mBaseColorFactor{1.0f}
@@ -41,7 +54,7 @@ namespace vkglTF
 		, mEmissiveTexture{nullptr}
 		, mSpecularGlossinessTexture{nullptr}
 		, mDiffuseTexture{nullptr}
-		, mDescriptorSet{VK_NULL_HANDLE}
+		, mBindlessIndex{gNoBindlessIndex}
 	{
 	}
 
@@ -51,7 +64,7 @@ namespace vkglTF
 		{
 			vkDestroyImageView(mVulkanDevice->mLogicalVkDevice, mImageView, nullptr);
 			vkDestroyImage(mVulkanDevice->mLogicalVkDevice, mImage, nullptr);
-			vkFreeMemory(mVulkanDevice->mLogicalVkDevice, mDeviceMemory, nullptr);
+			mVulkanDevice->mMemoryAllocator->Free(mAllocation);
 			vkDestroySampler(mVulkanDevice->mLogicalVkDevice, mSampler, nullptr);
 		}
 	}
@@ -74,16 +87,17 @@ namespace vkglTF
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 			sizeof(mUniformBlock),
 			&mUniformBuffer.buffer,
-			&mUniformBuffer.memory,
-			&mUniformBlock));
-		VK_CHECK_RESULT(vkMapMemory(aDevice->mLogicalVkDevice, mUniformBuffer.memory, 0, sizeof(mUniformBlock), 0, &mUniformBuffer.mMappedData));
+			&mUniformBuffer.mAllocation,
+			&mUniformBlock,
+			AllocationStrategy::Linear));
+		mUniformBuffer.mMappedData = mUniformBuffer.mAllocation.mMappedData;
 		mUniformBuffer.descriptor = {mUniformBuffer.buffer, 0, sizeof(mUniformBlock)};
 	};
 
 	Mesh::~Mesh()
 	{
 		vkDestroyBuffer(mVulkanDevice->mLogicalVkDevice, mUniformBuffer.buffer, nullptr);
-		vkFreeMemory(mVulkanDevice->mLogicalVkDevice, mUniformBuffer.memory, nullptr);
+		mVulkanDevice->mMemoryAllocator->Free(mUniformBuffer.mAllocation);
 		for (vkglTF::Primitive* primitive : mPrimitives)
 		{
 			delete primitive;
@@ -107,35 +121,160 @@ namespace vkglTF
 		return m;
 	}
 
-	void Node::update()
+	void NodeHierarchy::Build(const std::vector<Node*>& aRootNodes)
 	{
-		if (mMesh)
+		mNodes.clear();
+		mParents.clear();
+		mSubtreeEnds.clear();
+		mTranslations.clear();
+		mRotations.clear();
+		mScales.clear();
+		mMatrices.clear();
+
+		for (Node* node : aRootNodes)
+		{
+			AddSubtree(node, gNoParent);
+		}
+
+		const Core::size nodeCount = mNodes.size();
+		mLocalMatrices.assign(nodeCount, Math::Matrix4f{1.0f});
+		mWorldMatrices.assign(nodeCount, Math::Matrix4f{1.0f});
+		mIsLocalMatrixDirty.assign(nodeCount, 1);
+		mIsWorldMatrixChanged.assign(nodeCount, 0);
+		mFirstDirtyIndex = 0;
+	}
+
+	void NodeHierarchy::AddSubtree(Node* aNode, Core::uint32 aParent)
+	{
+		const Core::uint32 index = GetNodeCount();
+		aNode->mHierarchyIndex = index;
+		mNodes.push_back(aNode);
+		mParents.push_back(aParent);
+		mSubtreeEnds.push_back(index + 1);
+		mTranslations.push_back(aNode->mTranslation);
+		mRotations.push_back(aNode->mRotation);
+		mScales.push_back(aNode->mScale);
+		mMatrices.push_back(aNode->mMatrix);
+
+		for (Node* child : aNode->mChildren)
 		{
-			Math::Matrix4f m = GetMatrix();
-			if (mSkin)
+			AddSubtree(child, index);
+		}
+
+		mSubtreeEnds[index] = GetNodeCount();
+	}
+
+	void NodeHierarchy::SetTranslation(Core::uint32 aIndex, const Math::Vector3f& aTranslation)
+	{
+		mTranslations[aIndex] = aTranslation;
+		MarkDirty(aIndex);
+	}
+
+	void NodeHierarchy::SetRotation(Core::uint32 aIndex, const Math::Quaternionf& aRotation)
+	{
+		mRotations[aIndex] = aRotation;
+		MarkDirty(aIndex);
+	}
+
+	void NodeHierarchy::SetScale(Core::uint32 aIndex, const Math::Vector3f& aScale)
+	{
+		mScales[aIndex] = aScale;
+		MarkDirty(aIndex);
+	}
+
+	void NodeHierarchy::MarkDirty(Core::uint32 aIndex)
+	{
+		mIsLocalMatrixDirty[aIndex] = 1;
+		mFirstDirtyIndex = std::min(mFirstDirtyIndex, aIndex);
+	}
+
+	bool NodeHierarchy::UpdateWorldMatrices()
+	{
+		std::fill(mIsWorldMatrixChanged.begin(), mIsWorldMatrixChanged.end(), static_cast<Core::uint8>(0));
+
+		bool hasChanged = false;
+		const Core::uint32 nodeCount = GetNodeCount();
+		Core::uint32 i = mFirstDirtyIndex;
+		while (i < nodeCount)
+		{
+			if (!mIsLocalMatrixDirty[i])
 			{
-				mMesh->mUniformBlock.mMatrix = m;
-				// Update join matrices
-				Math::Matrix4f inverseTransform = Math::Inverse(m);
-				for (Core::size i = 0; i < mSkin->joints.size(); i++)
-				{
-					vkglTF::Node* jointNode = mSkin->joints[i];
-					Math::Matrix4f jointMat = jointNode->GetMatrix() * mSkin->inverseBindMatrices[i];
-					jointMat = inverseTransform * jointMat;
-					mMesh->mUniformBlock.mJointMatrix[i] = jointMat;
-				}
-				mMesh->mUniformBlock.mJointcount = static_cast<float>(mSkin->joints.size());
-				std::memcpy(mMesh->mUniformBuffer.mMappedData, &mMesh->mUniformBlock, sizeof(mMesh->mUniformBlock));
+				i++;
+				continue;
 			}
-			else
+
+			// Parents come first, so the world matrix of every parent is final by the time its children are reached
+			const Core::uint32 subtreeEnd = mSubtreeEnds[i];
+			for (Core::uint32 j = i; j < subtreeEnd; j++)
 			{
-				std::memcpy(mMesh->mUniformBuffer.mMappedData, &m, sizeof(Math::Matrix4f));
+				if (mIsLocalMatrixDirty[j])
+				{
+					// Same as Translate * Rotate * Scale, without multiplying full matrices
+					Math::Matrix4f localMatrix = Math::Matrix4f(mRotations[j]);
+					localMatrix[0] *= mScales[j].x;
+					localMatrix[1] *= mScales[j].y;
+					localMatrix[2] *= mScales[j].z;
+					localMatrix[3] = Math::Vector4f(mTranslations[j], 1.0f);
+					mLocalMatrices[j] = localMatrix * mMatrices[j];
+					mIsLocalMatrixDirty[j] = 0;
+				}
+
+				const Core::uint32 parent = mParents[j];
+				mWorldMatrices[j] = (parent == gNoParent) ? mLocalMatrices[j] : mWorldMatrices[parent] * mLocalMatrices[j];
+				mIsWorldMatrixChanged[j] = 1;
 			}
+
+			hasChanged = true;
+			i = subtreeEnd;
 		}
 
-		for (vkglTF::Node* child : mChildren)
+		mFirstDirtyIndex = nodeCount;
+		return hasChanged;
+	}
+
+	void Model::UpdateNodes()
+	{
+		if (!mHierarchy.UpdateWorldMatrices())
 		{
-			child->update();
+			return;
+		}
+
+		for (Core::uint32 i = 0; i < mHierarchy.GetNodeCount(); i++)
+		{
+			Node* node = mHierarchy.GetNode(i);
+			if (!node->mMesh)
+			{
+				continue;
+			}
+
+			const Math::Matrix4f& matrix = mHierarchy.GetWorldMatrix(i);
+			if (!node->mSkin)
+			{
+				if (mHierarchy.HasWorldMatrixChanged(i))
+				{
+					std::memcpy(node->mMesh->mUniformBuffer.mMappedData, &matrix, sizeof(Math::Matrix4f));
+				}
+
+				continue;
+			}
+
+			// The joints can move without the node they skin
+			const std::vector<Node*>& joints = node->mSkin->joints;
+			const bool isSkinChanged = mHierarchy.HasWorldMatrixChanged(i) || std::any_of(joints.begin(), joints.end(), [this](const Node* aJoint) { return mHierarchy.HasWorldMatrixChanged(aJoint->mHierarchyIndex); });
+			if (!isSkinChanged)
+			{
+				continue;
+			}
+
+			Mesh::UniformBlock& uniformBlock = node->mMesh->mUniformBlock;
+			uniformBlock.mMatrix = matrix;
+			const Math::Matrix4f inverseTransform = Math::Inverse(matrix);
+			for (Core::size j = 0; j < joints.size(); j++)
+			{
+				uniformBlock.mJointMatrix[j] = inverseTransform * mHierarchy.GetWorldMatrix(joints[j]->mHierarchyIndex) * node->mSkin->inverseBindMatrices[j];
+			}
+			uniformBlock.mJointcount = static_cast<float>(joints.size());
+			std::memcpy(node->mMesh->mUniformBuffer.mMappedData, &uniformBlock, sizeof(uniformBlock));
 		}
 	}
 
@@ -156,51 +295,142 @@ namespace vkglTF
 	std::vector<VkVertexInputAttributeDescription> Vertex::mVertexInputAttributeDescriptions;
 	VkPipelineVertexInputStateCreateInfo Vertex::mPipelineVertexInputStateCreateInfo;
 
-	VkVertexInputBindingDescription vkglTF::Vertex::inputBindingDescription(Core::uint32 aBinding)
+	VertexLayout::VertexLayout(const std::vector<VertexComponent>& aComponents, bool aIsQuantized)
+		: mComponents{aComponents}
+		, mStride{0}
+		, mIsQuantized{aIsQuantized}
 	{
-		return VkVertexInputBindingDescription({aBinding, sizeof(Vertex), VK_VERTEX_INPUT_RATE_VERTEX});
+		// Every component size is a multiple of four bytes, so all attributes stay aligned without padding
+		for (VertexComponent component : mComponents)
+		{
+			mOffsets.push_back(mStride);
+			mStride += GetComponentSize(component, mIsQuantized);
+		}
 	}
 
-	VkVertexInputAttributeDescription vkglTF::Vertex::inputAttributeDescription(Core::uint32 aBinding, Core::uint32 aLocation, VertexComponent aComponent)
+	bool VertexLayout::HasComponent(VertexComponent aComponent) const
+	{
+		return std::find(mComponents.begin(), mComponents.end(), aComponent) != mComponents.end();
+	}
+
+	Core::uint32 VertexLayout::GetOffset(VertexComponent aComponent) const
+	{
+		const std::vector<VertexComponent>::const_iterator it = std::find(mComponents.begin(), mComponents.end(), aComponent);
+		assert(it != mComponents.end());
+		return mOffsets[it - mComponents.begin()];
+	}
+
+	VkFormat VertexLayout::GetFormat(VertexComponent aComponent) const
 	{
 		switch (aComponent)
 		{
 			case VertexComponent::Position:
-				return VkVertexInputAttributeDescription({aLocation, aBinding, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, mPosition)});
+				return VK_FORMAT_R32G32B32_SFLOAT;
 			case VertexComponent::Normal:
-				return VkVertexInputAttributeDescription({aLocation, aBinding, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, mNormal)});
+				return mIsQuantized ? VK_FORMAT_R16G16_SNORM : VK_FORMAT_R32G32B32_SFLOAT; // Quantized normals are octahedral encoded and read as vec2 in shaders
 			case VertexComponent::UV:
-				return VkVertexInputAttributeDescription({aLocation, aBinding, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, mUV)});
+				return mIsQuantized ? VK_FORMAT_R16G16_SFLOAT : VK_FORMAT_R32G32_SFLOAT;
 			case VertexComponent::Color:
-				return VkVertexInputAttributeDescription({aLocation, aBinding, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(Vertex, mColor)});
+				return mIsQuantized ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_R32G32B32A32_SFLOAT;
 			case VertexComponent::Tangent:
-				return VkVertexInputAttributeDescription({aLocation, aBinding, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(Vertex, mTangent)});
+				return mIsQuantized ? VK_FORMAT_R8G8B8A8_SNORM : VK_FORMAT_R32G32B32A32_SFLOAT;
 			case VertexComponent::Joint0:
-				return VkVertexInputAttributeDescription({aLocation, aBinding, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(Vertex, mJoint0)});
+				return mIsQuantized ? VK_FORMAT_R8G8B8A8_UINT : VK_FORMAT_R32G32B32A32_SFLOAT; // Quantized joints are read as uvec4 in shaders
 			case VertexComponent::Weight0:
-				return VkVertexInputAttributeDescription({aLocation, aBinding, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(Vertex, mWeight0)});
+				return mIsQuantized ? VK_FORMAT_R16G16B16A16_UNORM : VK_FORMAT_R32G32B32A32_SFLOAT;
 			default:
-				return VkVertexInputAttributeDescription({});
+				return VK_FORMAT_UNDEFINED;
 		}
 	}
 
-	std::vector<VkVertexInputAttributeDescription> vkglTF::Vertex::inputAttributeDescriptions(Core::uint32 aBinding, const std::vector<VertexComponent>& aComponents)
+	Core::uint32 VertexLayout::GetComponentSize(VertexComponent aComponent, bool aIsQuantized)
+	{
+		switch (aComponent)
+		{
+			case VertexComponent::Position:
+				return sizeof(Math::Vector3f);
+			case VertexComponent::Normal:
+				return aIsQuantized ? sizeof(Core::uint32) : sizeof(Math::Vector3f);
+			case VertexComponent::UV:
+				return aIsQuantized ? sizeof(Core::uint32) : sizeof(Math::Vector2f);
+			case VertexComponent::Color:
+			case VertexComponent::Tangent:
+			case VertexComponent::Joint0:
+				return aIsQuantized ? sizeof(Core::uint32) : sizeof(Math::Vector4f);
+			case VertexComponent::Weight0:
+				return aIsQuantized ? sizeof(Core::uint64) : sizeof(Math::Vector4f);
+			default:
+				return 0;
+		}
+	}
+
+	std::vector<unsigned char> VertexLayout::PackVertices(std::span<const Vertex> aVertices) const
+	{
+		std::vector<unsigned char> packedVertices(aVertices.size() * mStride);
+		for (Core::size i = 0; i < aVertices.size(); i++)
+		{
+			const Vertex& vertex = aVertices[i];
+			for (Core::size j = 0; j < mComponents.size(); j++)
+			{
+				unsigned char* destination = packedVertices.data() + i * mStride + mOffsets[j];
+				switch (mComponents[j])
+				{
+					case VertexComponent::Position:
+						VulkanGlTFTypesLocal::WriteComponent(destination, vertex.mPosition);
+						break;
+					case VertexComponent::Normal:
+						mIsQuantized ? VulkanGlTFTypesLocal::WriteComponent(destination, Math::PackSnorm2x16(Math::OctEncode(vertex.mNormal))) : VulkanGlTFTypesLocal::WriteComponent(destination, vertex.mNormal);
+						break;
+					case VertexComponent::UV:
+						mIsQuantized ? VulkanGlTFTypesLocal::WriteComponent(destination, Math::PackHalf2x16(vertex.mUV)) : VulkanGlTFTypesLocal::WriteComponent(destination, vertex.mUV);
+						break;
+					case VertexComponent::Color:
+						mIsQuantized ? VulkanGlTFTypesLocal::WriteComponent(destination, Math::PackUnorm4x8(vertex.mColor)) : VulkanGlTFTypesLocal::WriteComponent(destination, vertex.mColor);
+						break;
+					case VertexComponent::Tangent:
+						mIsQuantized ? VulkanGlTFTypesLocal::WriteComponent(destination, Math::PackSnorm4x8(vertex.mTangent)) : VulkanGlTFTypesLocal::WriteComponent(destination, vertex.mTangent);
+						break;
+					case VertexComponent::Joint0:
+						// Joint indices address Mesh::UniformBlock::mJointMatrix, so they always fit into a byte
+						mIsQuantized ? VulkanGlTFTypesLocal::WriteComponent(destination, Math::PackUint4x8(vertex.mJoint0)) : VulkanGlTFTypesLocal::WriteComponent(destination, vertex.mJoint0);
+						break;
+					case VertexComponent::Weight0:
+						mIsQuantized ? VulkanGlTFTypesLocal::WriteComponent(destination, Math::PackUnorm4x16(vertex.mWeight0)) : VulkanGlTFTypesLocal::WriteComponent(destination, vertex.mWeight0);
+						break;
+				}
+			}
+		}
+
+		return packedVertices;
+	}
+
+	VkVertexInputBindingDescription vkglTF::Vertex::inputBindingDescription(Core::uint32 aBinding, const VertexLayout& aLayout)
+	{
+		return VkVertexInputBindingDescription({aBinding, aLayout.mStride, VK_VERTEX_INPUT_RATE_VERTEX});
+	}
+
+	VkVertexInputAttributeDescription vkglTF::Vertex::inputAttributeDescription(Core::uint32 aBinding, Core::uint32 aLocation, const VertexLayout& aLayout, VertexComponent aComponent)
+	{
+		return VkVertexInputAttributeDescription({aLocation, aBinding, aLayout.GetFormat(aComponent), aLayout.GetOffset(aComponent)});
+	}
+
+	std::vector<VkVertexInputAttributeDescription> vkglTF::Vertex::inputAttributeDescriptions(Core::uint32 aBinding, const VertexLayout& aLayout)
 	{
 		std::vector<VkVertexInputAttributeDescription> result;
 		Core::uint32 location = 0;
-		for (VertexComponent component : aComponents)
+		for (VertexComponent component : aLayout.mComponents)
 		{
-			result.push_back(Vertex::inputAttributeDescription(aBinding, location, component));
+			result.push_back(Vertex::inputAttributeDescription(aBinding, location, aLayout, component));
 			location++;
 		}
 		return result;
 	}
 
-	/** @brief Returns the default pipeline vertex input state create info structure for the requested vertex components */
-	VkPipelineVertexInputStateCreateInfo* vkglTF::Vertex::getPipelineVertexInputState(const std::vector<VertexComponent>& aComponents)
+	/** @brief Returns the pipeline vertex input state create info structure for a model's vertex layout */
+	VkPipelineVertexInputStateCreateInfo* vkglTF::Vertex::getPipelineVertexInputState(const VertexLayout& aLayout)
 	{
-		mVertexInputBindingDescription = Vertex::inputBindingDescription(0);
-		Vertex::mVertexInputAttributeDescriptions = Vertex::inputAttributeDescriptions(0, aComponents);
+		mVertexInputBindingDescription = Vertex::inputBindingDescription(0, aLayout);
+		Vertex::mVertexInputAttributeDescriptions = Vertex::inputAttributeDescriptions(0, aLayout);
 		mPipelineVertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 		mPipelineVertexInputStateCreateInfo.vertexBindingDescriptionCount = 1;
 		mPipelineVertexInputStateCreateInfo.pVertexBindingDescriptions = &Vertex::mVertexInputBindingDescription;
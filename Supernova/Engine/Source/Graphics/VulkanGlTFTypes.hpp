@@ -2,9 +2,11 @@
 
 #include "Core/Types.hpp"
 #include "Math/Types.hpp"
+#include "VulkanMemoryAllocator.hpp"
 
 #include <filesystem>
 #include <limits>
+#include <span>
 #include <string>
 #include <vector>
 #include <vulkan/vulkan_core.h>
@@ -20,6 +22,8 @@ namespace vkglTF
 {
 	struct Node;
 
+	static constexpr Core::uint32 gNoBindlessIndex = std::numeric_limits<Core::uint32>::max(); // Texture or material without a slot in ModelManager's bindless resources
+
 	struct Image
 	{
 		std::vector<unsigned char> image;
@@ -43,7 +47,7 @@ namespace vkglTF
 		VulkanDevice* mVulkanDevice;
 		VkDescriptorImageInfo mDescriptorImageInfo{};
 		VkImage mImage;
-		VkDeviceMemory mDeviceMemory;
+		VulkanAllocation mAllocation;
 		VkImageView mImageView;
 		VkSampler mSampler;
 		VkImageLayout imageLayout{};
@@ -52,6 +56,7 @@ namespace vkglTF
 		Core::uint32 mMipLevels;
 		Core::uint32 mLayerCount;
 		Core::uint32 mIndex;
+		Core::uint32 mBindlessIndex; // Slot in ModelManager's bindless texture array
 		TextureType mTextureType{vkglTF::TextureType::Flat};
 	};
 
@@ -64,6 +69,7 @@ namespace vkglTF
 		VulkanDevice* mVulkanDevice;
 		AlphaMode mAlphaMode;
 		float mAlphaCutoff;
+		bool mIsDoubleSided;
 		float mMetallicFactor;
 		float mRoughnessFactor;
 		Math::Vector4f mBaseColorFactor;
@@ -74,7 +80,19 @@ namespace vkglTF
 		vkglTF::Texture* mEmissiveTexture;
 		vkglTF::Texture* mSpecularGlossinessTexture;
 		vkglTF::Texture* mDiffuseTexture;
-		VkDescriptorSet mDescriptorSet;
+		Core::uint32 mBindlessIndex; // Index of the material in ModelManager's material buffer, pushed to the shaders before each draw
+	};
+
+	// Matches the std430 layout of the material buffer, textures are indices into the bindless texture array or gNoBindlessIndex
+	struct MaterialData
+	{
+		MaterialData() : mBaseColorFactor{1.0f}, mBaseColorTexture{gNoBindlessIndex}, mNormalTexture{gNoBindlessIndex}, mAlphaCutoff{1.0f}, mAlphaMode{0} {}
+
+		Math::Vector4f mBaseColorFactor;
+		Core::uint32 mBaseColorTexture;
+		Core::uint32 mNormalTexture;
+		float mAlphaCutoff;
+		Core::uint32 mAlphaMode; // Material::AlphaMode
 	};
 
 	struct Dimensions
@@ -90,7 +108,7 @@ namespace vkglTF
 
 	struct Primitive
 	{
-		Primitive(Core::uint32 firstIndex, Core::uint32 indexCount, Material& material) : firstIndex(firstIndex), indexCount(indexCount), firstVertex{0}, vertexCount{0}, material(material) {};
+		Primitive(Core::uint32 firstIndex, Core::uint32 indexCount, Material& material) : firstIndex(firstIndex), indexCount(indexCount), firstVertex{0}, vertexCount{0}, mFirstMeshlet{0}, mMeshletCount{0}, mMeshletDrawIndex{0}, material(material) {};
 
 		void SetDimensions(const Math::Vector3f& aMin, const Math::Vector3f& aMax);
 
@@ -99,35 +117,64 @@ namespace vkglTF
 		Core::uint32 indexCount;
 		Core::uint32 firstVertex;
 		Core::uint32 vertexCount;
+		Core::uint32 mFirstMeshlet; // Range in Model::meshlets, the primitive is drawn per meshlet if mMeshletCount is not 0
+		Core::uint32 mMeshletCount;
+		Core::uint32 mMeshletDrawIndex; // Index of the primitive's visible meshlet counter
 		Material& material;
 	};
 
+	// Cluster of up to gMaxMeshletVertices vertices and gMaxMeshletTriangles triangles of a primitive, its triangles are a contiguous range of the index buffer.
+	// Matches the std430 layout read by the meshlet culling shader. Bounds are in model space, a meshlet is back facing for a camera at position p if dot(normalize(mConeApex - p), mConeAxis) > mConeCutoff.
+	struct Meshlet
+	{
+		Math::Vector3f mCenter;
+		float mRadius;
+		Math::Vector3f mConeApex;
+		float mConeCutoff; // 1.0 if the meshlet can't be back face culled
+		Math::Vector3f mConeAxis;
+		Core::uint32 mFirstIndex;
+		Core::uint32 mIndexCount;
+		Core::uint32 mDrawIndex; // Primitive's mMeshletDrawIndex
+		Core::uint32 mFirstDrawMeshlet; // Primitive's mFirstMeshlet, visible meshlets are compacted into the draws starting there
+		Core::uint32 mMaterialIndex; // Index of the primitive's material in Model::materials
+	};
+
+	struct Meshlets
+	{
+		Meshlets() : mDrawCount{0}, mBuffer{VK_NULL_HANDLE} {}
+
+		std::vector<Meshlet> mData;
+		Core::uint32 mDrawCount; // Number of primitives that are drawn per meshlet
+		VkBuffer mBuffer; // Storage buffer holding mData
+		VulkanAllocation mAllocation;
+	};
+
 	struct Vertices
 	{
-		Vertices() : mCount{0}, mBuffer{VK_NULL_HANDLE}, mMemory{VK_NULL_HANDLE} {}
+		Vertices() : mCount{0}, mBuffer{VK_NULL_HANDLE} {}
 
 		int mCount;
 		VkBuffer mBuffer;
-		VkDeviceMemory mMemory;
+		VulkanAllocation mAllocation;
 	};
 
 	struct Indices
 	{
-		Indices() : mCount{0}, mBuffer{VK_NULL_HANDLE}, mMemory{VK_NULL_HANDLE} {}
+		Indices() : mCount{0}, mBuffer{VK_NULL_HANDLE} {}
 
 		int mCount;
 		VkBuffer mBuffer;
-		VkDeviceMemory mMemory;
+		VulkanAllocation mAllocation;
 	};
 
 	struct Mesh
 	{
 		struct UniformBuffer
 		{
-			UniformBuffer() : buffer{VK_NULL_HANDLE}, memory{VK_NULL_HANDLE}, mDescriptorSet{VK_NULL_HANDLE}, mMappedData{nullptr} {}
+			UniformBuffer() : buffer{VK_NULL_HANDLE}, mDescriptorSet{VK_NULL_HANDLE}, mMappedData{nullptr} {}
 
 			VkBuffer buffer;
-			VkDeviceMemory memory;
+			VulkanAllocation mAllocation;
 			VkDescriptorBufferInfo descriptor{};
 			VkDescriptorSet mDescriptorSet;
 			void* mMappedData;
@@ -162,18 +209,18 @@ namespace vkglTF
 		std::vector<Node*> joints{};
 	};
 
+	// The transform is the pose the node was loaded with, the model's NodeHierarchy holds the current one
 	struct Node
 	{
-		Node() : mParent{nullptr}, mIndex{0}, mMesh{nullptr}, mSkin{nullptr}, mSkinIndex{-1}, mScale{1.0f} {}
+		Node() : mParent{nullptr}, mIndex{0}, mHierarchyIndex{0}, mMesh{nullptr}, mSkin{nullptr}, mSkinIndex{-1}, mScale{1.0f} {}
 		~Node();
 
-		void update();
-
 		Math::Matrix4f GetLocalMatrix() const;
-		Math::Matrix4f GetMatrix() const;
+		Math::Matrix4f GetMatrix() const; // Walks the parent chain, only meant for loading
 
 		Node* mParent;
 		Core::uint32 mIndex;
+		Core::uint32 mHierarchyIndex; // Position in Model::mHierarchy
 		std::vector<Node*> mChildren{};
 		Math::Matrix4f mMatrix{};
 		std::string mName{};
@@ -196,15 +243,22 @@ namespace vkglTF
 		Core::uint32 mSamplerIndex;
 	};
 
+	// Compressed keyframes, see AnimationCompression
 	struct AnimationSampler
 	{
 		enum class InterpolationType { LINEAR, STEP, CUBICSPLINE };
+		enum class Encoding : Core::uint8 { SmallestThree, Range }; // Rotations of linear and step samplers, everything else
 
-		AnimationSampler() : mInterpolation{InterpolationType::LINEAR} {}
+		AnimationSampler() : mInterpolation{InterpolationType::LINEAR}, mEncoding{Encoding::Range}, mComponentCount{0}, mFirstTime{0}, mKeyCount{0}, mFirstValue{0} {}
 
-		std::vector<Math::Vector4f> mOutputsVec4{};
-		std::vector<float> mInputs{};
+		Math::Vector4f mMin{}; // Range encoding, a value is mMin + mStep * quantized value
+		Math::Vector4f mStep{};
 		InterpolationType mInterpolation;
+		Encoding mEncoding;
+		Core::uint32 mComponentCount; // Of the decoded values, four for rotations and three for translations and scales
+		Core::uint32 mFirstTime; // Offset into Animation::mTimes
+		Core::uint32 mKeyCount;
+		Core::uint32 mFirstValue; // Offset into Animation::mValues
 	};
 
 	struct Animation
@@ -213,6 +267,8 @@ namespace vkglTF
 
 		std::vector<AnimationSampler> mSamplers{};
 		std::vector<AnimationChannel> mChannels{};
+		std::vector<float> mTimes{}; // Shared by the samplers with the same keys
+		std::vector<Core::uint16> mValues{};
 		std::string mName{};
 		float mStart;
 		float mEnd;
@@ -220,14 +276,37 @@ namespace vkglTF
 
 	enum class VertexComponent { Position, Normal, UV, Color, Tangent, Joint0, Weight0 };
 
+	struct Vertex;
+
+	// Attributes stored in a model's vertex buffer, tightly packed in the order of mComponents which is also their shader location order.
+	// Quantized layouts keep positions as floats and store normals octahedral encoded as snorm16x2, tangents as snorm8, UVs as half floats, colors as unorm8, joints as uint8 and weights as unorm16.
+	struct VertexLayout
+	{
+		VertexLayout() : mStride{0}, mIsQuantized{false} {}
+		VertexLayout(const std::vector<VertexComponent>& aComponents, bool aIsQuantized);
+
+		bool HasComponent(VertexComponent aComponent) const;
+		Core::uint32 GetOffset(VertexComponent aComponent) const;
+		VkFormat GetFormat(VertexComponent aComponent) const;
+		std::vector<unsigned char> PackVertices(std::span<const Vertex> aVertices) const;
+
+		static Core::uint32 GetComponentSize(VertexComponent aComponent, bool aIsQuantized);
+
+		std::vector<VertexComponent> mComponents;
+		std::vector<Core::uint32> mOffsets;
+		Core::uint32 mStride;
+		bool mIsQuantized;
+	};
+
+	// Full precision vertex used while converting a model, packed into the model's VertexLayout before it is uploaded
 	struct Vertex
 	{
 		Vertex() {}
 
-		static VkVertexInputBindingDescription inputBindingDescription(Core::uint32 aBinding);
-		static VkVertexInputAttributeDescription inputAttributeDescription(Core::uint32 aBinding, Core::uint32 aLocation, VertexComponent aComponent);
-		static std::vector<VkVertexInputAttributeDescription> inputAttributeDescriptions(Core::uint32 aBinding, const std::vector<VertexComponent>& aComponents);
-		static VkPipelineVertexInputStateCreateInfo* getPipelineVertexInputState(const std::vector<VertexComponent>& aComponents); // Returns the default pipeline vertex input state create info structure for the requested vertex components
+		static VkVertexInputBindingDescription inputBindingDescription(Core::uint32 aBinding, const VertexLayout& aLayout);
+		static VkVertexInputAttributeDescription inputAttributeDescription(Core::uint32 aBinding, Core::uint32 aLocation, const VertexLayout& aLayout, VertexComponent aComponent);
+		static std::vector<VkVertexInputAttributeDescription> inputAttributeDescriptions(Core::uint32 aBinding, const VertexLayout& aLayout);
+		static VkPipelineVertexInputStateCreateInfo* getPipelineVertexInputState(const VertexLayout& aLayout); // Returns the pipeline vertex input state create info structure for a model's vertex layout
 
 		Math::Vector3f mPosition{};
 		Math::Vector3f mNormal{};
@@ -241,18 +320,68 @@ namespace vkglTF
 		static VkPipelineVertexInputStateCreateInfo mPipelineVertexInputStateCreateInfo;
 	};
 
+	// Transforms of the nodes of a model as a structure of arrays, in depth first order so parents come before their children and every subtree is a contiguous range.
+	// World matrices are propagated in a single linear pass that only visits the subtrees below nodes whose transform has been set since the last update.
+	class NodeHierarchy
+	{
+	public:
+		static constexpr Core::uint32 gNoParent = std::numeric_limits<Core::uint32>::max();
+
+		NodeHierarchy() : mFirstDirtyIndex{0} {}
+
+		void Build(const std::vector<Node*>& aRootNodes); // Copies the transforms of the nodes and sets their mHierarchyIndex
+
+		void SetTranslation(Core::uint32 aIndex, const Math::Vector3f& aTranslation);
+		void SetRotation(Core::uint32 aIndex, const Math::Quaternionf& aRotation);
+		void SetScale(Core::uint32 aIndex, const Math::Vector3f& aScale);
+		bool UpdateWorldMatrices(); // Returns whether any world matrix has changed
+
+		Core::uint32 GetNodeCount() const { return static_cast<Core::uint32>(mNodes.size()); }
+		Node* GetNode(Core::uint32 aIndex) const { return mNodes[aIndex]; }
+		Core::uint32 GetParent(Core::uint32 aIndex) const { return mParents[aIndex]; }
+		Core::uint32 GetSubtreeEnd(Core::uint32 aIndex) const { return mSubtreeEnds[aIndex]; }
+		const Math::Vector3f& GetTranslation(Core::uint32 aIndex) const { return mTranslations[aIndex]; }
+		const Math::Quaternionf& GetRotation(Core::uint32 aIndex) const { return mRotations[aIndex]; }
+		const Math::Vector3f& GetScale(Core::uint32 aIndex) const { return mScales[aIndex]; }
+		const Math::Matrix4f& GetWorldMatrix(Core::uint32 aIndex) const { return mWorldMatrices[aIndex]; }
+		bool HasWorldMatrixChanged(Core::uint32 aIndex) const { return mIsWorldMatrixChanged[aIndex] != 0; } // During the last update
+
+	private:
+		void AddSubtree(Node* aNode, Core::uint32 aParent);
+		void MarkDirty(Core::uint32 aIndex);
+
+		std::vector<Node*> mNodes;
+		std::vector<Core::uint32> mParents;
+		std::vector<Core::uint32> mSubtreeEnds; // One past the last node of the subtree
+		std::vector<Math::Vector3f> mTranslations;
+		std::vector<Math::Quaternionf> mRotations;
+		std::vector<Math::Vector3f> mScales;
+		std::vector<Math::Matrix4f> mMatrices; // Applied to the vertices before the scale, rotation and translation
+		std::vector<Math::Matrix4f> mLocalMatrices;
+		std::vector<Math::Matrix4f> mWorldMatrices;
+		std::vector<Core::uint8> mIsLocalMatrixDirty;
+		std::vector<Core::uint8> mIsWorldMatrixChanged;
+		Core::uint32 mFirstDirtyIndex; // Nodes before it are up to date
+	};
+
 	struct Model
 	{
+		void UpdateNodes(); // Propagates the transforms set in mHierarchy and writes the matrices of the meshes that have moved
+
 		Vertices vertices{};
 		Indices indices{};
+		Meshlets meshlets{};
 		std::vector<Node*> nodes{};
 		std::vector<Texture> textures{};
 		std::vector<Material> materials{};
 		vkglTF::Texture mEmptyTexture{};
 		std::vector<Node*> linearNodes{};
+		NodeHierarchy mHierarchy{};
 		std::vector<Skin*> skins{};
 		std::vector<Animation> animations{};
 		Dimensions mDimensions{};
+		VertexLayout mVertexLayout{};
 		std::filesystem::path path{};
+		bool mIsPreTransformed{false}; // Loaded with FileLoadingFlags::PreTransformVertices, the node matrices are baked into the vertices and mHierarchy doesn't move what is drawn
 	};
 }
\ No newline at end of file
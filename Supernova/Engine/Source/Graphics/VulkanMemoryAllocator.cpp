@@ -0,0 +1,483 @@
+#include "VulkanMemoryAllocator.hpp"
+
+#include "Core/Types.hpp"
+#include "VulkanTools.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+struct VulkanMemoryBlock
+{
+	VulkanMemoryBlock()
+		: mVkDeviceMemory{VK_NULL_HANDLE}
+		, mSize{0}
+		, mMappedData{nullptr}
+		, mMemoryTypeIndex{0}
+		, mResourceType{AllocationResourceType::Buffer}
+		, mStrategy{AllocationStrategy::Buddy}
+		, mUsedBytes{0}
+		, mAllocationCount{0}
+		, mLinearOffset{0}
+	{
+	}
+
+	VkDeviceMemory mVkDeviceMemory;
+	VkDeviceSize mSize;
+	void* mMappedData;
+	Core::uint32 mMemoryTypeIndex;
+	AllocationResourceType mResourceType;
+	AllocationStrategy mStrategy;
+	VkDeviceSize mUsedBytes;
+	Core::uint32 mAllocationCount;
+	VkDeviceSize mLinearOffset; // Linear: next free byte, rewinds once every allocation has been freed
+	std::vector<std::set<VkDeviceSize>> mFreeLists; // Buddy: free offsets per order, order 0 is gMinBuddyAllocationSize
+	std::unordered_map<VkDeviceSize, Core::uint32> mAllocatedOrders; // Buddy: order of every live allocation by offset
+};
+
+namespace VulkanMemoryAllocatorLocal
+{
+	static VkDeviceSize AlignUp(VkDeviceSize aValue, VkDeviceSize aAlignment)
+	{
+		return (aValue + aAlignment - 1) & ~(aAlignment - 1);
+	}
+
+	static VkDeviceSize AlignDown(VkDeviceSize aValue, VkDeviceSize aAlignment)
+	{
+		return aValue & ~(aAlignment - 1);
+	}
+
+	static Core::uint32 GetBuddyOrder(VkDeviceSize aSize)
+	{
+		return static_cast<Core::uint32>(std::countr_zero(aSize / gMinBuddyAllocationSize));
+	}
+
+	static bool AllocateBuddy(VulkanMemoryBlock& aBlock, VkDeviceSize aSize, VkDeviceSize aAlignment, VkDeviceSize& aOffset, VkDeviceSize& aAllocatedSize)
+	{
+		// Buddy ranges are naturally aligned to their own size, so rounding up to the alignment is enough
+		const VkDeviceSize size = std::bit_ceil(std::max({aSize, aAlignment, gMinBuddyAllocationSize}));
+		if (size > aBlock.mSize)
+			return false;
+
+		const Core::uint32 order = GetBuddyOrder(size);
+		Core::uint32 freeOrder = order;
+		while (freeOrder < aBlock.mFreeLists.size() && aBlock.mFreeLists[freeOrder].empty())
+		{
+			freeOrder++;
+		}
+
+		if (freeOrder >= aBlock.mFreeLists.size())
+			return false;
+
+		VkDeviceSize offset = *aBlock.mFreeLists[freeOrder].begin();
+		aBlock.mFreeLists[freeOrder].erase(aBlock.mFreeLists[freeOrder].begin());
+
+		// Split larger ranges down to the requested order, keeping the upper halves free
+		while (freeOrder > order)
+		{
+			freeOrder--;
+			aBlock.mFreeLists[freeOrder].insert(offset + (gMinBuddyAllocationSize << freeOrder));
+		}
+
+		aBlock.mAllocatedOrders[offset] = order;
+		aOffset = offset;
+		aAllocatedSize = size;
+		return true;
+	}
+
+	static VkDeviceSize FreeBuddy(VulkanMemoryBlock& aBlock, VkDeviceSize aOffset)
+	{
+		const auto allocatedOrder = aBlock.mAllocatedOrders.find(aOffset);
+		if (allocatedOrder == aBlock.mAllocatedOrders.end())
+		{
+			throw std::runtime_error(std::format("Freeing unknown buddy allocation at offset {}", aOffset));
+		}
+
+		Core::uint32 order = allocatedOrder->second;
+		const VkDeviceSize freedSize = gMinBuddyAllocationSize << order;
+		aBlock.mAllocatedOrders.erase(allocatedOrder);
+
+		// Merge with the buddy range for as long as it is free as well
+		VkDeviceSize offset = aOffset;
+		while (order + 1 < aBlock.mFreeLists.size())
+		{
+			const VkDeviceSize buddyOffset = offset ^ (gMinBuddyAllocationSize << order);
+			const auto buddy = aBlock.mFreeLists[order].find(buddyOffset);
+			if (buddy == aBlock.mFreeLists[order].end())
+				break;
+
+			aBlock.mFreeLists[order].erase(buddy);
+			offset = std::min(offset, buddyOffset);
+			order++;
+		}
+
+		aBlock.mFreeLists[order].insert(offset);
+		return freedSize;
+	}
+
+	static bool AllocateLinear(VulkanMemoryBlock& aBlock, VkDeviceSize aSize, VkDeviceSize aAlignment, VkDeviceSize& aOffset, VkDeviceSize& aAllocatedSize)
+	{
+		const VkDeviceSize offset = AlignUp(aBlock.mLinearOffset, aAlignment);
+		if (offset + aSize > aBlock.mSize)
+			return false;
+
+		aAllocatedSize = aSize;
+		aBlock.mLinearOffset = offset + aSize;
+		aOffset = offset;
+		return true;
+	}
+}
+
+bool VulkanMemoryAllocator::PoolKey::operator<(const PoolKey& aOther) const
+{
+	if (mMemoryTypeIndex != aOther.mMemoryTypeIndex)
+		return mMemoryTypeIndex < aOther.mMemoryTypeIndex;
+
+	if (mResourceType != aOther.mResourceType)
+		return mResourceType < aOther.mResourceType;
+
+	return mStrategy < aOther.mStrategy;
+}
+
+VulkanMemoryAllocator::VulkanMemoryAllocator(VkDevice aLogicalVkDevice, const VkPhysicalDeviceProperties& aPhysicalDeviceProperties, const VkPhysicalDeviceMemoryProperties& aPhysicalDeviceMemoryProperties)
+	: mPhysicalDeviceMemoryProperties{aPhysicalDeviceMemoryProperties}
+	, mLogicalVkDevice{aLogicalVkDevice}
+	, mNonCoherentAtomSize{std::max<VkDeviceSize>(aPhysicalDeviceProperties.limits.nonCoherentAtomSize, 1)}
+{
+}
+
+VulkanMemoryAllocator::~VulkanMemoryAllocator()
+{
+	for (auto& [poolKey, blocks] : mPools)
+	{
+		for (const std::unique_ptr<VulkanMemoryBlock>& block : blocks)
+		{
+			if (block->mMappedData)
+				vkUnmapMemory(mLogicalVkDevice, block->mVkDeviceMemory);
+
+			vkFreeMemory(mLogicalVkDevice, block->mVkDeviceMemory, nullptr);
+		}
+	}
+}
+
+/**
+* Sub-allocate memory for a resource from a block of a matching memory type
+*
+* @param memoryRequirements Requirements of the buffer or image the memory is meant for
+* @param memoryPropertyFlags Memory properties the memory type has to support
+* @param resourceType Buffers and optimally tiled images are kept in separate blocks
+* @param strategy (Optional) Placement strategy within the block
+* @param isDeviceAddress (Optional) Allocate with VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT, always uses a dedicated allocation
+*
+* @return The allocation, the caller binds it at mOffset of mVkDeviceMemory
+*/
+VulkanAllocation VulkanMemoryAllocator::Allocate(const VkMemoryRequirements& aMemoryRequirements, VkMemoryPropertyFlags aMemoryPropertyFlags, AllocationResourceType aResourceType, AllocationStrategy aStrategy, bool aIsDeviceAddress)
+{
+	const std::scoped_lock lock{mMutex};
+
+	const Core::uint32 memoryTypeIndex = FindMemoryTypeIndex(aMemoryRequirements.memoryTypeBits, aMemoryPropertyFlags);
+	const VkDeviceSize blockSize = GetBlockSize(memoryTypeIndex);
+
+	VkDeviceSize size = aMemoryRequirements.size;
+	VkDeviceSize alignment = std::max<VkDeviceSize>(aMemoryRequirements.alignment, 1);
+	if (IsNonCoherent(memoryTypeIndex))
+	{
+		// Flushes are rounded to the atom size, so neighbouring allocations must not share an atom
+		size = VulkanMemoryAllocatorLocal::AlignUp(size, mNonCoherentAtomSize);
+		alignment = std::max(alignment, mNonCoherentAtomSize);
+	}
+
+	if (aIsDeviceAddress || size > blockSize / 2)
+	{
+		return AllocateDedicated(size, memoryTypeIndex, aIsDeviceAddress);
+	}
+
+	const PoolKey poolKey{memoryTypeIndex, aResourceType, aStrategy};
+	std::vector<std::unique_ptr<VulkanMemoryBlock>>& blocks = mPools[poolKey];
+
+	VkDeviceSize offset = 0;
+	VkDeviceSize allocatedSize = 0;
+	VulkanMemoryBlock* targetBlock = nullptr;
+	for (const std::unique_ptr<VulkanMemoryBlock>& block : blocks)
+	{
+		const bool isAllocated = aStrategy == AllocationStrategy::Buddy
+			? VulkanMemoryAllocatorLocal::AllocateBuddy(*block, size, alignment, offset, allocatedSize)
+			: VulkanMemoryAllocatorLocal::AllocateLinear(*block, size, alignment, offset, allocatedSize);
+		if (isAllocated)
+		{
+			targetBlock = block.get();
+			break;
+		}
+	}
+
+	if (!targetBlock)
+	{
+		targetBlock = CreateBlock(poolKey);
+		const bool isAllocated = aStrategy == AllocationStrategy::Buddy
+			? VulkanMemoryAllocatorLocal::AllocateBuddy(*targetBlock, size, alignment, offset, allocatedSize)
+			: VulkanMemoryAllocatorLocal::AllocateLinear(*targetBlock, size, alignment, offset, allocatedSize);
+		if (!isAllocated)
+		{
+			throw std::runtime_error(std::format("Could not sub-allocate {} bytes from a new memory block", size));
+		}
+	}
+
+	targetBlock->mUsedBytes += allocatedSize;
+	targetBlock->mAllocationCount++;
+
+	VulkanMemoryStatistics& statistics = mStatistics[memoryTypeIndex];
+	statistics.mAllocationCount++;
+	statistics.mUsedBytes += allocatedSize;
+
+	VulkanAllocation allocation{};
+	allocation.mVkDeviceMemory = targetBlock->mVkDeviceMemory;
+	allocation.mOffset = offset;
+	allocation.mSize = allocatedSize;
+	allocation.mMappedData = targetBlock->mMappedData ? static_cast<Core::uint8*>(targetBlock->mMappedData) + offset : nullptr;
+	allocation.mMemoryTypeIndex = memoryTypeIndex;
+	allocation.mBlock = targetBlock;
+	return allocation;
+}
+
+void VulkanMemoryAllocator::Free(VulkanAllocation& aAllocation)
+{
+	if (!aAllocation.IsValid())
+		return;
+
+	const std::scoped_lock lock{mMutex};
+
+	VulkanMemoryStatistics& statistics = mStatistics[aAllocation.mMemoryTypeIndex];
+
+	if (!aAllocation.mBlock)
+	{
+		if (aAllocation.mMappedData)
+			vkUnmapMemory(mLogicalVkDevice, aAllocation.mVkDeviceMemory);
+
+		vkFreeMemory(mLogicalVkDevice, aAllocation.mVkDeviceMemory, nullptr);
+
+		statistics.mDedicatedAllocationCount--;
+		statistics.mAllocationCount--;
+		statistics.mReservedBytes -= aAllocation.mSize;
+		statistics.mUsedBytes -= aAllocation.mSize;
+		aAllocation = VulkanAllocation{};
+		return;
+	}
+
+	VulkanMemoryBlock* block = aAllocation.mBlock;
+	if (block->mStrategy == AllocationStrategy::Buddy)
+	{
+		VulkanMemoryAllocatorLocal::FreeBuddy(*block, aAllocation.mOffset);
+	}
+
+	block->mUsedBytes -= aAllocation.mSize;
+	block->mAllocationCount--;
+	statistics.mAllocationCount--;
+	statistics.mUsedBytes -= aAllocation.mSize;
+
+	if (block->mAllocationCount == 0)
+	{
+		block->mLinearOffset = 0;
+
+		// Keep one empty block per pool around so that load/unload cycles do not hit the driver every time
+		const PoolKey poolKey{block->mMemoryTypeIndex, block->mResourceType, block->mStrategy};
+		std::vector<std::unique_ptr<VulkanMemoryBlock>>& blocks = mPools[poolKey];
+		if (blocks.size() > 1)
+		{
+			if (block->mMappedData)
+				vkUnmapMemory(mLogicalVkDevice, block->mVkDeviceMemory);
+
+			vkFreeMemory(mLogicalVkDevice, block->mVkDeviceMemory, nullptr);
+
+			statistics.mBlockCount--;
+			statistics.mReservedBytes -= block->mSize;
+
+			std::erase_if(blocks, [block](const std::unique_ptr<VulkanMemoryBlock>& aBlock) { return aBlock.get() == block; });
+		}
+	}
+
+	aAllocation = VulkanAllocation{};
+}
+
+/**
+* Flush a range of a host visible allocation to make writes visible to the device
+*
+* @note Only required for non-coherent memory, the range is expanded to nonCoherentAtomSize
+*/
+VkResult VulkanMemoryAllocator::Flush(const VulkanAllocation& aAllocation, VkDeviceSize aSize, VkDeviceSize aOffset) const
+{
+	if (!aAllocation.IsValid() || !IsNonCoherent(aAllocation.mMemoryTypeIndex))
+		return VK_SUCCESS;
+
+	const VkDeviceSize memorySize = aAllocation.mBlock ? aAllocation.mBlock->mSize : aAllocation.mSize;
+	const VkDeviceSize size = aSize == VK_WHOLE_SIZE ? aAllocation.mSize - aOffset : aSize;
+	const VkDeviceSize begin = VulkanMemoryAllocatorLocal::AlignDown(aAllocation.mOffset + aOffset, mNonCoherentAtomSize);
+	const VkDeviceSize end = VulkanMemoryAllocatorLocal::AlignUp(aAllocation.mOffset + aOffset + size, mNonCoherentAtomSize);
+
+	const VkMappedMemoryRange mappedMemoryRange{
+		.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+		.memory = aAllocation.mVkDeviceMemory,
+		.offset = begin,
+		.size = end >= memorySize ? VK_WHOLE_SIZE : end - begin
+	};
+	return vkFlushMappedMemoryRanges(mLogicalVkDevice, 1, &mappedMemoryRange);
+}
+
+/**
+* Invalidate a range of a host visible allocation to make device writes visible to the host
+*
+* @note Only required for non-coherent memory, the range is expanded to nonCoherentAtomSize
+*/
+VkResult VulkanMemoryAllocator::Invalidate(const VulkanAllocation& aAllocation, VkDeviceSize aSize, VkDeviceSize aOffset) const
+{
+	if (!aAllocation.IsValid() || !IsNonCoherent(aAllocation.mMemoryTypeIndex))
+		return VK_SUCCESS;
+
+	const VkDeviceSize memorySize = aAllocation.mBlock ? aAllocation.mBlock->mSize : aAllocation.mSize;
+	const VkDeviceSize size = aSize == VK_WHOLE_SIZE ? aAllocation.mSize - aOffset : aSize;
+	const VkDeviceSize begin = VulkanMemoryAllocatorLocal::AlignDown(aAllocation.mOffset + aOffset, mNonCoherentAtomSize);
+	const VkDeviceSize end = VulkanMemoryAllocatorLocal::AlignUp(aAllocation.mOffset + aOffset + size, mNonCoherentAtomSize);
+
+	const VkMappedMemoryRange mappedMemoryRange{
+		.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+		.memory = aAllocation.mVkDeviceMemory,
+		.offset = begin,
+		.size = end >= memorySize ? VK_WHOLE_SIZE : end - begin
+	};
+	return vkInvalidateMappedMemoryRanges(mLogicalVkDevice, 1, &mappedMemoryRange);
+}
+
+VulkanMemoryStatistics VulkanMemoryAllocator::GetStatistics() const
+{
+	const std::scoped_lock lock{mMutex};
+
+	VulkanMemoryStatistics total{};
+	for (Core::uint32 i = 0; i < mPhysicalDeviceMemoryProperties.memoryTypeCount; i++)
+	{
+		total.mBlockCount += mStatistics[i].mBlockCount;
+		total.mDedicatedAllocationCount += mStatistics[i].mDedicatedAllocationCount;
+		total.mAllocationCount += mStatistics[i].mAllocationCount;
+		total.mReservedBytes += mStatistics[i].mReservedBytes;
+		total.mUsedBytes += mStatistics[i].mUsedBytes;
+	}
+	return total;
+}
+
+VulkanMemoryStatistics VulkanMemoryAllocator::GetStatistics(Core::uint32 aMemoryTypeIndex) const
+{
+	const std::scoped_lock lock{mMutex};
+
+	return mStatistics[aMemoryTypeIndex];
+}
+
+Core::uint32 VulkanMemoryAllocator::FindMemoryTypeIndex(Core::uint32 aTypeBits, VkMemoryPropertyFlags aMemoryPropertyFlags) const
+{
+	for (Core::uint32 i = 0; i < mPhysicalDeviceMemoryProperties.memoryTypeCount; i++)
+	{
+		if ((aTypeBits & (1u << i)) && (mPhysicalDeviceMemoryProperties.memoryTypes[i].propertyFlags & aMemoryPropertyFlags) == aMemoryPropertyFlags)
+		{
+			return i;
+		}
+	}
+
+	throw std::runtime_error("Could not find a matching memory type");
+}
+
+VkDeviceMemory VulkanMemoryAllocator::AllocateDeviceMemory(VkDeviceSize aSize, Core::uint32 aMemoryTypeIndex, bool aIsDeviceAddress, void** aMappedData)
+{
+	VkMemoryAllocateInfo memoryAllocateInfo{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.allocationSize = aSize,
+		.memoryTypeIndex = aMemoryTypeIndex
+	};
+
+	const VkMemoryAllocateFlagsInfo memoryAllocateFlagsInfo{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO,
+		.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT
+	};
+	if (aIsDeviceAddress)
+	{
+		memoryAllocateInfo.pNext = &memoryAllocateFlagsInfo;
+	}
+
+	VkDeviceMemory vkDeviceMemory{VK_NULL_HANDLE};
+	VK_CHECK_RESULT(vkAllocateMemory(mLogicalVkDevice, &memoryAllocateInfo, nullptr, &vkDeviceMemory));
+
+	// Host visible memory stays mapped for its whole lifetime, Vulkan does not allow mapping the same memory object twice
+	*aMappedData = nullptr;
+	if (mPhysicalDeviceMemoryProperties.memoryTypes[aMemoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		VK_CHECK_RESULT(vkMapMemory(mLogicalVkDevice, vkDeviceMemory, 0, VK_WHOLE_SIZE, 0, aMappedData));
+	}
+
+	return vkDeviceMemory;
+}
+
+VulkanAllocation VulkanMemoryAllocator::AllocateDedicated(VkDeviceSize aSize, Core::uint32 aMemoryTypeIndex, bool aIsDeviceAddress)
+{
+	VulkanAllocation allocation{};
+	allocation.mVkDeviceMemory = AllocateDeviceMemory(aSize, aMemoryTypeIndex, aIsDeviceAddress, &allocation.mMappedData);
+	allocation.mOffset = 0;
+	allocation.mSize = aSize;
+	allocation.mMemoryTypeIndex = aMemoryTypeIndex;
+	allocation.mBlock = nullptr;
+
+	VulkanMemoryStatistics& statistics = mStatistics[aMemoryTypeIndex];
+	statistics.mDedicatedAllocationCount++;
+	statistics.mAllocationCount++;
+	statistics.mReservedBytes += aSize;
+	statistics.mUsedBytes += aSize;
+
+	return allocation;
+}
+
+VulkanMemoryBlock* VulkanMemoryAllocator::CreateBlock(const PoolKey& aPoolKey)
+{
+	std::unique_ptr<VulkanMemoryBlock> block = std::make_unique<VulkanMemoryBlock>();
+	block->mSize = GetBlockSize(aPoolKey.mMemoryTypeIndex);
+	block->mMemoryTypeIndex = aPoolKey.mMemoryTypeIndex;
+	block->mResourceType = aPoolKey.mResourceType;
+	block->mStrategy = aPoolKey.mStrategy;
+	block->mVkDeviceMemory = AllocateDeviceMemory(block->mSize, aPoolKey.mMemoryTypeIndex, false, &block->mMappedData);
+
+	if (aPoolKey.mStrategy == AllocationStrategy::Buddy)
+	{
+		const Core::uint32 maxOrder = VulkanMemoryAllocatorLocal::GetBuddyOrder(block->mSize);
+		block->mFreeLists.resize(maxOrder + 1);
+		block->mFreeLists[maxOrder].insert(0);
+	}
+
+	VulkanMemoryStatistics& statistics = mStatistics[aPoolKey.mMemoryTypeIndex];
+	statistics.mBlockCount++;
+	statistics.mReservedBytes += block->mSize;
+
+	std::vector<std::unique_ptr<VulkanMemoryBlock>>& blocks = mPools[aPoolKey];
+	blocks.push_back(std::move(block));
+	return blocks.back().get();
+}
+
+VkDeviceSize VulkanMemoryAllocator::GetBlockSize(Core::uint32 aMemoryTypeIndex) const
+{
+	// Small heaps (e.g. the 256MB BAR heap or software implementations) get smaller blocks so one block never dominates the heap
+	const Core::uint32 heapIndex = mPhysicalDeviceMemoryProperties.memoryTypes[aMemoryTypeIndex].heapIndex;
+	const VkDeviceSize heapSize = mPhysicalDeviceMemoryProperties.memoryHeaps[heapIndex].size;
+
+	VkDeviceSize blockSize = gDefaultMemoryBlockSize;
+	while (blockSize > heapSize / 8 && blockSize > gMinBuddyAllocationSize * 4096)
+	{
+		blockSize /= 2;
+	}
+	return blockSize;
+}
+
+bool VulkanMemoryAllocator::IsNonCoherent(Core::uint32 aMemoryTypeIndex) const
+{
+	const VkMemoryPropertyFlags propertyFlags = mPhysicalDeviceMemoryProperties.memoryTypes[aMemoryTypeIndex].propertyFlags;
+	return (propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
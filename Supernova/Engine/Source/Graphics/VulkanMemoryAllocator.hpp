@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Core/Types.hpp"
+
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+static constexpr VkDeviceSize gDefaultMemoryBlockSize = 64ull * 1024 * 1024;
+static constexpr VkDeviceSize gMinBuddyAllocationSize = 256;
+
+// Buddy suits long-lived resources that are freed individually, linear packs many small
+// allocations that share a lifetime (e.g. all mesh uniform buffers of a model) without rounding
+enum class AllocationStrategy { Buddy, Linear };
+
+// Buffers and optimally tiled images never share a block, which keeps bufferImageGranularity out of the picture
+enum class AllocationResourceType { Buffer, Image };
+
+struct VulkanMemoryBlock;
+
+struct VulkanAllocation
+{
+	VulkanAllocation() : mVkDeviceMemory{VK_NULL_HANDLE}, mOffset{0}, mSize{0}, mMappedData{nullptr}, mMemoryTypeIndex{0}, mBlock{nullptr} {}
+
+	bool IsValid() const { return mVkDeviceMemory != VK_NULL_HANDLE; }
+
+	VkDeviceMemory mVkDeviceMemory;
+	VkDeviceSize mOffset;
+	VkDeviceSize mSize;
+	void* mMappedData; // Persistently mapped pointer at mOffset, null for memory that is not host visible
+	Core::uint32 mMemoryTypeIndex;
+	VulkanMemoryBlock* mBlock; // Null for dedicated allocations
+};
+
+struct VulkanMemoryStatistics
+{
+	VulkanMemoryStatistics() : mBlockCount{0}, mDedicatedAllocationCount{0}, mAllocationCount{0}, mReservedBytes{0}, mUsedBytes{0} {}
+
+	Core::uint32 mBlockCount; // Number of vkAllocateMemory calls backing sub-allocations
+	Core::uint32 mDedicatedAllocationCount; // Number of vkAllocateMemory calls owned by a single resource
+	Core::uint32 mAllocationCount; // Number of live sub-allocations and dedicated allocations
+	VkDeviceSize mReservedBytes; // Bytes requested from the driver
+	VkDeviceSize mUsedBytes; // Bytes handed out to resources, including buddy rounding
+};
+
+class VulkanMemoryAllocator
+{
+public:
+	VulkanMemoryAllocator(VkDevice aLogicalVkDevice, const VkPhysicalDeviceProperties& aPhysicalDeviceProperties, const VkPhysicalDeviceMemoryProperties& aPhysicalDeviceMemoryProperties);
+	~VulkanMemoryAllocator();
+
+	VulkanMemoryAllocator(const VulkanMemoryAllocator&) = delete;
+	VulkanMemoryAllocator& operator=(const VulkanMemoryAllocator&) = delete;
+
+	VulkanAllocation Allocate(const VkMemoryRequirements& aMemoryRequirements, VkMemoryPropertyFlags aMemoryPropertyFlags, AllocationResourceType aResourceType, AllocationStrategy aStrategy = AllocationStrategy::Buddy, bool aIsDeviceAddress = false);
+	void Free(VulkanAllocation& aAllocation);
+
+	VkResult Flush(const VulkanAllocation& aAllocation, VkDeviceSize aSize = VK_WHOLE_SIZE, VkDeviceSize aOffset = 0) const;
+	VkResult Invalidate(const VulkanAllocation& aAllocation, VkDeviceSize aSize = VK_WHOLE_SIZE, VkDeviceSize aOffset = 0) const;
+
+	VulkanMemoryStatistics GetStatistics() const;
+	VulkanMemoryStatistics GetStatistics(Core::uint32 aMemoryTypeIndex) const;
+	Core::uint32 GetMemoryTypeCount() const { return mPhysicalDeviceMemoryProperties.memoryTypeCount; }
+	VkMemoryPropertyFlags GetMemoryTypeProperties(Core::uint32 aMemoryTypeIndex) const { return mPhysicalDeviceMemoryProperties.memoryTypes[aMemoryTypeIndex].propertyFlags; }
+
+private:
+	struct PoolKey
+	{
+		bool operator<(const PoolKey& aOther) const;
+
+		Core::uint32 mMemoryTypeIndex;
+		AllocationResourceType mResourceType;
+		AllocationStrategy mStrategy;
+	};
+
+	Core::uint32 FindMemoryTypeIndex(Core::uint32 aTypeBits, VkMemoryPropertyFlags aMemoryPropertyFlags) const;
+	VkDeviceMemory AllocateDeviceMemory(VkDeviceSize aSize, Core::uint32 aMemoryTypeIndex, bool aIsDeviceAddress, void** aMappedData);
+	VulkanAllocation AllocateDedicated(VkDeviceSize aSize, Core::uint32 aMemoryTypeIndex, bool aIsDeviceAddress);
+	VulkanMemoryBlock* CreateBlock(const PoolKey& aPoolKey);
+	VkDeviceSize GetBlockSize(Core::uint32 aMemoryTypeIndex) const;
+	bool IsNonCoherent(Core::uint32 aMemoryTypeIndex) const;
+
+	std::map<PoolKey, std::vector<std::unique_ptr<VulkanMemoryBlock>>> mPools;
+	std::array<VulkanMemoryStatistics, VK_MAX_MEMORY_TYPES> mStatistics{};
+	mutable std::mutex mMutex;
+	VkPhysicalDeviceMemoryProperties mPhysicalDeviceMemoryProperties;
+	VkDevice mLogicalVkDevice;
+	VkDeviceSize mNonCoherentAtomSize;
+};
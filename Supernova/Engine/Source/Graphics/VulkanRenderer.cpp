@@ -1,18 +1,26 @@
 #include "VulkanRenderer.hpp"
 
+#include "AnimationSystem.hpp"
 #include "Camera.hpp"
+#include "CameraPath.hpp"
 #include "Core/Constants.hpp"
 #include "Core/Types.hpp"
+#include "ECS/Components.hpp"
+#include "ECS/Entity.hpp"
+#include "ECS/Scene.hpp"
 #include "EngineProperties.hpp"
 #include "FileLoader.hpp"
 #include "ImGuiOverlay.hpp"
+#include "InstanceRegistry.hpp"
 #include "Input/InputKeys.hpp"
 #include "Input/InputManager.hpp"
+#include "JobSystem.hpp"
 #include "Math/Functions.hpp"
 #include "Math/Types.hpp"
 #include "ModelFlags.hpp"
 #include "ModelManager.hpp"
 #include "Profiler/SimpleProfiler.hpp"
+#include "Profiler/SimpleProfilerGpu.hpp"
 #include "Profiler/SimpleProfilerImGui.hpp"
 #include "TextureManager.hpp"
 #include "Time.hpp"
@@ -21,38 +29,187 @@
 #include "VulkanDevice.hpp"
 #include "VulkanGlTFTypes.hpp"
 #include "VulkanInitializers.hpp"
+#include "VulkanStagingRing.hpp"
 #include "VulkanTools.hpp"
 #include "VulkanTypes.hpp"
 #include "Window.hpp"
 
 #include <algorithm>
 #include <array>
+#include <bit>
 #include <chrono>
 #include <cstddef>
 #include <cstring>
 #include <filesystem>
 #include <format>
+#include <fstream>
 #include <imgui.h>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <numeric>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <vector>
 #include <vulkan/vulkan_core.h>
 
+namespace VulkanRendererLocal
+{
+	static constexpr float gInstanceBoundingRadius = 1.0f; // Radius the cull shader tests the instances with
+	static constexpr Core::uint32 gVisibleInstanceCopyBatchSize = 4096;
+
+	// Box around the box aMin, aMax once aMatrix has been applied to it
+	static void TransformBox(const Math::Matrix4f& aMatrix, Math::Vector3f& aMin, Math::Vector3f& aMax)
+	{
+		const Math::Vector3f center = Math::Vector3f(aMatrix * Math::Vector4f((aMin + aMax) * 0.5f, 1.0f));
+		const Math::Vector3f extent = (aMax - aMin) * 0.5f;
+
+		// Every axis of the box reaches along the axes of the result as far as the absolute matrix elements scale it
+		const Math::Vector3f transformedExtent = Math::Abs(Math::Vector3f(aMatrix[0])) * extent.x + Math::Abs(Math::Vector3f(aMatrix[1])) * extent.y + Math::Abs(Math::Vector3f(aMatrix[2])) * extent.z;
+		aMin = center - transformedExtent;
+		aMax = center + transformedExtent;
+	}
+
+	// Numbers the primitives of every node and counts the primitives below it, returns the count of aNode
+	static Core::uint32 IndexModelParts(ModelPartCulling& aParts, const vkglTF::Node* aNode, Core::uint32& aPrimitiveCount)
+	{
+		Core::uint32 subtreePrimitiveCount = aNode->mMesh ? static_cast<Core::uint32>(aNode->mMesh->mPrimitives.size()) : 0;
+		aParts.mFirstPrimitives[aNode->mIndex] = aPrimitiveCount;
+		aPrimitiveCount += subtreePrimitiveCount;
+
+		for (const vkglTF::Node* child : aNode->mChildren)
+		{
+			subtreePrimitiveCount += IndexModelParts(aParts, child, aPrimitiveCount);
+		}
+
+		aParts.mSubtreePrimitiveCounts[aNode->mIndex] = subtreePrimitiveCount;
+		return subtreePrimitiveCount;
+	}
+
+	// Sets the boxes of the primitives of aNode and of the subtree below it, and grows aMin, aMax around the subtree
+	static void SetNodeBounds(ModelPartCulling& aParts, const vkglTF::NodeHierarchy& aHierarchy, const vkglTF::Node* aNode, const Math::Matrix4f& aModelMatrix, Math::Vector3f& aMin, Math::Vector3f& aMax)
+	{
+		const Math::Matrix4f matrix = aModelMatrix * aHierarchy.GetWorldMatrix(aNode->mHierarchyIndex);
+
+		Math::Vector3f subtreeMin{std::numeric_limits<float>::max()};
+		Math::Vector3f subtreeMax{std::numeric_limits<float>::lowest()};
+		if (aNode->mMesh)
+		{
+			const Core::uint32 firstPrimitive = aParts.mFirstPrimitives[aNode->mIndex];
+			for (Core::size i = 0; i < aNode->mMesh->mPrimitives.size(); i++)
+			{
+				const vkglTF::Dimensions& dimensions = aNode->mMesh->mPrimitives[i]->mDimensions;
+				Math::Vector3f min = dimensions.mMin;
+				Math::Vector3f max = dimensions.mMax;
+				TransformBox(matrix, min, max);
+				aParts.mPrimitiveBounds.SetBox(firstPrimitive + static_cast<Core::uint32>(i), min, max);
+
+				subtreeMin = Math::Min(subtreeMin, min);
+				subtreeMax = Math::Max(subtreeMax, max);
+			}
+		}
+
+		for (const vkglTF::Node* child : aNode->mChildren)
+		{
+			SetNodeBounds(aParts, aHierarchy, child, aModelMatrix, subtreeMin, subtreeMax);
+		}
+
+		if (aParts.mSubtreePrimitiveCounts[aNode->mIndex] != 0)
+		{
+			aParts.mNodeBounds.SetBox(aNode->mIndex, subtreeMin, subtreeMax);
+			aMin = Math::Min(aMin, subtreeMin);
+			aMax = Math::Max(aMax, subtreeMax);
+		}
+	}
+
+	// World space boxes of a model, of its primitives and of its subtrees, the model stays never visible while it is still loading
+	static void SetModelBounds(CpuCullingContext& aCulling, CpuCullingContext::Model aModel, const vkglTF::Model* aGltfModel, const Math::Matrix4f& aModelMatrix)
+	{
+		if (!aGltfModel)
+		{
+			return;
+		}
+
+		ModelPartCulling& parts = aCulling.mModelParts[static_cast<Core::size>(aModel)];
+		if (parts.mModel != aGltfModel)
+		{
+			Core::uint32 nodeCount = 0;
+			for (const vkglTF::Node* node : aGltfModel->linearNodes)
+			{
+				nodeCount = std::max(nodeCount, node->mIndex + 1);
+			}
+
+			parts.mModel = aGltfModel;
+			parts.mFirstPrimitives.assign(nodeCount, 0);
+			parts.mSubtreePrimitiveCounts.assign(nodeCount, 0);
+
+			Core::uint32 primitiveCount = 0;
+			for (const vkglTF::Node* node : aGltfModel->nodes)
+			{
+				IndexModelParts(parts, node, primitiveCount);
+			}
+
+			// Shrinking to nothing first clears the boxes of the previous model
+			parts.mNodeBounds.Resize(0);
+			parts.mNodeBounds.Resize(nodeCount);
+			parts.mPrimitiveBounds.Resize(0);
+			parts.mPrimitiveBounds.Resize(primitiveCount);
+		}
+
+		// The vertices have been moved out of their nodes and flipped along Y when the model was loaded, the vertex shader applies the model matrix
+		const Math::Matrix4f matrix = Math::Scale(aModelMatrix, Math::Vector3f{1.0f, -1.0f, 1.0f});
+		Math::Vector3f min{std::numeric_limits<float>::max()};
+		Math::Vector3f max{std::numeric_limits<float>::lowest()};
+		for (const vkglTF::Node* node : aGltfModel->nodes)
+		{
+			SetNodeBounds(parts, aGltfModel->mHierarchy, node, matrix, min, max);
+		}
+
+		if (min.x <= max.x)
+		{
+			aCulling.mModelBounds.SetBox(static_cast<Core::uint32>(aModel), min, max);
+		}
+	}
+
+	// The culled subtrees are only counted where their parent is visible, the subtrees below them are skipped together with them
+	static void CullModelParts(ModelPartCulling& aParts, const ViewFrustum& aFrustum, const Math::Vector3f& aViewPosition, FrustumCulling::Kernel aKernel)
+	{
+		FrustumCulling::Cull(aFrustum, aViewPosition, {}, aParts.mNodeBounds, aParts.mNodeDrawList, aKernel);
+		FrustumCulling::Cull(aFrustum, aViewPosition, {}, aParts.mPrimitiveBounds, aParts.mPrimitiveDrawList, aKernel);
+
+		aParts.mCulledSubtreeCount = 0;
+		for (const vkglTF::Node* node : aParts.mModel->linearNodes)
+		{
+			if (aParts.mSubtreePrimitiveCounts[node->mIndex] != 0 && !aParts.IsNodeVisible(node->mIndex) && (!node->mParent || aParts.IsNodeVisible(node->mParent->mIndex)))
+			{
+				aParts.mCulledSubtreeCount++;
+			}
+		}
+	}
+}
+
 VulkanRenderer::VulkanRenderer(const std::shared_ptr<EngineProperties>& aEngineProperties,
-	const std::shared_ptr<Window>& aWindow)
+	const std::shared_ptr<Window>& aWindow,
+	const std::shared_ptr<ECS::Scene>& aScene,
+	const std::shared_ptr<JobSystem>& aJobSystem)
 	: mEngineProperties{aEngineProperties}
 	, mWindow{aWindow}
+	, mScene{aScene}
+	, mJobSystem{aJobSystem}
 	, mFramebufferWidth{0}
 	, mFramebufferHeight{0}
 	, mFrametime{1.0f}
+	, mEngineFrametime{0.0f}
 	, mVulkanDevice{nullptr}
 	, mImGuiOverlay{nullptr}
 	, mCamera{nullptr}
+	, mCameraPath{nullptr}
 	, mFrameTimer{nullptr}
 	, mTextureManager{nullptr}
 	, mModelManager{nullptr}
+	, mAnimationSystem{nullptr}
+	, mStagingRing{nullptr}
 	, mFrameCounter{0}
 	, mAverageFPS{0}
 	, mFPSTimerInterval{1000.0f}
@@ -64,6 +221,11 @@ VulkanRenderer::VulkanRenderer(const std::shared_ptr<EngineProperties>& aEngineP
 	, mCurrentImageIndex{0}
 	, mCurrentBufferIndex{0}
 	, mIndirectDrawCount{0}
+	, mSecondaryCommandBufferCount{0}
+	, mInstanceCapacity{0}
+	, mCameraPathFrame{0}
+	, mUploadTimelineValue{0}
+	, mPhysicalDevice12Features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES}
 	, mPhysicalDevice13Features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES}
 	, mVoyagerModelMatrix{1.0f}
 	, mPlanetModelMatrix{1.0f}
@@ -73,6 +235,8 @@ VulkanRenderer::VulkanRenderer(const std::shared_ptr<EngineProperties>& aEngineP
 	, mShouldShowProfiler{false}
 	, mShouldShowModelInspector{false}
 	, mShouldFreezeFrustum{false}
+	, mIsRecordingInParallel{true}
+	, mIsBenchmarkFinished{false}
 #ifdef _DEBUG
 	, mShouldDrawWireframe{false}
 #endif
@@ -80,7 +244,8 @@ VulkanRenderer::VulkanRenderer(const std::shared_ptr<EngineProperties>& aEngineP
 	mFrameTimer = std::make_unique<Time::Timer>();
 
 	mTextureManager = std::make_shared<TextureManager>();
-	mModelManager = std::make_unique<ModelManager>(mTextureManager);
+	mModelManager = std::make_unique<ModelManager>(mTextureManager, aJobSystem);
+	mAnimationSystem = std::make_unique<AnimationSystem>();
 	
 	mEngineProperties.lock()->mAPIVersion = VK_API_VERSION_1_4;
 	mEngineProperties.lock()->mIsValidationEnabled = true;
@@ -89,7 +254,11 @@ VulkanRenderer::VulkanRenderer(const std::shared_ptr<EngineProperties>& aEngineP
 	mFramebufferWidth = mWindow.lock()->GetWindowProperties().mWindowWidth;
 	mFramebufferHeight = mWindow.lock()->GetWindowProperties().mWindowHeight;
 
+	mPhysicalDevice12Features.timelineSemaphore = VK_TRUE;
+	mPhysicalDevice12Features.hostQueryReset = VK_TRUE;
 	mPhysicalDevice13Features.dynamicRendering = VK_TRUE;
+	mPhysicalDevice13Features.synchronization2 = VK_TRUE;
+	mPhysicalDevice13Features.pNext = &mPhysicalDevice12Features;
 
 	mImGuiOverlay = std::make_unique<ImGuiOverlay>();
 
@@ -110,6 +279,8 @@ VulkanRenderer::~VulkanRenderer()
 
 	if (mVulkanDevice->mLogicalVkDevice != VK_NULL_HANDLE)
 	{
+		mStagingRing.reset();
+
 		if (mDescriptorPool != VK_NULL_HANDLE)
 			vkDestroyDescriptorPool(mVulkanDevice->mLogicalVkDevice, mDescriptorPool, nullptr);
 
@@ -119,8 +290,9 @@ VulkanRenderer::~VulkanRenderer()
 			vkDestroyShaderModule(mVulkanDevice->mLogicalVkDevice, shaderModule, nullptr);
 
 		vkDestroyImageView(mVulkanDevice->mLogicalVkDevice, mDepthStencil.mVkImageView, nullptr);
+		vkDestroyImageView(mVulkanDevice->mLogicalVkDevice, mDepthStencil.mDepthVkImageView, nullptr);
 		vkDestroyImage(mVulkanDevice->mLogicalVkDevice, mDepthStencil.mVkImage, nullptr);
-		vkFreeMemory(mVulkanDevice->mLogicalVkDevice, mDepthStencil.mVkDeviceMemory, nullptr);
+		mVulkanDevice->mMemoryAllocator->Free(mDepthStencil.mAllocation);
 
 		vkDestroyPipelineCache(mVulkanDevice->mLogicalVkDevice, mPipelineCache, nullptr);
 
@@ -137,16 +309,59 @@ VulkanRenderer::~VulkanRenderer()
 		vkDestroyDescriptorSetLayout(mVulkanDevice->mLogicalVkDevice, mGraphicsContext.mDescriptorSetLayout, nullptr);
 		vkDestroyCommandPool(mVulkanDevice->mLogicalVkDevice, mGraphicsContext.mCommandPool, nullptr);
 
+		for (std::vector<SecondaryCommandPool>& secondaryCommandPools : mGraphicsContext.mSecondaryCommandPools)
+		{
+			for (SecondaryCommandPool& secondaryCommandPool : secondaryCommandPools)
+				vkDestroyCommandPool(mVulkanDevice->mLogicalVkDevice, secondaryCommandPool.mCommandPool, nullptr);
+		}
+
 		mInstanceBuffer.Destroy();
 
+		for (Buffer& buffer : mInstanceUploadBuffers)
+			buffer.Destroy();
+
 		for (Buffer& buffer : mIndirectDrawCountBuffers)
 			buffer.Destroy();
 
 		for (Buffer& buffer : mIndirectCommandsBuffers)
 			buffer.Destroy();
 
+		for (Buffer& buffer : mInstanceVisibilityBuffers)
+			buffer.Destroy();
+
+		for (Buffer& buffer : mVisibleInstanceBuffers)
+			buffer.Destroy();
+
+		for (Buffer& buffer : mCpuCulling.mVisibleInstanceBuffers)
+			buffer.Destroy();
+
 		mComputeContext.mLoDBuffers.Destroy();
 
+		for (Buffer& buffer : mFrameDump.mReadbackBuffers)
+			buffer.Destroy();
+
+		for (Buffer& buffer : mMeshletCulling.mDrawCommandBuffers)
+			buffer.Destroy();
+
+		for (Buffer& buffer : mMeshletCulling.mDrawCountBuffers)
+			buffer.Destroy();
+
+		vkDestroyPipeline(mVulkanDevice->mLogicalVkDevice, mMeshletCulling.mPipeline, nullptr);
+		vkDestroyPipelineLayout(mVulkanDevice->mLogicalVkDevice, mMeshletCulling.mPipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(mVulkanDevice->mLogicalVkDevice, mMeshletCulling.mDescriptorSetLayout, nullptr);
+		vkDestroyDescriptorPool(mVulkanDevice->mLogicalVkDevice, mMeshletCulling.mDescriptorPool, nullptr);
+
+		DestroyDepthPyramid();
+
+		for (Buffer& buffer : mOcclusionCulling.mLateDrawCountBuffers)
+			buffer.Destroy();
+
+		vkDestroySampler(mVulkanDevice->mLogicalVkDevice, mOcclusionCulling.mDepthPyramidSampler, nullptr);
+		vkDestroyPipeline(mVulkanDevice->mLogicalVkDevice, mOcclusionCulling.mPipeline, nullptr);
+		vkDestroyPipelineLayout(mVulkanDevice->mLogicalVkDevice, mOcclusionCulling.mPipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(mVulkanDevice->mLogicalVkDevice, mOcclusionCulling.mDescriptorSetLayout, nullptr);
+		vkDestroyDescriptorPool(mVulkanDevice->mLogicalVkDevice, mOcclusionCulling.mDescriptorPool, nullptr);
+
 		vkDestroyPipelineLayout(mVulkanDevice->mLogicalVkDevice, mComputeContext.mPipelineLayout, nullptr);
 		vkDestroyDescriptorSetLayout(mVulkanDevice->mLogicalVkDevice, mComputeContext.mDescriptorSetLayout, nullptr);
 		vkDestroyPipeline(mVulkanDevice->mLogicalVkDevice, mComputeContext.mPipeline, nullptr);
@@ -170,10 +385,14 @@ VulkanRenderer::~VulkanRenderer()
 		for (Core::uint32 i = 0; i < gMaxConcurrentFrames; i++)
 		{
 			vkDestroyFence(mVulkanDevice->mLogicalVkDevice, mGraphicsContext.mFences[i], nullptr);
-			vkDestroyBuffer(mVulkanDevice->mLogicalVkDevice, mVulkanUniformBuffers[i].mVkBuffer, nullptr);
-			vkFreeMemory(mVulkanDevice->mLogicalVkDevice, mVulkanUniformBuffers[i].mVkDeviceMemory, nullptr);
+			mVulkanUniformBuffers[i].Destroy();
 		}
 
+		SimpleProfiler::DestroyGpu(mVulkanDevice->mLogicalVkDevice);
+
+		if (mFrameStatistics.mQueryPool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(mVulkanDevice->mLogicalVkDevice, mFrameStatistics.mQueryPool, nullptr);
+
 		mTextures.mPlanetTexture.Destroy();
 	}
 
@@ -192,6 +411,12 @@ VulkanRenderer::~VulkanRenderer()
 
 void VulkanRenderer::InitializeRenderer()
 {
+	// The size may have been changed from the command line since the renderer was created
+	mFramebufferWidth = mWindow.lock()->GetWindowProperties().mWindowWidth;
+	mFramebufferHeight = mWindow.lock()->GetWindowProperties().mWindowHeight;
+	mCamera->UpdateAspectRatio(static_cast<float>(mFramebufferWidth) / static_cast<float>(mFramebufferHeight));
+	mCpuCulling.mIsCullingInstances = mEngineProperties.lock()->mIsCpuCullingEnabled;
+
 	InitializeVulkan();
 	PrepareVulkanResources();
 }
@@ -206,22 +431,47 @@ void VulkanRenderer::EndUpdate()
 	if (mVulkanDevice->mLogicalVkDevice != VK_NULL_HANDLE)
 	{
 		vkDeviceWaitIdle(mVulkanDevice->mLogicalVkDevice);
+
+		// The last frames are still in the readback buffers and query slots, the oldest one is at the current buffer index
+		for (Core::uint32 i = 0; i < gMaxConcurrentFrames; i++)
+		{
+			WriteFrameDump((mCurrentBufferIndex + i) % gMaxConcurrentFrames);
+			CollectFrameStatistics((mCurrentBufferIndex + i) % gMaxConcurrentFrames);
+		}
+	}
+}
+
+void VulkanRenderer::ExtractScene(float aInterpolationFactor)
+{
+	SIMPLE_PROFILER_PROFILE_SCOPE("VulkanRenderer::ExtractScene");
+
+	if (!mWindow.lock()->GetWindowProperties().mIsMinimized && mEngineProperties.lock()->mIsRendererPrepared)
+	{
+		mInstanceRegistry->Update(aInterpolationFactor);
 	}
 }
 
-void VulkanRenderer::UpdateRenderer(float /*aDeltaTime*/)
+void VulkanRenderer::UpdateRenderer(float aDeltaTime)
 {
 	SIMPLE_PROFILER_PROFILE_SCOPE("VulkanRenderer::UpdateRenderer");
 
+	mEngineFrametime = aDeltaTime;
+
 	if (!mWindow.lock()->GetWindowProperties().mIsMinimized)
 	{
 		if (mEngineProperties.lock()->mIsRendererPrepared)
 		{
+			if (mCameraPath)
+			{
+				UpdateCameraPath();
+			}
+
 			RenderFrame();
 		}
 
+		// The camera path owns the camera, input would make the frames of a benchmark differ from run to run
 		Input::InputManager& inputManager = Input::InputManager::GetInstance();
-		if (!mImGuiOverlay->WantsToCaptureInput())
+		if (!mImGuiOverlay->WantsToCaptureInput() && !mCameraPath)
 		{
 			mCamera->mKeys.mIsRightDown = inputManager.IsKeyDown(Input::Key::Right) || inputManager.IsKeyDown(Input::Key::D);
 			mCamera->mKeys.mIsUpDown = inputManager.IsKeyDown(Input::Key::Up) || inputManager.IsKeyDown(Input::Key::W);
@@ -260,19 +510,80 @@ void VulkanRenderer::UpdateRenderer(float /*aDeltaTime*/)
 	mWindow.lock()->UpdateWindow();
 }
 
+void VulkanRenderer::StartBenchmark(std::unique_ptr<CameraPath> aCameraPath)
+{
+	mCameraPath = std::move(aCameraPath);
+	mCameraPathFrame = 0;
+	mIsBenchmarkFinished = false;
+	mFrameStatistics.mFrames.clear();
+	mFrameStatistics.mFrameCount = 0;
+}
+
+std::string VulkanRenderer::GetDeviceName() const
+{
+	return mVulkanDevice->mPhysicalDeviceProperties.deviceName;
+}
+
+void VulkanRenderer::UpdateCameraPath()
+{
+	// Playback waits for the streamed models, so every run renders the same frames
+	if (mIsBenchmarkFinished || mModelManager->GetPendingLoadCount() > 0)
+	{
+		return;
+	}
+
+	// The path advances by one simulation tick per frame, however long the frame took
+	const float time = static_cast<float>(mCameraPathFrame) / mEngineProperties.lock()->mFixedTickRate;
+	if (time > mCameraPath->GetDuration())
+	{
+		mFrameStatistics.mIsEnabled = false;
+		mIsBenchmarkFinished = true;
+		return;
+	}
+
+	Math::Vector3f position;
+	Math::Vector3f rotation;
+	mCameraPath->Sample(time, position, rotation);
+	mCamera->SetPosition(position);
+	mCamera->SetRotation(rotation);
+
+	mFrameStatistics.mIsEnabled = true;
+	mCameraPathFrame++;
+}
+
 void VulkanRenderer::LoadAssets()
 {
-	mTextureManager->SetContext(mVulkanDevice, mGraphicsContext.mQueue);
+	mTextureManager->SetContext(mVulkanDevice, mStagingRing.get());
+	mModelManager->CreateBindlessResources(mVulkanDevice);
 
 	const FileLoadingFlags glTFLoadingFlags = FileLoadingFlags::PreTransformVertices | FileLoadingFlags::PreMultiplyVertexColors | FileLoadingFlags::FlipY;
-	const std::filesystem::path voyagerModelPath = "Voyager.gltf";
-	mModelIdentifiers.mVoyagerModelIdentifier = mModelManager->LoadModel(FileLoader::GetEngineResourcesPath() / FileLoader::gModelsPath / voyagerModelPath, mVulkanDevice, mGraphicsContext.mQueue, glTFLoadingFlags, 1.0f);
 
-	const std::filesystem::path suzanneModelPath = "Suzanne_lods.gltf";
-	mModelIdentifiers.mSuzanneModelIdentifier = mModelManager->LoadModel(FileLoader::GetEngineResourcesPath() / FileLoader::gModelsPath / suzanneModelPath, mVulkanDevice, mGraphicsContext.mQueue, glTFLoadingFlags, 1.0f);
+	mVertexLayouts.mVoyager = vkglTF::VertexLayout{{vkglTF::VertexComponent::Position, vkglTF::VertexComponent::Normal, vkglTF::VertexComponent::UV}, true};
+	mVertexLayouts.mPlanet = vkglTF::VertexLayout{{vkglTF::VertexComponent::Position, vkglTF::VertexComponent::Normal, vkglTF::VertexComponent::UV, vkglTF::VertexComponent::Color}, true};
+	mVertexLayouts.mSuzanne = vkglTF::VertexLayout{{vkglTF::VertexComponent::Position, vkglTF::VertexComponent::Normal, vkglTF::VertexComponent::Color}, true};
+
+	// "Default" is the whole scene, "Instances" leaves out the static models to look at the instance culling and LOD selection on their own
+	const std::string& sceneName = mEngineProperties.lock()->mSceneName;
+	const bool isInstancesScene = (sceneName == "Instances");
+	if (!isInstancesScene && sceneName != "Default")
+	{
+		throw std::runtime_error(std::format("Unknown scene {}", sceneName));
+	}
+
+	// Static models stream in while the first frames render, they are skipped until ModelManager::ProcessPendingLoads publishes them
+	// The Voyager is the largest mesh in the scene, it is split into meshlets that are culled on the GPU
+	if (!isInstancesScene)
+	{
+		const std::filesystem::path voyagerModelPath = "Voyager.gltf";
+		mModelIdentifiers.mVoyagerModelIdentifier = mModelManager->LoadModelAsync(FileLoader::GetEngineResourcesPath() / FileLoader::gModelsPath / voyagerModelPath, mVulkanDevice, mStagingRing.get(), glTFLoadingFlags | FileLoadingFlags::BuildMeshlets, 1.0f, mVertexLayouts.mVoyager);
 
-	const std::filesystem::path planetModelPath = "Lavaplanet.gltf";
-	mModelIdentifiers.mPlanetModelIdentifier = mModelManager->LoadModel(FileLoader::GetEngineResourcesPath() / FileLoader::gModelsPath / planetModelPath, mVulkanDevice, mGraphicsContext.mQueue, glTFLoadingFlags, 1.0f);
+		const std::filesystem::path planetModelPath = "Lavaplanet.gltf";
+		mModelIdentifiers.mPlanetModelIdentifier = mModelManager->LoadModelAsync(FileLoader::GetEngineResourcesPath() / FileLoader::gModelsPath / planetModelPath, mVulkanDevice, mStagingRing.get(), glTFLoadingFlags, 1.0f, mVertexLayouts.mPlanet);
+	}
+
+	// The indirect draw and cull setup depends on the LOD nodes of this model, so it has to be loaded before the renderer is prepared
+	const std::filesystem::path suzanneModelPath = "Suzanne_lods.gltf";
+	mModelIdentifiers.mSuzanneModelIdentifier = mModelManager->LoadModel(FileLoader::GetEngineResourcesPath() / FileLoader::gModelsPath / suzanneModelPath, mVulkanDevice, mStagingRing.get(), glTFLoadingFlags, 1.0f, mVertexLayouts.mSuzanne);
 
 	const std::filesystem::path planetTexturePath = "Lavaplanet_rgba.ktx";
 	mTextures.mPlanetTexture = mTextureManager->CreateTexture(FileLoader::GetEngineResourcesPath() / FileLoader::gTexturesPath / planetTexturePath);
@@ -302,6 +613,40 @@ void VulkanRenderer::CreateSynchronizationPrimitives()
 	}
 }
 
+void VulkanRenderer::CreateGpuProfiler()
+{
+	// GPU scopes are recorded into the command buffers of both queues, so both have to support timestamps
+	const Core::uint32 graphicsTimestampBits = mVulkanDevice->mQueueFamilyProperties[mVulkanDevice->mQueueFamilyIndices.mGraphics].timestampValidBits;
+	const Core::uint32 computeTimestampBits = mVulkanDevice->mQueueFamilyProperties[mVulkanDevice->mQueueFamilyIndices.mCompute].timestampValidBits;
+	SimpleProfiler::InitializeGpu(mVulkanDevice->mLogicalVkDevice, mVulkanDevice->mPhysicalDeviceProperties.limits, std::min(graphicsTimestampBits, computeTimestampBits), gMaxConcurrentFrames);
+}
+
+void VulkanRenderer::CreateFrameStatisticsQueries()
+{
+	// Unlike the GPU profiler these timestamps exist in every configuration, benchmarks are meant to run in release builds
+	// Frames are timed on both queues, so GPU times are left out when one of them can't write timestamps
+	const Core::uint32 graphicsTimestampBits = mVulkanDevice->mQueueFamilyProperties[mVulkanDevice->mQueueFamilyIndices.mGraphics].timestampValidBits;
+	const Core::uint32 computeTimestampBits = mVulkanDevice->mQueueFamilyProperties[mVulkanDevice->mQueueFamilyIndices.mCompute].timestampValidBits;
+	const Core::uint32 timestampBits = std::min(graphicsTimestampBits, computeTimestampBits);
+
+	mFrameStatistics.mIsTimestampSupported = timestampBits > 0 && mVulkanDevice->mPhysicalDeviceProperties.limits.timestampPeriod > 0.0f;
+	if (!mFrameStatistics.mIsTimestampSupported)
+	{
+		return;
+	}
+
+	mFrameStatistics.mTimestampPeriodNs = static_cast<double>(mVulkanDevice->mPhysicalDeviceProperties.limits.timestampPeriod);
+	mFrameStatistics.mTimestampMask = timestampBits >= 64 ? Core::uint64_max : ((1ull << timestampBits) - 1);
+
+	const VkQueryPoolCreateInfo queryPoolCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		.queryType = VK_QUERY_TYPE_TIMESTAMP,
+		.queryCount = gMaxConcurrentFrames * FrameStatisticsContext::gQueriesPerFrame
+	};
+	VK_CHECK_RESULT(vkCreateQueryPool(mVulkanDevice->mLogicalVkDevice, &queryPoolCreateInfo, nullptr, &mFrameStatistics.mQueryPool));
+	vkResetQueryPool(mVulkanDevice->mLogicalVkDevice, mFrameStatistics.mQueryPool, 0, queryPoolCreateInfo.queryCount);
+}
+
 // Command buffers are used to record commands to and are submitted to a queue for execution ("rendering")
 void VulkanRenderer::CreateGraphicsCommandBuffers()
 {
@@ -310,15 +655,48 @@ void VulkanRenderer::CreateGraphicsCommandBuffers()
 	VK_CHECK_RESULT(vkAllocateCommandBuffers(mVulkanDevice->mLogicalVkDevice, &commandBufferAllocateInfo, mGraphicsContext.mCommandBuffers.data()));
 }
 
+void VulkanRenderer::CreateSecondaryCommandPools()
+{
+	// Each thread records into its own pool, so no pool is ever accessed by two threads
+	// The pools are reset as a whole, so their command buffers don't need to be resettable one by one
+	const VkCommandPoolCreateInfo commandPoolCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+		.queueFamilyIndex = mVulkanSwapChain.mQueueNodeIndex,
+	};
+
+	const Core::uint32 threadCount = mJobSystem.lock()->GetThreadCount();
+	for (std::vector<SecondaryCommandPool>& secondaryCommandPools : mGraphicsContext.mSecondaryCommandPools)
+	{
+		secondaryCommandPools.resize(threadCount);
+		for (SecondaryCommandPool& secondaryCommandPool : secondaryCommandPools)
+		{
+			VK_CHECK_RESULT(vkCreateCommandPool(mVulkanDevice->mLogicalVkDevice, &commandPoolCreateInfo, nullptr, &secondaryCommandPool.mCommandPool));
+		}
+	}
+}
+
+void VulkanRenderer::ResetSecondaryCommandPools()
+{
+	for (SecondaryCommandPool& secondaryCommandPool : mGraphicsContext.mSecondaryCommandPools[mCurrentBufferIndex])
+	{
+		if (secondaryCommandPool.mUsedCommandBufferCount > 0)
+		{
+			VK_CHECK_RESULT(vkResetCommandPool(mVulkanDevice->mLogicalVkDevice, secondaryCommandPool.mCommandPool, 0));
+			secondaryCommandPool.mUsedCommandBufferCount = 0;
+		}
+	}
+}
+
 void VulkanRenderer::CreateDescriptorPool()
 {
 	static constexpr Core::uint32 poolPadding = 2;
 	const std::vector<VkDescriptorPoolSize> poolSizes = {
-		VulkanInitializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, (gMaxConcurrentFrames * 3) + poolPadding),
-		VulkanInitializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, (gMaxConcurrentFrames * 2) + poolPadding),
-		VulkanInitializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, (gMaxConcurrentFrames * 4) + poolPadding)
+		VulkanInitializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, (gMaxConcurrentFrames * 5) + poolPadding),
+		VulkanInitializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, (gMaxConcurrentFrames * 3) + poolPadding),
+		VulkanInitializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, (gMaxConcurrentFrames * 12) + poolPadding)
 	};
-	const VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = VulkanInitializers::DescriptorPoolCreateInfo(poolSizes, gMaxConcurrentFrames * 4);
+	const VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = VulkanInitializers::DescriptorPoolCreateInfo(poolSizes, gMaxConcurrentFrames * 5);
 	VK_CHECK_RESULT(vkCreateDescriptorPool(mVulkanDevice->mLogicalVkDevice, &descriptorPoolCreateInfo, nullptr, &mDescriptorPool));
 }
 
@@ -380,22 +758,13 @@ void VulkanRenderer::SetupDepthStencil()
 		.arrayLayers = 1,
 		.samples = VK_SAMPLE_COUNT_1_BIT,
 		.tiling = VK_IMAGE_TILING_OPTIMAL,
-		.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+		.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | (mOcclusionCulling.mIsSupported ? VK_IMAGE_USAGE_SAMPLED_BIT : 0u),
 		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
 	};
 	VK_CHECK_RESULT(vkCreateImage(mVulkanDevice->mLogicalVkDevice, &imageCreateInfo, nullptr, &mDepthStencil.mVkImage));
 
 	// Allocate memory for the image (device local) and bind it to our image
-	VkMemoryRequirements memoryRequirements;
-	vkGetImageMemoryRequirements(mVulkanDevice->mLogicalVkDevice, mDepthStencil.mVkImage, &memoryRequirements);
-
-	const VkMemoryAllocateInfo memoryAllocateInfo{
-		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-		.allocationSize = memoryRequirements.size,
-		.memoryTypeIndex = mVulkanDevice->GetMemoryTypeIndex(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
-	};
-	VK_CHECK_RESULT(vkAllocateMemory(mVulkanDevice->mLogicalVkDevice, &memoryAllocateInfo, nullptr, &mDepthStencil.mVkDeviceMemory));
-	VK_CHECK_RESULT(vkBindImageMemory(mVulkanDevice->mLogicalVkDevice, mDepthStencil.mVkImage, mDepthStencil.mVkDeviceMemory, 0));
+	mDepthStencil.mAllocation = mVulkanDevice->AllocateImageMemory(mDepthStencil.mVkImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
 	// Create a view for the depth stencil image
 	// Images aren't directly accessed in Vulkan, but rather through views described by a subresource range
@@ -421,15 +790,22 @@ void VulkanRenderer::SetupDepthStencil()
 	}
 	
 	VK_CHECK_RESULT(vkCreateImageView(mVulkanDevice->mLogicalVkDevice, &imageViewCreateInfo, nullptr, &mDepthStencil.mVkImageView));
+
+	// Only a single aspect can be sampled, the depth pyramid reads the depth through its own view
+	if (mOcclusionCulling.mIsSupported)
+	{
+		imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+		VK_CHECK_RESULT(vkCreateImageView(mVulkanDevice->mLogicalVkDevice, &imageViewCreateInfo, nullptr, &mDepthStencil.mDepthVkImageView));
+	}
 }
 
 void VulkanRenderer::CreateGraphicsPipelines()
 {
 	// Layout
-	// Uses set 0 for passing vertex shader ubo and set 1 for fragment shader images (taken from glTF model)
+	// Uses set 0 for passing vertex shader ubo and set 1 for the bindless textures and materials of all glTF models
 	const std::vector<VkDescriptorSetLayout> descriptorSetLayouts = {
 		mGraphicsContext.mDescriptorSetLayout,
-		mModelManager->GetDescriptorSetLayoutImage()
+		mModelManager->GetBindlessDescriptorSetLayout()
 	};
 	
 	const VkPushConstantRange pushConstantRange{
@@ -478,59 +854,21 @@ void VulkanRenderer::CreateGraphicsPipelines()
 	};
 	pipelineCI.pNext = &pipelineRenderingCreateInfo;
 	
-	// Vertex input bindings
-	const std::vector<VkVertexInputBindingDescription> bindingDescriptions = {
-		// Binding point 0: Mesh vertex layout description at per-vertex rate
-		VulkanInitializers::VertexInputBindingDescription(0, sizeof(vkglTF::Vertex), VK_VERTEX_INPUT_RATE_VERTEX),
-		// Binding point 1: Instanced data at per-instance rate
-		VulkanInitializers::VertexInputBindingDescription(1, sizeof(InstanceData), VK_VERTEX_INPUT_RATE_INSTANCE),
-	};
-
-	const std::vector<VkVertexInputAttributeDescription> attributeDescriptions = {
-		// Per-vertex attributes
-		// These are advanced for each vertex fetched by the vertex shader
-		VulkanInitializers::VertexInputAttributeDescription(0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(vkglTF::Vertex, mPosition)), // Location 0: Position
-		VulkanInitializers::VertexInputAttributeDescription(0, 1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(vkglTF::Vertex, mNormal)), // Location 1: Normal
-		VulkanInitializers::VertexInputAttributeDescription(0, 2, VK_FORMAT_R32G32B32_SFLOAT, offsetof(vkglTF::Vertex, mColor)), // Location 3: Color
-		// Per-Instance attributes
-		// These are advanced for each instance rendered
-		VulkanInitializers::VertexInputAttributeDescription(1, 3, VK_FORMAT_R32G32B32_SFLOAT, offsetof(InstanceData, mPosition)), // Location 4: Position
-		VulkanInitializers::VertexInputAttributeDescription(1, 4, VK_FORMAT_R32G32B32_SFLOAT, offsetof(InstanceData, mScale)), // Location 5: Scale
-	};
-
-	const std::vector<VkVertexInputAttributeDescription> texturedAttributeDescriptions = {
-		// Per-vertex attributes
-		// These are advanced for each vertex fetched by the vertex shader
-		VulkanInitializers::VertexInputAttributeDescription(0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(vkglTF::Vertex, mPosition)), // Location 0: Position
-		VulkanInitializers::VertexInputAttributeDescription(0, 1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(vkglTF::Vertex, mNormal)), // Location 1: Normal
-		VulkanInitializers::VertexInputAttributeDescription(0, 2, VK_FORMAT_R32G32_SFLOAT, offsetof(vkglTF::Vertex, mUV)), // Location 2: Texture coordinates
-		VulkanInitializers::VertexInputAttributeDescription(0, 3, VK_FORMAT_R32G32B32_SFLOAT, offsetof(vkglTF::Vertex, mColor)), // Location 3: Color
-		// Per-Instance attributes
-		// These are advanced for each instance rendered
-		VulkanInitializers::VertexInputAttributeDescription(1, 4, VK_FORMAT_R32G32B32_SFLOAT, offsetof(InstanceData, mPosition)), // Location 4: Position
-		VulkanInitializers::VertexInputAttributeDescription(1, 5, VK_FORMAT_R32G32B32_SFLOAT, offsetof(InstanceData, mScale)), // Location 5: Scale
-	};
-
-	VkPipelineVertexInputStateCreateInfo inputState = VulkanInitializers::PipelineVertexInputStateCreateInfo();
-	inputState.pVertexBindingDescriptions = bindingDescriptions.data();
-	inputState.pVertexAttributeDescriptions = texturedAttributeDescriptions.data();
-
-	pipelineCI.pVertexInputState = &inputState;
+	// The mesh vertex input state follows the vertex layout of each model
+	pipelineCI.pVertexInputState = vkglTF::Vertex::getPipelineVertexInputState(mVertexLayouts.mVoyager);
 
 	const std::filesystem::path voyagerVertexShaderPath = "DynamicRendering/Texture_vert.spv";
 	const std::filesystem::path voyagerFragmentShaderPath = "DynamicRendering/Texture_frag.spv";
 	shaderStages[0] = LoadShader(FileLoader::GetEngineResourcesPath() / FileLoader::gShadersPath / voyagerVertexShaderPath, VK_SHADER_STAGE_VERTEX_BIT);
 	shaderStages[1] = LoadShader(FileLoader::GetEngineResourcesPath() / FileLoader::gShadersPath / voyagerFragmentShaderPath, VK_SHADER_STAGE_FRAGMENT_BIT);
-	inputState.vertexBindingDescriptionCount = 1;
-	inputState.vertexAttributeDescriptionCount = 3;
 	VK_CHECK_RESULT(vkCreateGraphicsPipelines(mVulkanDevice->mLogicalVkDevice, mPipelineCache, 1, &pipelineCI, nullptr, &mVkPipelines.mVoyager));
 
+	pipelineCI.pVertexInputState = vkglTF::Vertex::getPipelineVertexInputState(mVertexLayouts.mPlanet);
+
 	const std::filesystem::path planetVertexShaderPath = "Instancing/Planet_vert.spv";
 	const std::filesystem::path planetFragmentShaderPath = "Instancing/Planet_frag.spv";
 	shaderStages[0] = LoadShader(FileLoader::GetEngineResourcesPath() / FileLoader::gShadersPath / planetVertexShaderPath, VK_SHADER_STAGE_VERTEX_BIT);
 	shaderStages[1] = LoadShader(FileLoader::GetEngineResourcesPath() / FileLoader::gShadersPath / planetFragmentShaderPath, VK_SHADER_STAGE_FRAGMENT_BIT);
-	inputState.vertexBindingDescriptionCount = 1;
-	inputState.vertexAttributeDescriptionCount = 4;
 	VK_CHECK_RESULT(vkCreateGraphicsPipelines(mVulkanDevice->mLogicalVkDevice, mPipelineCache, 1, &pipelineCI, nullptr, &mVkPipelines.mPlanet));
 
 #ifdef _DEBUG
@@ -543,13 +881,35 @@ void VulkanRenderer::CreateGraphicsPipelines()
 	}
 #endif
 
+	// Vertex input bindings
+	const std::vector<VkVertexInputBindingDescription> bindingDescriptions = {
+		// Binding point 0: Mesh vertex layout description at per-vertex rate
+		vkglTF::Vertex::inputBindingDescription(0, mVertexLayouts.mSuzanne),
+		// Binding point 1: Instanced data at per-instance rate
+		VulkanInitializers::VertexInputBindingDescription(1, sizeof(InstanceData), VK_VERTEX_INPUT_RATE_INSTANCE),
+	};
+
+	// Per-vertex attributes
+	// These are advanced for each vertex fetched by the vertex shader
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions = vkglTF::Vertex::inputAttributeDescriptions(0, mVertexLayouts.mSuzanne); // Location 0-2: Position, normal and color
+	// Per-Instance attributes
+	// These are advanced for each instance rendered
+	const Core::uint32 instanceLocation = static_cast<Core::uint32>(attributeDescriptions.size());
+	attributeDescriptions.push_back(VulkanInitializers::VertexInputAttributeDescription(1, instanceLocation, VK_FORMAT_R32G32B32_SFLOAT, offsetof(InstanceData, mPosition))); // Location 3: Position
+	attributeDescriptions.push_back(VulkanInitializers::VertexInputAttributeDescription(1, instanceLocation + 1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(InstanceData, mScale))); // Location 4: Scale
+
+	VkPipelineVertexInputStateCreateInfo inputState = VulkanInitializers::PipelineVertexInputStateCreateInfo();
+	inputState.pVertexBindingDescriptions = bindingDescriptions.data();
+	inputState.vertexBindingDescriptionCount = static_cast<Core::uint32>(bindingDescriptions.size());
+	inputState.pVertexAttributeDescriptions = attributeDescriptions.data();
+	inputState.vertexAttributeDescriptionCount = static_cast<Core::uint32>(attributeDescriptions.size());
+
+	pipelineCI.pVertexInputState = &inputState;
+
 	const std::filesystem::path suzanneVertexShaderPath = "ComputeCull/Indirectdraw_vert.spv";
 	const std::filesystem::path suzanneFragmentShaderPath = "ComputeCull/Indirectdraw_frag.spv";
 	shaderStages[0] = LoadShader(FileLoader::GetEngineResourcesPath() / FileLoader::gShadersPath / suzanneVertexShaderPath, VK_SHADER_STAGE_VERTEX_BIT);
 	shaderStages[1] = LoadShader(FileLoader::GetEngineResourcesPath() / FileLoader::gShadersPath / suzanneFragmentShaderPath, VK_SHADER_STAGE_FRAGMENT_BIT);
-	inputState.pVertexAttributeDescriptions = attributeDescriptions.data();
-	inputState.vertexBindingDescriptionCount = static_cast<Core::uint32>(bindingDescriptions.size());
-	inputState.vertexAttributeDescriptionCount = static_cast<Core::uint32>(attributeDescriptions.size());
 	VK_CHECK_RESULT(vkCreateGraphicsPipelines(mVulkanDevice->mLogicalVkDevice, mPipelineCache, 1, &pipelineCI, nullptr, &mVkPipelines.mInstancedSuzanne));
 
 #ifdef _DEBUG
@@ -578,6 +938,12 @@ void VulkanRenderer::CreateComputeDescriptorSetLayout()
 		VulkanInitializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 3),
 		// Binding 4: LOD info (input)
 		VulkanInitializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 4),
+		// Binding 5: Depth pyramid (input)
+		VulkanInitializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 5),
+		// Binding 6: Instance visibility
+		VulkanInitializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 6),
+		// Binding 7: Visible instance data (output)
+		VulkanInitializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 7),
 	};
 
 	const VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = VulkanInitializers::DescriptorSetLayoutCreateInfo(setLayoutBindings);
@@ -586,7 +952,15 @@ void VulkanRenderer::CreateComputeDescriptorSetLayout()
 
 void VulkanRenderer::CreateComputeDescriptorSets()
 {
-	const VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = VulkanInitializers::PipelineLayoutCreateInfo(&mComputeContext.mDescriptorSetLayout, 1);
+	const VkPushConstantRange pushConstantRange{
+		.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		.offset = 0,
+		.size = sizeof(OcclusionCullingPushConstant)
+	};
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = VulkanInitializers::PipelineLayoutCreateInfo(&mComputeContext.mDescriptorSetLayout, 1);
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
 	VK_CHECK_RESULT(vkCreatePipelineLayout(mVulkanDevice->mLogicalVkDevice, &pipelineLayoutCreateInfo, nullptr, &mComputeContext.mPipelineLayout));
 
 	for (Core::size i = 0; i < mVulkanUniformBuffers.size(); i++)
@@ -603,9 +977,27 @@ void VulkanRenderer::CreateComputeDescriptorSets()
 			// Binding 3: Atomic counter (written in shader)
 			VulkanInitializers::WriteDescriptorSet(mComputeContext.mDescriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3, &mIndirectDrawCountBuffers[i].mVkDescriptorBufferInfo),
 			// Binding 4: LOD info
-			VulkanInitializers::WriteDescriptorSet(mComputeContext.mDescriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, &mComputeContext.mLoDBuffers.mVkDescriptorBufferInfo)
+			VulkanInitializers::WriteDescriptorSet(mComputeContext.mDescriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, &mComputeContext.mLoDBuffers.mVkDescriptorBufferInfo),
+			// Binding 6: Instance visibility
+			VulkanInitializers::WriteDescriptorSet(mComputeContext.mDescriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6, &mInstanceVisibilityBuffers[i].mVkDescriptorBufferInfo),
+			// Binding 7: Visible instance data
+			VulkanInitializers::WriteDescriptorSet(mComputeContext.mDescriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 7, &mVisibleInstanceBuffers[i].mVkDescriptorBufferInfo)
 		};
 		vkUpdateDescriptorSets(mVulkanDevice->mLogicalVkDevice, static_cast<Core::uint32>(computeWriteDescriptorSets.size()), computeWriteDescriptorSets.data(), 0, nullptr);
+
+		// The late occlusion pass rewrites the same indirect commands, but keeps its statistics apart since it runs on the graphics queue
+		// Binding 5 (depth pyramid) of both sets is written by CreateDepthPyramid
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(mVulkanDevice->mLogicalVkDevice, &allocInfo, &mOcclusionCulling.mLateDescriptorSets[i]));
+		const std::vector<VkWriteDescriptorSet> lateWriteDescriptorSets = {
+			VulkanInitializers::WriteDescriptorSet(mOcclusionCulling.mLateDescriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &mInstanceBuffer.mVkDescriptorBufferInfo),
+			VulkanInitializers::WriteDescriptorSet(mOcclusionCulling.mLateDescriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &mIndirectCommandsBuffers[i].mVkDescriptorBufferInfo),
+			VulkanInitializers::WriteDescriptorSet(mOcclusionCulling.mLateDescriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2, &mVulkanUniformBuffers[i].mVkDescriptorBufferInfo),
+			VulkanInitializers::WriteDescriptorSet(mOcclusionCulling.mLateDescriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3, &mOcclusionCulling.mLateDrawCountBuffers[i].mVkDescriptorBufferInfo),
+			VulkanInitializers::WriteDescriptorSet(mOcclusionCulling.mLateDescriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, &mComputeContext.mLoDBuffers.mVkDescriptorBufferInfo),
+			VulkanInitializers::WriteDescriptorSet(mOcclusionCulling.mLateDescriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6, &mInstanceVisibilityBuffers[i].mVkDescriptorBufferInfo),
+			VulkanInitializers::WriteDescriptorSet(mOcclusionCulling.mLateDescriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 7, &mVisibleInstanceBuffers[i].mVkDescriptorBufferInfo)
+		};
+		vkUpdateDescriptorSets(mVulkanDevice->mLogicalVkDevice, static_cast<Core::uint32>(lateWriteDescriptorSets.size()), lateWriteDescriptorSets.data(), 0, nullptr);
 	}
 }
 
@@ -673,70 +1065,690 @@ void VulkanRenderer::CreateComputePipelines()
 		.signalSemaphoreCount = 1,
 		.pSignalSemaphores = &mComputeContext.mSemaphores[gMaxConcurrentFrames - 1].mReadySemaphore
 	};
-	VK_CHECK_RESULT(vkQueueSubmit(mComputeContext.mQueue, 1, &computeSubmitInfo, VK_NULL_HANDLE));
+	mVulkanDevice->QueueSubmit(mComputeContext.mQueue, computeSubmitInfo, VK_NULL_HANDLE);
 }
 
-void VulkanRenderer::CreateUniformBuffers()
+void VulkanRenderer::CreateMeshletCullingPipeline()
 {
-	for (Buffer& buffer : mVulkanUniformBuffers)
-	{
-		VK_CHECK_RESULT(mVulkanDevice->CreateBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &buffer, sizeof(UniformBufferData), &mUniformBufferData));
-		VK_CHECK_RESULT(buffer.Map());
-	}
-}
+	// The shader is compiled by the build, a missing binary throws in LoadShader like every other shader
+	const std::filesystem::path meshletCullShaderPath = FileLoader::GetEngineResourcesPath() / FileLoader::gShadersPath / "MeshletCull/Meshletcull_comp.spv";
 
-void VulkanRenderer::CreateUIOverlay()
-{
-	const std::filesystem::path UIVertexShaderPath = "Core/UIOverlay_vert.spv";
-	const std::filesystem::path UIFragmentShaderPath = "Core/UIOverlay_frag.spv";
-	mImGuiOverlay->SetMaxConcurrentFrames(gMaxConcurrentFrames);
-	mImGuiOverlay->SetVulkanDevice(mVulkanDevice);
-	mImGuiOverlay->SetVkQueue(mGraphicsContext.mQueue);
-	mImGuiOverlay->SetScale(mWindow.lock()->GetContentScaleForMonitor());
-	mImGuiOverlay->AddShader(LoadShader(FileLoader::GetEngineResourcesPath() / FileLoader::gShadersPath / UIVertexShaderPath, VK_SHADER_STAGE_VERTEX_BIT));
-	mImGuiOverlay->AddShader(LoadShader(FileLoader::GetEngineResourcesPath() / FileLoader::gShadersPath / UIFragmentShaderPath, VK_SHADER_STAGE_FRAGMENT_BIT));
-	mImGuiOverlay->PrepareResources();
-	mImGuiOverlay->PreparePipeline(mPipelineCache, mVulkanSwapChain.mColorVkFormat, mVkDepthFormat);
-}
+	const std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
+		// Binding 0: Meshlet bounds (input)
+		VulkanInitializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+		// Binding 1: Indirect draw commands (output)
+		VulkanInitializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+		// Binding 2: Uniform buffer with the frustum planes (input)
+		VulkanInitializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2),
+		// Binding 3: Visible meshlets per primitive (output)
+		VulkanInitializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 3),
+	};
 
-void VulkanRenderer::PrepareVulkanResources()
-{
-	InitializeSwapchain();
-	CreateGraphicsCommandPool();
-	SetupSwapchain();
-	CreateGraphicsCommandBuffers();
-	CreateSynchronizationPrimitives();
-	SetupDepthStencil();
-	CreatePipelineCache();
+	const VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = VulkanInitializers::DescriptorSetLayoutCreateInfo(setLayoutBindings);
+	VK_CHECK_RESULT(vkCreateDescriptorSetLayout(mVulkanDevice->mLogicalVkDevice, &descriptorSetLayoutCreateInfo, nullptr, &mMeshletCulling.mDescriptorSetLayout));
 
-	CreateUIOverlay();
+	const std::vector<VkDescriptorPoolSize> poolSizes = {
+		VulkanInitializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, gMaxConcurrentFrames),
+		VulkanInitializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, gMaxConcurrentFrames * 3)
+	};
+	const VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = VulkanInitializers::DescriptorPoolCreateInfo(poolSizes, gMaxConcurrentFrames);
+	VK_CHECK_RESULT(vkCreateDescriptorPool(mVulkanDevice->mLogicalVkDevice, &descriptorPoolCreateInfo, nullptr, &mMeshletCulling.mDescriptorPool));
 
-	LoadAssets();
-	
-	PrepareIndirectData();
-	PrepareInstanceData();
-	CreateUniformBuffers();
-	CreateDescriptorPool();
-	CreateGraphicsDescriptorSetLayout();
-	CreateGraphicsDescriptorSets();
-	CreateGraphicsPipelines();
-	CreateComputeDescriptorSetLayout();
-	CreateComputeDescriptorSets();
+	const VkPushConstantRange pushConstantRange{
+		.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		.offset = 0,
+		.size = sizeof(MeshletCullingPushConstant)
+	};
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = VulkanInitializers::PipelineLayoutCreateInfo(&mMeshletCulling.mDescriptorSetLayout, 1);
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+	VK_CHECK_RESULT(vkCreatePipelineLayout(mVulkanDevice->mLogicalVkDevice, &pipelineLayoutCreateInfo, nullptr, &mMeshletCulling.mPipelineLayout));
+
+	// Without draw count support the shader keeps one draw per meshlet and zeroes the instance count of culled ones
+	mMeshletCulling.mIsCompactingDraws = mPhysicalDevice12Features.drawIndirectCount == VK_TRUE;
+
+	const VkSpecializationMapEntry specializationEntry =
+	{
+		.constantID = 0,
+		.offset = 0,
+		.size = sizeof(VkBool32)
+	};
+
+	const VkBool32 specializationData = mMeshletCulling.mIsCompactingDraws ? VK_TRUE : VK_FALSE;
+
+	const VkSpecializationInfo specializationInfo =
+	{
+		.mapEntryCount = 1,
+		.pMapEntries = &specializationEntry,
+		.dataSize = sizeof(specializationData),
+		.pData = &specializationData
+	};
+
+	VkComputePipelineCreateInfo computePipelineCreateInfo = VulkanInitializers::ComputePipelineCreateInfo(mMeshletCulling.mPipelineLayout, 0);
+	computePipelineCreateInfo.stage = LoadShader(meshletCullShaderPath, VK_SHADER_STAGE_COMPUTE_BIT);
+	computePipelineCreateInfo.stage.pSpecializationInfo = &specializationInfo;
+	VK_CHECK_RESULT(vkCreateComputePipelines(mVulkanDevice->mLogicalVkDevice, mPipelineCache, 1, &computePipelineCreateInfo, nullptr, &mMeshletCulling.mPipeline));
+}
+
+void VulkanRenderer::PrepareMeshletCulling(const vkglTF::Model& aModel)
+{
+	const VkDeviceSize drawCommandsSize = aModel.meshlets.mData.size() * sizeof(VkDrawIndexedIndirectCommand);
+	const VkDeviceSize drawCountsSize = aModel.meshlets.mDrawCount * sizeof(Core::uint32);
+	VkDescriptorBufferInfo meshletBufferInfo{aModel.meshlets.mBuffer, 0, VK_WHOLE_SIZE};
+
+	for (Core::uint32 i = 0; i < gMaxConcurrentFrames; i++)
+	{
+		Buffer& drawCommandBuffer = mMeshletCulling.mDrawCommandBuffers[i];
+		Buffer& drawCountBuffer = mMeshletCulling.mDrawCountBuffers[i];
+
+		VK_CHECK_RESULT(mVulkanDevice->CreateBuffer(
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			&drawCommandBuffer,
+			drawCommandsSize));
+
+		VK_CHECK_RESULT(mVulkanDevice->CreateBuffer(
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&drawCountBuffer,
+			drawCountsSize));
+
+		VK_CHECK_RESULT(drawCountBuffer.Map());
+		std::memset(drawCountBuffer.mMappedData, 0, drawCountsSize);
+
+		VkDescriptorSetAllocateInfo allocInfo = VulkanInitializers::DescriptorSetAllocateInfo(mMeshletCulling.mDescriptorPool, &mMeshletCulling.mDescriptorSetLayout, 1);
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(mVulkanDevice->mLogicalVkDevice, &allocInfo, &mMeshletCulling.mDescriptorSets[i]));
+		const std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+			// Binding 0: Meshlet bounds
+			VulkanInitializers::WriteDescriptorSet(mMeshletCulling.mDescriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &meshletBufferInfo),
+			// Binding 1: Indirect draw commands
+			VulkanInitializers::WriteDescriptorSet(mMeshletCulling.mDescriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &drawCommandBuffer.mVkDescriptorBufferInfo),
+			// Binding 2: Uniform buffer with the frustum planes
+			VulkanInitializers::WriteDescriptorSet(mMeshletCulling.mDescriptorSets[i], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2, &mVulkanUniformBuffers[i].mVkDescriptorBufferInfo),
+			// Binding 3: Visible meshlets per primitive
+			VulkanInitializers::WriteDescriptorSet(mMeshletCulling.mDescriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3, &drawCountBuffer.mVkDescriptorBufferInfo)
+		};
+		vkUpdateDescriptorSets(mVulkanDevice->mLogicalVkDevice, static_cast<Core::uint32>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+	}
+
+	mMeshletCulling.mPushConstant.mMeshletCount = static_cast<Core::uint32>(aModel.meshlets.mData.size());
+	mMeshletCulling.mIsPrepared = true;
+}
+
+void VulkanRenderer::CullMeshlets(VkCommandBuffer aCommandBuffer)
+{
+	vkglTF::Model* model = mModelManager->GetModel(mModelIdentifiers.mVoyagerModelIdentifier);
+	if (mMeshletCulling.mPipeline == VK_NULL_HANDLE || !model || model->meshlets.mData.empty())
+	{
+		return;
+	}
+
+	// The model streams in asynchronously, so its culling resources are created on first use
+	if (!mMeshletCulling.mIsPrepared)
+	{
+		PrepareMeshletCulling(*model);
+	}
+
+	SIMPLE_PROFILER_GPU_SCOPE(aCommandBuffer, "Meshlet cull");
+
+	// The counts written by the previous use of this buffer have been read back by ReadBackFrameStatistics
+	const Buffer& drawCountBuffer = mMeshletCulling.mDrawCountBuffers[mCurrentBufferIndex];
+	vkCmdFillBuffer(aCommandBuffer, drawCountBuffer.mVkBuffer, 0, VK_WHOLE_SIZE, 0);
+
+	// The counters have to be cleared before the shader increments them
+	const VkMemoryBarrier fillBarrier =
+	{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+	};
+	vkCmdPipelineBarrier(aCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &fillBarrier, 0, nullptr, 0, nullptr);
+
+	mMeshletCulling.mPushConstant.mModelMatrix = mVoyagerModelMatrix;
+	vkCmdBindPipeline(aCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mMeshletCulling.mPipeline);
+	vkCmdBindDescriptorSets(aCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mMeshletCulling.mPipelineLayout, 0, 1, &mMeshletCulling.mDescriptorSets[mCurrentBufferIndex], 0, nullptr);
+	vkCmdPushConstants(aCommandBuffer, mMeshletCulling.mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(MeshletCullingPushConstant), &mMeshletCulling.mPushConstant);
+
+	// One invocation per meshlet, the shader tests the bounding sphere against the frustum and the normal cone against the camera position
+	vkCmdDispatch(aCommandBuffer, (mMeshletCulling.mPushConstant.mMeshletCount + 63) / 64, 1, 1);
+
+	// The draw commands and counts are consumed by the indirect draws of this command buffer
+	const VkMemoryBarrier cullBarrier =
+	{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+	};
+	vkCmdPipelineBarrier(aCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+}
+
+void VulkanRenderer::CreateOcclusionCullingPipeline()
+{
+	// The cull shader samples the pyramid binding even if occlusion culling is unavailable, so the sampler is always created
+	const VkSamplerCreateInfo samplerCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+		.magFilter = VK_FILTER_NEAREST,
+		.minFilter = VK_FILTER_NEAREST,
+		.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+		.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.maxAnisotropy = 1.0f,
+		.compareOp = VK_COMPARE_OP_NEVER,
+		.maxLod = VK_LOD_CLAMP_NONE,
+	};
+	VK_CHECK_RESULT(vkCreateSampler(mVulkanDevice->mLogicalVkDevice, &samplerCreateInfo, nullptr, &mOcclusionCulling.mDepthPyramidSampler));
+
+	if (!mOcclusionCulling.mIsSupported)
+	{
+		std::cout << "Occlusion culling is disabled, the depth format can't be sampled" << std::endl;
+		return;
+	}
+
+	// The shader is compiled by the build, a missing binary throws in LoadShader like every other shader
+	const std::filesystem::path depthPyramidShaderPath = FileLoader::GetEngineResourcesPath() / FileLoader::gShadersPath / "ComputeCull/Depthpyramid_comp.spv";
+
+	const std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
+		// Binding 0: Depth buffer or previous mip (input)
+		VulkanInitializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+		// Binding 1: Pyramid mip (output)
+		VulkanInitializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+	};
+
+	const VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = VulkanInitializers::DescriptorSetLayoutCreateInfo(setLayoutBindings);
+	VK_CHECK_RESULT(vkCreateDescriptorSetLayout(mVulkanDevice->mLogicalVkDevice, &descriptorSetLayoutCreateInfo, nullptr, &mOcclusionCulling.mDescriptorSetLayout));
+
+	const std::vector<VkDescriptorPoolSize> poolSizes = {
+		VulkanInitializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, gMaxDepthPyramidMipCount),
+		VulkanInitializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, gMaxDepthPyramidMipCount)
+	};
+	const VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = VulkanInitializers::DescriptorPoolCreateInfo(poolSizes, gMaxDepthPyramidMipCount);
+	VK_CHECK_RESULT(vkCreateDescriptorPool(mVulkanDevice->mLogicalVkDevice, &descriptorPoolCreateInfo, nullptr, &mOcclusionCulling.mDescriptorPool));
+
+	const VkPushConstantRange pushConstantRange{
+		.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		.offset = 0,
+		.size = sizeof(DepthPyramidPushConstant)
+	};
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = VulkanInitializers::PipelineLayoutCreateInfo(&mOcclusionCulling.mDescriptorSetLayout, 1);
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+	VK_CHECK_RESULT(vkCreatePipelineLayout(mVulkanDevice->mLogicalVkDevice, &pipelineLayoutCreateInfo, nullptr, &mOcclusionCulling.mPipelineLayout));
+
+	VkComputePipelineCreateInfo computePipelineCreateInfo = VulkanInitializers::ComputePipelineCreateInfo(mOcclusionCulling.mPipelineLayout, 0);
+	computePipelineCreateInfo.stage = LoadShader(depthPyramidShaderPath, VK_SHADER_STAGE_COMPUTE_BIT);
+	VK_CHECK_RESULT(vkCreateComputePipelines(mVulkanDevice->mLogicalVkDevice, mPipelineCache, 1, &computePipelineCreateInfo, nullptr, &mOcclusionCulling.mPipeline));
+}
+
+void VulkanRenderer::CreateDepthPyramid()
+{
+	// Rounded down to a power of two so every following mip halves exactly
+	mOcclusionCulling.mDepthPyramidWidth = std::bit_floor(std::max(mFramebufferWidth, 1u));
+	mOcclusionCulling.mDepthPyramidHeight = std::bit_floor(std::max(mFramebufferHeight, 1u));
+	mOcclusionCulling.mDepthPyramidMipCount = std::min(static_cast<Core::uint32>(std::bit_width(std::max(mOcclusionCulling.mDepthPyramidWidth, mOcclusionCulling.mDepthPyramidHeight))), gMaxDepthPyramidMipCount);
+	mOcclusionCulling.mPushConstant.mDepthPyramidSize = Math::Vector2f{static_cast<float>(mOcclusionCulling.mDepthPyramidWidth), static_cast<float>(mOcclusionCulling.mDepthPyramidHeight)};
+	mOcclusionCulling.mIsDepthPyramidValid = false;
+
+	// Written on the graphics queue and read by the early pass on the compute queue
+	const std::array<Core::uint32, 2> queueFamilyIndices = {mVulkanDevice->mQueueFamilyIndices.mGraphics, mVulkanDevice->mQueueFamilyIndices.mCompute};
+	const bool isSharedWithComputeQueue = queueFamilyIndices[0] != queueFamilyIndices[1];
+
+	const VkImageCreateInfo imageCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+		.imageType = VK_IMAGE_TYPE_2D,
+		.format = VK_FORMAT_R32_SFLOAT,
+		.extent = { mOcclusionCulling.mDepthPyramidWidth, mOcclusionCulling.mDepthPyramidHeight, 1 },
+		.mipLevels = mOcclusionCulling.mDepthPyramidMipCount,
+		.arrayLayers = 1,
+		.samples = VK_SAMPLE_COUNT_1_BIT,
+		.tiling = VK_IMAGE_TILING_OPTIMAL,
+		.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+		.sharingMode = isSharedWithComputeQueue ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = isSharedWithComputeQueue ? static_cast<Core::uint32>(queueFamilyIndices.size()) : 0u,
+		.pQueueFamilyIndices = queueFamilyIndices.data(),
+		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+	};
+	VK_CHECK_RESULT(vkCreateImage(mVulkanDevice->mLogicalVkDevice, &imageCreateInfo, nullptr, &mOcclusionCulling.mDepthPyramidVkImage));
+	mOcclusionCulling.mDepthPyramidAllocation = mVulkanDevice->AllocateImageMemory(mOcclusionCulling.mDepthPyramidVkImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	VkImageViewCreateInfo imageViewCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.image = mOcclusionCulling.mDepthPyramidVkImage,
+		.viewType = VK_IMAGE_VIEW_TYPE_2D,
+		.format = VK_FORMAT_R32_SFLOAT,
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = mOcclusionCulling.mDepthPyramidMipCount,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		}
+	};
+	VK_CHECK_RESULT(vkCreateImageView(mVulkanDevice->mLogicalVkDevice, &imageViewCreateInfo, nullptr, &mOcclusionCulling.mDepthPyramidVkImageView));
+
+	mOcclusionCulling.mDepthPyramidMipVkImageViews.resize(mOcclusionCulling.mDepthPyramidMipCount);
+	for (Core::uint32 i = 0; i < mOcclusionCulling.mDepthPyramidMipCount; i++)
+	{
+		imageViewCreateInfo.subresourceRange.baseMipLevel = i;
+		imageViewCreateInfo.subresourceRange.levelCount = 1;
+		VK_CHECK_RESULT(vkCreateImageView(mVulkanDevice->mLogicalVkDevice, &imageViewCreateInfo, nullptr, &mOcclusionCulling.mDepthPyramidMipVkImageViews[i]));
+	}
+
+	// The pyramid stays in the general layout, it is written as storage image and sampled by both queues
+	VkCommandBuffer layoutCommandBuffer = mVulkanDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+	VulkanTools::InsertImageMemoryBarrier(
+		layoutCommandBuffer,
+		mOcclusionCulling.mDepthPyramidVkImage,
+		0,
+		VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_GENERAL,
+		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VkImageSubresourceRange{VK_IMAGE_ASPECT_COLOR_BIT, 0, mOcclusionCulling.mDepthPyramidMipCount, 0, 1});
+	mVulkanDevice->FlushCommandBuffer(layoutCommandBuffer, mGraphicsContext.mQueue);
+
+	const VkDescriptorImageInfo depthPyramidImageInfo{mOcclusionCulling.mDepthPyramidSampler, mOcclusionCulling.mDepthPyramidVkImageView, VK_IMAGE_LAYOUT_GENERAL};
+	for (Core::uint32 i = 0; i < gMaxConcurrentFrames; i++)
+	{
+		const std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+			// Binding 5: Depth pyramid of the early pass
+			VulkanInitializers::WriteDescriptorSet(mComputeContext.mDescriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 5, &depthPyramidImageInfo),
+			// Binding 5: Depth pyramid of the late pass
+			VulkanInitializers::WriteDescriptorSet(mOcclusionCulling.mLateDescriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 5, &depthPyramidImageInfo)
+		};
+		vkUpdateDescriptorSets(mVulkanDevice->mLogicalVkDevice, static_cast<Core::uint32>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+	}
+
+	if (mOcclusionCulling.mPipeline == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	VK_CHECK_RESULT(vkResetDescriptorPool(mVulkanDevice->mLogicalVkDevice, mOcclusionCulling.mDescriptorPool, 0));
+
+	mOcclusionCulling.mDepthPyramidDescriptorSets.resize(mOcclusionCulling.mDepthPyramidMipCount);
+	for (Core::uint32 i = 0; i < mOcclusionCulling.mDepthPyramidMipCount; i++)
+	{
+		const VkDescriptorSetAllocateInfo allocInfo = VulkanInitializers::DescriptorSetAllocateInfo(mOcclusionCulling.mDescriptorPool, &mOcclusionCulling.mDescriptorSetLayout, 1);
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(mVulkanDevice->mLogicalVkDevice, &allocInfo, &mOcclusionCulling.mDepthPyramidDescriptorSets[i]));
+
+		// The first mip reduces the depth buffer, every other mip the one before it
+		const VkDescriptorImageInfo inputImageInfo = i == 0
+			? VkDescriptorImageInfo{mOcclusionCulling.mDepthPyramidSampler, mDepthStencil.mDepthVkImageView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL}
+			: VkDescriptorImageInfo{mOcclusionCulling.mDepthPyramidSampler, mOcclusionCulling.mDepthPyramidMipVkImageViews[i - 1], VK_IMAGE_LAYOUT_GENERAL};
+		const VkDescriptorImageInfo outputImageInfo{VK_NULL_HANDLE, mOcclusionCulling.mDepthPyramidMipVkImageViews[i], VK_IMAGE_LAYOUT_GENERAL};
+
+		const std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+			// Binding 0: Depth buffer or previous mip
+			VulkanInitializers::WriteDescriptorSet(mOcclusionCulling.mDepthPyramidDescriptorSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &inputImageInfo),
+			// Binding 1: Pyramid mip
+			VulkanInitializers::WriteDescriptorSet(mOcclusionCulling.mDepthPyramidDescriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, &outputImageInfo)
+		};
+		vkUpdateDescriptorSets(mVulkanDevice->mLogicalVkDevice, static_cast<Core::uint32>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+	}
+}
+
+void VulkanRenderer::DestroyDepthPyramid()
+{
+	for (VkImageView& imageView : mOcclusionCulling.mDepthPyramidMipVkImageViews)
+		vkDestroyImageView(mVulkanDevice->mLogicalVkDevice, imageView, nullptr);
+
+	mOcclusionCulling.mDepthPyramidMipVkImageViews.clear();
+	mOcclusionCulling.mDepthPyramidDescriptorSets.clear();
+
+	vkDestroyImageView(mVulkanDevice->mLogicalVkDevice, mOcclusionCulling.mDepthPyramidVkImageView, nullptr);
+	vkDestroyImage(mVulkanDevice->mLogicalVkDevice, mOcclusionCulling.mDepthPyramidVkImage, nullptr);
+	mVulkanDevice->mMemoryAllocator->Free(mOcclusionCulling.mDepthPyramidAllocation);
+
+	mOcclusionCulling.mDepthPyramidVkImageView = VK_NULL_HANDLE;
+	mOcclusionCulling.mDepthPyramidVkImage = VK_NULL_HANDLE;
+	mOcclusionCulling.mIsDepthPyramidValid = false;
+}
+
+void VulkanRenderer::BuildDepthPyramid(VkCommandBuffer aCommandBuffer)
+{
+	SIMPLE_PROFILER_PROFILE_SCOPE("VulkanRenderer::BuildDepthPyramid");
+	SIMPLE_PROFILER_GPU_SCOPE(aCommandBuffer, "Depth pyramid");
+
+	// The depth written by the early draws becomes the input of the first mip
+	VulkanTools::InsertImageMemoryBarrier(
+		aCommandBuffer,
+		mDepthStencil.mVkImage,
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+		VK_ACCESS_SHADER_READ_BIT,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VkImageSubresourceRange{VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT, 0, 1, 0, 1});
+
+	// The late pass of the previous frame may still be sampling the pyramid
+	VulkanTools::InsertImageMemoryBarrier(
+		aCommandBuffer,
+		mOcclusionCulling.mDepthPyramidVkImage,
+		VK_ACCESS_SHADER_READ_BIT,
+		VK_ACCESS_SHADER_WRITE_BIT,
+		VK_IMAGE_LAYOUT_GENERAL,
+		VK_IMAGE_LAYOUT_GENERAL,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VkImageSubresourceRange{VK_IMAGE_ASPECT_COLOR_BIT, 0, mOcclusionCulling.mDepthPyramidMipCount, 0, 1});
+
+	vkCmdBindPipeline(aCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mOcclusionCulling.mPipeline);
+
+	DepthPyramidPushConstant pushConstant{};
+	pushConstant.mInputWidth = mFramebufferWidth;
+	pushConstant.mInputHeight = mFramebufferHeight;
+
+	for (Core::uint32 i = 0; i < mOcclusionCulling.mDepthPyramidMipCount; i++)
+	{
+		pushConstant.mOutputWidth = std::max(mOcclusionCulling.mDepthPyramidWidth >> i, 1u);
+		pushConstant.mOutputHeight = std::max(mOcclusionCulling.mDepthPyramidHeight >> i, 1u);
+
+		vkCmdBindDescriptorSets(aCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mOcclusionCulling.mPipelineLayout, 0, 1, &mOcclusionCulling.mDepthPyramidDescriptorSets[i], 0, nullptr);
+		vkCmdPushConstants(aCommandBuffer, mOcclusionCulling.mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DepthPyramidPushConstant), &pushConstant);
+		vkCmdDispatch(aCommandBuffer, (pushConstant.mOutputWidth + 7) / 8, (pushConstant.mOutputHeight + 7) / 8, 1);
+
+		// The next mip and the late pass read this one
+		VulkanTools::InsertImageMemoryBarrier(
+			aCommandBuffer,
+			mOcclusionCulling.mDepthPyramidVkImage,
+			VK_ACCESS_SHADER_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VkImageSubresourceRange{VK_IMAGE_ASPECT_COLOR_BIT, i, 1, 0, 1});
+
+		pushConstant.mInputWidth = pushConstant.mOutputWidth;
+		pushConstant.mInputHeight = pushConstant.mOutputHeight;
+	}
+
+	// The late draws keep testing against and writing to the depth of the early draws
+	VulkanTools::InsertImageMemoryBarrier(
+		aCommandBuffer,
+		mDepthStencil.mVkImage,
+		VK_ACCESS_SHADER_READ_BIT,
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		VkImageSubresourceRange{VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT, 0, 1, 0, 1});
+}
+
+void VulkanRenderer::CullOccludedInstances(VkCommandBuffer aCommandBuffer)
+{
+	SIMPLE_PROFILER_PROFILE_SCOPE("VulkanRenderer::CullOccludedInstances");
+	SIMPLE_PROFILER_GPU_SCOPE(aCommandBuffer, "Late cull");
+
+	// The early draws have consumed the draws and visible instances, the late pass overwrites them
+	const VkMemoryBarrier cullBarrier =
+	{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+		.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+	};
+	vkCmdPipelineBarrier(aCommandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+
+	// Instances are tested against the pyramid of the depth that has just been rendered, from the view of this frame
+	OcclusionCullingPushConstant pushConstant = mOcclusionCulling.mPushConstant;
+	pushConstant.mViewProjectionMatrix = mUniformBufferData.mProjectionMatrix * mUniformBufferData.mViewMatrix;
+	pushConstant.mIsOcclusionCullingEnabled = 1;
+	pushConstant.mIsLatePass = 1;
+
+	CullInstances(aCommandBuffer, mOcclusionCulling.mLateDescriptorSets[mCurrentBufferIndex], mOcclusionCulling.mLateDrawCountBuffers[mCurrentBufferIndex], pushConstant);
+
+	// Only the newly disoccluded instances are left in the draws for the late pass
+	const VkMemoryBarrier drawBarrier =
+	{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+	};
+	vkCmdPipelineBarrier(aCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &drawBarrier, 0, nullptr, 0, nullptr);
+}
+
+void VulkanRenderer::CullInstances(VkCommandBuffer aCommandBuffer, VkDescriptorSet aDescriptorSet, const Buffer& aDrawCountBuffer, OcclusionCullingPushConstant aPushConstant)
+{
+	// Clear the buffers that the compute shader pass will write statistics and draw calls to
+	// The instance counts of the draws start at zero, since the compaction pass uses them as fill counters
+	vkCmdFillBuffer(aCommandBuffer, aDrawCountBuffer.mVkBuffer, 0, VK_WHOLE_SIZE, 0);
+	vkCmdFillBuffer(aCommandBuffer, mIndirectCommandsBuffers[mCurrentBufferIndex].mVkBuffer, 0, VK_WHOLE_SIZE, 0);
+
+	// This barrier ensures that the fill commands are finished before the compute shader can start writing to the buffers
+	const VkMemoryBarrier fillBarrier =
+	{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+	};
+	vkCmdPipelineBarrier(aCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &fillBarrier, 0, nullptr, 0, nullptr);
+
+	vkCmdBindPipeline(aCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mComputeContext.mPipeline);
+	vkCmdBindDescriptorSets(aCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mComputeContext.mPipelineLayout, 0, 1, &aDescriptorSet, 0, nullptr);
+
+	aPushConstant.mInstanceCount = mIndirectDrawCount;
+	aPushConstant.mIsCompactionPass = 0;
+	vkCmdPushConstants(aCommandBuffer, mComputeContext.mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(OcclusionCullingPushConstant), &aPushConstant);
+	vkCmdDispatch(aCommandBuffer, (mIndirectDrawCount + 15) / 16, 1, 1);
+
+	// The visible instances can only be placed once the instance count of every LOD is known
+	const VkMemoryBarrier compactionBarrier =
+	{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+	};
+	vkCmdPipelineBarrier(aCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &compactionBarrier, 0, nullptr, 0, nullptr);
+
+	aPushConstant.mIsCompactionPass = 1;
+	vkCmdPushConstants(aCommandBuffer, mComputeContext.mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(OcclusionCullingPushConstant), &aPushConstant);
+	vkCmdDispatch(aCommandBuffer, (mIndirectDrawCount + 15) / 16, 1, 1);
+}
+
+std::array<VkBufferMemoryBarrier, 4> VulkanRenderer::GetCullOutputBarriers(Core::uint32 aBufferIndex, VkAccessFlags aSrcAccessMask, VkAccessFlags aDstAccessMask, Core::uint32 aSrcQueueFamilyIndex, Core::uint32 aDstQueueFamilyIndex) const
+{
+	const std::array<const Buffer*, 4> buffers = {&mInstanceBuffer, &mIndirectCommandsBuffers[aBufferIndex], &mInstanceVisibilityBuffers[aBufferIndex], &mVisibleInstanceBuffers[aBufferIndex]};
+
+	std::array<VkBufferMemoryBarrier, 4> bufferMemoryBarriers{};
+	for (Core::size i = 0; i < buffers.size(); i++)
+	{
+		bufferMemoryBarriers[i] =
+		{
+			VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+			nullptr,
+			aSrcAccessMask,
+			aDstAccessMask,
+			aSrcQueueFamilyIndex,
+			aDstQueueFamilyIndex,
+			buffers[i]->mVkBuffer,
+			0,
+			buffers[i]->mVkDescriptorBufferInfo.range
+		};
+	}
+
+	return bufferMemoryBarriers;
+}
+
+void VulkanRenderer::CreateUniformBuffers()
+{
+	for (Buffer& buffer : mVulkanUniformBuffers)
+	{
+		VK_CHECK_RESULT(mVulkanDevice->CreateBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &buffer, sizeof(UniformBufferData), &mUniformBufferData));
+		VK_CHECK_RESULT(buffer.Map());
+	}
+}
+
+void VulkanRenderer::CreateUIOverlay()
+{
+	const std::filesystem::path UIVertexShaderPath = "Core/UIOverlay_vert.spv";
+	const std::filesystem::path UIFragmentShaderPath = "Core/UIOverlay_frag.spv";
+	mImGuiOverlay->SetMaxConcurrentFrames(gMaxConcurrentFrames);
+	mImGuiOverlay->SetVulkanDevice(mVulkanDevice);
+	mImGuiOverlay->SetVkQueue(mGraphicsContext.mQueue);
+	mImGuiOverlay->SetScale(mWindow.lock()->GetContentScaleForMonitor());
+	mImGuiOverlay->AddShader(LoadShader(FileLoader::GetEngineResourcesPath() / FileLoader::gShadersPath / UIVertexShaderPath, VK_SHADER_STAGE_VERTEX_BIT));
+	mImGuiOverlay->AddShader(LoadShader(FileLoader::GetEngineResourcesPath() / FileLoader::gShadersPath / UIFragmentShaderPath, VK_SHADER_STAGE_FRAGMENT_BIT));
+	mImGuiOverlay->PrepareResources();
+	mImGuiOverlay->PreparePipeline(mPipelineCache, mVulkanSwapChain.mColorVkFormat, mVkDepthFormat);
+}
+
+void VulkanRenderer::PrepareVulkanResources()
+{
+	InitializeSwapchain();
+	CreateGraphicsCommandPool();
+	SetupSwapchain();
+	CreateGraphicsCommandBuffers();
+	CreateSecondaryCommandPools();
+	CreateSynchronizationPrimitives();
+	CreateGpuProfiler();
+	CreateFrameStatisticsQueries();
+	SetupDepthStencil();
+	CreatePipelineCache();
+
+	CreateUIOverlay();
+	CreateStagingRing();
+	CreateFrameDumpBuffers();
+
+	LoadAssets();
+	
+	PrepareInstanceData();
+	PrepareIndirectData();
+
+	// All uploads so far were batched into the staging ring, the first frames wait for them on the GPU instead of stalling here
+	mUploadTimelineValue = mStagingRing->Submit();
+
+	CreateUniformBuffers();
+	CreateDescriptorPool();
+	CreateGraphicsDescriptorSetLayout();
+	CreateGraphicsDescriptorSets();
+	CreateGraphicsPipelines();
+	CreateComputeDescriptorSetLayout();
+	CreateComputeDescriptorSets();
 	CreateComputePipelines();
+	CreateMeshletCullingPipeline();
+	CreateOcclusionCullingPipeline();
+	CreateDepthPyramid();
+
+	mEngineProperties.lock()->mIsRendererPrepared = true;
+}
+
+void VulkanRenderer::ReadBackFrameStatistics()
+{
+	SIMPLE_PROFILER_PROFILE_SCOPE("VulkanRenderer::ReadBackFrameStatistics");
+
+	// The graphics submission of a frame waits on its compute submission, so a signaled graphics fence covers both
+	// Polling from the most recent frame backwards shows the statistics a frame or more late, but never stalls on the GPU
+	for (Core::uint32 i = 1; i <= gMaxConcurrentFrames; i++)
+	{
+		const Core::uint32 bufferIndex = (mCurrentBufferIndex + gMaxConcurrentFrames - i) % gMaxConcurrentFrames;
+		// During the first frames the count buffers of unused indices still hold whatever the allocation contained
+		if (!mGraphicsContext.mIsSubmitted[bufferIndex] || vkGetFenceStatus(mVulkanDevice->mLogicalVkDevice, mGraphicsContext.mFences[bufferIndex]) != VK_SUCCESS)
+		{
+			continue;
+		}
+
+		std::memcpy(&mIndrectDrawInfo, mIndirectDrawCountBuffers[bufferIndex].mMappedData, sizeof(mIndrectDrawInfo));
+		std::memcpy(&mOcclusionCulling.mLateDrawInfo, mOcclusionCulling.mLateDrawCountBuffers[bufferIndex].mMappedData, sizeof(IndirectDrawInfo));
+
+		const vkglTF::Model* model = mModelManager->GetModel(mModelIdentifiers.mVoyagerModelIdentifier);
+		if (mMeshletCulling.mIsPrepared && model)
+		{
+			const Core::uint32* drawCounts = static_cast<const Core::uint32*>(mMeshletCulling.mDrawCountBuffers[bufferIndex].mMappedData);
+			mMeshletCulling.mVisibleMeshletCount = std::accumulate(drawCounts, drawCounts + model->meshlets.mDrawCount, 0u);
+		}
+
+		return;
+	}
+}
+
+void VulkanRenderer::CollectFrameStatistics(Core::uint32 aBufferIndex)
+{
+	FrameStatistics& frame = mFrameStatistics.mPendingFrames[aBufferIndex];
+	if (frame.mFrameNumber == Core::uint32_max)
+	{
+		return;
+	}
+
+	std::memcpy(&frame.mEarlyDrawInfo, mIndirectDrawCountBuffers[aBufferIndex].mMappedData, sizeof(IndirectDrawInfo));
+	std::memcpy(&frame.mLateDrawInfo, mOcclusionCulling.mLateDrawCountBuffers[aBufferIndex].mMappedData, sizeof(IndirectDrawInfo));
+
+	const vkglTF::Model* model = mModelManager->GetModel(mModelIdentifiers.mVoyagerModelIdentifier);
+	if (mMeshletCulling.mIsPrepared && model)
+	{
+		const Core::uint32* drawCounts = static_cast<const Core::uint32*>(mMeshletCulling.mDrawCountBuffers[aBufferIndex].mMappedData);
+		frame.mVisibleMeshletCount = std::accumulate(drawCounts, drawCounts + model->meshlets.mDrawCount, 0u);
+	}
+
+	if (mFrameStatistics.mIsTimestampSupported)
+	{
+		const Core::uint32 firstQuery = aBufferIndex * FrameStatisticsContext::gQueriesPerFrame;
+		std::array<Core::uint64, FrameStatisticsContext::gQueriesPerFrame> timestamps{};
+		const VkResult result = vkGetQueryPoolResults(mVulkanDevice->mLogicalVkDevice, mFrameStatistics.mQueryPool, firstQuery, FrameStatisticsContext::gQueriesPerFrame, sizeof(timestamps), timestamps.data(), sizeof(Core::uint64), VK_QUERY_RESULT_64_BIT);
+		if (result == VK_SUCCESS)
+		{
+			const auto toMilliseconds = [this](Core::uint64 aBegin, Core::uint64 aEnd) { return static_cast<double>((aEnd - aBegin) & mFrameStatistics.mTimestampMask) * mFrameStatistics.mTimestampPeriodNs / 1000000.0; };
+			frame.mGpuComputeTimeMs = toMilliseconds(timestamps[0], timestamps[1]);
+			frame.mGpuGraphicsTimeMs = toMilliseconds(timestamps[2], timestamps[3]);
+			frame.mHasGpuTime = true;
+		}
+
+		vkResetQueryPool(mVulkanDevice->mLogicalVkDevice, mFrameStatistics.mQueryPool, firstQuery, FrameStatisticsContext::gQueriesPerFrame);
+	}
+
+	mFrameStatistics.mFrames.push_back(frame);
+	frame = FrameStatistics{};
+}
+
+void VulkanRenderer::WriteFrameStatisticsTimestamp(VkCommandBuffer aCommandBuffer, Core::uint32 aQuery)
+{
+	if (mFrameStatistics.mIsEnabled && mFrameStatistics.mIsTimestampSupported)
+	{
+		vkCmdWriteTimestamp2(aCommandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, mFrameStatistics.mQueryPool, mCurrentBufferIndex * FrameStatisticsContext::gQueriesPerFrame + aQuery);
+	}
+}
+
+void VulkanRenderer::PrepareFrame()
+{
+	SIMPLE_PROFILER_PROFILE_SCOPE("VulkanRenderer::PrepareFrame");
+
+	// The uniform buffer of the frame is read by both queues, so both of its previous submissions have to be done
+	// The graphics fence stays signaled until right before its submission, ReadBackFrameStatistics polls it until then
+	const std::array<VkFence, 2> fences{mComputeContext.mFences[mCurrentBufferIndex], mGraphicsContext.mFences[mCurrentBufferIndex]};
+	VK_CHECK_RESULT(vkWaitForFences(mVulkanDevice->mLogicalVkDevice, static_cast<Core::uint32>(fences.size()), fences.data(), VK_TRUE, Core::uint64_max));
+	VK_CHECK_RESULT(vkResetFences(mVulkanDevice->mLogicalVkDevice, 1, &mComputeContext.mFences[mCurrentBufferIndex]));
+
+	SimpleProfiler::BeginGpuFrame(mCurrentBufferIndex);
+	WriteFrameDump(mCurrentBufferIndex);
+	CollectFrameStatistics(mCurrentBufferIndex);
+
+	// Everything written from here on has been collected before the wait
+	std::memcpy(mVulkanUniformBuffers[mCurrentBufferIndex].mMappedData, &mUniformBufferData, sizeof(UniformBufferData));
+
+	std::byte* uploadData = static_cast<std::byte*>(mInstanceUploadBuffers[mCurrentBufferIndex].mMappedData);
+	const std::byte* instanceData = reinterpret_cast<const std::byte*>(mInstanceRegistry->GetInstanceData().data());
+	for (const VkBufferCopy& copyRegion : mInstanceCopyRegions)
+	{
+		std::memcpy(uploadData + copyRegion.srcOffset, instanceData + copyRegion.dstOffset, copyRegion.size);
+	}
 
-	mEngineProperties.lock()->mIsRendererPrepared = true;
+	if (mCpuCulling.mIsCullingInstances)
+	{
+		WriteCpuCulledInstances();
+	}
+
+	mImGuiOverlay->Update(mCurrentBufferIndex);
 }
 
 void VulkanRenderer::PrepareFrameGraphics()
 {
 	SIMPLE_PROFILER_PROFILE_SCOPE("VulkanRenderer::PrepareFrameGraphics");
 
-	// Use a fence to wait until the command buffer has finished execution before using it again
-	VK_CHECK_RESULT(vkWaitForFences(mVulkanDevice->mLogicalVkDevice, 1, &mGraphicsContext.mFences[mCurrentBufferIndex], VK_TRUE, Core::uint64_max));
-	VK_CHECK_RESULT(vkResetFences(mVulkanDevice->mLogicalVkDevice, 1, &mGraphicsContext.mFences[mCurrentBufferIndex]));
-
-	UpdateUIOverlay();
-
 	const VkResult result = mVulkanSwapChain.AcquireNextImage(mGraphicsContext.mPresentCompleteSemaphores[mCurrentBufferIndex], mCurrentImageIndex);
 	if ((result == VK_ERROR_OUT_OF_DATE_KHR) || (result == VK_SUBOPTIMAL_KHR))
 	{
@@ -761,6 +1773,14 @@ void VulkanRenderer::BuildGraphicsCommandBuffer()
 
 	const VkCommandBufferBeginInfo commandBufferBeginInfo = VulkanInitializers::CommandBufferBeginInfo();
 	VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo));
+	WriteFrameStatisticsTimestamp(commandBuffer, 2);
+
+	// The fence of this frame has signaled, so the secondary command buffers it has executed can be recorded again
+	ResetSecondaryCommandPools();
+	mSecondaryCommandBufferCount = 0;
+
+	// Dispatches can't be recorded inside dynamic rendering, so the meshlets are culled up front on the graphics queue
+	CullMeshlets(commandBuffer);
 
 	// With dynamic rendering there are no subpass dependencies, so we need to take care of proper layout transitions by using barriers
 	// This set of barriers prepares the color and depth images for output
@@ -788,33 +1808,27 @@ void VulkanRenderer::BuildGraphicsCommandBuffer()
 
 	if (mVulkanDevice->mQueueFamilyIndices.mGraphics != mVulkanDevice->mQueueFamilyIndices.mCompute)
 	{
-		const VkBufferMemoryBarrier bufferMemoryBarrier =
-		{
-			VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-			nullptr,
+		const std::array<VkBufferMemoryBarrier, 4> bufferMemoryBarriers = GetCullOutputBarriers(
+			mCurrentBufferIndex,
 			0,
-			VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+			VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
 			mVulkanDevice->mQueueFamilyIndices.mCompute,
-			mVulkanDevice->mQueueFamilyIndices.mGraphics,
-			mIndirectCommandsBuffers[mCurrentBufferIndex].mVkBuffer,
-			0,
-			mIndirectCommandsBuffers[mCurrentBufferIndex].mVkDescriptorBufferInfo.range
-		};
+			mVulkanDevice->mQueueFamilyIndices.mGraphics);
 		vkCmdPipelineBarrier(
 			commandBuffer,
 			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
 			0,
 			0,
 			nullptr,
-			1,
-			&bufferMemoryBarrier,
+			static_cast<Core::uint32>(bufferMemoryBarriers.size()),
+			bufferMemoryBarriers.data(),
 			0,
 			nullptr);
 	}
 
 	// New structures are used to define the attachments used in dynamic rendering
-	const VkRenderingAttachmentInfoKHR colorAttachmentInfo{
+	VkRenderingAttachmentInfoKHR colorAttachmentInfo{
 		.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
 		.imageView = mVulkanSwapChain.mVkImageViews[mCurrentImageIndex],
 		.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
@@ -825,7 +1839,7 @@ void VulkanRenderer::BuildGraphicsCommandBuffer()
 
 	// A single depth stencil attachment info can be used, but they can also be specified separately.
 	// When both are specified separately, the only requirement is that the image view is identical.			
-	const VkRenderingAttachmentInfoKHR depthStencilAttachmentInfo{
+	VkRenderingAttachmentInfoKHR depthStencilAttachmentInfo{
 		.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
 		.imageView = mDepthStencil.mVkImageView,
 		.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
@@ -844,73 +1858,120 @@ void VulkanRenderer::BuildGraphicsCommandBuffer()
 		.pStencilAttachment = &depthStencilAttachmentInfo
 	};
 
-	vkCmdBeginRendering(commandBuffer, &renderingInfo);
+	// Instances the early pass found hidden are re-tested against the depth the early draws have just written
+	// Running the late pass whenever the early pass occluded keeps toggling the mode from dropping instances for a frame
+	// The late pass needs the visibility the cull shader has written, the CPU culling doesn't test occlusion
+	const bool isCullingOcclusion = mOcclusionCulling.mIsSupported && (mOcclusionCulling.mIsEnabled || mOcclusionCulling.mIsEarlyPassOccluding) && !mCpuCulling.mIsCullingInstances;
 
-	const VkViewport viewport = VulkanInitializers::Viewport(static_cast<float>(mFramebufferWidth), static_cast<float>(mFramebufferHeight), 0.0f, 1.0f);
-	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	// The draw lists don't depend on each other, the overlay is drawn on top by the last pass
+	static constexpr std::array<DrawListFunction, 4> drawLists{&VulkanRenderer::DrawPlanet, &VulkanRenderer::DrawVoyager, &VulkanRenderer::DrawInstancedModels, &VulkanRenderer::DrawImGuiOverlay};
+	RecordRendering(commandBuffer, renderingInfo, std::span(drawLists).first(isCullingOcclusion ? 3 : 4));
 
-	const VkRect2D scissor = VulkanInitializers::Rect2D(mFramebufferWidth, mFramebufferHeight, 0, 0);
-	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	if (isCullingOcclusion)
+	{
+		BuildDepthPyramid(commandBuffer);
+		CullOccludedInstances(commandBuffer);
 
-	DrawModels(commandBuffer);
+		// The late draws are added on top of the early ones
+		VulkanTools::InsertImageMemoryBarrier(
+			commandBuffer,
+			mVulkanSwapChain.mVkImages[mCurrentImageIndex],
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VkImageSubresourceRange{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1});
+
+		colorAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		depthStencilAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		RecordRendering(commandBuffer, renderingInfo, std::span(drawLists).last(2));
+
+		// The next early pass tests against this pyramid, so it needs the camera it was rendered with
+		mOcclusionCulling.mPushConstant.mViewProjectionMatrix = mUniformBufferData.mProjectionMatrix * mUniformBufferData.mViewMatrix;
+		mOcclusionCulling.mIsDepthPyramidValid = true;
+	}
+	else
+	{
+		mOcclusionCulling.mIsDepthPyramidValid = false;
+		std::memset(mOcclusionCulling.mLateDrawCountBuffers[mCurrentBufferIndex].mMappedData, 0, sizeof(IndirectDrawInfo));
+	}
 
-	DrawImGuiOverlay(commandBuffer);
+	if (mVulkanSwapChain.IsHeadless())
+	{
+		// Offscreen images aren't presented, they are copied out when the frames are dumped
+		VulkanTools::InsertImageMemoryBarrier(
+			commandBuffer,
+			mVulkanSwapChain.mVkImages[mCurrentImageIndex],
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_ACCESS_TRANSFER_READ_BIT,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VkImageSubresourceRange{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1});
+
+		if (!mFrameDump.mDirectory.empty())
+		{
+			const VkBufferImageCopy bufferImageCopy{
+				.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+				.imageExtent = {mFramebufferWidth, mFramebufferHeight, 1}
+			};
+			vkCmdCopyImageToBuffer(commandBuffer, mVulkanSwapChain.mVkImages[mCurrentImageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, mFrameDump.mReadbackBuffers[mCurrentBufferIndex].mVkBuffer, 1, &bufferImageCopy);
 
-	vkCmdEndRendering(commandBuffer);
+			// Makes the copy visible to WriteFrameDump once the fence has signaled
+			const VkMemoryBarrier memoryBarrier{
+				.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+				.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+				.dstAccessMask = VK_ACCESS_HOST_READ_BIT
+			};
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+			mFrameDump.mPendingFrames[mCurrentBufferIndex] = mFrameDump.mFrameCount;
+		}
 
-	// This set of barriers prepares the color image for presentation, we don't need to care for the depth image
-	VulkanTools::InsertImageMemoryBarrier(
-		commandBuffer,
-		mVulkanSwapChain.mVkImages[mCurrentImageIndex],
-		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-		0,
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-		VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-		VkImageSubresourceRange{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1});
+		mFrameDump.mFrameCount++;
+	}
+	else
+	{
+		// This set of barriers prepares the color image for presentation, we don't need to care for the depth image
+		VulkanTools::InsertImageMemoryBarrier(
+			commandBuffer,
+			mVulkanSwapChain.mVkImages[mCurrentImageIndex],
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			0,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			VkImageSubresourceRange{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1});
+	}
 
 	if (mVulkanDevice->mQueueFamilyIndices.mGraphics != mVulkanDevice->mQueueFamilyIndices.mCompute)
 	{
-		const VkBufferMemoryBarrier bufferMemoryBarrier =
-		{
-			VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-			nullptr,
-			VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+		const std::array<VkBufferMemoryBarrier, 4> bufferMemoryBarriers = GetCullOutputBarriers(
+			mCurrentBufferIndex,
+			VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
 			0,
 			mVulkanDevice->mQueueFamilyIndices.mGraphics,
-			mVulkanDevice->mQueueFamilyIndices.mCompute,
-			mIndirectCommandsBuffers[mCurrentBufferIndex].mVkBuffer,
-			0,
-			mIndirectCommandsBuffers[mCurrentBufferIndex].mVkDescriptorBufferInfo.range
-		};
+			mVulkanDevice->mQueueFamilyIndices.mCompute);
 		vkCmdPipelineBarrier(
 			commandBuffer,
-			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
 			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
 			0,
 			0,
 			nullptr,
-			1,
-			&bufferMemoryBarrier,
+			static_cast<Core::uint32>(bufferMemoryBarriers.size()),
+			bufferMemoryBarriers.data(),
 			0,
 			nullptr);
 	}
 
+	WriteFrameStatisticsTimestamp(commandBuffer, 3);
 	VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
 }
 
-void VulkanRenderer::PrepareFrameCompute()
-{
-	SIMPLE_PROFILER_PROFILE_SCOPE("VulkanRenderer::PrepareFrameCompute");
-
-	VK_CHECK_RESULT(vkWaitForFences(mVulkanDevice->mLogicalVkDevice, 1, &mComputeContext.mFences[mCurrentBufferIndex], VK_TRUE, Core::uint64_max));
-	VK_CHECK_RESULT(vkResetFences(mVulkanDevice->mLogicalVkDevice, 1, &mComputeContext.mFences[mCurrentBufferIndex]));
-
-	// Get draw count from compute
-	std::memcpy(&mIndrectDrawInfo, mIndirectDrawCountBuffers[mCurrentBufferIndex].mMappedData, sizeof(mIndrectDrawInfo));
-}
-
 void VulkanRenderer::BuildComputeCommandBuffer()
 {
 	SIMPLE_PROFILER_PROFILE_SCOPE("VulkanRenderer::BuildComputeCommandBuffer");
@@ -919,82 +1980,63 @@ void VulkanRenderer::BuildComputeCommandBuffer()
 
 	const VkCommandBufferBeginInfo commandBufferBeginInfo = VulkanInitializers::CommandBufferBeginInfo();
 	VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo));
+	WriteFrameStatisticsTimestamp(commandBuffer, 0);
 
 	// Acquire barrier
 	// Add memory barrier to ensure that the indirect commands have been consumed before the compute shader updates them
 	if (mVulkanDevice->mQueueFamilyIndices.mGraphics != mVulkanDevice->mQueueFamilyIndices.mCompute)
 	{
-		const VkBufferMemoryBarrier bufferMemoryBarrier =
-		{
-			VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-			nullptr,
+		const std::array<VkBufferMemoryBarrier, 4> bufferMemoryBarriers = GetCullOutputBarriers(
+			mCurrentBufferIndex,
 			0,
-			VK_ACCESS_SHADER_WRITE_BIT,
+			VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
 			mVulkanDevice->mQueueFamilyIndices.mGraphics,
-			mVulkanDevice->mQueueFamilyIndices.mCompute,
-			mIndirectCommandsBuffers[mCurrentBufferIndex].mVkBuffer,
-			0,
-			mIndirectCommandsBuffers[mCurrentBufferIndex].mVkDescriptorBufferInfo.range
-		};
+			mVulkanDevice->mQueueFamilyIndices.mCompute);
 		vkCmdPipelineBarrier(
 			commandBuffer,
 			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
 			0,
 			0,
 			nullptr,
-			1,
-			&bufferMemoryBarrier,
+			static_cast<Core::uint32>(bufferMemoryBarriers.size()),
+			bufferMemoryBarriers.data(),
 			0,
 			nullptr);
 	}
 
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mComputeContext.mPipeline);
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mComputeContext.mPipelineLayout, 0, 1, &mComputeContext.mDescriptorSets[mCurrentBufferIndex], 0, nullptr);
-
-	// Clear the buffer that the compute shader pass will write statistics and draw calls to
-	vkCmdFillBuffer(commandBuffer, mIndirectDrawCountBuffers[mCurrentBufferIndex].mVkBuffer, 0, mIndirectDrawCountBuffers[mCurrentBufferIndex].mVkDescriptorBufferInfo.range, 0);
-
-	// This barrier ensures that the fill command is finished before the compute shader can start writing to the buffer
-	const VkMemoryBarrier memoryBarrier =
+	// Upload the instances that changed since this frame slot was last used, the fill barrier in CullInstances makes them visible to the cull shader
+	if (!mInstanceCopyRegions.empty())
 	{
-		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
-		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-		.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
-	};
-	vkCmdPipelineBarrier(
-		commandBuffer,
-		VK_PIPELINE_STAGE_TRANSFER_BIT,
-		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-		0,
-		1,
-		&memoryBarrier,
-		0,
-		nullptr,
-		0,
-		nullptr);
+		vkCmdCopyBuffer(commandBuffer, mInstanceUploadBuffers[mCurrentBufferIndex].mVkBuffer, mInstanceBuffer.mVkBuffer, static_cast<Core::uint32>(mInstanceCopyRegions.size()), mInstanceCopyRegions.data());
+	}
+
+	// The early pass tests against the pyramid of the previous frame, as seen from the camera that rendered it
+	// Instances it skips are re-tested by the late pass in the graphics command buffer of this frame
+	mOcclusionCulling.mIsEarlyPassOccluding = mOcclusionCulling.mIsSupported && mOcclusionCulling.mIsEnabled && mOcclusionCulling.mIsDepthPyramidValid && !mCpuCulling.mIsCullingInstances;
+	OcclusionCullingPushConstant pushConstant = mOcclusionCulling.mPushConstant;
+	pushConstant.mIsOcclusionCullingEnabled = mOcclusionCulling.mIsEarlyPassOccluding ? 1 : 0;
+	pushConstant.mIsLatePass = 0;
 
-	// Dispatch the compute job
-	// The compute shader will do the frustum culling and adjust the indirect draw calls depending on object visibility.
+	// The compute shader will do the frustum culling and append the visible instances to one draw per LOD.
 	// It also determines the lod to use depending on distance to the viewer.
-	vkCmdDispatch(commandBuffer, mIndirectDrawCount / 16, 1, 1);
+	// While the instances are culled on the CPU, WriteCpuCulledInstances has already done both.
+	if (!mCpuCulling.mIsCullingInstances)
+	{
+		SIMPLE_PROFILER_GPU_SCOPE(commandBuffer, "Cull");
+		CullInstances(commandBuffer, mComputeContext.mDescriptorSets[mCurrentBufferIndex], mIndirectDrawCountBuffers[mCurrentBufferIndex], pushConstant);
+	}
 
 	// Release barrier
 	// Add memory barrier to ensure that the compute shader has finished writing the indirect command buffer before it's consumed
 	if (mVulkanDevice->mQueueFamilyIndices.mGraphics != mVulkanDevice->mQueueFamilyIndices.mCompute)
 	{
-		const VkBufferMemoryBarrier bufferMemoryBarrier =
-		{
-			VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-			nullptr,
+		const std::array<VkBufferMemoryBarrier, 4> bufferMemoryBarriers = GetCullOutputBarriers(
+			mCurrentBufferIndex,
 			VK_ACCESS_SHADER_WRITE_BIT,
 			0,
 			mVulkanDevice->mQueueFamilyIndices.mCompute,
-			mVulkanDevice->mQueueFamilyIndices.mGraphics,
-			mIndirectCommandsBuffers[mCurrentBufferIndex].mVkBuffer,
-			0,
-			mIndirectCommandsBuffers[mCurrentBufferIndex].mVkDescriptorBufferInfo.range
-		};
+			mVulkanDevice->mQueueFamilyIndices.mGraphics);
 		vkCmdPipelineBarrier(
 			commandBuffer,
 			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
@@ -1002,12 +2044,13 @@ void VulkanRenderer::BuildComputeCommandBuffer()
 			0,
 			0,
 			nullptr,
-			1,
-			&bufferMemoryBarrier,
+			static_cast<Core::uint32>(bufferMemoryBarriers.size()),
+			bufferMemoryBarriers.data(),
 			0,
 			nullptr);
 	}
 
+	WriteFrameStatisticsTimestamp(commandBuffer, 1);
 	vkEndCommandBuffer(commandBuffer);
 }
 
@@ -1018,13 +2061,35 @@ void VulkanRenderer::UpdateModelMatrix()
 	const Math::Vector3f pivotPoint = Math::Vector3f{20.0f, 0.0f, 80.0f};
 	mVoyagerModelMatrix = Math::Translate(mVoyagerModelMatrix, -pivotPoint);
 
+	// Benchmarks turn it by one tick per frame like the camera path, so every run renders the same frames
+	const float deltaTime = mCameraPath ? 1.0f / mEngineProperties.lock()->mFixedTickRate : mFrametime;
+
 	static constexpr float angle = Math::ToRadians(-5.0f);
 	const Math::Vector3f rotationAxis = Math::Vector3f{0.0f, 1.0f, 0.0f};
-	mVoyagerModelMatrix = Math::Rotate(mVoyagerModelMatrix, angle * mFrametime, rotationAxis);
+	mVoyagerModelMatrix = Math::Rotate(mVoyagerModelMatrix, angle * deltaTime, rotationAxis);
 
 	mVoyagerModelMatrix = Math::Translate(mVoyagerModelMatrix, pivotPoint);
 }
 
+void VulkanRenderer::UpdateAnimations()
+{
+	SIMPLE_PROFILER_PROFILE_SCOPE("VulkanRenderer::UpdateAnimations");
+
+	// Pre-transformed models are skipped, posing them would only move the CPU culling bounds away from the drawn geometry
+	for (const UniqueIdentifier identifier : {mModelIdentifiers.mVoyagerModelIdentifier, mModelIdentifiers.mPlanetModelIdentifier, mModelIdentifiers.mSuzanneModelIdentifier})
+	{
+		vkglTF::Model* model = mModelManager->GetModel(identifier);
+		if (model && !model->animations.empty() && !model->mIsPreTransformed && !mAnimationSystem->IsDriven(model))
+		{
+			mAnimationSystem->CreateInstance(*model, true)->Play(0);
+		}
+	}
+
+	// Benchmarks advance by one tick per frame like the camera path
+	const float deltaTime = mCameraPath ? 1.0f / mEngineProperties.lock()->mFixedTickRate : mFrametime;
+	mAnimationSystem->Update(deltaTime, mJobSystem.lock().get());
+}
+
 void VulkanRenderer::UpdateUniformBuffers()
 {
 	SIMPLE_PROFILER_PROFILE_SCOPE("VulkanRenderer::UpdateUniformBuffers");
@@ -1036,31 +2101,50 @@ void VulkanRenderer::UpdateUniformBuffers()
 	if (!mShouldFreezeFrustum)
 	{
 		mUniformBufferData.mViewPosition = mCamera->GetViewPosition();
+		mMeshletCulling.mPushConstant.mCameraPosition = Math::Inverse(mUniformBufferData.mViewMatrix)[3];
 		mViewFrustum.UpdateFrustum(mUniformBufferData.mProjectionMatrix * mUniformBufferData.mViewMatrix);
 		std::memcpy(mUniformBufferData.mFrustumPlanes, mViewFrustum.mPlanes.data(), sizeof(Math::Vector4f) * 6);
 	}
-
-	std::memcpy(mVulkanUniformBuffers[mCurrentBufferIndex].mMappedData, &mUniformBufferData, sizeof(UniformBufferData));
 }
 
 void VulkanRenderer::SubmitFrameGraphics()
 {
 	SIMPLE_PROFILER_PROFILE_SCOPE("VulkanRenderer::SubmitFrameGraphics");
 
-	const VkPipelineStageFlags waitPipelineStageMask[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT };
-	const VkSemaphore waitSemaphores[2] = {mGraphicsContext.mPresentCompleteSemaphores[mCurrentBufferIndex], mComputeContext.mSemaphores[mCurrentBufferIndex].mCompleteSemaphore};
+	// Until the asset uploads have finished, also wait on the upload timeline (binary semaphore values are ignored)
+	const bool isWaitingForUploads = !mStagingRing->IsComplete(mUploadTimelineValue);
+	// The late cull pass also waits on the early one, since it rewrites its draws and visibility (and samples a depth pyramid rebuilt in this command buffer)
+	const VkPipelineStageFlags waitPipelineStageMask[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT};
+	const VkSemaphore waitSemaphores[3] = {mGraphicsContext.mPresentCompleteSemaphores[mCurrentBufferIndex], mComputeContext.mSemaphores[mCurrentBufferIndex].mCompleteSemaphore, mStagingRing->GetTimelineSemaphore()};
+	const Core::uint64 waitSemaphoreValues[3] = {0, 0, mUploadTimelineValue};
 	const VkSemaphore signalSemaphores[2] = {mGraphicsContext.mRenderCompleteSemaphores[mCurrentImageIndex], mComputeContext.mSemaphores[mCurrentBufferIndex].mReadySemaphore};
+	// Headless frames neither wait for an acquired image nor signal its presentation, so the first semaphore of both lists is skipped
+	const Core::uint32 firstSemaphore = mVulkanSwapChain.IsHeadless() ? 1 : 0;
+	const VkTimelineSemaphoreSubmitInfo timelineSemaphoreSubmitInfo{
+		.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+		.waitSemaphoreValueCount = 3 - firstSemaphore,
+		.pWaitSemaphoreValues = waitSemaphoreValues + firstSemaphore
+	};
 	const VkSubmitInfo submitInfo{
 		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-		.waitSemaphoreCount = 2,
-		.pWaitSemaphores = waitSemaphores,
-		.pWaitDstStageMask = waitPipelineStageMask,
+		.pNext = isWaitingForUploads ? &timelineSemaphoreSubmitInfo : nullptr,
+		.waitSemaphoreCount = (isWaitingForUploads ? 3u : 2u) - firstSemaphore,
+		.pWaitSemaphores = waitSemaphores + firstSemaphore,
+		.pWaitDstStageMask = waitPipelineStageMask + firstSemaphore,
 		.commandBufferCount = 1,
 		.pCommandBuffers = &mGraphicsContext.mCommandBuffers[mCurrentBufferIndex],
-		.signalSemaphoreCount = 2,
-		.pSignalSemaphores = signalSemaphores
+		.signalSemaphoreCount = 2 - firstSemaphore,
+		.pSignalSemaphores = signalSemaphores + firstSemaphore
 	};
-	VK_CHECK_RESULT(vkQueueSubmit(mGraphicsContext.mQueue, 1, &submitInfo, mGraphicsContext.mFences[mCurrentBufferIndex]));
+	VK_CHECK_RESULT(vkResetFences(mVulkanDevice->mLogicalVkDevice, 1, &mGraphicsContext.mFences[mCurrentBufferIndex]));
+	mVulkanDevice->QueueSubmit(mGraphicsContext.mQueue, submitInfo, mGraphicsContext.mFences[mCurrentBufferIndex]);
+	mGraphicsContext.mIsSubmitted[mCurrentBufferIndex] = true;
+
+	if (mVulkanSwapChain.IsHeadless())
+	{
+		mCurrentBufferIndex = (mCurrentBufferIndex + 1) % gMaxConcurrentFrames;
+		return;
+	}
 
 	const VkPresentInfoKHR presentInfo{
 		.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
@@ -1071,7 +2155,7 @@ void VulkanRenderer::SubmitFrameGraphics()
 		.pImageIndices = &mCurrentImageIndex
 	};
 
-	const VkResult result = vkQueuePresentKHR(mGraphicsContext.mQueue, &presentInfo);
+	const VkResult result = mVulkanDevice->QueuePresent(mGraphicsContext.mQueue, presentInfo);
 	// Recreate the swapchain if it's no longer compatible with the surface (OUT_OF_DATE) or no longer optimal for presentation (SUBOPTIMAL)
 	if ((result == VK_ERROR_OUT_OF_DATE_KHR) || (result == VK_SUBOPTIMAL_KHR) || mWindow.lock()->GetWindowProperties().mIsFramebufferResized)
 	{
@@ -1097,19 +2181,29 @@ void VulkanRenderer::SubmitFrameCompute()
 {
 	SIMPLE_PROFILER_PROFILE_SCOPE("VulkanRenderer::SubmitFrameCompute");
 
-	const VkPipelineStageFlags waitDstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	// Instance and LOD data may still be in flight on the transfer queue during the first frames
+	const bool isWaitingForUploads = !mStagingRing->IsComplete(mUploadTimelineValue);
+	const VkPipelineStageFlags waitDstStageMask[2] = {VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT};
+	const VkSemaphore waitSemaphores[2] = {mComputeContext.mSemaphores[(mCurrentBufferIndex + gMaxConcurrentFrames - 1) % gMaxConcurrentFrames].mReadySemaphore, mStagingRing->GetTimelineSemaphore()};
+	const Core::uint64 waitSemaphoreValues[2] = {0, mUploadTimelineValue};
+	const VkTimelineSemaphoreSubmitInfo timelineSemaphoreSubmitInfo{
+		.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+		.waitSemaphoreValueCount = 2,
+		.pWaitSemaphoreValues = waitSemaphoreValues
+	};
 	const VkSubmitInfo submitInfo =
 	{
 		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-		.waitSemaphoreCount = 1,
-		.pWaitSemaphores = &mComputeContext.mSemaphores[((int)mCurrentBufferIndex - 1) % gMaxConcurrentFrames].mReadySemaphore,
-		.pWaitDstStageMask = &waitDstStageMask,
+		.pNext = isWaitingForUploads ? &timelineSemaphoreSubmitInfo : nullptr,
+		.waitSemaphoreCount = isWaitingForUploads ? 2u : 1u,
+		.pWaitSemaphores = waitSemaphores,
+		.pWaitDstStageMask = waitDstStageMask,
 		.commandBufferCount = 1,
 		.pCommandBuffers = &mComputeContext.mCommandBuffers[mCurrentBufferIndex],
 		.signalSemaphoreCount = 1,
 		.pSignalSemaphores = &mComputeContext.mSemaphores[mCurrentBufferIndex].mCompleteSemaphore,
 	};
-	VK_CHECK_RESULT(vkQueueSubmit(mComputeContext.mQueue, 1, &submitInfo, mComputeContext.mFences[mCurrentBufferIndex]));
+	mVulkanDevice->QueueSubmit(mComputeContext.mQueue, submitInfo, mComputeContext.mFences[mCurrentBufferIndex]);
 }
 
 void VulkanRenderer::CreateVkInstance()
@@ -1169,7 +2263,8 @@ void VulkanRenderer::CreateVkInstance()
 	if (mEngineProperties.lock()->mIsValidationEnabled || std::find(mSupportedInstanceExtensions.begin(), mSupportedInstanceExtensions.end(), VK_EXT_DEBUG_UTILS_EXTENSION_NAME) != mSupportedInstanceExtensions.end())
 		mInstanceExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 
-	const std::vector<const char*> glfwRequiredExtensions = mWindow.lock()->GetGlfwRequiredExtensions();
+	// A headless run has no surface, so it doesn't need the window system extensions either
+	const std::vector<const char*> glfwRequiredExtensions = mEngineProperties.lock()->mIsHeadless ? std::vector<const char*>{} : mWindow.lock()->GetGlfwRequiredExtensions();
 	for (const char* glfwRequiredExtension : glfwRequiredExtensions)
 	{
 		auto iterator = std::ranges::find_if(mInstanceExtensions, [&](const char* aInstanceExtension)
@@ -1245,7 +2340,10 @@ void VulkanRenderer::CreateVkInstance()
 		throw std::runtime_error(std::format("Could not create Vulkan instance: {}", VulkanTools::GetErrorString(result)));
 	}
 
-	mWindow.lock()->CreateWindowSurface(&mInstance, &mVulkanSwapChain.mVkSurfaceKHR);
+	if (!mEngineProperties.lock()->mIsHeadless)
+	{
+		mWindow.lock()->CreateWindowSurface(&mInstance, &mVulkanSwapChain.mVkSurfaceKHR);
+	}
 
 	// If the debug utils extension is present we set up debug functions, so samples can label objects for debugging
 	if (std::find(mSupportedInstanceExtensions.begin(), mSupportedInstanceExtensions.end(), VK_EXT_DEBUG_UTILS_EXTENSION_NAME) != mSupportedInstanceExtensions.end())
@@ -1270,7 +2368,29 @@ void VulkanRenderer::CreateVulkanDevice()
 	VkPhysicalDevice vkPhysicalDevice = physicalDevices[selectedDevice];
 	mVulkanDevice = new VulkanDevice();
 	mVulkanDevice->CreatePhysicalDevice(vkPhysicalDevice);
-	mVulkanDevice->CreateLogicalDevice(mEnabledDeviceExtensions, &mPhysicalDevice13Features, true, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+
+	// Draw counts read from a buffer let the meshlet culling pass issue only the visible meshlets
+	VkPhysicalDeviceVulkan12Features supportedPhysicalDevice12Features{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+	VkPhysicalDeviceFeatures2 supportedPhysicalDeviceFeatures2{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, .pNext = &supportedPhysicalDevice12Features};
+	vkGetPhysicalDeviceFeatures2(vkPhysicalDevice, &supportedPhysicalDeviceFeatures2);
+	mPhysicalDevice12Features.drawIndirectCount = supportedPhysicalDevice12Features.drawIndirectCount;
+
+	// Model textures are indexed from a single bindless array, these are core in Vulkan 1.3 but still have to be enabled
+	if (!supportedPhysicalDevice12Features.runtimeDescriptorArray || !supportedPhysicalDevice12Features.shaderSampledImageArrayNonUniformIndexing
+		|| !supportedPhysicalDevice12Features.descriptorBindingPartiallyBound || !supportedPhysicalDevice12Features.descriptorBindingSampledImageUpdateAfterBind
+		|| !supportedPhysicalDevice12Features.descriptorBindingUpdateUnusedWhilePending)
+	{
+		throw std::runtime_error("Selected device doesn't support descriptor indexing");
+	}
+
+	mPhysicalDevice12Features.descriptorIndexing = VK_TRUE;
+	mPhysicalDevice12Features.runtimeDescriptorArray = VK_TRUE;
+	mPhysicalDevice12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	mPhysicalDevice12Features.descriptorBindingPartiallyBound = VK_TRUE;
+	mPhysicalDevice12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	mPhysicalDevice12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+
+	mVulkanDevice->CreateLogicalDevice(mEnabledDeviceExtensions, &mPhysicalDevice13Features, !mEngineProperties.lock()->mIsHeadless, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT);
 }
 
 void VulkanRenderer::CreatePipelineCache()
@@ -1283,47 +2403,22 @@ void VulkanRenderer::CreatePipelineCache()
 
 void VulkanRenderer::PrepareIndirectData()
 {
-	mIndirectDrawCount = gModelInstanceCount * gModelInstanceCount * gModelInstanceCount;
-	mIndirectCommands.resize(mIndirectDrawCount);
-
-	for (Core::uint8 x = 0; x < gModelInstanceCount; x++)
-	{
-		for (Core::uint8 y = 0; y < gModelInstanceCount; y++)
-		{
-			for (Core::uint8 z = 0; z < gModelInstanceCount; z++)
-			{
-				const Core::uint32 index = x + y * gModelInstanceCount + z * gModelInstanceCount * gModelInstanceCount;
-				mIndirectCommands[index].instanceCount = 1;
-				mIndirectCommands[index].firstInstance = index;
-				// firstIndex and indexCount are written by the compute shader
-			}
-		}
-	}
-
-	mIndrectDrawInfo.mDrawCount = static_cast<Core::uint32>(mIndirectCommands.size());
-
-	Buffer stagingBuffer;
-	VK_CHECK_RESULT(mVulkanDevice->CreateBuffer(
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		&stagingBuffer,
-		mIndirectCommands.size() * sizeof(VkDrawIndexedIndirectCommand),
-		mIndirectCommands.data()));
-
+	// The draws are written by the compute shader, one per LOD that has visible instances
+	const IndirectDrawCommands indirectCommands{};
+	const VkDeviceSize indirectCommandsSize = sizeof(IndirectDrawCommands);
 	for (Buffer& indirectCommandsBuffer : mIndirectCommandsBuffers)
 	{
 		VK_CHECK_RESULT(mVulkanDevice->CreateBuffer(
 			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 			&indirectCommandsBuffer,
-			stagingBuffer.mVkDeviceSize));
+			indirectCommandsSize));
 
-		mVulkanDevice->CopyBuffer(&stagingBuffer, &indirectCommandsBuffer, mGraphicsContext.mQueue);
+		mStagingRing->UploadBuffer(indirectCommandsBuffer.mVkBuffer, &indirectCommands, indirectCommandsSize);
 
 		// Add an initial release barrier to the graphics queue,
 		// so that when the compute command buffer executes for the first time
 		// it doesn't complain about a lack of a corresponding "release" to its "acquire"
-		VkCommandBuffer barrierCommandBuffer = mVulkanDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
 		if (mVulkanDevice->mQueueFamilyIndices.mGraphics != mVulkanDevice->mQueueFamilyIndices.mCompute)
 		{
 			const VkBufferMemoryBarrier bufferMemoryBarrier =
@@ -1339,113 +2434,344 @@ void VulkanRenderer::PrepareIndirectData()
 				indirectCommandsBuffer.mVkDescriptorBufferInfo.range
 			};
 			vkCmdPipelineBarrier(
-				barrierCommandBuffer,
+				mStagingRing->GetGraphicsCommandBuffer(),
 				VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
 				VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
 				0,
 				0,
 				nullptr,
-				1, 
+				1,
 				&bufferMemoryBarrier,
 				0, 
 				nullptr);
 		}
-
-		mVulkanDevice->FlushCommandBuffer(barrierCommandBuffer, mGraphicsContext.mQueue, true);
 	}
 
-	stagingBuffer.Destroy();
+	CreateInstanceBuffers(std::max(std::bit_ceil(mInstanceRegistry->GetInstanceCount()), gMinInstanceCapacity));
 }
 
 void VulkanRenderer::PrepareInstanceData()
 {
-	std::vector<InstanceData> instanceData(mIndirectDrawCount);
+	ECS::Scene& scene = *mScene.lock();
+	mInstanceRegistry = std::make_unique<InstanceRegistry>(scene, mModelIdentifiers.mSuzanneModelIdentifier);
 
+	// Demo grid of instanced models, the instance buffer follows the entities from here on
 	for (Core::uint8 x = 0; x < gModelInstanceCount; x++)
 	{
 		for (Core::uint8 y = 0; y < gModelInstanceCount; y++)
 		{
 			for (Core::uint8 z = 0; z < gModelInstanceCount; z++)
 			{
-				const Core::uint32 index = x + y * gModelInstanceCount + z * gModelInstanceCount * gModelInstanceCount;
-				instanceData[index].mPosition = Math::Vector3f((float)x, (float)y, (float)z) - Math::Vector3f((float)gModelInstanceCount / 2.0f);
-				instanceData[index].mScale = 2.0f;
+				ECS::Entity entity = scene.CreateEntity("Suzanne");
+				ECS::TransformComponent& transform = entity.GetComponent<ECS::TransformComponent>();
+				transform.mPosition = Math::Vector3f((float)x, (float)y, (float)z) - Math::Vector3f((float)gModelInstanceCount / 2.0f);
+				transform.mScale = Math::Vector3f(2.0f);
+
+				// The top layer rises and falls in a wave, moved by the fixed update and drawn between its last two ticks
+				if (y == gModelInstanceCount - 1)
+				{
+					ECS::OscillationComponent oscillation{transform.mPosition + Math::Vector3f(0.0f, 0.5f, 0.0f), Math::Vector3f(0.0f, 0.5f, 0.0f), 2.0f, 0.25f * static_cast<float>(x + z)};
+					entity.AddComponent<ECS::OscillationComponent>(oscillation);
+					entity.AddComponent<ECS::InterpolationComponent>(transform);
+				}
+
+				entity.AddComponent<ECS::InstancedMeshComponent>(mModelIdentifiers.mSuzanneModelIdentifier);
 			}
 		}
-	}
+	}
+
+	mInstanceRegistry->Update(1.0f);
+	mIndirectDrawCount = mInstanceRegistry->GetInstanceCount();
+
+	// Draw count buffer for host side info readback
+	for (Buffer& indirectDrawCountBuffer : mIndirectDrawCountBuffers)
+	{
+		VK_CHECK_RESULT(mVulkanDevice->CreateBuffer(
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&indirectDrawCountBuffer,
+			sizeof(mIndrectDrawInfo)));
+
+		VK_CHECK_RESULT(indirectDrawCountBuffer.Map());
+	}
+
+	// Statistics of the late occlusion pass, which runs on the graphics queue
+	for (Buffer& lateDrawCountBuffer : mOcclusionCulling.mLateDrawCountBuffers)
+	{
+		VK_CHECK_RESULT(mVulkanDevice->CreateBuffer(
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&lateDrawCountBuffer,
+			sizeof(IndirectDrawInfo)));
+
+		VK_CHECK_RESULT(lateDrawCountBuffer.Map());
+		std::memset(lateDrawCountBuffer.mMappedData, 0, sizeof(IndirectDrawInfo));
+	}
+
+	// Shader storage buffer containing index offsets and counts for the LODs
+	std::vector<LoDLevel>& LODLevels = mCpuCulling.mLoDLevels;
+	LODLevels.clear();
+
+	Core::uint32 nodeIndex = 0;
+	for (const vkglTF::Node* node : mModelManager->GetModel(mModelIdentifiers.mSuzanneModelIdentifier)->nodes)
+	{
+		LoDLevel lod{};
+		lod.mFirstIndex = node->mMesh->mPrimitives[0]->firstIndex; // First index for this LOD
+		lod.mIndexCount = node->mMesh->mPrimitives[0]->indexCount; // Index count for this LOD
+		lod.mDistance = 5.0f + nodeIndex * 5.0f; // Starting distance (to viewer) for the next LOD
+		nodeIndex++;
+		LODLevels.push_back(lod);
+	}
+
+	// The cull shader compares against the distances of all but the last of its LODs
+	const Core::size lodDistanceCount = std::min<Core::size>(LODLevels.size(), gMaxLOD + 1) - 1;
+	mCpuCulling.mLoDDistances.clear();
+	for (Core::size i = 0; i < lodDistanceCount; i++)
+	{
+		mCpuCulling.mLoDDistances.push_back(LODLevels[i].mDistance);
+	}
+
+	const VkDeviceSize LODLevelsSize = LODLevels.size() * sizeof(LoDLevel);
+	VK_CHECK_RESULT(mVulkanDevice->CreateBuffer(
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		&mComputeContext.mLoDBuffers,
+		LODLevelsSize));
+
+	mStagingRing->UploadBuffer(mComputeContext.mLoDBuffers.mVkBuffer, LODLevels.data(), LODLevelsSize);
+}
+
+void VulkanRenderer::CreateInstanceBuffers(Core::uint32 aCapacity)
+{
+	const bool isResizing = mInstanceCapacity != 0;
+	if (isResizing)
+	{
+		mInstanceBuffer.Destroy();
+
+		for (Core::uint32 i = 0; i < gMaxConcurrentFrames; i++)
+		{
+			mInstanceUploadBuffers[i].Destroy();
+			mInstanceVisibilityBuffers[i].Destroy();
+			mVisibleInstanceBuffers[i].Destroy();
+			mCpuCulling.mVisibleInstanceBuffers[i].Destroy();
+		}
+	}
+
+	mInstanceCapacity = aCapacity;
+
+	VK_CHECK_RESULT(mVulkanDevice->CreateBuffer(
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		&mInstanceBuffer,
+		mInstanceCapacity * sizeof(InstanceData)));
+
+	for (Core::uint32 i = 0; i < gMaxConcurrentFrames; i++)
+	{
+		VK_CHECK_RESULT(mVulkanDevice->CreateBuffer(
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&mInstanceUploadBuffers[i],
+			mInstanceCapacity * sizeof(InstanceData)));
+
+		VK_CHECK_RESULT(mInstanceUploadBuffers[i].Map());
+
+		VK_CHECK_RESULT(mVulkanDevice->CreateBuffer(
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			&mInstanceVisibilityBuffers[i],
+			mInstanceCapacity * sizeof(Core::uint32)));
+
+		VK_CHECK_RESULT(mVulkanDevice->CreateBuffer(
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			&mVisibleInstanceBuffers[i],
+			mInstanceCapacity * sizeof(InstanceData)));
+
+		VK_CHECK_RESULT(mVulkanDevice->CreateBuffer(
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&mCpuCulling.mVisibleInstanceBuffers[i],
+			mInstanceCapacity * sizeof(InstanceData)));
+
+		VK_CHECK_RESULT(mCpuCulling.mVisibleInstanceBuffers[i].Map());
+	}
+
+	// Same initial release as for the indirect commands, the compute queue acquires the buffers before it writes them
+	if (mVulkanDevice->mQueueFamilyIndices.mGraphics != mVulkanDevice->mQueueFamilyIndices.mCompute)
+	{
+		std::vector<const Buffer*> buffers = {&mInstanceBuffer};
+		for (Core::uint32 i = 0; i < gMaxConcurrentFrames; i++)
+		{
+			buffers.push_back(&mInstanceVisibilityBuffers[i]);
+			buffers.push_back(&mVisibleInstanceBuffers[i]);
+		}
+
+		std::vector<VkBufferMemoryBarrier> bufferMemoryBarriers;
+		for (const Buffer* buffer : buffers)
+		{
+			bufferMemoryBarriers.push_back(
+			{
+				VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+				nullptr,
+				VK_ACCESS_SHADER_READ_BIT,
+				0,
+				mVulkanDevice->mQueueFamilyIndices.mGraphics,
+				mVulkanDevice->mQueueFamilyIndices.mCompute,
+				buffer->mVkBuffer,
+				0,
+				buffer->mVkDescriptorBufferInfo.range
+			});
+		}
+
+		vkCmdPipelineBarrier(
+			mStagingRing->GetGraphicsCommandBuffer(),
+			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0,
+			0,
+			nullptr,
+			static_cast<Core::uint32>(bufferMemoryBarriers.size()),
+			bufferMemoryBarriers.data(),
+			0,
+			nullptr);
+	}
+
+	if (!isResizing)
+	{
+		return;
+	}
+
+	// The release has to be submitted before the next compute submission, which waits on the upload timeline
+	mUploadTimelineValue = mStagingRing->Submit();
+
+	for (Core::uint32 i = 0; i < gMaxConcurrentFrames; i++)
+	{
+		for (const VkDescriptorSet descriptorSet : {mComputeContext.mDescriptorSets[i], mOcclusionCulling.mLateDescriptorSets[i]})
+		{
+			const std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+				VulkanInitializers::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &mInstanceBuffer.mVkDescriptorBufferInfo),
+				VulkanInitializers::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6, &mInstanceVisibilityBuffers[i].mVkDescriptorBufferInfo),
+				VulkanInitializers::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 7, &mVisibleInstanceBuffers[i].mVkDescriptorBufferInfo)
+			};
+			vkUpdateDescriptorSets(mVulkanDevice->mLogicalVkDevice, static_cast<Core::uint32>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+		}
+	}
+}
+
+void VulkanRenderer::UpdateInstanceData()
+{
+	SIMPLE_PROFILER_PROFILE_SCOPE("VulkanRenderer::UpdateInstanceData");
+
+	const Core::uint32 instanceCount = mInstanceRegistry->GetInstanceCount();
+	if (instanceCount > mInstanceCapacity)
+	{
+		// The buffers are used by the frames in flight, growing is rare enough to wait for them
+		VK_CHECK_RESULT(vkDeviceWaitIdle(mVulkanDevice->mLogicalVkDevice));
+
+		CreateInstanceBuffers(std::bit_ceil(instanceCount));
+		mInstanceRegistry->MarkAllDirty();
+	}
+
+	mIndirectDrawCount = instanceCount;
+
+	// Only the copy regions are collected here, PrepareFrame fills the upload buffer once the frame's previous use has finished with it
+	// Consecutive dirty instances are merged into a single copy region
+	mDirtyInstanceIndices.assign(mInstanceRegistry->GetDirtyInstances().begin(), mInstanceRegistry->GetDirtyInstances().end());
+	std::sort(mDirtyInstanceIndices.begin(), mDirtyInstanceIndices.end());
+
+	mInstanceCopyRegions.clear();
+	Core::uint32 uploadCount = 0;
+	for (Core::size i = 0; i < mDirtyInstanceIndices.size();)
+	{
+		const Core::uint32 firstInstance = mDirtyInstanceIndices[i];
+		Core::uint32 instanceRunCount = 1;
+		while (i + instanceRunCount < mDirtyInstanceIndices.size() && mDirtyInstanceIndices[i + instanceRunCount] == firstInstance + instanceRunCount)
+		{
+			instanceRunCount++;
+		}
 
-	Buffer stagingBuffer;
-	VK_CHECK_RESULT(mVulkanDevice->CreateBuffer(
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		&stagingBuffer,
-		instanceData.size() * sizeof(InstanceData),
-		instanceData.data()));
+		mInstanceCopyRegions.push_back({uploadCount * sizeof(InstanceData), firstInstance * sizeof(InstanceData), instanceRunCount * sizeof(InstanceData)});
 
-	VK_CHECK_RESULT(mVulkanDevice->CreateBuffer(
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		&mInstanceBuffer,
-		stagingBuffer.mVkDeviceSize));
+		uploadCount += instanceRunCount;
+		i += instanceRunCount;
+	}
 
-	mVulkanDevice->CopyBuffer(&stagingBuffer, &mInstanceBuffer, mGraphicsContext.mQueue);
+	// The bounds for CPU culling follow the same dirty instances, so they are ready whenever it's switched on
+	const std::vector<InstanceData>& instanceData = mInstanceRegistry->GetInstanceData();
+	mCpuCulling.mInstanceBounds.Resize(instanceCount);
+	for (const Core::uint32 instanceIndex : mDirtyInstanceIndices)
+	{
+		mCpuCulling.mInstanceBounds.SetSphere(instanceIndex, instanceData[instanceIndex].mPosition, VulkanRendererLocal::gInstanceBoundingRadius);
+	}
 
-	stagingBuffer.Destroy();
+	mInstanceRegistry->ClearDirtyInstances();
+}
 
-	// Draw count buffer for host side info readback
-	for (Buffer& indirectDrawCountBuffer : mIndirectDrawCountBuffers)
-	{
-		VK_CHECK_RESULT(mVulkanDevice->CreateBuffer(
-			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			&indirectDrawCountBuffer,
-			sizeof(mIndrectDrawInfo)));
+void VulkanRenderer::CullOnCpu()
+{
+	SIMPLE_PROFILER_PROFILE_SCOPE("VulkanRenderer::CullOnCpu");
 
-		VK_CHECK_RESULT(indirectDrawCountBuffer.Map());
-	}
+	// Same frustum and viewer as the cull shader, so freezing the frustum also freezes the LODs
+	const Math::Vector3f viewPosition = Math::Vector3f(mUniformBufferData.mViewPosition);
 
-	// Shader storage buffer containing index offsets and counts for the LODs
-	struct LOD
+	mCpuCulling.mModelBounds.Resize(static_cast<Core::uint32>(CpuCullingContext::Model::Count));
+	VulkanRendererLocal::SetModelBounds(mCpuCulling, CpuCullingContext::Model::Planet, mModelManager->GetModel(mModelIdentifiers.mPlanetModelIdentifier), mPlanetModelMatrix);
+	VulkanRendererLocal::SetModelBounds(mCpuCulling, CpuCullingContext::Model::Voyager, mModelManager->GetModel(mModelIdentifiers.mVoyagerModelIdentifier), mVoyagerModelMatrix);
+	FrustumCulling::Cull(mViewFrustum, viewPosition, {}, mCpuCulling.mModelBounds, mCpuCulling.mModelDrawList, mCpuCulling.mKernel);
+
+	if (mCpuCulling.mIsCullingModelParts)
 	{
-		Core::uint32 firstIndex;
-		Core::uint32 indexCount;
-		float distance;
-		float _pad0;
-	};
-	std::vector<LOD> LODLevels;
+		for (ModelPartCulling& parts : mCpuCulling.mModelParts)
+		{
+			if (parts.mModel)
+			{
+				VulkanRendererLocal::CullModelParts(parts, mViewFrustum, viewPosition, mCpuCulling.mKernel);
+			}
+		}
+	}
 
-	Core::uint32 nodeIndex = 0;
-	for (const vkglTF::Node* node : mModelManager->GetModel(mModelIdentifiers.mSuzanneModelIdentifier)->nodes)
+	if (mCpuCulling.mIsCullingInstances)
 	{
-		LOD lod{};
-		lod.firstIndex = node->mMesh->mPrimitives[0]->firstIndex; // First index for this LOD
-		lod.indexCount = node->mMesh->mPrimitives[0]->indexCount; // Index count for this LOD
-		lod.distance = 5.0f + nodeIndex * 5.0f; // Starting distance (to viewer) for this LOD
-		nodeIndex++;
-		LODLevels.push_back(lod);
+		FrustumCulling::Cull(mViewFrustum, viewPosition, mCpuCulling.mLoDDistances, mCpuCulling.mInstanceBounds, mCpuCulling.mInstanceDrawList, mCpuCulling.mKernel, mJobSystem.lock().get());
 	}
+}
 
-	VK_CHECK_RESULT(mVulkanDevice->CreateBuffer(
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		&stagingBuffer,
-		LODLevels.size() * sizeof(LOD),
-		LODLevels.data()));
+void VulkanRenderer::WriteCpuCulledInstances()
+{
+	SIMPLE_PROFILER_PROFILE_SCOPE("VulkanRenderer::WriteCpuCulledInstances");
 
-	VK_CHECK_RESULT(mVulkanDevice->CreateBuffer(
-		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		&mComputeContext.mLoDBuffers,
-		stagingBuffer.mVkDeviceSize));
+	const FrustumCulling::DrawList& drawList = mCpuCulling.mInstanceDrawList;
 
-	mVulkanDevice->CopyBuffer(&stagingBuffer, &mComputeContext.mLoDBuffers, mGraphicsContext.mQueue);
+	// The statistics go where the cull shader would have written them, so they are read back the same way
+	IndirectDrawInfo drawInfo{};
+	drawInfo.mDrawCount = drawList.GetVisibleCount();
+	std::copy_n(drawList.mCount.begin(), gMaxLOD + 1, drawInfo.mLoDCount);
+	std::memcpy(mIndirectDrawCountBuffers[mCurrentBufferIndex].mMappedData, &drawInfo, sizeof(IndirectDrawInfo));
 
-	stagingBuffer.Destroy();
+	InstanceData* visibleInstances = static_cast<InstanceData*>(mCpuCulling.mVisibleInstanceBuffers[mCurrentBufferIndex].mMappedData);
+	const std::vector<InstanceData>& instanceData = mInstanceRegistry->GetInstanceData();
+	const Core::uint32 batchCount = (drawList.GetVisibleCount() + VulkanRendererLocal::gVisibleInstanceCopyBatchSize - 1) / VulkanRendererLocal::gVisibleInstanceCopyBatchSize;
+	mJobSystem.lock()->ParallelFor(batchCount, [&](Core::uint32 aBatch)
+	{
+		const Core::uint32 begin = aBatch * VulkanRendererLocal::gVisibleInstanceCopyBatchSize;
+		const Core::uint32 end = std::min(begin + VulkanRendererLocal::gVisibleInstanceCopyBatchSize, drawList.GetVisibleCount());
+		for (Core::uint32 i = begin; i < end; i++)
+		{
+			visibleInstances[i] = instanceData[drawList.mIndices[i]];
+		}
+	});
 }
 
 void VulkanRenderer::InitializeSwapchain()
 {
-	mVulkanSwapChain.InitializeSurface();
+	if (mEngineProperties.lock()->mIsHeadless)
+	{
+		mVulkanSwapChain.InitializeHeadless();
+	}
+	else
+	{
+		mVulkanSwapChain.InitializeSurface();
+	}
 }
 
 VkPipelineShaderStageCreateInfo VulkanRenderer::LoadShader(const std::filesystem::path& aPath, VkShaderStageFlagBits aVkShaderStageMask)
@@ -1466,12 +2792,24 @@ VkPipelineShaderStageCreateInfo VulkanRenderer::LoadShader(const std::filesystem
 	return pipelineShaderStageCreateInfo;
 }
 
-void VulkanRenderer::DrawNode(const vkglTF::Node* aNode, VkCommandBuffer aCommandBuffer, RenderFlags aRenderFlags, VkPipelineLayout aPipelineLayout, Core::uint32 aBindImageSet)
+void VulkanRenderer::DrawNode(const vkglTF::Node* aNode, VkCommandBuffer aCommandBuffer, RenderFlags aRenderFlags, const ModelPartCulling* aCulling)
 {
+	// Nothing below a culled node is visible
+	if (aCulling && !aCulling->IsNodeVisible(aNode->mIndex))
+	{
+		return;
+	}
+
 	if (aNode->mMesh)
 	{
-		for (const vkglTF::Primitive* primitive : aNode->mMesh->mPrimitives)
+		for (Core::size i = 0; i < aNode->mMesh->mPrimitives.size(); i++)
 		{
+			if (aCulling && !aCulling->IsPrimitiveVisible(aCulling->mFirstPrimitives[aNode->mIndex] + static_cast<Core::uint32>(i)))
+			{
+				continue;
+			}
+
+			const vkglTF::Primitive* primitive = aNode->mMesh->mPrimitives[i];
 			bool shouldSkipPrimitive = false;
 			const vkglTF::Material& material = primitive->material;
 			if ((aRenderFlags & RenderFlags::RenderOpaqueNodes) == RenderFlags::RenderOpaqueNodes)
@@ -1491,11 +2829,7 @@ void VulkanRenderer::DrawNode(const vkglTF::Node* aNode, VkCommandBuffer aComman
 
 			if (!shouldSkipPrimitive)
 			{
-				if ((aRenderFlags & RenderFlags::BindImages) == RenderFlags::BindImages)
-				{
-					vkCmdBindDescriptorSets(aCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelineLayout, aBindImageSet, 1, &material.mDescriptorSet, 0, nullptr);
-				}
-
+				PushMaterialIndex(aCommandBuffer, material);
 				vkCmdDrawIndexed(aCommandBuffer, primitive->indexCount, 1, primitive->firstIndex, 0, 0);
 			}
 		}
@@ -1503,20 +2837,98 @@ void VulkanRenderer::DrawNode(const vkglTF::Node* aNode, VkCommandBuffer aComman
 
 	for (const vkglTF::Node* child : aNode->mChildren)
 	{
-		DrawNode(child, aCommandBuffer, aRenderFlags, aPipelineLayout, aBindImageSet);
+		DrawNode(child, aCommandBuffer, aRenderFlags, aCulling);
 	}
 }
 
-void VulkanRenderer::DrawModel(vkglTF::Model* aModel, VkCommandBuffer aCommandBuffer, RenderFlags aRenderFlags, VkPipelineLayout aPipelineLayout, Core::uint32 aBindImageSet)
+void VulkanRenderer::DrawModel(vkglTF::Model* aModel, VkCommandBuffer aCommandBuffer, RenderFlags aRenderFlags, const ModelPartCulling* aCulling)
 {
+	// Still loading
+	if (!aModel)
+	{
+		return;
+	}
+
+	// The parts are culled once the model has finished loading, until then everything is drawn
+	if (aCulling && aCulling->mModel != aModel)
+	{
+		aCulling = nullptr;
+	}
+
 	BindModelBuffers(aModel, aCommandBuffer);
 
 	for (const vkglTF::Node* node : aModel->nodes)
 	{
-		DrawNode(node, aCommandBuffer, aRenderFlags, aPipelineLayout, aBindImageSet);
+		DrawNode(node, aCommandBuffer, aRenderFlags, aCulling);
+	}
+}
+
+void VulkanRenderer::DrawModelMeshlets(vkglTF::Model* aModel, VkCommandBuffer aCommandBuffer, const ModelPartCulling* aCulling)
+{
+	if (aCulling && aCulling->mModel != aModel)
+	{
+		aCulling = nullptr;
+	}
+
+	BindModelBuffers(aModel, aCommandBuffer);
+
+	const Buffer& drawCommandBuffer = mMeshletCulling.mDrawCommandBuffers[mCurrentBufferIndex];
+	const Buffer& drawCountBuffer = mMeshletCulling.mDrawCountBuffers[mCurrentBufferIndex];
+	static constexpr Core::uint32 drawCommandStride = sizeof(VkDrawIndexedIndirectCommand);
+
+	// Meshlets are only built for pre-transformed vertices, so the node hierarchy doesn't matter and primitives can be drawn in any order
+	for (const vkglTF::Node* node : aModel->linearNodes)
+	{
+		if (!node->mMesh || (aCulling && !aCulling->IsNodeVisible(node->mIndex)))
+		{
+			continue;
+		}
+
+		for (Core::size primitiveIndex = 0; primitiveIndex < node->mMesh->mPrimitives.size(); primitiveIndex++)
+		{
+			// Primitives outside of the frustum don't need their meshlets tested either
+			if (aCulling && !aCulling->IsPrimitiveVisible(aCulling->mFirstPrimitives[node->mIndex] + static_cast<Core::uint32>(primitiveIndex)))
+			{
+				continue;
+			}
+
+			const vkglTF::Primitive* primitive = node->mMesh->mPrimitives[primitiveIndex];
+
+			// All meshlets of a primitive share its material, so it is pushed once for their draws
+			PushMaterialIndex(aCommandBuffer, primitive->material);
+			if (primitive->mMeshletCount == 0)
+			{
+				vkCmdDrawIndexed(aCommandBuffer, primitive->indexCount, 1, primitive->firstIndex, 0, 0);
+				continue;
+			}
+
+			const VkDeviceSize drawCommandOffset = primitive->mFirstMeshlet * drawCommandStride;
+			if (mMeshletCulling.mIsCompactingDraws)
+			{
+				// Only the visible meshlets the culling pass has compacted to the front of the primitive's range are drawn
+				vkCmdDrawIndexedIndirectCount(aCommandBuffer, drawCommandBuffer.mVkBuffer, drawCommandOffset, drawCountBuffer.mVkBuffer, primitive->mMeshletDrawIndex * sizeof(Core::uint32), primitive->mMeshletCount, drawCommandStride);
+			}
+			else if (mVulkanDevice->mEnabledPhysicalDeviceFeatures.multiDrawIndirect)
+			{
+				vkCmdDrawIndexedIndirect(aCommandBuffer, drawCommandBuffer.mVkBuffer, drawCommandOffset, primitive->mMeshletCount, drawCommandStride);
+			}
+			else
+			{
+				for (Core::uint32 i = 0; i < primitive->mMeshletCount; i++)
+				{
+					vkCmdDrawIndexedIndirect(aCommandBuffer, drawCommandBuffer.mVkBuffer, drawCommandOffset + i * drawCommandStride, 1, drawCommandStride);
+				}
+			}
+		}
 	}
 }
 
+void VulkanRenderer::PushMaterialIndex(VkCommandBuffer aCommandBuffer, const vkglTF::Material& aMaterial)
+{
+	// Only the material index changes between the draws of a model, the model matrix stays as pushed before
+	vkCmdPushConstants(aCommandBuffer, mGraphicsContext.mPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, offsetof(PushConstant, mMaterialIndex), sizeof(Core::uint32), &aMaterial.mBindlessIndex);
+}
+
 void VulkanRenderer::BindModelBuffers(vkglTF::Model* aModel, VkCommandBuffer aCommandBuffer)
 {
 	const VkDeviceSize offsets[1] = {0};
@@ -1529,14 +2941,25 @@ void VulkanRenderer::RenderFrame()
 	SIMPLE_PROFILER_PROFILE_SCOPE("VulkanRenderer::RenderFrame");
 
 	mFrameTimer->StartTimer();
-	
-	PrepareFrameCompute();
+
+	// SubmitFrameGraphics moves on to the next buffer index
+	const Core::uint32 bufferIndex = mCurrentBufferIndex;
+
+	// The CPU side of the frame is collected before any wait, so it overlaps with the frames the GPU is still working on
+	mModelManager->ProcessPendingLoads();
+	ReadBackFrameStatistics();
+	UpdateUIOverlay();
+	UpdateModelMatrix();
+	UpdateAnimations();
+	UpdateUniformBuffers();
+	UpdateInstanceData();
+	CullOnCpu();
+
+	PrepareFrame();
 	BuildComputeCommandBuffer();
 	SubmitFrameCompute();
 
 	PrepareFrameGraphics();
-	UpdateUniformBuffers();
-	UpdateModelMatrix();
 	BuildGraphicsCommandBuffer();
 	SubmitFrameGraphics();
 
@@ -1544,6 +2967,25 @@ void VulkanRenderer::RenderFrame()
 
 	mFrametime = static_cast<float>(mFrameTimer->GetDurationSeconds());
 
+	// The GPU side of the frame is read back by CollectFrameStatistics, once its buffer index comes around again
+	if (mFrameStatistics.mIsEnabled)
+	{
+		FrameStatistics& frame = mFrameStatistics.mPendingFrames[bufferIndex];
+		frame.mFrameNumber = mFrameStatistics.mFrameCount++;
+		frame.mFrameTimeMs = static_cast<double>(mEngineFrametime) * 1000.0;
+		frame.mRenderCpuTimeMs = static_cast<double>(mFrametime) * 1000.0;
+
+		const VulkanMemoryAllocator& memoryAllocator = *mVulkanDevice->mMemoryAllocator;
+		for (Core::uint32 i = 0; i < memoryAllocator.GetMemoryTypeCount(); i++)
+		{
+			const VulkanMemoryStatistics statistics = memoryAllocator.GetStatistics(i);
+			const VkMemoryPropertyFlags memoryPropertyFlags = memoryAllocator.GetMemoryTypeProperties(i);
+			frame.mDeviceLocalBytes += (memoryPropertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) ? statistics.mUsedBytes : 0;
+			frame.mHostVisibleBytes += (memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) ? statistics.mUsedBytes : 0;
+			frame.mReservedBytes += statistics.mReservedBytes;
+		}
+	}
+
 	mFrameCounter++;
 	const float fpsTimer = static_cast<float>(Time::GetDurationMilliseconds(mFrameTimer->GetEndTime(), mLastTimestamp));
 	if (fpsTimer > mFPSTimerInterval)
@@ -1576,6 +3018,11 @@ void VulkanRenderer::InitializeVulkan()
 		throw std::runtime_error("Invalid format");
 	}
 
+	// The depth pyramid for occlusion culling is built by sampling the depth buffer
+	VkFormatProperties depthFormatProperties;
+	vkGetPhysicalDeviceFormatProperties(mVulkanDevice->mPhysicalDevice, mVkDepthFormat, &depthFormatProperties);
+	mOcclusionCulling.mIsSupported = (depthFormatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+
 	mVulkanSwapChain.SetContext(mInstance, mVulkanDevice);
 }
 
@@ -1589,6 +3036,71 @@ void VulkanRenderer::CreateGraphicsCommandPool()
 	VK_CHECK_RESULT(vkCreateCommandPool(mVulkanDevice->mLogicalVkDevice, &commandPoolCreateInfo, nullptr, &mGraphicsContext.mCommandPool));
 }
 
+void VulkanRenderer::CreateStagingRing()
+{
+	VkQueue transferQueue = VK_NULL_HANDLE;
+	vkGetDeviceQueue(mVulkanDevice->mLogicalVkDevice, mVulkanDevice->mQueueFamilyIndices.mTransfer, mVulkanDevice->mQueueFamilyIndices.mTransferQueueIndex, &transferQueue);
+
+	mStagingRing = std::make_unique<VulkanStagingRing>(mVulkanDevice, transferQueue, mVulkanDevice->mQueueFamilyIndices.mTransfer, mGraphicsContext.mQueue, mVulkanDevice->mQueueFamilyIndices.mGraphics);
+}
+
+void VulkanRenderer::CreateFrameDumpBuffers()
+{
+	mFrameDump.mDirectory = mEngineProperties.lock()->mFrameDumpDirectory;
+	if (!mVulkanSwapChain.IsHeadless() || mFrameDump.mDirectory.empty())
+	{
+		mFrameDump.mDirectory.clear();
+		return;
+	}
+
+	std::filesystem::create_directories(mFrameDump.mDirectory);
+
+	const VkDeviceSize readbackSize = static_cast<VkDeviceSize>(mFramebufferWidth) * mFramebufferHeight * 4;
+	for (Buffer& buffer : mFrameDump.mReadbackBuffers)
+	{
+		VK_CHECK_RESULT(mVulkanDevice->CreateBuffer(VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &buffer, readbackSize));
+		VK_CHECK_RESULT(buffer.Map());
+	}
+}
+
+void VulkanRenderer::WriteFrameDump(Core::uint32 aBufferIndex)
+{
+	const Core::uint32 frameNumber = mFrameDump.mPendingFrames[aBufferIndex];
+	if (frameNumber == Core::uint32_max)
+	{
+		return;
+	}
+
+	mFrameDump.mPendingFrames[aBufferIndex] = Core::uint32_max;
+
+	// Binary PPM, which needs no image library and is read by most viewers and diff tools
+	const std::filesystem::path path = mFrameDump.mDirectory / std::format("Frame{:05}.ppm", frameNumber);
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << std::format("Could not write frame dump {}", path.generic_string()) << std::endl;
+		return;
+	}
+
+	file << std::format("P6\n{} {}\n255\n", mFramebufferWidth, mFramebufferHeight);
+
+	// The offscreen images are R8G8B8A8, the alpha channel is dropped
+	const Core::uint8* texels = static_cast<const Core::uint8*>(mFrameDump.mReadbackBuffers[aBufferIndex].mMappedData);
+	std::vector<Core::uint8> row(static_cast<Core::size>(mFramebufferWidth) * 3);
+	for (Core::uint32 y = 0; y < mFramebufferHeight; y++)
+	{
+		for (Core::uint32 x = 0; x < mFramebufferWidth; x++)
+		{
+			const Core::uint8* texel = texels + (static_cast<Core::size>(y) * mFramebufferWidth + x) * 4;
+			row[x * 3 + 0] = texel[0];
+			row[x * 3 + 1] = texel[1];
+			row[x * 3 + 2] = texel[2];
+		}
+
+		file.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size()));
+	}
+}
+
 void VulkanRenderer::OnResizeWindow()
 {
 	if (!mEngineProperties.lock()->mIsRendererPrepared)
@@ -1604,11 +3116,16 @@ void VulkanRenderer::OnResizeWindow()
 
 	// Recreate the frame buffers
 	vkDestroyImageView(mVulkanDevice->mLogicalVkDevice, mDepthStencil.mVkImageView, nullptr);
+	vkDestroyImageView(mVulkanDevice->mLogicalVkDevice, mDepthStencil.mDepthVkImageView, nullptr);
 	vkDestroyImage(mVulkanDevice->mLogicalVkDevice, mDepthStencil.mVkImage, nullptr);
-	vkFreeMemory(mVulkanDevice->mLogicalVkDevice, mDepthStencil.mVkDeviceMemory, nullptr);
+	mVulkanDevice->mMemoryAllocator->Free(mDepthStencil.mAllocation);
 
 	SetupDepthStencil();
 
+	// The pyramid follows the framebuffer size and reads the new depth buffer
+	DestroyDepthPyramid();
+	CreateDepthPyramid();
+
 	if ((mFramebufferWidth > 0.0f) && (mFramebufferHeight > 0.0f))
 	{
 		mImGuiOverlay->Resize(mFramebufferWidth, mFramebufferHeight);
@@ -1640,29 +3157,149 @@ void VulkanRenderer::SetupSwapchain()
 	mVulkanSwapChain.CreateSwapchain(mFramebufferWidth, mFramebufferHeight, mEngineProperties.lock()->mIsVSyncEnabled);
 }
 
-void VulkanRenderer::DrawModels(VkCommandBuffer aCommandBuffer)
+void VulkanRenderer::RecordRendering(VkCommandBuffer aCommandBuffer, VkRenderingInfo aRenderingInfo, std::span<const DrawListFunction> aDrawLists)
+{
+	if (!mIsRecordingInParallel)
+	{
+		vkCmdBeginRendering(aCommandBuffer, &aRenderingInfo);
+		SetViewportAndScissor(aCommandBuffer);
+		for (const DrawListFunction drawList : aDrawLists)
+		{
+			(this->*drawList)(aCommandBuffer);
+		}
+		vkCmdEndRendering(aCommandBuffer);
+		return;
+	}
+
+	const Core::uint32 drawListCount = static_cast<Core::uint32>(aDrawLists.size());
+	std::vector<VkCommandBuffer> secondaryCommandBuffers(drawListCount);
+	mJobSystem.lock()->ParallelFor(drawListCount, [this, aDrawLists, &secondaryCommandBuffers](Core::uint32 aIndex)
+	{
+		secondaryCommandBuffers[aIndex] = RecordSecondaryCommandBuffer(aDrawLists[aIndex]);
+	});
+
+	// A rendering pass that executes secondary command buffers can't record any commands inline
+	aRenderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+	vkCmdBeginRendering(aCommandBuffer, &aRenderingInfo);
+	vkCmdExecuteCommands(aCommandBuffer, drawListCount, secondaryCommandBuffers.data());
+	vkCmdEndRendering(aCommandBuffer);
+
+	mSecondaryCommandBufferCount += drawListCount;
+}
+
+VkCommandBuffer VulkanRenderer::RecordSecondaryCommandBuffer(DrawListFunction aDrawList)
+{
+	SecondaryCommandPool& secondaryCommandPool = mGraphicsContext.mSecondaryCommandPools[mCurrentBufferIndex][JobSystem::GetThreadIndex()];
+	if (secondaryCommandPool.mUsedCommandBufferCount == secondaryCommandPool.mCommandBuffers.size())
+	{
+		secondaryCommandPool.mCommandBuffers.push_back(mVulkanDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_SECONDARY, secondaryCommandPool.mCommandPool));
+	}
+
+	VkCommandBuffer commandBuffer = secondaryCommandPool.mCommandBuffers[secondaryCommandPool.mUsedCommandBufferCount++];
+
+	// Secondary command buffers executed inside dynamic rendering need the attachment formats of the pass
+	const VkCommandBufferInheritanceRenderingInfo inheritanceRenderingInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+		.colorAttachmentCount = 1,
+		.pColorAttachmentFormats = &mVulkanSwapChain.mColorVkFormat,
+		.depthAttachmentFormat = mVkDepthFormat,
+		.stencilAttachmentFormat = mVkDepthFormat,
+		.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT
+	};
+
+	const VkCommandBufferInheritanceInfo inheritanceInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+		.pNext = &inheritanceRenderingInfo
+	};
+
+	const VkCommandBufferBeginInfo commandBufferBeginInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+		.pInheritanceInfo = &inheritanceInfo
+	};
+	VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo));
+
+	// Dynamic state isn't inherited from the primary command buffer
+	SetViewportAndScissor(commandBuffer);
+	(this->*aDrawList)(commandBuffer);
+
+	VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
+	return commandBuffer;
+}
+
+void VulkanRenderer::SetViewportAndScissor(VkCommandBuffer aCommandBuffer)
+{
+	const VkViewport viewport = VulkanInitializers::Viewport(static_cast<float>(mFramebufferWidth), static_cast<float>(mFramebufferHeight), 0.0f, 1.0f);
+	vkCmdSetViewport(aCommandBuffer, 0, 1, &viewport);
+
+	const VkRect2D scissor = VulkanInitializers::Rect2D(mFramebufferWidth, mFramebufferHeight, 0, 0);
+	vkCmdSetScissor(aCommandBuffer, 0, 1, &scissor);
+}
+
+void VulkanRenderer::DrawPlanet(VkCommandBuffer aCommandBuffer)
 {
-	// Draw non-instanced static models
+	// Still loading, or outside of the frustum
+	if (!mCpuCulling.IsModelVisible(CpuCullingContext::Model::Planet))
+	{
+		return;
+	}
+
+	SIMPLE_PROFILER_GPU_SCOPE(aCommandBuffer, "Planet");
+
+	// Every draw list binds all of its state, so it can be recorded into its own secondary command buffer
 	vkCmdBindDescriptorSets(aCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mGraphicsContext.mPipelineLayout, 0, 1, &mDescriptorSets[mCurrentBufferIndex].mStaticPlanet, 0, nullptr);
 
+	// Textures and materials of every model are in one set, draws select their material through the push constant
+	const VkDescriptorSet bindlessDescriptorSet = mModelManager->GetBindlessDescriptorSet();
+	vkCmdBindDescriptorSets(aCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mGraphicsContext.mPipelineLayout, 1, 1, &bindlessDescriptorSet, 0, nullptr);
+
 #ifdef _DEBUG
 	vkCmdBindPipeline(aCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mShouldDrawWireframe ? mVkPipelines.mPlanetWireframe : mVkPipelines.mPlanet);
 #else
 	vkCmdBindPipeline(aCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mVkPipelines.mPlanet);
 #endif
 
-	mPushConstant.mModelMatrix = mPlanetModelMatrix;
-	vkCmdPushConstants(aCommandBuffer, mGraphicsContext.mPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstant), &mPushConstant);
+	PushConstant pushConstant;
+	pushConstant.mModelMatrix = mPlanetModelMatrix;
+	vkCmdPushConstants(aCommandBuffer, mGraphicsContext.mPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstant), &pushConstant);
+
+	DrawModel(mModelManager->GetModel(mModelIdentifiers.mPlanetModelIdentifier), aCommandBuffer, RenderFlags::None, mCpuCulling.GetModelParts(CpuCullingContext::Model::Planet));
+}
+
+void VulkanRenderer::DrawVoyager(VkCommandBuffer aCommandBuffer)
+{
+	if (!mCpuCulling.IsModelVisible(CpuCullingContext::Model::Voyager))
+	{
+		return;
+	}
 
-	DrawModel(mModelManager->GetModel(mModelIdentifiers.mPlanetModelIdentifier), aCommandBuffer);
+	SIMPLE_PROFILER_GPU_SCOPE(aCommandBuffer, "Voyager");
 
 	vkCmdBindDescriptorSets(aCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mGraphicsContext.mPipelineLayout, 0, 1, &mDescriptorSets[mCurrentBufferIndex].mStaticVoyager, 0, nullptr);
+
+	const VkDescriptorSet bindlessDescriptorSet = mModelManager->GetBindlessDescriptorSet();
+	vkCmdBindDescriptorSets(aCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mGraphicsContext.mPipelineLayout, 1, 1, &bindlessDescriptorSet, 0, nullptr);
+
 	vkCmdBindPipeline(aCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mVkPipelines.mVoyager);
 
-	mPushConstant.mModelMatrix = mVoyagerModelMatrix;
-	vkCmdPushConstants(aCommandBuffer, mGraphicsContext.mPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstant), &mPushConstant);
+	PushConstant pushConstant;
+	pushConstant.mModelMatrix = mVoyagerModelMatrix;
+	vkCmdPushConstants(aCommandBuffer, mGraphicsContext.mPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstant), &pushConstant);
+
+	// Once its culling resources exist the Voyager is drawn from the meshlets that survived CullMeshlets
+	if (mMeshletCulling.mIsPrepared)
+	{
+		DrawModelMeshlets(mModelManager->GetModel(mModelIdentifiers.mVoyagerModelIdentifier), aCommandBuffer, mCpuCulling.GetModelParts(CpuCullingContext::Model::Voyager));
+	}
+	else
+	{
+		DrawModel(mModelManager->GetModel(mModelIdentifiers.mVoyagerModelIdentifier), aCommandBuffer, RenderFlags::None, mCpuCulling.GetModelParts(CpuCullingContext::Model::Voyager));
+	}
+}
 
-	DrawModel(mModelManager->GetModel(mModelIdentifiers.mVoyagerModelIdentifier), aCommandBuffer, RenderFlags::BindImages, mGraphicsContext.mPipelineLayout);
+void VulkanRenderer::DrawInstancedModels(VkCommandBuffer aCommandBuffer)
+{
+	SIMPLE_PROFILER_GPU_SCOPE(aCommandBuffer, "Instanced models");
 
 	// Draw instanced multi draw models
 	const VkDeviceSize offsets[1] = {0};
@@ -1675,31 +3312,54 @@ void VulkanRenderer::DrawModels(VkCommandBuffer aCommandBuffer)
 #endif
 
 	vkCmdBindVertexBuffers(aCommandBuffer, 0, 1, &mModelManager->GetModel(mModelIdentifiers.mSuzanneModelIdentifier)->vertices.mBuffer, offsets);
-	vkCmdBindVertexBuffers(aCommandBuffer, 1, 1, &mInstanceBuffer.mVkBuffer, offsets);
 	vkCmdBindIndexBuffer(aCommandBuffer, mModelManager->GetModel(mModelIdentifiers.mSuzanneModelIdentifier)->indices.mBuffer, 0, VK_INDEX_TYPE_UINT32);
 
-	// One draw call for an arbitrary number of objects
-	if (mVulkanDevice->mEnabledPhysicalDeviceFeatures.multiDrawIndirect)
+	// The CPU draw list already has the instance count of every LOD, so the draws are recorded directly
+	if (mCpuCulling.mIsCullingInstances)
+	{
+		vkCmdBindVertexBuffers(aCommandBuffer, 1, 1, &mCpuCulling.mVisibleInstanceBuffers[mCurrentBufferIndex].mVkBuffer, offsets);
+
+		const FrustumCulling::DrawList& drawList = mCpuCulling.mInstanceDrawList;
+		for (Core::size lod = 0; lod < mCpuCulling.mLoDLevels.size() && lod < FrustumCulling::gMaxLoDCount; lod++)
+		{
+			if (drawList.mCount[lod] != 0)
+			{
+				vkCmdDrawIndexed(aCommandBuffer, mCpuCulling.mLoDLevels[lod].mIndexCount, drawList.mCount[lod], mCpuCulling.mLoDLevels[lod].mFirstIndex, 0, drawList.mFirstIndex[lod]);
+			}
+		}
+
+		return;
+	}
+
+	vkCmdBindVertexBuffers(aCommandBuffer, 1, 1, &mVisibleInstanceBuffers[mCurrentBufferIndex].mVkBuffer, offsets);
+
+	// The cull shader leaves one instanced draw per visible LOD, followed by unused draws without instances
+	const VkBuffer indirectCommandsBuffer = mIndirectCommandsBuffers[mCurrentBufferIndex].mVkBuffer;
+	static constexpr VkDeviceSize drawCommandsOffset = offsetof(IndirectDrawCommands, mDrawCommands);
+	static constexpr Core::uint32 maxDrawCount = gMaxLOD + 1;
+	if (mPhysicalDevice12Features.drawIndirectCount)
+	{
+		// The draw count is taken from the buffer as well, so the unused draws are never processed
+		vkCmdDrawIndexedIndirectCount(aCommandBuffer, indirectCommandsBuffer, drawCommandsOffset, indirectCommandsBuffer, offsetof(IndirectDrawCommands, mDrawCount), maxDrawCount, sizeof(VkDrawIndexedIndirectCommand));
+	}
+	else if (mVulkanDevice->mEnabledPhysicalDeviceFeatures.multiDrawIndirect)
 	{
 		// Index offsets and instance count are taken from the indirect buffer
-		vkCmdDrawIndexedIndirect(aCommandBuffer, mIndirectCommandsBuffers[mCurrentBufferIndex].mVkBuffer, 0, static_cast<Core::uint32>(mIndirectCommands.size()), sizeof(VkDrawIndexedIndirectCommand));
+		vkCmdDrawIndexedIndirect(aCommandBuffer, indirectCommandsBuffer, drawCommandsOffset, maxDrawCount, sizeof(VkDrawIndexedIndirectCommand));
 	}
 	else
 	{
 		// Issue separate draw commands
-		for (Core::size j = 0; j < mIndirectCommands.size(); j++)
+		for (Core::uint32 j = 0; j < maxDrawCount; j++)
 		{
-			vkCmdDrawIndexedIndirect(aCommandBuffer, mIndirectCommandsBuffers[mCurrentBufferIndex].mVkBuffer, j * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+			vkCmdDrawIndexedIndirect(aCommandBuffer, indirectCommandsBuffer, drawCommandsOffset + j * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
 		}
 	}
 }
 
 void VulkanRenderer::DrawImGuiOverlay(VkCommandBuffer aCommandBuffer)
 {
-	const VkViewport viewport{.width = static_cast<float>(mFramebufferWidth), .height = static_cast<float>(mFramebufferHeight), .minDepth = 0.0f, .maxDepth = 1.0f};
-	const VkRect2D scissor{.extent = {.width = mFramebufferWidth, .height = mFramebufferHeight }};
-	vkCmdSetViewport(aCommandBuffer, 0, 1, &viewport);
-	vkCmdSetScissor(aCommandBuffer, 0, 1, &scissor);
+	SIMPLE_PROFILER_GPU_SCOPE(aCommandBuffer, "ImGui overlay");
 	mImGuiOverlay->Draw(aCommandBuffer, mCurrentBufferIndex);
 }
 
@@ -1738,8 +3398,6 @@ void VulkanRenderer::UpdateUIOverlay()
 
 	ImGui::PopStyleVar();
 	ImGui::Render();
-
-	mImGuiOverlay->Update(mCurrentBufferIndex);
 }
 
 void VulkanRenderer::OnUpdateUIOverlay()
@@ -1766,10 +3424,19 @@ void VulkanRenderer::OnUpdateUIOverlay()
 #endif
 
 			ImGui::Checkbox("Freeze frustum", &mShouldFreezeFrustum);
+			ImGui::Checkbox("Parallel command recording", &mIsRecordingInParallel);
+
+			if (mOcclusionCulling.mIsSupported)
+				ImGui::Checkbox("Occlusion culling", &mOcclusionCulling.mIsEnabled);
+
+			ImGui::Checkbox("CPU instance culling", &mCpuCulling.mIsCullingInstances);
+			ImGui::Checkbox("Primitive culling", &mCpuCulling.mIsCullingModelParts);
+			ImGui::Text("CPU culling kernel: %s", FrustumCulling::GetKernelName(mCpuCulling.mKernel));
 
 			ImGui::Text("samplerAnisotropy is %s", mVulkanDevice->mEnabledPhysicalDeviceFeatures.samplerAnisotropy ? "enabled" : "disabled");
 			ImGui::Text("multiDrawIndirect is %s", mVulkanDevice->mEnabledPhysicalDeviceFeatures.multiDrawIndirect ? "enabled" : "disabled");
 			ImGui::Text("drawIndirectFirstInstance is %s", mVulkanDevice->mEnabledPhysicalDeviceFeatures.drawIndirectFirstInstance ? "enabled" : "disabled");
+			ImGui::Text("drawIndirectCount is %s", mPhysicalDevice12Features.drawIndirectCount ? "enabled" : "disabled");
 #ifdef _DEBUG
 			ImGui::Text("fillModeNonSolid is %s", mVulkanDevice->mEnabledPhysicalDeviceFeatures.fillModeNonSolid ? "enabled" : "disabled");
 #endif
@@ -1779,12 +3446,46 @@ void VulkanRenderer::OnUpdateUIOverlay()
 
 		ImGui::NewLine();
 
+		if (ImGui::CollapsingHeader("Simulation Settings", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			const std::shared_ptr<EngineProperties> engineProperties = mEngineProperties.lock();
+			ImGui::SliderFloat("Tick rate", &engineProperties->mFixedTickRate, 10.0f, 240.0f, "%.0f Hz");
+			ImGui::Checkbox("Threaded simulation", &engineProperties->mIsSimulationThreaded);
+		}
+
+		ImGui::NewLine();
+
 		if (ImGui::CollapsingHeader("Scene Details", ImGuiTreeNodeFlags_DefaultOpen))
 		{
-			ImGui::Text("Visible objects: %d", mIndrectDrawInfo.mDrawCount);
+			ImGui::Text("Instances: %u/%u", mIndirectDrawCount, mInstanceCapacity);
+			ImGui::Text("Visible objects: %d", mIndrectDrawInfo.mDrawCount + mOcclusionCulling.mLateDrawInfo.mDrawCount);
+			if (mOcclusionCulling.mIsSupported && mOcclusionCulling.mIsEnabled)
+			{
+				ImGui::Text("Disoccluded objects: %d", mOcclusionCulling.mLateDrawInfo.mDrawCount);
+			}
+			// Every LOD with visible instances is a single instanced draw in each pass
+			const auto countDraws = [](const IndirectDrawInfo& aDrawInfo) { return std::ranges::count_if(aDrawInfo.mLoDCount, [](Core::uint32 aCount) { return aCount != 0; }); };
+			ImGui::Text("Instanced draws: %d", static_cast<int>(countDraws(mIndrectDrawInfo) + countDraws(mOcclusionCulling.mLateDrawInfo)));
+			if (mMeshletCulling.mIsPrepared)
+			{
+				ImGui::Text("Visible meshlets: %u/%u", mMeshletCulling.mVisibleMeshletCount, mMeshletCulling.mPushConstant.mMeshletCount);
+			}
+			if (mCpuCulling.mIsCullingModelParts)
+			{
+				static constexpr std::array<const char*, static_cast<Core::size>(CpuCullingContext::Model::Count)> modelNames{"Planet", "Voyager"};
+				for (Core::size i = 0; i < modelNames.size(); i++)
+				{
+					const ModelPartCulling& parts = mCpuCulling.mModelParts[i];
+					ImGui::Text("%s primitives: %u/%u (%u subtrees culled)", modelNames[i], parts.GetVisiblePrimitiveCount(), parts.GetPrimitiveCount(), parts.mCulledSubtreeCount);
+				}
+			}
+			ImGui::Text("Loading models: %zu", mModelManager->GetPendingLoadCount());
+			ImGui::Text("Staging submits: %u%s", mStagingRing->GetSubmitCount(), mStagingRing->IsUsingDedicatedTransferQueue() ? " (dedicated transfer queue)" : "");
+			ImGui::Text("Animation instances: %u", mAnimationSystem->GetInstanceCount());
+			ImGui::Text("Secondary command buffers: %u (%u threads)", mSecondaryCommandBufferCount, mJobSystem.lock()->GetThreadCount());
 			for (int i = 0; i < gMaxLOD + 1; i++)
 			{
-				ImGui::Text("LOD %d: %d", i, mIndrectDrawInfo.mLoDCount[i]);
+				ImGui::Text("LOD %d: %d", i, mIndrectDrawInfo.mLoDCount[i] + mOcclusionCulling.mLateDrawInfo.mLoDCount[i]);
 			}
 
 			ImGui::NewLine();
@@ -1827,15 +3528,42 @@ void VulkanRenderer::OnUpdateUIOverlay()
 			mImGuiOverlay->Mat4Text("Planet", mPlanetModelMatrix);
 		}
 
+		ImGui::NewLine();
+
+		if (ImGui::CollapsingHeader("Memory"))
+		{
+			const VulkanMemoryStatistics memoryStatistics = mVulkanDevice->mMemoryAllocator->GetStatistics();
+			ImGui::Text("Device memory objects: %u (%u dedicated)", memoryStatistics.mBlockCount + memoryStatistics.mDedicatedAllocationCount, memoryStatistics.mDedicatedAllocationCount);
+			ImGui::Text("Allocations: %u", memoryStatistics.mAllocationCount);
+			ImGui::Text("Used: %.2f / %.2f MB", static_cast<double>(memoryStatistics.mUsedBytes) / (1024.0 * 1024.0), static_cast<double>(memoryStatistics.mReservedBytes) / (1024.0 * 1024.0));
+
+			for (Core::uint32 i = 0; i < mVulkanDevice->mMemoryAllocator->GetMemoryTypeCount(); i++)
+			{
+				const VulkanMemoryStatistics typeStatistics = mVulkanDevice->mMemoryAllocator->GetStatistics(i);
+				if (typeStatistics.mReservedBytes == 0)
+					continue;
+
+				const VkMemoryPropertyFlags propertyFlags = mVulkanDevice->mMemoryAllocator->GetMemoryTypeProperties(i);
+				ImGui::BulletText("Type %u%s%s: %u blocks, %.2f / %.2f MB", i,
+					(propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) ? " local" : "",
+					(propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) ? " host" : "",
+					typeStatistics.mBlockCount,
+					static_cast<double>(typeStatistics.mUsedBytes) / (1024.0 * 1024.0),
+					static_cast<double>(typeStatistics.mReservedBytes) / (1024.0 * 1024.0));
+			}
+		}
+
 		ImGui::PopItemWidth();
 		ImGui::End();
 	}
 
-	if (mShouldShowModelInspector)
+	if (mShouldShowModelInspector && selectedModel)
 	{
 		ImGui::Begin("Model Inspector", &mShouldShowModelInspector, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoResize);
 		ImGui::Text("Vertices %i", selectedModel->vertices.mCount);
+		ImGui::Text("Vertex stride %u bytes%s", selectedModel->mVertexLayout.mStride, selectedModel->mVertexLayout.mIsQuantized ? " (quantized)" : "");
 		ImGui::Text("Indices %i", selectedModel->indices.mCount);
+		ImGui::Text("Meshlets %zu", selectedModel->meshlets.mData.size());
 
 		if (ImGui::TreeNode(std::format("Textures ({})", selectedModel->textures.size()).c_str()))
 		{
@@ -1909,6 +3637,8 @@ void VulkanRenderer::OnUpdateUIOverlay()
 	{
 		ImGui::Begin("Simple Profiler", &mShouldShowProfiler, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoResize);
 		SimpleProfiler::ShowImguiProfiler();
+		ImGui::NewLine();
+		SimpleProfiler::ShowImguiThreadActivity();
 		ImGui::End();
 	}
 }
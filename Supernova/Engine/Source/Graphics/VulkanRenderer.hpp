@@ -13,6 +13,7 @@
 #include <array>
 #include <filesystem>
 #include <memory>
+#include <span>
 #include <string>
 #include <vector>
 #include <vulkan/vulkan_core.h>
@@ -29,31 +30,55 @@ namespace Time
 	struct Timer;
 }
 
+namespace ECS
+{
+	class Scene;
+}
+
 struct EngineProperties;
 class Camera;
+class CameraPath;
 class Window;
 class ImGuiOverlay;
 class TextureManager;
 class ModelManager;
+class VulkanStagingRing;
+class InstanceRegistry;
+class JobSystem;
+class AnimationSystem;
 
 class VulkanRenderer
 {
 public:
-	VulkanRenderer(const std::shared_ptr<EngineProperties>& aEngineProperties, const std::shared_ptr<Window>& aWindow);
+	VulkanRenderer(const std::shared_ptr<EngineProperties>& aEngineProperties, const std::shared_ptr<Window>& aWindow, const std::shared_ptr<ECS::Scene>& aScene, const std::shared_ptr<JobSystem>& aJobSystem);
 	~VulkanRenderer();
 
 	void InitializeRenderer();
 	void PrepareUpdate();
 	void EndUpdate();
+	void ExtractScene(float aInterpolationFactor); // Copies what the frame draws out of the scene, must not overlap with a simulation step
 	void UpdateRenderer(float aDeltaTime);
 
+	// Replaces the camera input with the path once the streamed models are loaded, and collects the statistics of every frame until the path ends
+	void StartBenchmark(std::unique_ptr<CameraPath> aCameraPath);
+	bool IsBenchmarkFinished() const { return mIsBenchmarkFinished; }
+	std::span<const FrameStatistics> GetFrameStatistics() const { return mFrameStatistics.mFrames; }
+	std::string GetDeviceName() const;
+
 private:
+	using DrawListFunction = void (VulkanRenderer::*)(VkCommandBuffer aCommandBuffer); // Records one independent part of a rendering pass
+
 	void PrepareVulkanResources();
+	void ReadBackFrameStatistics(); // Reads the statistics of the latest frame the GPU has finished, without waiting for one
+	void CollectFrameStatistics(Core::uint32 aBufferIndex); // Moves the statistics of a frame into mFrameStatistics.mFrames, the frame's fence must have signaled
+	void WriteFrameStatisticsTimestamp(VkCommandBuffer aCommandBuffer, Core::uint32 aQuery);
+	void UpdateCameraPath();
+	void PrepareFrame(); // Waits until the resources of the frame are no longer in use, and fills them with the data collected for it
 	void PrepareFrameGraphics();
 	void BuildGraphicsCommandBuffer();
-	void PrepareFrameCompute();
 	void BuildComputeCommandBuffer();
 	void UpdateModelMatrix();
+	void UpdateAnimations(); // Plays the first animation of every static model that has one, once the model has been published
 	void UpdateUniformBuffers();
 	void SubmitFrameGraphics();
 	void SubmitFrameCompute();
@@ -61,7 +86,11 @@ private:
 
 	void LoadAssets();
 	void CreateSynchronizationPrimitives();
+	void CreateGpuProfiler();
+	void CreateFrameStatisticsQueries();
 	void CreateGraphicsCommandBuffers();
+	void CreateSecondaryCommandPools();
+	void ResetSecondaryCommandPools();
 	void CreateDescriptorPool();
 	void CreateGraphicsDescriptorSetLayout();
 	void CreateGraphicsDescriptorSets();
@@ -69,8 +98,21 @@ private:
 	void CreateComputeDescriptorSetLayout();
 	void CreateComputeDescriptorSets();
 	void CreateComputePipelines();
+	void CreateMeshletCullingPipeline();
+	void PrepareMeshletCulling(const vkglTF::Model& aModel);
+	void CullMeshlets(VkCommandBuffer aCommandBuffer);
+	void CreateOcclusionCullingPipeline();
+	void CreateDepthPyramid();
+	void DestroyDepthPyramid();
+	void BuildDepthPyramid(VkCommandBuffer aCommandBuffer);
+	void CullOccludedInstances(VkCommandBuffer aCommandBuffer);
+	void CullInstances(VkCommandBuffer aCommandBuffer, VkDescriptorSet aDescriptorSet, const Buffer& aDrawCountBuffer, OcclusionCullingPushConstant aPushConstant);
+	std::array<VkBufferMemoryBarrier, 4> GetCullOutputBarriers(Core::uint32 aBufferIndex, VkAccessFlags aSrcAccessMask, VkAccessFlags aDstAccessMask, Core::uint32 aSrcQueueFamilyIndex, Core::uint32 aDstQueueFamilyIndex) const; // Queue family ownership transfer of the buffers written on the compute queue
 	void CreateUniformBuffers();
 	void CreateUIOverlay();
+	void CreateStagingRing();
+	void CreateFrameDumpBuffers();
+	void WriteFrameDump(Core::uint32 aBufferIndex); // Writes the frame copied into the readback buffer, the frame's fence must have signaled
 
 	void InitializeVulkan();
 	void CreateVkInstance();
@@ -80,17 +122,28 @@ private:
 
 	void OnResizeWindow();
 
-	void DrawNode(const vkglTF::Node* aNode, VkCommandBuffer aCommandBuffer, RenderFlags aRenderFlags, VkPipelineLayout aPipelineLayout, Core::uint32 aBindImageSet);
-	void DrawModel(vkglTF::Model* aModel, VkCommandBuffer aCommandBuffer, RenderFlags aRenderFlags = RenderFlags::None, VkPipelineLayout aPipelineLayout = VK_NULL_HANDLE, Core::uint32 aBindImageSet = 1);
+	void DrawNode(const vkglTF::Node* aNode, VkCommandBuffer aCommandBuffer, RenderFlags aRenderFlags, const ModelPartCulling* aCulling);
+	void DrawModel(vkglTF::Model* aModel, VkCommandBuffer aCommandBuffer, RenderFlags aRenderFlags = RenderFlags::None, const ModelPartCulling* aCulling = nullptr); // The material of each primitive is pushed before its draw, see ModelManager::GetBindlessDescriptorSet. Skips the parts aCulling has culled
+	void DrawModelMeshlets(vkglTF::Model* aModel, VkCommandBuffer aCommandBuffer, const ModelPartCulling* aCulling = nullptr); // Draws the meshlets left by CullMeshlets
 	void BindModelBuffers(vkglTF::Model* aModel, VkCommandBuffer aCommandBuffer);
+	void PushMaterialIndex(VkCommandBuffer aCommandBuffer, const vkglTF::Material& aMaterial);
 	void RenderFrame();
 	void CreatePipelineCache();
 	void PrepareIndirectData();
 	void PrepareInstanceData();
+	void CreateInstanceBuffers(Core::uint32 aCapacity);
+	void UpdateInstanceData();
+	void CullOnCpu(); // Culls the static models, and the instances in place of the cull shader while mCpuCulling.mIsCullingInstances is set
+	void WriteCpuCulledInstances(); // Fills the frame's visible instances and statistics from the CPU draw list, its fences must have signaled
 	void InitializeSwapchain();
 	void CreateGraphicsCommandPool();
 	void SetupSwapchain();
-	void DrawModels(VkCommandBuffer aCommandBuffer);
+	void RecordRendering(VkCommandBuffer aCommandBuffer, VkRenderingInfo aRenderingInfo, std::span<const DrawListFunction> aDrawLists); // Records the draw lists inline, or in parallel into secondary command buffers
+	VkCommandBuffer RecordSecondaryCommandBuffer(DrawListFunction aDrawList);
+	void SetViewportAndScissor(VkCommandBuffer aCommandBuffer);
+	void DrawPlanet(VkCommandBuffer aCommandBuffer);
+	void DrawVoyager(VkCommandBuffer aCommandBuffer);
+	void DrawInstancedModels(VkCommandBuffer aCommandBuffer);
 	void DrawImGuiOverlay(VkCommandBuffer aCommandBuffer);
 	void UpdateUIOverlay();
 	void OnUpdateUIOverlay();
@@ -116,6 +169,14 @@ private:
 		vkglTF::Texture mPlanetTexture;
 	} mTextures{};
 
+	// Vertex layouts of the models, they hold exactly the attributes their pipelines read
+	struct
+	{
+		vkglTF::VertexLayout mVoyager;
+		vkglTF::VertexLayout mPlanet;
+		vkglTF::VertexLayout mSuzanne;
+	} mVertexLayouts{};
+
 	struct
 	{
 		UniqueIdentifier mVoyagerModelIdentifier;
@@ -123,26 +184,26 @@ private:
 		UniqueIdentifier mPlanetModelIdentifier;
 	} mModelIdentifiers{};
 
-	struct
-	{
-		Core::uint32 mDrawCount; // Total number of indirect draw counts to be issued
-		Core::uint32 mLoDCount[gMaxLOD + 1]; // Statistics for number of draws per LOD level (written by compute shader)
-	} mIndrectDrawInfo{};
+	IndirectDrawInfo mIndrectDrawInfo{};
 
 	GraphicsContext mGraphicsContext{};
 	ComputeContext mComputeContext{};
+	MeshletCullingContext mMeshletCulling{};
+	OcclusionCullingContext mOcclusionCulling{};
+	CpuCullingContext mCpuCulling{};
+	FrameDumpContext mFrameDump{};
+	FrameStatisticsContext mFrameStatistics{};
 	ViewFrustum mViewFrustum{};
 	UniformBufferData mUniformBufferData{};
 	Buffer mInstanceBuffer{};
+	VkPhysicalDeviceVulkan12Features mPhysicalDevice12Features;
 	VkPhysicalDeviceVulkan13Features mPhysicalDevice13Features;
 	DepthStencil mDepthStencil;
 	VkInstance mInstance; // Vulkan instance, stores all per-application states
 	VkDescriptorPool mDescriptorPool; // Descriptor set pool
 	VkPipelineCache mPipelineCache; // Pipeline cache object
-	VulkanSwapChain mVulkanSwapChain; // Wraps the swap chain to present images (framebuffers) to the windowing system
-	PushConstant mPushConstant{};
+	VulkanSwapChain mVulkanSwapChain; // Wraps the swap chain to present images (framebuffers) to the windowing system, or the offscreen images of a headless run
 	Time::TimePoint mLastTimestamp;
-	std::vector<VkDrawIndexedIndirectCommand> mIndirectCommands; // Store the indirect draw commands containing index offsets and instance count per object
 	std::vector<std::string> mSupportedInstanceExtensions{};
 	std::vector<const char*> mEnabledDeviceExtensions{}; // Set of device extensions to be enabled for this example
 	std::vector<const char*> mRequestedInstanceExtensions{}; // Set of instance extensions to be enabled for this example
@@ -151,8 +212,13 @@ private:
 	std::vector<VkShaderModule> mShaderModules{}; // List of shader modules created (stored for cleanup)
 	std::array<DescriptorSets, gMaxConcurrentFrames> mDescriptorSets{};
 	std::array<Buffer, gMaxConcurrentFrames> mVulkanUniformBuffers;
-	std::array<Buffer, gMaxConcurrentFrames> mIndirectCommandsBuffers;
+	std::array<Buffer, gMaxConcurrentFrames> mIndirectCommandsBuffers; // Compacted LOD draws and their count, see IndirectDrawCommands
+	std::array<Buffer, gMaxConcurrentFrames> mInstanceUploadBuffers; // Host copies of the instances that changed, copied into mInstanceBuffer by the compute queue
+	std::array<Buffer, gMaxConcurrentFrames> mInstanceVisibilityBuffers; // LOD level plus one per instance, zero when culled
+	std::array<Buffer, gMaxConcurrentFrames> mVisibleInstanceBuffers; // Instance data of the visible instances, grouped by LOD
 	std::array<Buffer, gMaxConcurrentFrames> mIndirectDrawCountBuffers;
+	std::vector<VkBufferCopy> mInstanceCopyRegions; // Dirty instance ranges recorded by the next compute command buffer
+	std::vector<Core::uint32> mDirtyInstanceIndices;
 	Core::uint32 mFramebufferWidth;
 	Core::uint32 mFramebufferHeight;
 	Core::uint32 mFrameCounter;
@@ -161,25 +227,38 @@ private:
 	Core::uint32 mCurrentImageIndex;
 	Core::uint32 mCurrentBufferIndex;
 	Core::uint32 mIndirectDrawCount;
+	Core::uint32 mSecondaryCommandBufferCount; // Secondary command buffers the last frame has recorded
+	Core::uint32 mInstanceCapacity; // Number of instances the instance, visibility and upload buffers have room for
+	Core::uint32 mCameraPathFrame; // Frames the camera path has been played for
+	Core::uint64 mUploadTimelineValue; // Staging ring timeline value that signals the initial asset uploads have completed
 	Math::Matrix4f mVoyagerModelMatrix;
 	Math::Matrix4f mPlanetModelMatrix;
 	Math::Vector4f mClearColor;
 	Math::Vector4f mLightPosition;
 	std::unique_ptr<Time::Timer> mFrameTimer;
 	std::unique_ptr<Camera> mCamera;
+	std::unique_ptr<CameraPath> mCameraPath; // Drives the camera instead of the input while a benchmark runs
 	std::unique_ptr<ImGuiOverlay> mImGuiOverlay;
+	std::unique_ptr<InstanceRegistry> mInstanceRegistry;
 	std::weak_ptr<EngineProperties> mEngineProperties;
 	std::weak_ptr<Window> mWindow;
+	std::weak_ptr<ECS::Scene> mScene;
+	std::weak_ptr<JobSystem> mJobSystem;
 	std::shared_ptr<TextureManager> mTextureManager;
 	std::unique_ptr<ModelManager> mModelManager;
+	std::unique_ptr<AnimationSystem> mAnimationSystem;
+	std::unique_ptr<VulkanStagingRing> mStagingRing; // Persistently mapped upload buffer shared by all asset uploads
 	VulkanDevice* mVulkanDevice; // Encapsulated physical and logical vulkan device
 	VkFormat mVkDepthFormat; // Depth buffer format (selected during Vulkan initialization)
 	float mFrametime;
+	float mEngineFrametime; // Time since the engine loop started the previous frame, as passed to UpdateRenderer
 	float mFPSTimerInterval;
 	bool mShouldShowEditorInfo;
 	bool mShouldShowProfiler;
 	bool mShouldShowModelInspector;
 	bool mShouldFreezeFrustum;
+	bool mIsRecordingInParallel; // Draw lists are recorded into secondary command buffers by the job system
+	bool mIsBenchmarkFinished;
 #ifdef _DEBUG
 	bool mShouldDrawWireframe;
 #endif
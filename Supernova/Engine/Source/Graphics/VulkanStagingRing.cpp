@@ -0,0 +1,439 @@
+#include "VulkanStagingRing.hpp"
+
+#include "Core/Types.hpp"
+#include "VulkanDevice.hpp"
+#include "VulkanTools.hpp"
+#include "VulkanTypes.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <deque>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+namespace VulkanStagingRingLocal
+{
+	static VkDeviceSize AlignUp(VkDeviceSize aValue, VkDeviceSize aAlignment)
+	{
+		return (aValue + aAlignment - 1) / aAlignment * aAlignment;
+	}
+
+	// Make the transfer writes of a batch visible to everything submitted to the same queue afterwards
+	static void InsertTransferWriteBarrier(VkCommandBuffer aCommandBuffer)
+	{
+		const VkMemoryBarrier memoryBarrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT
+		};
+		vkCmdPipelineBarrier(aCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+	}
+}
+
+VulkanStagingRing::VulkanStagingRing(VulkanDevice* aDevice, VkQueue aTransferQueue, Core::uint32 aTransferQueueFamilyIndex, VkQueue aGraphicsQueue, Core::uint32 aGraphicsQueueFamilyIndex, VkDeviceSize aSize)
+	: mVulkanDevice{aDevice}
+	, mTransferQueue{aTransferQueue}
+	, mGraphicsQueue{aGraphicsQueue}
+	, mTransferQueueFamilyIndex{aTransferQueueFamilyIndex}
+	, mGraphicsQueueFamilyIndex{aGraphicsQueueFamilyIndex}
+	, mTransferCommandPool{VK_NULL_HANDLE}
+	, mGraphicsCommandPool{VK_NULL_HANDLE}
+	, mTimelineSemaphore{VK_NULL_HANDLE}
+	, mTimelineValue{0}
+	, mHead{0}
+	, mTail{0}
+	, mUsedBytes{0}
+	, mSubmitCount{0}
+	, mIsBatchOpen{false}
+{
+	VkCommandPoolCreateInfo commandPoolCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+		.queueFamilyIndex = mTransferQueueFamilyIndex,
+	};
+	VK_CHECK_RESULT(vkCreateCommandPool(mVulkanDevice->mLogicalVkDevice, &commandPoolCreateInfo, nullptr, &mTransferCommandPool));
+
+	if (!IsSharingGraphicsQueue())
+	{
+		commandPoolCreateInfo.queueFamilyIndex = mGraphicsQueueFamilyIndex;
+		VK_CHECK_RESULT(vkCreateCommandPool(mVulkanDevice->mLogicalVkDevice, &commandPoolCreateInfo, nullptr, &mGraphicsCommandPool));
+	}
+
+	const VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+		.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+		.initialValue = 0
+	};
+	const VkSemaphoreCreateInfo semaphoreCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		.pNext = &semaphoreTypeCreateInfo
+	};
+	VK_CHECK_RESULT(vkCreateSemaphore(mVulkanDevice->mLogicalVkDevice, &semaphoreCreateInfo, nullptr, &mTimelineSemaphore));
+
+	VK_CHECK_RESULT(mVulkanDevice->CreateBuffer(
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		&mBuffer,
+		aSize));
+	VK_CHECK_RESULT(mBuffer.Map());
+}
+
+VulkanStagingRing::~VulkanStagingRing()
+{
+	Flush();
+
+	vkDestroySemaphore(mVulkanDevice->mLogicalVkDevice, mTimelineSemaphore, nullptr);
+
+	// Destroying the pools frees all command buffers allocated from them
+	vkDestroyCommandPool(mVulkanDevice->mLogicalVkDevice, mTransferCommandPool, nullptr);
+	if (mGraphicsCommandPool != VK_NULL_HANDLE)
+		vkDestroyCommandPool(mVulkanDevice->mLogicalVkDevice, mGraphicsCommandPool, nullptr);
+
+	mBuffer.Destroy();
+}
+
+StagingAllocation VulkanStagingRing::Allocate(VkDeviceSize aSize, VkDeviceSize aAlignment)
+{
+	assert(aSize > 0);
+
+	StagingAllocation allocation{};
+
+	if (aSize > GetSize())
+	{
+		// Too large for the ring, fall back to a temporary buffer that lives as long as the batch
+		BeginBatch();
+
+		Buffer dedicatedBuffer;
+		VK_CHECK_RESULT(mVulkanDevice->CreateBuffer(
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&dedicatedBuffer,
+			aSize));
+		VK_CHECK_RESULT(dedicatedBuffer.Map());
+
+		allocation.mVkBuffer = dedicatedBuffer.mVkBuffer;
+		allocation.mMappedData = dedicatedBuffer.mMappedData;
+		mOpenBatch.mDedicatedBuffers.push_back(dedicatedBuffer);
+
+		return allocation;
+	}
+
+	Reclaim();
+
+	VkDeviceSize offset = 0;
+	while (!TryAllocate(aSize, aAlignment, offset))
+	{
+		// Push out what has been recorded so far, then wait for the oldest batch to free up its range
+		if (mIsBatchOpen && mOpenBatch.mByteCount > 0)
+		{
+			Submit();
+		}
+		else
+		{
+			assert(!mInFlightBatches.empty());
+			RetireOldestBatch(true);
+		}
+	}
+
+	BeginBatch();
+
+	allocation.mVkBuffer = mBuffer.mVkBuffer;
+	allocation.mOffset = offset;
+	allocation.mMappedData = static_cast<Core::uint8*>(mBuffer.mMappedData) + offset;
+
+	return allocation;
+}
+
+VkCommandBuffer VulkanStagingRing::GetCommandBuffer()
+{
+	BeginBatch();
+
+	return mOpenBatch.mTransferCommandBuffer;
+}
+
+VkCommandBuffer VulkanStagingRing::GetGraphicsCommandBuffer()
+{
+	BeginBatch();
+
+	if (IsSharingGraphicsQueue())
+		return mOpenBatch.mTransferCommandBuffer;
+
+	if (mOpenBatch.mGraphicsCommandBuffer == VK_NULL_HANDLE)
+	{
+		mOpenBatch.mGraphicsCommandBuffer = AcquireCommandBuffer(mGraphicsCommandPool, mFreeGraphicsCommandBuffers);
+	}
+
+	return mOpenBatch.mGraphicsCommandBuffer;
+}
+
+void VulkanStagingRing::UploadBuffer(VkBuffer aDestination, const void* aData, VkDeviceSize aSize, VkDeviceSize aDestinationOffset, VkPipelineStageFlags aDestinationStageMask, VkAccessFlags aDestinationAccessMask)
+{
+	const StagingAllocation allocation = Allocate(aSize);
+	std::memcpy(allocation.mMappedData, aData, aSize);
+
+	const VkBufferCopy bufferCopy{
+		.srcOffset = allocation.mOffset,
+		.dstOffset = aDestinationOffset,
+		.size = aSize
+	};
+	vkCmdCopyBuffer(GetCommandBuffer(), allocation.mVkBuffer, aDestination, 1, &bufferCopy);
+
+	TransferBufferOwnership(aDestination, aDestinationOffset, aSize, aDestinationStageMask, aDestinationAccessMask);
+}
+
+void VulkanStagingRing::TransferBufferOwnership(VkBuffer aBuffer, VkDeviceSize aOffset, VkDeviceSize aSize, VkPipelineStageFlags aDestinationStageMask, VkAccessFlags aDestinationAccessMask)
+{
+	// On a shared queue the barrier recorded at submission already covers buffer copies
+	if (!IsUsingDedicatedTransferQueue())
+		return;
+
+	// Release on the transfer queue, the matching acquire is recorded into the graphics command buffer of the same batch
+	VkBufferMemoryBarrier bufferMemoryBarrier{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = 0,
+		.srcQueueFamilyIndex = mTransferQueueFamilyIndex,
+		.dstQueueFamilyIndex = mGraphicsQueueFamilyIndex,
+		.buffer = aBuffer,
+		.offset = aOffset,
+		.size = aSize
+	};
+	vkCmdPipelineBarrier(GetCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &bufferMemoryBarrier, 0, nullptr);
+
+	bufferMemoryBarrier.srcAccessMask = 0;
+	bufferMemoryBarrier.dstAccessMask = aDestinationAccessMask;
+	vkCmdPipelineBarrier(GetGraphicsCommandBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, aDestinationStageMask, 0, 0, nullptr, 1, &bufferMemoryBarrier, 0, nullptr);
+}
+
+void VulkanStagingRing::TransferImageOwnership(VkImage aImage, const VkImageSubresourceRange& aSubresourceRange, VkImageLayout aOldLayout, VkImageLayout aNewLayout, VkPipelineStageFlags aDestinationStageMask, VkAccessFlags aDestinationAccessMask)
+{
+	VkImageMemoryBarrier imageMemoryBarrier{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = aDestinationAccessMask,
+		.oldLayout = aOldLayout,
+		.newLayout = aNewLayout,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = aImage,
+		.subresourceRange = aSubresourceRange
+	};
+
+	if (!IsUsingDedicatedTransferQueue())
+	{
+		// Same queue family, a plain layout transition is enough
+		vkCmdPipelineBarrier(GetCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, aDestinationStageMask, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+		return;
+	}
+
+	// Release and acquire have to specify the same layout transition, it is only executed once
+	imageMemoryBarrier.dstAccessMask = 0;
+	imageMemoryBarrier.srcQueueFamilyIndex = mTransferQueueFamilyIndex;
+	imageMemoryBarrier.dstQueueFamilyIndex = mGraphicsQueueFamilyIndex;
+	vkCmdPipelineBarrier(GetCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+
+	imageMemoryBarrier.srcAccessMask = 0;
+	imageMemoryBarrier.dstAccessMask = aDestinationAccessMask;
+	vkCmdPipelineBarrier(GetGraphicsCommandBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, aDestinationStageMask, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+}
+
+Core::uint64 VulkanStagingRing::Submit()
+{
+	if (!mIsBatchOpen)
+		return mTimelineValue;
+
+	VulkanStagingRingLocal::InsertTransferWriteBarrier(mOpenBatch.mTransferCommandBuffer);
+	VK_CHECK_RESULT(vkEndCommandBuffer(mOpenBatch.mTransferCommandBuffer));
+
+	const Core::uint64 transferValue = ++mTimelineValue;
+	SubmitCommandBuffer(mTransferQueue, mOpenBatch.mTransferCommandBuffer, 0, transferValue);
+
+	if (!IsSharingGraphicsQueue())
+	{
+		// Acquire side runs on the graphics queue as soon as the transfer part has signaled, it is submitted even when empty
+		// since models are drawn from the graphics queue without waiting on the timeline once the batch has completed
+		VkCommandBuffer graphicsCommandBuffer = GetGraphicsCommandBuffer();
+		VulkanStagingRingLocal::InsertTransferWriteBarrier(graphicsCommandBuffer);
+		VK_CHECK_RESULT(vkEndCommandBuffer(graphicsCommandBuffer));
+
+		SubmitCommandBuffer(mGraphicsQueue, graphicsCommandBuffer, transferValue, ++mTimelineValue);
+	}
+
+	mOpenBatch.mTimelineValue = mTimelineValue;
+	mOpenBatch.mEndOffset = mHead;
+	mInFlightBatches.push_back(std::move(mOpenBatch));
+	mOpenBatch = Batch{};
+	mIsBatchOpen = false;
+
+	return mTimelineValue;
+}
+
+void VulkanStagingRing::Flush()
+{
+	Submit();
+
+	while (!mInFlightBatches.empty())
+	{
+		RetireOldestBatch(true);
+	}
+}
+
+void VulkanStagingRing::Reclaim()
+{
+	Core::uint64 completedValue = 0;
+	VK_CHECK_RESULT(vkGetSemaphoreCounterValue(mVulkanDevice->mLogicalVkDevice, mTimelineSemaphore, &completedValue));
+
+	while (!mInFlightBatches.empty() && mInFlightBatches.front().mTimelineValue <= completedValue)
+	{
+		RetireOldestBatch(false);
+	}
+}
+
+void VulkanStagingRing::Wait(Core::uint64 aTimelineValue) const
+{
+	const VkSemaphoreWaitInfo semaphoreWaitInfo{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+		.semaphoreCount = 1,
+		.pSemaphores = &mTimelineSemaphore,
+		.pValues = &aTimelineValue
+	};
+	VK_CHECK_RESULT(vkWaitSemaphores(mVulkanDevice->mLogicalVkDevice, &semaphoreWaitInfo, gDefaultFenceTimeoutNS));
+}
+
+bool VulkanStagingRing::IsComplete(Core::uint64 aTimelineValue) const
+{
+	Core::uint64 completedValue = 0;
+	VK_CHECK_RESULT(vkGetSemaphoreCounterValue(mVulkanDevice->mLogicalVkDevice, mTimelineSemaphore, &completedValue));
+
+	return completedValue >= aTimelineValue;
+}
+
+bool VulkanStagingRing::TryAllocate(VkDeviceSize aSize, VkDeviceSize aAlignment, VkDeviceSize& aOffset)
+{
+	const VkDeviceSize capacity = GetSize();
+
+	if (mUsedBytes == 0)
+	{
+		mHead = 0;
+		mTail = 0;
+	}
+
+	VkDeviceSize offset = VulkanStagingRingLocal::AlignUp(mHead, aAlignment);
+	VkDeviceSize consumedBytes = 0;
+
+	if (mUsedBytes == 0 || mHead > mTail)
+	{
+		// Free range runs from the head to the end of the ring and wraps around up to the tail
+		if (offset + aSize <= capacity)
+		{
+			consumedBytes = offset + aSize - mHead;
+		}
+		else if (aSize <= mTail)
+		{
+			consumedBytes = capacity - mHead + aSize;
+			offset = 0;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	else
+	{
+		// Head has wrapped, free range is between head and tail (empty if the ring is full)
+		if (offset + aSize > mTail)
+			return false;
+
+		consumedBytes = offset + aSize - mHead;
+	}
+
+	aOffset = offset;
+	mHead = offset + aSize;
+	mUsedBytes += consumedBytes;
+	mOpenBatch.mByteCount += consumedBytes;
+
+	return true;
+}
+
+void VulkanStagingRing::BeginBatch()
+{
+	if (mIsBatchOpen)
+		return;
+
+	mOpenBatch.mTransferCommandBuffer = AcquireCommandBuffer(mTransferCommandPool, mFreeTransferCommandBuffers);
+	mIsBatchOpen = true;
+}
+
+void VulkanStagingRing::RetireOldestBatch(bool aShouldWait)
+{
+	Batch& batch = mInFlightBatches.front();
+
+	if (aShouldWait)
+	{
+		Wait(batch.mTimelineValue);
+	}
+
+	for (Buffer& dedicatedBuffer : batch.mDedicatedBuffers)
+	{
+		dedicatedBuffer.Destroy();
+	}
+
+	mFreeTransferCommandBuffers.push_back(batch.mTransferCommandBuffer);
+	if (batch.mGraphicsCommandBuffer != VK_NULL_HANDLE)
+		mFreeGraphicsCommandBuffers.push_back(batch.mGraphicsCommandBuffer);
+
+	mTail = batch.mEndOffset;
+	mUsedBytes -= batch.mByteCount;
+
+	mInFlightBatches.pop_front();
+}
+
+VkCommandBuffer VulkanStagingRing::AcquireCommandBuffer(VkCommandPool aCommandPool, std::vector<VkCommandBuffer>& aFreeCommandBuffers)
+{
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	if (aFreeCommandBuffers.empty())
+	{
+		commandBuffer = mVulkanDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, aCommandPool, false);
+	}
+	else
+	{
+		commandBuffer = aFreeCommandBuffers.back();
+		aFreeCommandBuffers.pop_back();
+	}
+
+	const VkCommandBufferBeginInfo commandBufferBeginInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+	};
+	VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo));
+
+	return commandBuffer;
+}
+
+void VulkanStagingRing::SubmitCommandBuffer(VkQueue aQueue, VkCommandBuffer aCommandBuffer, Core::uint64 aWaitValue, Core::uint64 aSignalValue)
+{
+	const bool isWaiting = aWaitValue > 0;
+	const VkPipelineStageFlags waitStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+	const VkTimelineSemaphoreSubmitInfo timelineSemaphoreSubmitInfo{
+		.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+		.waitSemaphoreValueCount = isWaiting ? 1u : 0u,
+		.pWaitSemaphoreValues = isWaiting ? &aWaitValue : nullptr,
+		.signalSemaphoreValueCount = 1,
+		.pSignalSemaphoreValues = &aSignalValue
+	};
+	const VkSubmitInfo submitInfo{
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.pNext = &timelineSemaphoreSubmitInfo,
+		.waitSemaphoreCount = isWaiting ? 1u : 0u,
+		.pWaitSemaphores = isWaiting ? &mTimelineSemaphore : nullptr,
+		.pWaitDstStageMask = isWaiting ? &waitStageMask : nullptr,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &aCommandBuffer,
+		.signalSemaphoreCount = 1,
+		.pSignalSemaphores = &mTimelineSemaphore
+	};
+	mVulkanDevice->QueueSubmit(aQueue, submitInfo, VK_NULL_HANDLE);
+
+	mSubmitCount++;
+}
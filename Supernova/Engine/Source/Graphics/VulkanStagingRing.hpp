@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Core/Types.hpp"
+#include "VulkanTypes.hpp"
+
+#include <deque>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+struct VulkanDevice;
+
+static constexpr VkDeviceSize gDefaultStagingRingSize = 32ull * 1024 * 1024;
+
+struct StagingAllocation
+{
+	StagingAllocation() : mVkBuffer{VK_NULL_HANDLE}, mOffset{0}, mMappedData{nullptr} {}
+
+	VkBuffer mVkBuffer; // Source buffer for vkCmdCopyBuffer / vkCmdCopyBufferToImage
+	VkDeviceSize mOffset; // Offset of the allocation inside mVkBuffer
+	void* mMappedData; // Host pointer to write the upload data to
+};
+
+// Persistently mapped upload buffer shared by all transfers, recorded on the dedicated transfer queue.
+// Allocations are handed out in submission order and reclaimed once the timeline value of the batch that consumed them has been reached.
+// Copies are recorded into the transfer command buffer of the open batch, which is only submitted when the ring runs out of space or on Submit/Flush.
+// If the transfer queue belongs to another family than the graphics queue, resources are released on the transfer queue
+// and acquired by a small graphics submission that waits on the timeline semaphore, which is also where graphics-only work (e.g. blits) is recorded.
+// A second queue of the graphics family gets the same graphics submission, only without the ownership transfers.
+// Submissions go through VulkanDevice::QueueSubmit, since the transfer queue may also be the graphics or compute queue.
+// Always allocate before calling GetCommandBuffer/GetGraphicsCommandBuffer, since an allocation may submit the open batch to make room.
+class VulkanStagingRing
+{
+public:
+	VulkanStagingRing(VulkanDevice* aDevice, VkQueue aTransferQueue, Core::uint32 aTransferQueueFamilyIndex, VkQueue aGraphicsQueue, Core::uint32 aGraphicsQueueFamilyIndex, VkDeviceSize aSize = gDefaultStagingRingSize);
+	~VulkanStagingRing();
+
+	VulkanStagingRing(const VulkanStagingRing&) = delete;
+	VulkanStagingRing& operator=(const VulkanStagingRing&) = delete;
+
+	StagingAllocation Allocate(VkDeviceSize aSize, VkDeviceSize aAlignment = 4);
+	VkCommandBuffer GetCommandBuffer();
+	VkCommandBuffer GetGraphicsCommandBuffer();
+
+	void UploadBuffer(VkBuffer aDestination, const void* aData, VkDeviceSize aSize, VkDeviceSize aDestinationOffset = 0, VkPipelineStageFlags aDestinationStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VkAccessFlags aDestinationAccessMask = VK_ACCESS_MEMORY_READ_BIT);
+	void TransferBufferOwnership(VkBuffer aBuffer, VkDeviceSize aOffset, VkDeviceSize aSize, VkPipelineStageFlags aDestinationStageMask, VkAccessFlags aDestinationAccessMask);
+	void TransferImageOwnership(VkImage aImage, const VkImageSubresourceRange& aSubresourceRange, VkImageLayout aOldLayout, VkImageLayout aNewLayout, VkPipelineStageFlags aDestinationStageMask, VkAccessFlags aDestinationAccessMask);
+
+	Core::uint64 Submit();
+	void Flush();
+	void Reclaim();
+	void Wait(Core::uint64 aTimelineValue) const;
+	bool IsComplete(Core::uint64 aTimelineValue) const;
+
+	VkSemaphore GetTimelineSemaphore() const { return mTimelineSemaphore; }
+	Core::uint64 GetLastSubmittedValue() const { return mTimelineValue; }
+	Core::uint32 GetSubmitCount() const { return mSubmitCount; }
+	VkDeviceSize GetSize() const { return mBuffer.mVkDeviceSize; }
+	VkDeviceSize GetUsedBytes() const { return mUsedBytes; }
+	bool IsUsingDedicatedTransferQueue() const { return mTransferQueueFamilyIndex != mGraphicsQueueFamilyIndex; }
+	bool IsSharingGraphicsQueue() const { return mTransferQueue == mGraphicsQueue; }
+
+private:
+	struct Batch
+	{
+		Batch() : mTransferCommandBuffer{VK_NULL_HANDLE}, mGraphicsCommandBuffer{VK_NULL_HANDLE}, mTimelineValue{0}, mEndOffset{0}, mByteCount{0} {}
+
+		VkCommandBuffer mTransferCommandBuffer;
+		VkCommandBuffer mGraphicsCommandBuffer; // Acquire barriers and graphics-only work, only used when the transfer queue isn't the graphics queue
+		Core::uint64 mTimelineValue; // Value signaled once every command of this batch has completed
+		VkDeviceSize mEndOffset; // Ring head at submission, becomes the tail once the batch has retired
+		VkDeviceSize mByteCount; // Ring bytes consumed by this batch, including alignment and wrap padding
+		std::vector<Buffer> mDedicatedBuffers; // Uploads larger than the ring, destroyed once the batch has retired
+	};
+
+	bool TryAllocate(VkDeviceSize aSize, VkDeviceSize aAlignment, VkDeviceSize& aOffset);
+	void BeginBatch();
+	void RetireOldestBatch(bool aShouldWait);
+	VkCommandBuffer AcquireCommandBuffer(VkCommandPool aCommandPool, std::vector<VkCommandBuffer>& aFreeCommandBuffers);
+	void SubmitCommandBuffer(VkQueue aQueue, VkCommandBuffer aCommandBuffer, Core::uint64 aWaitValue, Core::uint64 aSignalValue);
+
+	VulkanDevice* mVulkanDevice;
+	VkQueue mTransferQueue;
+	VkQueue mGraphicsQueue;
+	Core::uint32 mTransferQueueFamilyIndex;
+	Core::uint32 mGraphicsQueueFamilyIndex;
+	VkCommandPool mTransferCommandPool;
+	VkCommandPool mGraphicsCommandPool;
+	VkSemaphore mTimelineSemaphore;
+	Buffer mBuffer;
+	Batch mOpenBatch;
+	std::deque<Batch> mInFlightBatches;
+	std::vector<VkCommandBuffer> mFreeTransferCommandBuffers;
+	std::vector<VkCommandBuffer> mFreeGraphicsCommandBuffers;
+	Core::uint64 mTimelineValue; // Last value a submission will signal
+	VkDeviceSize mHead; // Next free byte
+	VkDeviceSize mTail; // First byte still referenced by an in-flight batch
+	VkDeviceSize mUsedBytes;
+	Core::uint32 mSubmitCount;
+	bool mIsBatchOpen;
+};
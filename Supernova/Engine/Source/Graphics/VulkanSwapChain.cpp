@@ -3,7 +3,9 @@
 #include "Core/Constants.hpp"
 #include "Core/Types.hpp"
 #include "VulkanDevice.hpp"
+#include "VulkanMemoryAllocator.hpp"
 #include "VulkanTools.hpp"
+#include "VulkanTypes.hpp"
 
 #include <algorithm>
 #include <cassert>
@@ -20,6 +22,7 @@ VulkanSwapChain::VulkanSwapChain()
 	, mVkSwapchainKHR{VK_NULL_HANDLE}
 	, mQueueNodeIndex{Core::uint32_max}
 	, mImageCount{0}
+	, mIsHeadless{false}
 {
 }
 
@@ -119,6 +122,16 @@ void VulkanSwapChain::InitializeSurface()
 	mVkColorSpaceKHR = selectedFormat.colorSpace;
 }
 
+void VulkanSwapChain::InitializeHeadless()
+{
+	mIsHeadless = true;
+
+	// Without a surface any graphics queue will do, and every implementation can render to and copy from this format
+	mQueueNodeIndex = mActiveVulkanDevice->mQueueFamilyIndices.mGraphics;
+	mColorVkFormat = VK_FORMAT_R8G8B8A8_UNORM;
+	mVkColorSpaceKHR = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+}
+
 void VulkanSwapChain::SetContext(VkInstance aVkInstance, VulkanDevice* aVulkanDevice)
 {
 	mActiveVkInstance = aVkInstance;
@@ -130,6 +143,12 @@ void VulkanSwapChain::CreateSwapchain(Core::uint32& aWidth, Core::uint32& aHeigh
 	assert(mActiveVulkanDevice);
 	assert(mActiveVkInstance);
 
+	if (mIsHeadless)
+	{
+		CreateOffscreenImages(aWidth, aHeight);
+		return;
+	}
+
 	// Store the current swap chain handle so we can use it later on to ease up recreation
 	VkSwapchainKHR oldSwapchain = mVkSwapchainKHR;
 
@@ -301,6 +320,13 @@ void VulkanSwapChain::CreateSwapchain(Core::uint32& aWidth, Core::uint32& aHeigh
 
 VkResult VulkanSwapChain::AcquireNextImage(VkSemaphore aPresentCompleteSemaphore, Core::uint32& aImageIndex) const
 {
+	// Offscreen images are used in turn, and nothing signals the semaphore
+	if (mIsHeadless)
+	{
+		aImageIndex = (aImageIndex + 1) % mImageCount;
+		return VK_SUCCESS;
+	}
+
 	// By setting timeout to UINT64_MAX we will always wait until the next image has been acquired or an actual error is thrown
 	// With that we don't have to handle VK_NOT_READY
 	return vkAcquireNextImageKHR(mActiveVulkanDevice->mLogicalVkDevice, mVkSwapchainKHR, Core::uint64_max, aPresentCompleteSemaphore, static_cast<VkFence>(VK_NULL_HANDLE), &aImageIndex);
@@ -308,6 +334,12 @@ VkResult VulkanSwapChain::AcquireNextImage(VkSemaphore aPresentCompleteSemaphore
 
 void VulkanSwapChain::CleanUp()
 {
+	if (mIsHeadless)
+	{
+		DestroyImages();
+		return;
+	}
+
 	if (mVkSwapchainKHR != VK_NULL_HANDLE)
 	{
 		for (Core::size i = 0; i < mVkImages.size(); i++)
@@ -322,3 +354,63 @@ void VulkanSwapChain::CleanUp()
 	mVkSurfaceKHR = VK_NULL_HANDLE;
 	mVkSwapchainKHR = VK_NULL_HANDLE;
 }
+
+void VulkanSwapChain::CreateOffscreenImages(Core::uint32 aWidth, Core::uint32 aHeight)
+{
+	DestroyImages();
+
+	// One image per frame in flight, so a frame never renders into an image an earlier one is still copying out
+	mImageCount = gMaxConcurrentFrames;
+	mVkImages.resize(mImageCount);
+	mVkImageViews.resize(mImageCount);
+	mOffscreenAllocations.resize(mImageCount);
+
+	const VkImageCreateInfo imageCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+		.imageType = VK_IMAGE_TYPE_2D,
+		.format = mColorVkFormat,
+		.extent = {aWidth, aHeight, 1},
+		.mipLevels = 1,
+		.arrayLayers = 1,
+		.samples = VK_SAMPLE_COUNT_1_BIT,
+		.tiling = VK_IMAGE_TILING_OPTIMAL,
+		.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+	};
+
+	for (Core::size i = 0; i < mVkImages.size(); i++)
+	{
+		VK_CHECK_RESULT(vkCreateImage(mActiveVulkanDevice->mLogicalVkDevice, &imageCreateInfo, nullptr, &mVkImages[i]));
+		mOffscreenAllocations[i] = mActiveVulkanDevice->AllocateImageMemory(mVkImages[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		const VkImageViewCreateInfo colorAttachmentViewCreateInfo{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+			.image = mVkImages[i],
+			.viewType = VK_IMAGE_VIEW_TYPE_2D,
+			.format = mColorVkFormat,
+			.subresourceRange = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.baseMipLevel = 0,
+				.levelCount = 1,
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			}
+		};
+		VK_CHECK_RESULT(vkCreateImageView(mActiveVulkanDevice->mLogicalVkDevice, &colorAttachmentViewCreateInfo, nullptr, &mVkImageViews[i]));
+	}
+}
+
+void VulkanSwapChain::DestroyImages()
+{
+	for (Core::size i = 0; i < mVkImages.size(); i++)
+	{
+		vkDestroyImageView(mActiveVulkanDevice->mLogicalVkDevice, mVkImageViews[i], nullptr);
+		vkDestroyImage(mActiveVulkanDevice->mLogicalVkDevice, mVkImages[i], nullptr);
+		mActiveVulkanDevice->mMemoryAllocator->Free(mOffscreenAllocations[i]);
+	}
+
+	mVkImages.clear();
+	mVkImageViews.clear();
+	mOffscreenAllocations.clear();
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Core/Types.hpp"
+#include "VulkanMemoryAllocator.hpp"
 
 #include <vector>
 #include <vulkan/vulkan_core.h>
@@ -13,6 +14,7 @@ public:
 	VulkanSwapChain();
 
 	void InitializeSurface();
+	void InitializeHeadless(); // Renders into offscreen images instead, no surface or presentation support is needed
 
 	void SetContext(VkInstance aVkInstance, VulkanDevice* aVulkanDevice);
 
@@ -39,6 +41,8 @@ public:
 	
 	void CleanUp();
 
+	bool IsHeadless() const { return mIsHeadless; }
+
 	VkFormat mColorVkFormat;
 	VkColorSpaceKHR mVkColorSpaceKHR;
 	VkSwapchainKHR mVkSwapchainKHR;
@@ -49,6 +53,11 @@ public:
 	Core::uint32 mImageCount;
 
 private:
+	void CreateOffscreenImages(Core::uint32 aWidth, Core::uint32 aHeight);
+	void DestroyImages();
+
+	std::vector<VulkanAllocation> mOffscreenAllocations{}; // Memory of the headless images, which aren't owned by a swap chain
 	VkInstance mActiveVkInstance;
 	VulkanDevice* mActiveVulkanDevice;
+	bool mIsHeadless;
 };
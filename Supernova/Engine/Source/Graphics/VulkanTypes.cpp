@@ -21,40 +21,44 @@
 /**
 * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
 *
+* @note Host visible memory is persistently mapped by the memory allocator, so this only hands out a pointer into that mapping
+*
 * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete buffer range.
 * @param offset (Optional) Byte offset from beginning
 *
 * @return VkResult of the buffer mapping call
 */
-VkResult Buffer::Map(VkDeviceSize aSize, VkDeviceSize aOffset)
+VkResult Buffer::Map(VkDeviceSize /*aSize*/, VkDeviceSize aOffset)
 {
-	return vkMapMemory(mLogicalVkDevice, mVkDeviceMemory, aOffset, aSize, 0, &mMappedData);
+	if (!mAllocation.mMappedData)
+	{
+		return VK_ERROR_MEMORY_MAP_FAILED;
+	}
+
+	mMappedData = static_cast<Core::uint8*>(mAllocation.mMappedData) + aOffset;
+	return VK_SUCCESS;
 }
 
 /**
 * Unmap a mapped memory range
 *
-* @note Does not return a result as vkUnmapMemory can't fail
+* @note The memory itself stays mapped by the memory allocator until the allocation is freed
 */
 void Buffer::Unmap()
 {
-	if (mMappedData)
-	{
-		vkUnmapMemory(mLogicalVkDevice, mVkDeviceMemory);
-		mMappedData = nullptr;
-	}
+	mMappedData = nullptr;
 }
 
 /**
 * Attach the allocated memory block to the buffer
 *
-* @param offset (Optional) Byte offset (from the beginning) for the memory region to bind
+* @param offset (Optional) Byte offset (from the beginning of the allocation) for the memory region to bind
 *
 * @return VkResult of the bindBufferMemory call
 */
 VkResult Buffer::Bind(VkDeviceSize aOffset)
 {
-	return vkBindBufferMemory(mLogicalVkDevice, mVkBuffer, mVkDeviceMemory, aOffset);
+	return vkBindBufferMemory(mLogicalVkDevice, mVkBuffer, mAllocation.mVkDeviceMemory, mAllocation.mOffset + aOffset);
 }
 
 /**
@@ -100,13 +104,7 @@ void Buffer::CopyTo(void* aData, VkDeviceSize aSize) const
 */
 VkResult Buffer::Flush(VkDeviceSize aSize, VkDeviceSize aOffset) const
 {
-	const VkMappedMemoryRange mappedMemoryRange{
-		.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
-		.memory = mVkDeviceMemory,
-		.offset = aOffset,
-		.size = aSize
-	};
-	return vkFlushMappedMemoryRanges(mLogicalVkDevice, 1, &mappedMemoryRange);
+	return mMemoryAllocator->Flush(mAllocation, aSize, aOffset);
 }
 
 /**
@@ -121,13 +119,7 @@ VkResult Buffer::Flush(VkDeviceSize aSize, VkDeviceSize aOffset) const
 */
 VkResult Buffer::Invalidate(VkDeviceSize aSize, VkDeviceSize aOffset) const
 {
-	const VkMappedMemoryRange mappedMemoryRange{
-		.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
-		.memory = mVkDeviceMemory,
-		.offset = aOffset,
-		.size = aSize
-	};
-	return vkInvalidateMappedMemoryRanges(mLogicalVkDevice, 1, &mappedMemoryRange);
+	return mMemoryAllocator->Invalidate(mAllocation, aSize, aOffset);
 }
 
 /**
@@ -140,11 +132,11 @@ void Buffer::Destroy()
 		vkDestroyBuffer(mLogicalVkDevice, mVkBuffer, nullptr);
 		mVkBuffer = VK_NULL_HANDLE;
 	}
-	if (mVkDeviceMemory)
+	if (mMemoryAllocator)
 	{
-		vkFreeMemory(mLogicalVkDevice, mVkDeviceMemory, nullptr);
-		mVkDeviceMemory = VK_NULL_HANDLE;
+		mMemoryAllocator->Free(mAllocation);
 	}
+	mMappedData = nullptr;
 }
 
 void ViewFrustum::UpdateFrustum(const Math::Matrix4f& aMatrix)
@@ -1,20 +1,31 @@
 #pragma once
 
+#include "Core/Constants.hpp"
 #include "Core/Types.hpp"
+#include "FrustumCulling.hpp"
 #include "Math/Types.hpp"
+#include "VulkanMemoryAllocator.hpp"
 
 #include <array>
+#include <cstddef>
 #include <filesystem>
 #include <ktx.h>
 #include <vector>
 #include <vulkan/vulkan_core.h>
 
-static constexpr Core::uint32 gMaxConcurrentFrames = 2;
+static constexpr Core::uint32 gMaxConcurrentFrames = 3;
 static constexpr int gModelInstanceCount = 64;
 static constexpr int gMaxLOD = 5;
+static constexpr Core::uint32 gMaxDepthPyramidMipCount = 16;
+static constexpr Core::uint32 gMinInstanceCapacity = 1024;
 
 struct VulkanDevice;
 
+namespace vkglTF
+{
+	struct Model;
+}
+
 struct UniformBufferData
 {
 	UniformBufferData() : mProjectionMatrix{}, mViewMatrix{}, mViewPosition{0.0f}, mLightPosition{0.0f}, mFrustumPlanes{}, mLightIntensity{1.8f} {}
@@ -37,14 +48,79 @@ struct InstanceData
 
 struct PushConstant
 {
-	PushConstant() : mModelMatrix{} {}
+	PushConstant() : mModelMatrix{}, mMaterialIndex{0} {}
 
 	Math::Matrix4f mModelMatrix;
+	Core::uint32 mMaterialIndex; // Slot in ModelManager's material buffer, pushed again before every draw of a model
+};
+
+struct MeshletCullingPushConstant
+{
+	MeshletCullingPushConstant() : mModelMatrix{}, mCameraPosition{0.0f}, mMeshletCount{0} {}
+
+	Math::Matrix4f mModelMatrix;
+	Math::Vector4f mCameraPosition; // World space position the meshlet normal cones are tested against
+	Core::uint32 mMeshletCount;
+};
+
+struct OcclusionCullingPushConstant
+{
+	OcclusionCullingPushConstant() : mViewProjectionMatrix{1.0f}, mDepthPyramidSize{0.0f}, mIsOcclusionCullingEnabled{0}, mIsLatePass{0}, mIsCompactionPass{0}, mInstanceCount{0} {}
+
+	Math::Matrix4f mViewProjectionMatrix; // Matrix the depth in the pyramid was rendered with
+	Math::Vector2f mDepthPyramidSize;
+	Core::uint32 mIsOcclusionCullingEnabled;
+	Core::uint32 mIsLatePass; // Re-tests the instances the early pass has skipped against the depth of the current frame
+	Core::uint32 mIsCompactionPass; // Copies the visible instances into their LOD draw once all of them have been counted
+	Core::uint32 mInstanceCount; // Instances beyond the count are spare capacity of the instance buffer
+};
+
+// Same layout as the push block of Indirectdraw.comp
+static_assert(offsetof(OcclusionCullingPushConstant, mInstanceCount) == 84 && sizeof(OcclusionCullingPushConstant) == 88);
+
+struct DepthPyramidPushConstant
+{
+	DepthPyramidPushConstant() : mInputWidth{0}, mInputHeight{0}, mOutputWidth{0}, mOutputHeight{0} {}
+
+	Core::uint32 mInputWidth;
+	Core::uint32 mInputHeight;
+	Core::uint32 mOutputWidth;
+	Core::uint32 mOutputHeight;
+};
+
+struct IndirectDrawCommands
+{
+	IndirectDrawCommands() : mDrawCount{0}, mDrawCommands{} {}
+
+	Core::uint32 mDrawCount; // Number of non-empty draws, read by vkCmdDrawIndexedIndirectCount
+	VkDrawIndexedIndirectCommand mDrawCommands[gMaxLOD + 1]; // One instanced draw per visible LOD (written by compute shader)
+};
+
+// Indirectdraw.comp declares the count and the draws in one std430 block, the draws start right after the count
+static_assert(offsetof(IndirectDrawCommands, mDrawCount) == 0 && offsetof(IndirectDrawCommands, mDrawCommands) == sizeof(Core::uint32));
+
+struct IndirectDrawInfo
+{
+	IndirectDrawInfo() : mDrawCount{0}, mLoDCount{} {}
+
+	Core::uint32 mDrawCount; // Total number of indirect draw counts to be issued
+	Core::uint32 mLoDCount[gMaxLOD + 1]; // Statistics for number of draws per LOD level (written by compute shader)
+};
+
+// Index range of a LOD of the instanced model, matches the std430 layout read by the cull shader
+struct LoDLevel
+{
+	LoDLevel() : mFirstIndex{0}, mIndexCount{0}, mDistance{0.0f}, mPadding{0.0f} {}
+
+	Core::uint32 mFirstIndex;
+	Core::uint32 mIndexCount;
+	float mDistance; // Instances closer to the viewer use this LOD, farther ones one of the next
+	float mPadding;
 };
 
 struct Buffer
 {
-	Buffer() : mLogicalVkDevice{VK_NULL_HANDLE}, mVkBuffer{VK_NULL_HANDLE}, mVkDeviceMemory{VK_NULL_HANDLE}, mVkDeviceSize{0}, mVkDeviceAlignment{0}, mMappedData{nullptr}, mDeviceAddress{0} {}
+	Buffer() : mLogicalVkDevice{VK_NULL_HANDLE}, mVkBuffer{VK_NULL_HANDLE}, mMemoryAllocator{nullptr}, mVkDeviceSize{0}, mVkDeviceAlignment{0}, mMappedData{nullptr}, mDeviceAddress{0} {}
 
 	VkResult Map(VkDeviceSize aSize = VK_WHOLE_SIZE, VkDeviceSize aOffset = 0);
 	void Unmap();
@@ -57,7 +133,8 @@ struct Buffer
 
 	VkDevice mLogicalVkDevice;
 	VkBuffer mVkBuffer;
-	VkDeviceMemory mVkDeviceMemory;
+	VulkanAllocation mAllocation;
+	VulkanMemoryAllocator* mMemoryAllocator; // Allocator that owns mAllocation
 	VkDescriptorBufferInfo mVkDescriptorBufferInfo{};
 	VkDeviceSize mVkDeviceSize;
 	VkDeviceSize mVkDeviceAlignment;
@@ -69,11 +146,12 @@ struct Buffer
 
 struct DepthStencil
 {
-	DepthStencil() : mVkImage{VK_NULL_HANDLE}, mVkDeviceMemory{VK_NULL_HANDLE}, mVkImageView{VK_NULL_HANDLE} {}
+	DepthStencil() : mVkImage{VK_NULL_HANDLE}, mVkImageView{VK_NULL_HANDLE}, mDepthVkImageView{VK_NULL_HANDLE} {}
 
 	VkImage mVkImage;
-	VkDeviceMemory mVkDeviceMemory;
+	VulkanAllocation mAllocation;
 	VkImageView mVkImageView;
+	VkImageView mDepthVkImageView; // Depth aspect only, sampled to build the depth pyramid (VK_NULL_HANDLE if the format can't be sampled)
 };
 
 class ViewFrustum
@@ -87,6 +165,15 @@ public:
 	bool IsInSphere(const Math::Vector3f& aPosition, float aRadius) const;
 };
 
+struct SecondaryCommandPool
+{
+	SecondaryCommandPool() : mCommandPool{VK_NULL_HANDLE}, mUsedCommandBufferCount{0} {}
+
+	VkCommandPool mCommandPool; // Only used by a single job system thread, command pools can't be accessed concurrently
+	std::vector<VkCommandBuffer> mCommandBuffers; // Allocated when a frame needs more than before, reused once the pool has been reset
+	Core::uint32 mUsedCommandBufferCount;
+};
+
 struct GraphicsContext
 {
 	GraphicsContext() : mQueue{VK_NULL_HANDLE}, mCommandPool{VK_NULL_HANDLE}, mPipelineLayout{VK_NULL_HANDLE}, mDescriptorSetLayout{VK_NULL_HANDLE} {}
@@ -96,11 +183,74 @@ struct GraphicsContext
 	VkPipelineLayout mPipelineLayout;
 	VkDescriptorSetLayout mDescriptorSetLayout;
 	std::array<VkCommandBuffer, gMaxConcurrentFrames> mCommandBuffers{}; // Command buffers used for rendering
-	std::array<VkFence, gMaxConcurrentFrames> mFences{};
+	std::array<std::vector<SecondaryCommandPool>, gMaxConcurrentFrames> mSecondaryCommandPools{}; // One pool per job system thread, reset once the frame's fence has signaled
+	std::array<VkFence, gMaxConcurrentFrames> mFences{}; // Created signaled, so a signaled fence alone doesn't mean its buffers have been written
+	std::array<bool, gMaxConcurrentFrames> mIsSubmitted{}; // Whether each buffer index has been submitted at least once
 	std::array<VkSemaphore, gMaxConcurrentFrames> mPresentCompleteSemaphores{};
 	std::vector<VkSemaphore> mRenderCompleteSemaphores{};
 };
 
+// Copies of the headless frames, written to disk once the graphics fence of their frame has signaled
+struct FrameDumpContext
+{
+	FrameDumpContext() : mFrameCount{0} { mPendingFrames.fill(Core::uint32_max); }
+
+	std::array<Buffer, gMaxConcurrentFrames> mReadbackBuffers{}; // Tightly packed texels of the color image, host visible
+	std::array<Core::uint32, gMaxConcurrentFrames> mPendingFrames; // Frame number copied into each readback buffer, uint32_max when there is none
+	std::filesystem::path mDirectory; // Empty when frames aren't dumped
+	Core::uint32 mFrameCount; // Frames recorded since the renderer was prepared
+};
+
+// Timings and counters of one rendered frame, as reported by benchmarks
+struct FrameStatistics
+{
+	FrameStatistics()
+		: mFrameNumber{Core::uint32_max}
+		, mFrameTimeMs{0.0}
+		, mRenderCpuTimeMs{0.0}
+		, mGpuComputeTimeMs{0.0}
+		, mGpuGraphicsTimeMs{0.0}
+		, mEarlyDrawInfo{}
+		, mLateDrawInfo{}
+		, mVisibleMeshletCount{0}
+		, mDeviceLocalBytes{0}
+		, mHostVisibleBytes{0}
+		, mReservedBytes{0}
+		, mHasGpuTime{false}
+	{
+	}
+
+	Core::uint32 mFrameNumber; // Frames recorded since statistics were enabled, uint32_max for an empty slot
+	double mFrameTimeMs; // Time since the engine loop started the previous frame
+	double mRenderCpuTimeMs; // VulkanRenderer::RenderFrame on the CPU
+	double mGpuComputeTimeMs; // Compute command buffer, from its first to its last timestamp
+	double mGpuGraphicsTimeMs; // Graphics command buffer, from its first to its last timestamp
+	IndirectDrawInfo mEarlyDrawInfo; // Instances drawn by the compute queue cull
+	IndirectDrawInfo mLateDrawInfo; // Instances the late occlusion pass has drawn in addition
+	Core::uint32 mVisibleMeshletCount;
+	VkDeviceSize mDeviceLocalBytes; // Memory handed out to resources from device local and from host visible memory types, memory types that are both count twice
+	VkDeviceSize mHostVisibleBytes;
+	VkDeviceSize mReservedBytes; // Memory allocated from the driver, including unused parts of blocks
+	bool mHasGpuTime; // False when a queue doesn't support timestamps
+};
+
+// Per frame statistics collected for benchmarks, read back once the graphics fence of their frame has signaled
+struct FrameStatisticsContext
+{
+	static constexpr Core::uint32 gQueriesPerFrame = 4; // Compute begin and end, graphics begin and end
+
+	FrameStatisticsContext() : mQueryPool{VK_NULL_HANDLE}, mTimestampPeriodNs{0.0}, mTimestampMask{0}, mFrameCount{0}, mIsEnabled{false}, mIsTimestampSupported{false} {}
+
+	VkQueryPool mQueryPool; // gQueriesPerFrame timestamps per frame in flight
+	std::array<FrameStatistics, gMaxConcurrentFrames> mPendingFrames{}; // Frames submitted but not read back yet
+	std::vector<FrameStatistics> mFrames{}; // Frames read back, in the order they were rendered
+	double mTimestampPeriodNs;
+	Core::uint64 mTimestampMask;
+	Core::uint32 mFrameCount; // Frames recorded since statistics were enabled
+	bool mIsEnabled;
+	bool mIsTimestampSupported;
+};
+
 struct ComputeContext
 {
 	struct ComputeSemaphores
@@ -124,3 +274,97 @@ struct ComputeContext
 	VkPipelineLayout mPipelineLayout; // Layout of the compute pipeline
 	VkPipeline mPipeline{}; // Compute pipeline
 };
+
+struct MeshletCullingContext
+{
+	MeshletCullingContext() : mDescriptorPool{VK_NULL_HANDLE}, mDescriptorSetLayout{VK_NULL_HANDLE}, mPipelineLayout{VK_NULL_HANDLE}, mPipeline{VK_NULL_HANDLE}, mVisibleMeshletCount{0}, mIsCompactingDraws{false}, mIsPrepared{false} {}
+
+	VkDescriptorPool mDescriptorPool; // Separate pool, the sets are only allocated once the culled model has been loaded
+	VkDescriptorSetLayout mDescriptorSetLayout;
+	std::array<VkDescriptorSet, gMaxConcurrentFrames> mDescriptorSets{};
+	VkPipelineLayout mPipelineLayout;
+	VkPipeline mPipeline; // Stays VK_NULL_HANDLE if the shader has not been compiled, meshlet models are then drawn per primitive
+	MeshletCullingPushConstant mPushConstant{};
+	std::array<Buffer, gMaxConcurrentFrames> mDrawCommandBuffers{}; // One draw per meshlet, grouped by primitive
+	std::array<Buffer, gMaxConcurrentFrames> mDrawCountBuffers{}; // Visible meshlets per primitive, host visible for the statistics
+	Core::uint32 mVisibleMeshletCount;
+	bool mIsCompactingDraws; // Visible meshlets are compacted and drawn with vkCmdDrawIndexedIndirectCount
+	bool mIsPrepared; // Buffers and descriptor sets have been created for the loaded model
+};
+
+struct OcclusionCullingContext
+{
+	OcclusionCullingContext() : mDepthPyramidVkImage{VK_NULL_HANDLE}, mDepthPyramidVkImageView{VK_NULL_HANDLE}, mDepthPyramidSampler{VK_NULL_HANDLE}, mDescriptorPool{VK_NULL_HANDLE}, mDescriptorSetLayout{VK_NULL_HANDLE}, mPipelineLayout{VK_NULL_HANDLE}, mPipeline{VK_NULL_HANDLE}, mDepthPyramidWidth{0}, mDepthPyramidHeight{0}, mDepthPyramidMipCount{0}, mIsSupported{false}, mIsEnabled{true}, mIsDepthPyramidValid{false}, mIsEarlyPassOccluding{false} {}
+
+	VkImage mDepthPyramidVkImage; // Farthest depth per texel, kept in VK_IMAGE_LAYOUT_GENERAL and shared with the compute queue
+	VulkanAllocation mDepthPyramidAllocation;
+	VkImageView mDepthPyramidVkImageView; // All mips, sampled by the cull shader
+	std::vector<VkImageView> mDepthPyramidMipVkImageViews; // One per mip, written by the reduction shader
+	std::vector<VkDescriptorSet> mDepthPyramidDescriptorSets; // One per mip, reads the depth buffer or the previous mip
+	VkSampler mDepthPyramidSampler;
+	VkDescriptorPool mDescriptorPool; // Separate pool, the pyramid sets are reallocated when the window is resized
+	VkDescriptorSetLayout mDescriptorSetLayout;
+	VkPipelineLayout mPipelineLayout;
+	VkPipeline mPipeline; // Stays VK_NULL_HANDLE if the shader has not been compiled, instances are then only frustum culled
+	std::array<VkDescriptorSet, gMaxConcurrentFrames> mLateDescriptorSets{}; // Cull shader sets of the late pass, only the statistics buffer differs
+	std::array<Buffer, gMaxConcurrentFrames> mLateDrawCountBuffers{}; // Statistics of the late pass, read back once the graphics fence has signaled
+	IndirectDrawInfo mLateDrawInfo{};
+	OcclusionCullingPushConstant mPushConstant{};
+	Core::uint32 mDepthPyramidWidth;
+	Core::uint32 mDepthPyramidHeight;
+	Core::uint32 mDepthPyramidMipCount;
+	bool mIsSupported; // The depth format can be sampled and the reduction shader has been found
+	bool mIsEnabled;
+	bool mIsDepthPyramidValid; // The pyramid holds the depth of a previous frame, cleared when it is recreated
+	bool mIsEarlyPassOccluding; // The early pass of the current frame has skipped occluded instances, so the late pass has to run
+};
+
+// World space boxes of the primitives of a model drawn with DrawModel, and of every subtree of its nodes.
+// Nodes are indexed by vkglTF::Node::mIndex, the primitives of a node follow each other from mFirstPrimitives[mIndex] on.
+struct ModelPartCulling
+{
+	ModelPartCulling() : mModel{nullptr}, mNodeBounds{FrustumCulling::VolumeType::Box}, mPrimitiveBounds{FrustumCulling::VolumeType::Box}, mCulledSubtreeCount{0} {}
+
+	bool IsNodeVisible(Core::uint32 aNodeIndex) const { return mNodeDrawList.mVisibility[aNodeIndex] != 0; } // False when nothing below the node is visible
+	bool IsPrimitiveVisible(Core::uint32 aPrimitiveIndex) const { return mPrimitiveDrawList.mVisibility[aPrimitiveIndex] != 0; }
+	Core::uint32 GetVisiblePrimitiveCount() const { return mPrimitiveDrawList.GetVisibleCount(); }
+	Core::uint32 GetPrimitiveCount() const { return mPrimitiveBounds.GetCount(); }
+
+	const vkglTF::Model* mModel; // The indices are rebuilt when the model changes
+	std::vector<Core::uint32> mFirstPrimitives;
+	std::vector<Core::uint32> mSubtreePrimitiveCounts;
+	FrustumCulling::Bounds mNodeBounds; // Subtrees without primitives are never visible
+	FrustumCulling::Bounds mPrimitiveBounds;
+	FrustumCulling::DrawList mNodeDrawList;
+	FrustumCulling::DrawList mPrimitiveDrawList;
+	Core::uint32 mCulledSubtreeCount; // Subtrees with primitives that are culled while their parent is visible
+};
+
+// Frustum culling and LOD selection on the CPU, see FrustumCulling.
+// The models that are drawn without a cull shader are always culled here, the instances only while mIsCullingInstances is set, in place of the cull shader.
+struct CpuCullingContext
+{
+	enum class Model : Core::uint32
+	{
+		Planet,
+		Voyager,
+		Count
+	};
+
+	CpuCullingContext() : mModelBounds{FrustumCulling::VolumeType::Box}, mInstanceBounds{FrustumCulling::VolumeType::Sphere}, mKernel{FrustumCulling::GetFastestKernel()}, mIsCullingInstances{false}, mIsCullingModelParts{true} {}
+
+	bool IsModelVisible(Model aModel) const { return mModelDrawList.mVisibility[static_cast<Core::size>(aModel)] != 0; }
+	const ModelPartCulling* GetModelParts(Model aModel) const { return mIsCullingModelParts ? &mModelParts[static_cast<Core::size>(aModel)] : nullptr; } // Nothing while every part is drawn
+
+	FrustumCulling::Bounds mModelBounds; // World space box of every Model, never visible until the model has been loaded
+	FrustumCulling::Bounds mInstanceBounds; // The spheres the cull shader tests, updated with the dirty instances
+	FrustumCulling::DrawList mModelDrawList;
+	FrustumCulling::DrawList mInstanceDrawList;
+	std::array<ModelPartCulling, static_cast<Core::size>(Model::Count)> mModelParts{};
+	std::vector<LoDLevel> mLoDLevels; // Same as ComputeContext::mLoDBuffers
+	std::vector<float> mLoDDistances; // Distances of the LODs the cull shader selects by
+	std::array<Buffer, gMaxConcurrentFrames> mVisibleInstanceBuffers{}; // Host visible, filled with the visible instances grouped by LOD once the frame's fences have signaled
+	FrustumCulling::Kernel mKernel;
+	bool mIsCullingInstances;
+	bool mIsCullingModelParts; // Primitives and subtrees of the models outside of the frustum are skipped by DrawModel
+};
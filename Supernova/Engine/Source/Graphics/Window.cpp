@@ -28,11 +28,15 @@ Window::Window()
 	: mGLFWWindow{nullptr}
 	, mIconPath{"Textures/Supernova.png"}
 	, mShouldClose{false}
+	, mIsHeadless{false}
 {
 }
 
 Window::~Window()
 {
+	if (mIsHeadless)
+		return;
+
 	glfwDestroyWindow(mGLFWWindow);
 	glfwTerminate();
 }
@@ -89,6 +93,14 @@ void Window::InitializeWindow(const std::string& aApplicationName)
 	std::cout << std::format("GLFW v{}.{}.{}", major, minor, revision) << std::endl;
 }
 
+void Window::InitializeHeadless()
+{
+	mIsHeadless = true;
+	mWindowProperties.mIsFocused = true;
+
+	std::cout << std::format("Headless {}x{}", mWindowProperties.mWindowWidth, mWindowProperties.mWindowHeight) << std::endl;
+}
+
 void Window::CreateWindowSurface(VkInstance* aVkInstance, VkSurfaceKHR* aVkSurface)
 {
 	VK_CHECK_RESULT(glfwCreateWindowSurface(*aVkInstance, mGLFWWindow, nullptr, aVkSurface));
@@ -98,6 +110,10 @@ void Window::UpdateWindow()
 {
 	SIMPLE_PROFILER_PROFILE_SCOPE("Window::UpdateWindow");
 
+	// Without a window there are no events, and only Close ends the run
+	if (mIsHeadless)
+		return;
+
 	glfwPollEvents();
 
 	mShouldClose = glfwWindowShouldClose(mGLFWWindow);
@@ -120,6 +136,14 @@ void Window::OnFramebufferResizeProcessed()
 	mWindowProperties.mIsFramebufferResized = false;
 }
 
+void Window::Close()
+{
+	mShouldClose = true;
+
+	if (mGLFWWindow)
+		glfwSetWindowShouldClose(mGLFWWindow, GLFW_TRUE);
+}
+
 std::vector<const char*> Window::GetGlfwRequiredExtensions()
 {
 	std::uint32_t glfwExtensionCount = 0;
@@ -204,6 +228,9 @@ void Window::SetWindowIcon(unsigned char* aSource, int aWidth, int aHeight) cons
 
 float Window::GetContentScaleForMonitor() const
 {
+	if (mIsHeadless)
+		return 1.0f;
+
 	float scaleX = 0.0f;
 	float scaleY = 0.0f;
 	glfwGetMonitorContentScale(glfwGetPrimaryMonitor(), &scaleX, &scaleY);
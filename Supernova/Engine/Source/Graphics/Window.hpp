@@ -28,13 +28,16 @@ public:
 	~Window();
 
 	void InitializeWindow(const std::string& aApplicationName);
+	void InitializeHeadless(); // No window is created, the size is only the resolution of the offscreen images
 	void CreateWindowSurface(VkInstance* aVkInstance, VkSurfaceKHR* aVkSurface);
 	void UpdateWindow();
 
 	void SetWindowSize(int aWidth, int aHeight);
 	void OnFramebufferResizeProcessed();
+	void Close();
 
 	bool ShouldClose() const { return mShouldClose; }
+	bool IsHeadless() const { return mIsHeadless; }
 	const WindowProperties& GetWindowProperties() const { return mWindowProperties; }
 	std::vector<const char*> GetGlfwRequiredExtensions();
 	float GetContentScaleForMonitor() const;
@@ -55,5 +58,6 @@ private:
 	WindowProperties mWindowProperties;
 	std::filesystem::path mIconPath;
 	bool mShouldClose;
+	bool mIsHeadless;
 	GLFWwindow* mGLFWWindow;
 };
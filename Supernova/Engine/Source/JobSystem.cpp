@@ -0,0 +1,321 @@
+#include "JobSystem.hpp"
+
+#include "Core/Types.hpp"
+#include "Profiler/SimpleProfiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	thread_local Core::uint32 gThreadIndex = JobSystem::gInvalidThreadIndex;
+
+	void LogUncountedException(const std::exception_ptr& aException)
+	{
+		try
+		{
+			std::rethrow_exception(aException);
+		}
+		catch (const std::exception& exception)
+		{
+			std::cerr << "Job without a counter threw: " << exception.what() << std::endl;
+		}
+		catch (...)
+		{
+			std::cerr << "Job without a counter threw an unknown exception" << std::endl;
+		}
+	}
+}
+
+JobSystem::JobSystem()
+	: JobSystem{std::max(std::thread::hardware_concurrency(), 2u) - 1}
+{
+}
+
+JobSystem::JobSystem(Core::uint32 aWorkerCount)
+	: mQueuedJobCount{0}
+	, mSleepingWorkerCount{0}
+	, mIsStopping{false}
+{
+	mQueues.resize(aWorkerCount + 1);
+	for (std::unique_ptr<WorkQueue>& queue : mQueues)
+	{
+		queue = std::make_unique<WorkQueue>();
+	}
+
+	SimpleProfiler::RegisterThreads(mQueues.size());
+	SimpleProfiler::SetThreadName("Main");
+
+	gThreadIndex = 0;
+	mWorkers.reserve(aWorkerCount);
+	for (Core::uint32 i = 0; i < aWorkerCount; i++)
+	{
+		mWorkers.emplace_back(&JobSystem::RunWorker, this, i + 1);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	// Workers only stop once the queues are empty, so jobs that are still queued get to run
+	{
+		const std::lock_guard lock(mSleepMutex);
+		mIsStopping = true;
+	}
+
+	mJobAvailable.notify_all();
+	for (std::thread& worker : mWorkers)
+	{
+		worker.join();
+	}
+
+	gThreadIndex = gInvalidThreadIndex;
+}
+
+void JobSystem::Run(Job aJob, JobCounter* aCounter, JobCounter* aDependency)
+{
+	if (aCounter)
+	{
+		aCounter->mPendingCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if (aDependency)
+	{
+		const std::lock_guard lock(aDependency->mMutex);
+		if (!aDependency->IsDone())
+		{
+			aDependency->mDependentJobs.emplace_back([this, job = std::move(aJob), aCounter]() mutable { Schedule(QueuedJob{std::move(job), aCounter}); });
+			return;
+		}
+	}
+
+	Schedule(QueuedJob{std::move(aJob), aCounter});
+}
+
+void JobSystem::RunOnWorker(Job aJob, JobCounter* aCounter)
+{
+	if (aCounter)
+	{
+		aCounter->mPendingCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// Without workers there is nobody else to run it
+	if (mWorkers.empty())
+	{
+		Schedule(QueuedJob{std::move(aJob), aCounter});
+		return;
+	}
+
+	// Thread zero's own queue is never used, a worker that calls this keeps the job in its own queue
+	const Core::uint32 threadIndex = GetThreadIndex();
+	const bool isWorker = (threadIndex != gInvalidThreadIndex) && (threadIndex != 0);
+	Schedule(QueuedJob{std::move(aJob), aCounter, true}, isWorker ? threadIndex : 1);
+}
+
+void JobSystem::Wait(JobCounter& aCounter)
+{
+	const Core::uint32 threadIndex = GetThreadIndex();
+	if (threadIndex != gInvalidThreadIndex)
+	{
+		while (!aCounter.IsDone())
+		{
+			if (!TryRunJob(threadIndex))
+			{
+				// The remaining jobs are running on other threads, or waiting for a dependency
+				std::unique_lock lock(aCounter.mMutex);
+				aCounter.mDone.wait_for(lock, std::chrono::microseconds{100}, [&aCounter]() { return aCounter.IsDone(); });
+			}
+		}
+	}
+
+	// Also makes sure the thread that finished the last job has released the counter, so it can be destroyed after this
+	std::unique_lock lock(aCounter.mMutex);
+	aCounter.mDone.wait(lock, [&aCounter]() { return aCounter.IsDone(); });
+	if (aCounter.mException)
+	{
+		std::rethrow_exception(std::exchange(aCounter.mException, nullptr));
+	}
+}
+
+void JobSystem::ParallelFor(Core::uint32 aCount, const std::function<void(Core::uint32 aIndex)>& aFunction, Core::uint32 aMinBatchSize)
+{
+	if (aCount == 0)
+	{
+		return;
+	}
+
+	// A few batches per thread leave room for stealing when iterations take uneven time
+	const Core::uint32 batchCount = std::clamp(aCount / std::max(aMinBatchSize, 1u), 1u, GetThreadCount() * 4);
+	const Core::uint32 batchSize = (aCount + batchCount - 1) / batchCount;
+
+	JobCounter counter;
+	for (Core::uint32 begin = 0; begin < aCount; begin += batchSize)
+	{
+		const Core::uint32 end = std::min(begin + batchSize, aCount);
+		Run([&aFunction, begin, end]()
+		{
+			for (Core::uint32 i = begin; i < end; i++)
+			{
+				aFunction(i);
+			}
+		}, &counter);
+	}
+
+	Wait(counter);
+}
+
+Core::uint32 JobSystem::GetThreadIndex()
+{
+	return gThreadIndex;
+}
+
+void JobSystem::RunWorker(Core::uint32 aThreadIndex)
+{
+	gThreadIndex = aThreadIndex;
+	SimpleProfiler::SetThreadName(std::format("Worker {}", aThreadIndex));
+
+	while (true)
+	{
+		if (TryRunJob(aThreadIndex))
+		{
+			continue;
+		}
+
+		std::unique_lock lock(mSleepMutex);
+		mSleepingWorkerCount++;
+		mJobAvailable.wait(lock, [this]() { return mIsStopping || (mQueuedJobCount > 0); });
+		mSleepingWorkerCount--;
+
+		if (mIsStopping && (mQueuedJobCount == 0))
+		{
+			return;
+		}
+	}
+}
+
+void JobSystem::Schedule(QueuedJob aJob)
+{
+	const Core::uint32 threadIndex = GetThreadIndex();
+	Schedule(std::move(aJob), (threadIndex == gInvalidThreadIndex) ? 0 : threadIndex);
+}
+
+void JobSystem::Schedule(QueuedJob aJob, Core::uint32 aQueueIndex)
+{
+	WorkQueue& queue = *mQueues[aQueueIndex];
+	{
+		const std::lock_guard lock(queue.mMutex);
+		queue.mJobs.push_back(std::move(aJob));
+	}
+
+	// Workers count themselves as sleeping before they check the queued jobs, so either they see this job or it sees them
+	mQueuedJobCount++;
+	if (mSleepingWorkerCount > 0)
+	{
+		{
+			const std::lock_guard lock(mSleepMutex);
+		}
+
+		mJobAvailable.notify_one();
+	}
+}
+
+bool JobSystem::TryRunJob(Core::uint32 aThreadIndex)
+{
+	QueuedJob job;
+	bool hasJob = false;
+
+	// The most recently pushed job of the own queue is the most likely to still be in cache
+	{
+		WorkQueue& queue = *mQueues[aThreadIndex];
+		const std::lock_guard lock(queue.mMutex);
+		if (!queue.mJobs.empty())
+		{
+			job = std::move(queue.mJobs.back());
+			queue.mJobs.pop_back();
+			hasJob = true;
+		}
+	}
+
+	// Thieves take the oldest jobs, which tend to be the largest part of the work that is left
+	const Core::uint32 threadCount = GetThreadCount();
+	for (Core::uint32 i = 1; !hasJob && (i < threadCount); i++)
+	{
+		WorkQueue& queue = *mQueues[(aThreadIndex + i) % threadCount];
+		const std::lock_guard lock(queue.mMutex);
+		const auto iterator = (aThreadIndex == 0) ? std::find_if(queue.mJobs.begin(), queue.mJobs.end(), [](const QueuedJob& aJob) { return !aJob.mIsWorkerOnly; }) : queue.mJobs.begin();
+		if (iterator != queue.mJobs.end())
+		{
+			job = std::move(*iterator);
+			queue.mJobs.erase(iterator);
+			hasJob = true;
+		}
+	}
+
+	if (!hasJob)
+	{
+		return false;
+	}
+
+	mQueuedJobCount--;
+
+	try
+	{
+		SIMPLE_PROFILER_PROFILE_JOB(aThreadIndex);
+		job.mJob();
+	}
+	catch (...)
+	{
+		// Nothing waits for a job without a counter, so its exception is logged instead of ending the thread that ran it
+		if (!job.mCounter)
+		{
+			LogUncountedException(std::current_exception());
+		}
+		else
+		{
+			const std::lock_guard lock(job.mCounter->mMutex);
+			if (!job.mCounter->mException)
+			{
+				job.mCounter->mException = std::current_exception();
+			}
+		}
+	}
+
+	FinishJob(job.mCounter);
+	return true;
+}
+
+void JobSystem::FinishJob(JobCounter* aCounter)
+{
+	if (!aCounter)
+	{
+		return;
+	}
+
+	// The counter may be destroyed as soon as its lock is released, so the dependent jobs are moved out first
+	std::vector<std::function<void()>> dependentJobs;
+	{
+		const std::lock_guard lock(aCounter->mMutex);
+		if (aCounter->mPendingCount.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		{
+			return;
+		}
+
+		dependentJobs.swap(aCounter->mDependentJobs);
+		aCounter->mDone.notify_all();
+	}
+
+	for (std::function<void()>& scheduleDependentJob : dependentJobs)
+	{
+		scheduleDependentJob();
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Core/Types.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Counts the unfinished jobs it has been passed to, jobs that depend on it are held back until the count reaches zero.
+// A counter can be reused once it is done, it has to outlive the jobs and the waits that use it.
+class JobCounter
+{
+public:
+	JobCounter() : mPendingCount{0} {}
+
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	bool IsDone() const { return mPendingCount.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+
+	std::atomic<Core::uint32> mPendingCount;
+	std::vector<std::function<void()>> mDependentJobs; // Scheduled by the job that brings the count to zero
+	std::exception_ptr mException; // First exception thrown by one of the jobs, rethrown by Wait
+	std::mutex mMutex;
+	std::condition_variable mDone;
+};
+
+// Work-stealing job scheduler, there is one per process.
+// Every thread pushes and pops jobs at the back of its own queue, threads that run out of jobs steal from the front of the others.
+// The thread that creates the job system is thread zero and runs jobs while it waits, the workers start at one.
+// Every job system thread has a stable index below GetThreadCount(), so per-thread resources (like command pools) can be indexed with it.
+class JobSystem
+{
+public:
+	using Job = std::function<void()>;
+
+	static constexpr Core::uint32 gInvalidThreadIndex = std::numeric_limits<Core::uint32>::max();
+
+	JobSystem();
+	explicit JobSystem(Core::uint32 aWorkerCount);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	void Run(Job aJob, JobCounter* aCounter = nullptr, JobCounter* aDependency = nullptr); // The counter includes the job until it has run, the job only starts once the dependency is done. Exceptions of jobs without a counter are logged and dropped
+	void RunOnWorker(Job aJob, JobCounter* aCounter = nullptr); // Like Run, but thread zero never picks the job up, so a long job it starts doesn't end up running inline in one of its waits
+	void Wait(JobCounter& aCounter); // Job system threads run other jobs in the meantime, rethrows the first exception of the counted jobs
+	void ParallelFor(Core::uint32 aCount, const std::function<void(Core::uint32 aIndex)>& aFunction, Core::uint32 aMinBatchSize = 1); // Returns once every iteration has run
+
+	Core::uint32 GetThreadCount() const { return static_cast<Core::uint32>(mQueues.size()); }
+	static Core::uint32 GetThreadIndex(); // gInvalidThreadIndex on threads that aren't part of the job system
+
+private:
+	struct QueuedJob
+	{
+		QueuedJob() : mCounter{nullptr}, mIsWorkerOnly{false} {}
+		QueuedJob(Job aJob, JobCounter* aCounter, bool aIsWorkerOnly = false) : mJob{std::move(aJob)}, mCounter{aCounter}, mIsWorkerOnly{aIsWorkerOnly} {}
+
+		Job mJob;
+		JobCounter* mCounter;
+		bool mIsWorkerOnly; // Skipped by thread zero when it steals
+	};
+
+	struct WorkQueue
+	{
+		std::mutex mMutex; // Taken briefly by the owner and by thieves, jobs are never run while it's held
+		std::deque<QueuedJob> mJobs;
+	};
+
+	void RunWorker(Core::uint32 aThreadIndex);
+	void Schedule(QueuedJob aJob);
+	void Schedule(QueuedJob aJob, Core::uint32 aQueueIndex);
+	bool TryRunJob(Core::uint32 aThreadIndex); // Runs a job of the thread's own queue, or one stolen from another thread
+	void FinishJob(JobCounter* aCounter);
+
+	std::vector<std::unique_ptr<WorkQueue>> mQueues; // One per thread, threads outside of the job system push to the first one
+	std::vector<std::thread> mWorkers;
+	std::atomic<Core::uint32> mQueuedJobCount;
+	std::atomic<Core::uint32> mSleepingWorkerCount;
+	std::mutex mSleepMutex;
+	std::condition_variable mJobAvailable;
+	bool mIsStopping;
+};
@@ -0,0 +1,155 @@
+#include "MappedFile.hpp"
+
+#include "Core/Types.hpp"
+
+#include <filesystem>
+#include <format>
+#include <stdexcept>
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+	: mData{nullptr}
+	, mSize{0}
+	, mFileHandle{nullptr}
+	, mMappingHandle{nullptr}
+{
+}
+
+MappedFile::MappedFile(const std::filesystem::path& aPath)
+	: MappedFile{}
+{
+#if defined(_WIN32)
+	const HANDLE fileHandle = CreateFileW(aPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error(std::format("Could not open file: {}", aPath.generic_string()));
+	}
+
+	mFileHandle = fileHandle;
+
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(fileHandle, &fileSize))
+	{
+		Unmap();
+		throw std::runtime_error(std::format("Could not get the size of file: {}", aPath.generic_string()));
+	}
+
+	mSize = static_cast<Core::size>(fileSize.QuadPart);
+
+	// Empty files can't be mapped, they are represented by an empty view instead
+	if (mSize == 0)
+	{
+		return;
+	}
+
+	mMappingHandle = CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mMappingHandle)
+	{
+		Unmap();
+		throw std::runtime_error(std::format("Could not create a file mapping for: {}", aPath.generic_string()));
+	}
+
+	mData = static_cast<const unsigned char*>(MapViewOfFile(mMappingHandle, FILE_MAP_READ, 0, 0, 0));
+#else
+	const int fileDescriptor = open(aPath.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+	{
+		throw std::runtime_error(std::format("Could not open file: {}", aPath.generic_string()));
+	}
+
+	struct stat fileStatus{};
+	if (fstat(fileDescriptor, &fileStatus) != 0)
+	{
+		close(fileDescriptor);
+		throw std::runtime_error(std::format("Could not get the size of file: {}", aPath.generic_string()));
+	}
+
+	mSize = static_cast<Core::size>(fileStatus.st_size);
+
+	// Empty files can't be mapped, they are represented by an empty view instead
+	if (mSize == 0)
+	{
+		close(fileDescriptor);
+		return;
+	}
+
+	// The mapping stays valid after the descriptor has been closed
+	void* data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	close(fileDescriptor);
+	mData = data != MAP_FAILED ? static_cast<const unsigned char*>(data) : nullptr;
+#endif
+
+	if (!mData)
+	{
+		Unmap();
+		throw std::runtime_error(std::format("Could not map file: {}", aPath.generic_string()));
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	Unmap();
+}
+
+MappedFile::MappedFile(MappedFile&& aOther) noexcept
+	: mData{std::exchange(aOther.mData, nullptr)}
+	, mSize{std::exchange(aOther.mSize, 0)}
+	, mFileHandle{std::exchange(aOther.mFileHandle, nullptr)}
+	, mMappingHandle{std::exchange(aOther.mMappingHandle, nullptr)}
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& aOther) noexcept
+{
+	if (this != &aOther)
+	{
+		Unmap();
+		mData = std::exchange(aOther.mData, nullptr);
+		mSize = std::exchange(aOther.mSize, 0);
+		mFileHandle = std::exchange(aOther.mFileHandle, nullptr);
+		mMappingHandle = std::exchange(aOther.mMappingHandle, nullptr);
+	}
+
+	return *this;
+}
+
+void MappedFile::Unmap()
+{
+#if defined(_WIN32)
+	if (mData)
+	{
+		UnmapViewOfFile(mData);
+	}
+
+	if (mMappingHandle)
+	{
+		CloseHandle(mMappingHandle);
+	}
+
+	if (mFileHandle)
+	{
+		CloseHandle(mFileHandle);
+	}
+#else
+	if (mData)
+	{
+		munmap(const_cast<unsigned char*>(mData), mSize);
+	}
+#endif
+
+	mData = nullptr;
+	mSize = 0;
+	mFileHandle = nullptr;
+	mMappingHandle = nullptr;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Core/Types.hpp"
+
+#include <filesystem>
+#include <span>
+
+// Read-only view of a whole file mapped into the address space, pages are only read from disk once they are touched
+class MappedFile
+{
+public:
+	MappedFile();
+	explicit MappedFile(const std::filesystem::path& aPath);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& aOther) noexcept;
+	MappedFile& operator=(MappedFile&& aOther) noexcept;
+
+	std::span<const unsigned char> GetData() const { return {mData, mSize}; }
+	Core::size GetSize() const { return mSize; }
+	bool IsMapped() const { return mData != nullptr; }
+
+private:
+	void Unmap();
+
+	const unsigned char* mData;
+	Core::size mSize;
+	void* mFileHandle; // Only used on Windows, where the view keeps both the file and the mapping object open
+	void* mMappingHandle;
+};
@@ -6,6 +6,7 @@
 
 #include <glm/geometric.hpp>
 #include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/matrix_decompose.hpp>
 #include <glm/gtx/transform.hpp>
@@ -110,6 +111,16 @@ namespace Math
 		return glm::normalize(aVector);
 	}
 
+	inline float Mix(const float aX, const float aY, const float aFactor)
+	{
+		return glm::mix(aX, aY, aFactor);
+	}
+
+	inline Vector3f Mix(const Vector3f& aX, const Vector3f& aY, const float aFactor)
+	{
+		return glm::mix(aX, aY, aFactor);
+	}
+
 	inline Vector4f Mix(const Vector4f& aX, const Vector4f& aY, const float aFactor)
 	{
 		return glm::mix(aX, aY, aFactor);
@@ -120,6 +131,46 @@ namespace Math
 		return glm::cross(aX, aY);
 	}
 
+	inline float Dot(const Vector3f& aX, const Vector3f& aY)
+	{
+		return glm::dot(aX, aY);
+	}
+
+	inline float Dot(const Vector4f& aX, const Vector4f& aY)
+	{
+		return glm::dot(aX, aY);
+	}
+
+	inline float Length(const Vector3f& aVector)
+	{
+		return glm::length(aVector);
+	}
+
+	inline Vector3f Min(const Vector3f& aX, const Vector3f& aY)
+	{
+		return glm::min(aX, aY);
+	}
+
+	inline Vector3f Max(const Vector3f& aX, const Vector3f& aY)
+	{
+		return glm::max(aX, aY);
+	}
+
+	inline Vector4f Min(const Vector4f& aX, const Vector4f& aY)
+	{
+		return glm::min(aX, aY);
+	}
+
+	inline Vector4f Max(const Vector4f& aX, const Vector4f& aY)
+	{
+		return glm::max(aX, aY);
+	}
+
+	inline Vector3f Abs(const Vector3f& aVector)
+	{
+		return glm::abs(aVector);
+	}
+
 	inline Quaternionf MakeQuaternion(const double* aData)
 	{
 		return glm::make_quat(aData);
@@ -147,6 +198,55 @@ namespace Math
 		return glm::decompose(aMatrix, aScale, aOrientation, aTranslation, skew, perspective);
 	}
 
+	// Octahedral encoding of a unit vector into [-1, 1]^2, the vertex shaders decode it with OctDecode from Shaders/GLSL/Common/Octahedral.glsl
+	inline Vector2f OctEncode(const Vector3f& aVector)
+	{
+		const float length = std::abs(aVector.x) + std::abs(aVector.y) + std::abs(aVector.z);
+		if (length == 0.0f)
+		{
+			return Vector2f{0.0f};
+		}
+
+		const Vector3f projected = aVector / length;
+		if (projected.z >= 0.0f)
+		{
+			return Vector2f{projected.x, projected.y};
+		}
+
+		// The lower hemisphere is folded over the diagonals
+		return Vector2f{(1.0f - std::abs(projected.y)) * (projected.x >= 0.0f ? 1.0f : -1.0f), (1.0f - std::abs(projected.x)) * (projected.y >= 0.0f ? 1.0f : -1.0f)};
+	}
+
+	inline Core::uint32 PackSnorm2x16(const Vector2f& aVector)
+	{
+		return glm::packSnorm2x16(aVector);
+	}
+
+	inline Core::uint32 PackSnorm4x8(const Vector4f& aVector)
+	{
+		return glm::packSnorm4x8(aVector);
+	}
+
+	inline Core::uint32 PackUnorm4x8(const Vector4f& aVector)
+	{
+		return glm::packUnorm4x8(aVector);
+	}
+
+	inline Core::uint32 PackUint4x8(const Vector4f& aVector)
+	{
+		return glm::packUint4x8(glm::u8vec4(aVector));
+	}
+
+	inline Core::uint64 PackUnorm4x16(const Vector4f& aVector)
+	{
+		return glm::packUnorm4x16(aVector);
+	}
+
+	inline Core::uint32 PackHalf2x16(const Vector2f& aVector)
+	{
+		return glm::packHalf2x16(aVector);
+	}
+
 	inline float Sine(const float aAngle)
 	{
 		return std::sin(aAngle);
@@ -1,10 +1,23 @@
 #pragma once
 
+#include "Profiler/SimpleSampler.hpp"
 #include "Timer.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
 #include <span>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace SimpleProfiler
@@ -12,7 +25,10 @@ namespace SimpleProfiler
 	using NodeId = std::size_t;
 
 	inline constexpr NodeId gNullNode = static_cast<NodeId>(-1);
-	inline constexpr NodeId gMaxNodes = 128;
+	inline constexpr NodeId gMaxNodes = 256;
+	inline constexpr std::size_t gMaxThreads = 64;
+	inline constexpr std::size_t gMaxThreadEvents = 4096; // Scopes a thread can finish between two calls to NewFrame, later ones are dropped
+	inline constexpr std::size_t gFrameHistorySize = 256; // Frames the percentiles are taken over
 
 	struct [[nodiscard]] ScopeInfo
 	{
@@ -22,33 +38,106 @@ namespace SimpleProfiler
 
 		int mLine;
 
-		double mTimeUs;
+		double mTimeUs; // Summed over every call on every thread during the last collected frame, negative if the scope didn't run
+		std::uint32_t mCallCount;
 
 		NodeId mNodeId;
 		NodeId mParentNodeId;
 
 		std::size_t mDepth;
 	};
+
+	// Running totals of the jobs a job system thread has run, the ImGui view turns them into per-frame numbers
+	struct ThreadActivity
+	{
+		std::atomic<std::uint64_t> mBusyTimeNs{0u};
+		std::atomic<std::uint64_t> mJobCount{0u};
+	};
 }
 
 #ifdef SIMPLE_PROFILER_ENABLED
 namespace SimpleProfiler::Private
 {
+	[[nodiscard]] inline std::uint64_t GetTimestampNs()
+	{
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	// A finished scope, its parent is the scope that was open on the same thread
+	struct [[nodiscard]] Event
+	{
+		std::uint64_t mBeginNs;
+		std::uint64_t mEndNs;
+		NodeId mNodeId;
+		NodeId mParentNodeId;
+		std::size_t mDepth;
+	};
+
+	// Only its own thread pushes and only NewFrame pops, so the two indices are all the synchronization it needs
+	struct [[nodiscard]] ThreadEventRing
+	{
+		Event mEvents[gMaxThreadEvents]{};
+		std::atomic<std::uint64_t> mWriteIndex = 0u;
+		std::atomic<std::uint64_t> mReadIndex = 0u;
+		std::atomic<std::uint64_t> mDroppedEventCount = 0u;
+
+		std::size_t mThreadIndex = 0u;
+		std::string mThreadName; // Guarded by the database mutex
+
+		inline void Push(const Event& event)
+		{
+			const std::uint64_t writeIndex = mWriteIndex.load(std::memory_order_relaxed);
+			if (writeIndex - mReadIndex.load(std::memory_order_acquire) >= gMaxThreadEvents)
+			{
+				mDroppedEventCount.fetch_add(1u, std::memory_order_relaxed);
+				return;
+			}
+
+			mEvents[writeIndex % gMaxThreadEvents] = event;
+			mWriteIndex.store(writeIndex + 1u, std::memory_order_release);
+		}
+	};
+
+	struct [[nodiscard]] CapturedEvent
+	{
+		Event mEvent;
+		std::size_t mThreadIndex;
+	};
+
 	struct [[nodiscard]] Database
 	{
+		// Taken when a thread or a scope is seen for the first time, and by NewFrame
+		std::mutex mMutex;
+
+		// Every scope in the code is one node, shared by all threads
 		ScopeInfo mNodes[gMaxNodes]{};
+		std::atomic<NodeId> mNodeCount = 0u;
+
+		// Kept after their threads exit, so their last events are still collected
+		std::vector<std::unique_ptr<ThreadEventRing>> mThreadEventRings;
 
-		NodeId mNextNodeId = 0u;
-		NodeId mCurrentNodeId = gNullNode;
+		// Only used by the thread that calls NewFrame
+		std::vector<Sampler> mNodeTimeHistories = std::vector<Sampler>(gMaxNodes, Sampler{gFrameHistorySize});
+		Sampler mFrameTimeHistory{gFrameHistorySize};
+		std::uint64_t mFrameBeginNs = 0u;
+		std::uint64_t mDroppedEventCount = 0u;
+
+		std::vector<CapturedEvent> mCapturedEvents;
+		std::vector<std::pair<std::uint64_t, std::uint64_t>> mCapturedFrames;
+		std::filesystem::path mCapturePath;
+		std::filesystem::path mLastCapturePath;
+		std::uint64_t mCaptureBeginNs = 0u;
+		std::uint64_t mCaptureEndNs = 0u;
+		bool mIsCapturing = false;
 
-		std::size_t mCurrentDepth = 0u;
-		
 		[[nodiscard]] ScopeInfo& InitNode(const std::string_view label,
 			const std::string_view file,
 			const std::string_view func,
 			const int line)
 		{
-			const NodeId id = mNextNodeId++;
+			const std::lock_guard lock(mMutex);
+
+			const NodeId id = mNodeCount.load(std::memory_order_relaxed);
 			assert(id < gMaxNodes);
 
 			mNodes[id] = ScopeInfo{
@@ -57,60 +146,318 @@ namespace SimpleProfiler::Private
 				.mFunction = func,
 				.mLine = line,
 				.mTimeUs = -1,
+				.mCallCount = 0u,
 				.mNodeId = id,
 				.mParentNodeId = gNullNode,
-				.mDepth = mCurrentDepth,
+				.mDepth = 0u,
 			};
 
+			mNodeCount.store(id + 1u, std::memory_order_release);
 			return mNodes[id];
 		}
 	};
 
-	inline thread_local Database gThreadLocalDatabase;
+	inline Database gDatabase;
 
-	struct [[nodiscard]] ScopeGuard
+	inline thread_local ThreadEventRing* gThreadEventRing = nullptr;
+	inline thread_local NodeId gCurrentNodeId = gNullNode;
+	inline thread_local std::size_t gCurrentDepth = 0u;
+
+	inline ThreadActivity gThreadActivities[gMaxThreads]{};
+	inline std::atomic<std::size_t> gThreadCount = 0u;
+
+	[[nodiscard]] inline ThreadEventRing& GetThreadEventRing()
 	{
-		ScopeInfo& scopeInfo;
-		Time::Timer mTimer;
-		NodeId previousNodeId;
-		
-		inline explicit ScopeGuard(ScopeInfo& theScopeInfo) :
-			scopeInfo{theScopeInfo},
-			previousNodeId{Private::gThreadLocalDatabase.mCurrentNodeId}
+		if (!gThreadEventRing)
 		{
-			mTimer.StartTimer();
+			const std::lock_guard lock(gDatabase.mMutex);
 
-			Database& db = Private::gThreadLocalDatabase;
+			gDatabase.mThreadEventRings.push_back(std::make_unique<ThreadEventRing>());
+			gThreadEventRing = gDatabase.mThreadEventRings.back().get();
+			gThreadEventRing->mThreadIndex = gDatabase.mThreadEventRings.size() - 1u;
+			gThreadEventRing->mThreadName = "Thread " + std::to_string(gThreadEventRing->mThreadIndex);
+		}
+
+		return *gThreadEventRing;
+	}
 
-			scopeInfo.mParentNodeId = db.mCurrentNodeId;
-			db.mCurrentNodeId = scopeInfo.mNodeId;
-			db.mCurrentDepth = scopeInfo.mDepth + 1u;
+	struct [[nodiscard]] ScopeGuard
+	{
+		const ScopeInfo& mScopeInfo;
+		NodeId mPreviousNodeId;
+		std::size_t mPreviousDepth;
+		std::uint64_t mBeginNs;
+
+		inline explicit ScopeGuard(const ScopeInfo& theScopeInfo) :
+			mScopeInfo{theScopeInfo},
+			mPreviousNodeId{gCurrentNodeId},
+			mPreviousDepth{gCurrentDepth}
+		{
+			gCurrentNodeId = mScopeInfo.mNodeId;
+			gCurrentDepth = mPreviousDepth + 1u;
+			mBeginNs = GetTimestampNs();
 		}
 
 		inline ~ScopeGuard()
 		{
-			Database& db = Private::gThreadLocalDatabase;
+			const std::uint64_t endNs = GetTimestampNs();
+
+			gCurrentNodeId = mPreviousNodeId;
+			gCurrentDepth = mPreviousDepth;
+
+			GetThreadEventRing().Push(Event{
+				.mBeginNs = mBeginNs,
+				.mEndNs = endNs,
+				.mNodeId = mScopeInfo.mNodeId,
+				.mParentNodeId = mPreviousNodeId,
+				.mDepth = mPreviousDepth,
+			});
+		}
 
+		ScopeGuard(const ScopeGuard&) = delete;
+		ScopeGuard& operator=(const ScopeGuard&) = delete;
+	};
+
+	struct [[nodiscard]] JobScopeGuard
+	{
+		ThreadActivity& mThreadActivity;
+		Time::Timer mTimer;
+
+		inline explicit JobScopeGuard(const std::size_t threadIndex) :
+			mThreadActivity{gThreadActivities[std::min(threadIndex, gMaxThreads - 1u)]}
+		{
+			assert(threadIndex < gMaxThreads);
+			mTimer.StartTimer();
+		}
+
+		inline ~JobScopeGuard()
+		{
 			mTimer.EndTimer();
-			scopeInfo.mTimeUs = mTimer.GetDurationMicroseconds();
-			db.mCurrentNodeId = previousNodeId;
-			db.mCurrentDepth = scopeInfo.mDepth;
+			mThreadActivity.mBusyTimeNs.fetch_add(static_cast<std::uint64_t>(mTimer.GetDurationMicroseconds() * 1000.0), std::memory_order_relaxed);
+			mThreadActivity.mJobCount.fetch_add(1u, std::memory_order_relaxed);
 		}
 	};
+
+	inline void WriteJsonString(std::ostream& stream, const std::string_view string)
+	{
+		stream << '"';
+		for (const char c : string)
+		{
+			if (c == '"' || c == '\\')
+				stream << '\\' << c;
+			else if (static_cast<unsigned char>(c) < 0x20u)
+				stream << ' ';
+			else
+				stream << c;
+		}
+		stream << '"';
+	}
+
+	// Chrome trace event format, which chrome://tracing and ui.perfetto.dev open directly
+	// Times are in microseconds since the start of the capture, frames get a track of their own after the threads
+	[[nodiscard]] inline bool WriteChromeTrace(const Database& db, const std::filesystem::path& path)
+	{
+		std::ofstream file(path);
+		if (!file)
+			return false;
+
+		const std::size_t frameTrackId = db.mThreadEventRings.size();
+		const auto toUs = [&db](const std::uint64_t timeNs) { return static_cast<double>(timeNs - std::min(timeNs, db.mCaptureBeginNs)) / 1000.0; };
+
+		file << std::fixed << std::setprecision(3);
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+		for (const std::unique_ptr<ThreadEventRing>& ring : db.mThreadEventRings)
+		{
+			file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->mThreadIndex << ",\"args\":{\"name\":";
+			WriteJsonString(file, ring->mThreadName);
+			file << "}},\n";
+		}
+
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << frameTrackId << ",\"args\":{\"name\":\"Frames\"}}";
+
+		for (const auto& [frameBeginNs, frameEndNs] : db.mCapturedFrames)
+		{
+			file << ",\n{\"name\":\"Frame\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":" << frameTrackId
+				<< ",\"ts\":" << toUs(frameBeginNs) << ",\"dur\":" << static_cast<double>(frameEndNs - frameBeginNs) / 1000.0 << "}";
+		}
+
+		for (const CapturedEvent& capturedEvent : db.mCapturedEvents)
+		{
+			const ScopeInfo& node = db.mNodes[capturedEvent.mEvent.mNodeId];
+
+			file << ",\n{\"name\":";
+			WriteJsonString(file, node.mLabebl);
+			file << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << capturedEvent.mThreadIndex
+				<< ",\"ts\":" << toUs(capturedEvent.mEvent.mBeginNs) << ",\"dur\":" << static_cast<double>(capturedEvent.mEvent.mEndNs - capturedEvent.mEvent.mBeginNs) / 1000.0
+				<< ",\"args\":{\"file\":";
+			WriteJsonString(file, node.mFile);
+			file << ",\"line\":" << node.mLine << "}}";
+		}
+
+		file << "\n]}\n";
+		return static_cast<bool>(file);
+	}
 }
 #endif
 
 namespace SimpleProfiler
 {
+	// Collects the scopes every thread has finished since the last call, call it once per frame from the thread that shows the results
+	inline void NewFrame()
+	{
+#ifdef SIMPLE_PROFILER_ENABLED
+		Private::Database& db = Private::gDatabase;
+		const std::uint64_t frameEndNs = Private::GetTimestampNs();
+
+		// Scopes never take the mutex once their thread and node are known, so holding it only delays new ones
+		const std::lock_guard lock(db.mMutex);
+		const NodeId nodeCount = db.mNodeCount.load(std::memory_order_relaxed);
+
+		for (NodeId i = 0; i < nodeCount; ++i)
+		{
+			db.mNodes[i].mTimeUs = -1;
+			db.mNodes[i].mCallCount = 0u;
+		}
+
+		for (const std::unique_ptr<Private::ThreadEventRing>& ring : db.mThreadEventRings)
+		{
+			const std::uint64_t readIndex = ring->mReadIndex.load(std::memory_order_relaxed);
+			const std::uint64_t writeIndex = ring->mWriteIndex.load(std::memory_order_acquire);
+
+			for (std::uint64_t i = readIndex; i < writeIndex; ++i)
+			{
+				const Private::Event& event = ring->mEvents[i % gMaxThreadEvents];
+				const double timeUs = static_cast<double>(event.mEndNs - event.mBeginNs) / 1000.0;
+
+				ScopeInfo& node = db.mNodes[event.mNodeId];
+				node.mTimeUs = node.mTimeUs < 0.0 ? timeUs : node.mTimeUs + timeUs;
+				node.mCallCount++;
+				node.mParentNodeId = event.mParentNodeId;
+				node.mDepth = event.mDepth;
+
+				if (db.mIsCapturing)
+					db.mCapturedEvents.push_back(Private::CapturedEvent{event, ring->mThreadIndex});
+			}
+
+			ring->mReadIndex.store(writeIndex, std::memory_order_release);
+			db.mDroppedEventCount += ring->mDroppedEventCount.exchange(0u, std::memory_order_relaxed);
+		}
+
+		// Scopes that don't run every frame only add the frames they ran in to their history
+		for (NodeId i = 0; i < nodeCount; ++i)
+		{
+			if (db.mNodes[i].mTimeUs >= 0.0)
+				db.mNodeTimeHistories[i].Record(static_cast<float>(db.mNodes[i].mTimeUs) / 1000.0f);
+		}
+
+		if (db.mFrameBeginNs != 0u)
+		{
+			db.mFrameTimeHistory.Record(static_cast<float>(frameEndNs - db.mFrameBeginNs) / 1000000.0f);
+
+			if (db.mIsCapturing)
+				db.mCapturedFrames.emplace_back(db.mFrameBeginNs, frameEndNs);
+		}
+
+		db.mFrameBeginNs = frameEndNs;
+
+		if (db.mIsCapturing && frameEndNs >= db.mCaptureEndNs)
+		{
+			if (Private::WriteChromeTrace(db, db.mCapturePath))
+				db.mLastCapturePath = db.mCapturePath;
+
+			db.mCapturedEvents.clear();
+			db.mCapturedFrames.clear();
+			db.mIsCapturing = false;
+		}
+#endif
+	}
+
+	// Records every scope of the next seconds, the frame that completes the capture writes it to the path as Chrome trace JSON
+	inline void StartTraceCapture([[maybe_unused]] const double durationSeconds, [[maybe_unused]] std::filesystem::path path)
+	{
+#ifdef SIMPLE_PROFILER_ENABLED
+		Private::Database& db = Private::gDatabase;
+		const std::lock_guard lock(db.mMutex);
+
+		db.mCapturedEvents.clear();
+		db.mCapturedFrames.clear();
+		db.mCapturePath = std::move(path);
+		db.mCaptureBeginNs = Private::GetTimestampNs();
+		db.mCaptureEndNs = db.mCaptureBeginNs + static_cast<std::uint64_t>(durationSeconds * 1000000000.0);
+		db.mIsCapturing = true;
+#endif
+	}
+
+	[[nodiscard]] inline bool IsCapturingTrace()
+	{
+#ifdef SIMPLE_PROFILER_ENABLED
+		return Private::gDatabase.mIsCapturing;
+#else
+		return false;
+#endif
+	}
+
+	// Empty until a capture has been written
+	[[nodiscard]] inline std::filesystem::path GetLastTracePath()
+	{
+#ifdef SIMPLE_PROFILER_ENABLED
+		return Private::gDatabase.mLastCapturePath;
+#else
+		return {};
+#endif
+	}
+
+	// Names the calling thread in trace captures
+	inline void SetThreadName([[maybe_unused]] const std::string_view name)
+	{
+#ifdef SIMPLE_PROFILER_ENABLED
+		Private::ThreadEventRing& ring = Private::GetThreadEventRing();
+		const std::lock_guard lock(Private::gDatabase.mMutex);
+		ring.mThreadName = name;
+#endif
+	}
+
+	// Scopes of all threads as of the last NewFrame
 	[[nodiscard]] inline std::span<const ScopeInfo> GetScopeInfos()
 	{
 #ifdef SIMPLE_PROFILER_ENABLED
-		return std::span<const ScopeInfo>{Private::gThreadLocalDatabase.mNodes, Private::gThreadLocalDatabase.mNextNodeId};
+		return std::span<const ScopeInfo>{Private::gDatabase.mNodes, Private::gDatabase.mNodeCount.load(std::memory_order_acquire)};
+#else
+		return {};
+#endif
+	}
+
+	// Frame times of every node in milliseconds, indexed by node ID
+	[[nodiscard]] inline std::span<const Sampler> GetScopeHistories()
+	{
+#ifdef SIMPLE_PROFILER_ENABLED
+		return Private::gDatabase.mNodeTimeHistories;
 #else
 		return {};
 #endif
 	}
 
+	// Time between the calls to NewFrame in milliseconds
+	[[nodiscard]] inline const Sampler& GetFrameTimeHistory()
+	{
+#ifdef SIMPLE_PROFILER_ENABLED
+		return Private::gDatabase.mFrameTimeHistory;
+#else
+		static const Sampler emptySampler{1u};
+		return emptySampler;
+#endif
+	}
+
+	[[nodiscard]] inline std::uint64_t GetDroppedEventCount()
+	{
+#ifdef SIMPLE_PROFILER_ENABLED
+		return Private::gDatabase.mDroppedEventCount;
+#else
+		return 0u;
+#endif
+	}
+
 	inline void PopulateNodes([[maybe_unused]] std::span<const ScopeInfo> scopeInfos,
 		[[maybe_unused]] std::vector <std::vector<NodeId>>& childrenMap,
 		[[maybe_unused]] std::vector<NodeId>& rootNodes)
@@ -136,11 +483,21 @@ namespace SimpleProfiler
 #endif
 	}
 
-	inline void ResetNodes()
+	// Called by the job system, the threads are shown in the ImGui view even before they have run a job
+	inline void RegisterThreads([[maybe_unused]] const std::size_t threadCount)
 	{
 #ifdef SIMPLE_PROFILER_ENABLED
-		for (ScopeInfo& node : Private::gThreadLocalDatabase.mNodes)
-			node.mTimeUs = -1;
+		assert(threadCount <= gMaxThreads);
+		Private::gThreadCount = std::min(threadCount, gMaxThreads);
+#endif
+	}
+
+	[[nodiscard]] inline std::span<const ThreadActivity> GetThreadActivities()
+	{
+#ifdef SIMPLE_PROFILER_ENABLED
+		return std::span<const ThreadActivity>{Private::gThreadActivities, Private::gThreadCount.load()};
+#else
+		return {};
 #endif
 	}
 }
@@ -155,8 +512,8 @@ namespace SimpleProfiler
 
 #define SIMPLE_PROFILER_PROFILE_SCOPE(label) \
 \
-static thread_local auto& SIMPLE_PROFILER_PRIVATE_UNIQUE_NAME( \
-    sfProfilerScopeInfo) = ::SimpleProfiler::Private::gThreadLocalDatabase.InitNode((label), __FILE__, __func__, __LINE__); \
+static const auto& SIMPLE_PROFILER_PRIVATE_UNIQUE_NAME( \
+    sfProfilerScopeInfo) = ::SimpleProfiler::Private::gDatabase.InitNode((label), __FILE__, __func__, __LINE__); \
  \
 const ::SimpleProfiler::Private::ScopeGuard SIMPLE_PROFILER_PRIVATE_UNIQUE_NAME(sfProfilerScopeGuard)( \
 SIMPLE_PROFILER_PRIVATE_UNIQUE_NAME(sfProfilerScopeInfo))
@@ -165,3 +522,14 @@ SIMPLE_PROFILER_PRIVATE_UNIQUE_NAME(sfProfilerScopeInfo))
 #define SIMPLE_PROFILER_PROFILE_SCOPE(label) (void)0
 
 #endif
+
+#ifdef SIMPLE_PROFILER_ENABLED
+
+#define SIMPLE_PROFILER_PROFILE_JOB(threadIndex) \
+const ::SimpleProfiler::Private::JobScopeGuard SIMPLE_PROFILER_PRIVATE_UNIQUE_NAME(sfProfilerJobGuard)(threadIndex)
+
+#else
+
+#define SIMPLE_PROFILER_PROFILE_JOB(threadIndex) (void)0
+
+#endif
@@ -0,0 +1,274 @@
+#pragma once
+
+#include "Profiler/SimpleProfiler.hpp"
+
+#include <vulkan/vulkan_core.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string_view>
+
+namespace SimpleProfiler
+{
+	inline constexpr std::size_t gMaxGpuScopesPerFrame = 256;
+	inline constexpr std::size_t gMaxGpuFrames = 4;
+}
+
+#ifdef SIMPLE_PROFILER_ENABLED
+namespace SimpleProfiler::Private
+{
+	// One execution of a GPU scope, its begin and end timestamps are the queries at twice its index and the one after
+	struct [[nodiscard]] GpuScopeRecord
+	{
+		NodeId mNodeId;
+		NodeId mParentNodeId;
+		std::size_t mDepth;
+	};
+
+	// Queries of one frame in flight, they are read back once the frame's fences have signaled
+	struct [[nodiscard]] GpuFrame
+	{
+		VkQueryPool mQueryPool = VK_NULL_HANDLE;
+		GpuScopeRecord mRecords[gMaxGpuScopesPerFrame]{};
+		std::atomic<std::size_t> mRecordCount = 0u; // Command buffers of a frame may be recorded on several threads
+	};
+
+	struct [[nodiscard]] GpuDatabase
+	{
+		// Every GPU scope in the code is one node, shared by all threads and frames
+		ScopeInfo mNodes[gMaxNodes]{};
+		std::atomic<NodeId> mNodeCount = 0u;
+		std::mutex mNodeMutex;
+
+		GpuFrame mFrames[gMaxGpuFrames]{};
+		std::size_t mFrameCount = 0u;
+		std::size_t mCurrentFrame = 0u;
+
+		VkDevice mDevice = VK_NULL_HANDLE;
+		double mTimestampPeriodNs = 1.0;
+		std::uint64_t mTimestampMask = 0u;
+
+		[[nodiscard]] ScopeInfo& InitNode(const std::string_view label,
+			const std::string_view file,
+			const std::string_view func,
+			const int line)
+		{
+			const std::lock_guard lock(mNodeMutex);
+
+			const NodeId id = mNodeCount.load(std::memory_order_relaxed);
+			assert(id < gMaxNodes);
+
+			mNodes[id] = ScopeInfo{
+				.mLabebl = label,
+				.mFile = file,
+				.mFunction = func,
+				.mLine = line,
+				.mTimeUs = -1,
+				.mCallCount = 0u,
+				.mNodeId = id,
+				.mParentNodeId = gNullNode,
+				.mDepth = 0u,
+			};
+
+			mNodeCount.store(id + 1u, std::memory_order_release);
+			return mNodes[id];
+		}
+	};
+
+	inline GpuDatabase gGpuDatabase;
+
+	// GPU scopes nest within the command buffer a thread is recording
+	inline thread_local NodeId gCurrentGpuNodeId = gNullNode;
+	inline thread_local std::size_t gCurrentGpuDepth = 0u;
+
+	struct [[nodiscard]] GpuScopeGuard
+	{
+		VkCommandBuffer mCommandBuffer;
+		VkQueryPool mQueryPool;
+		std::uint32_t mEndQuery;
+		NodeId mPreviousNodeId;
+		std::size_t mPreviousDepth;
+
+		inline GpuScopeGuard(VkCommandBuffer commandBuffer, const ScopeInfo& scopeInfo) :
+			mCommandBuffer{commandBuffer},
+			mQueryPool{VK_NULL_HANDLE},
+			mEndQuery{0u},
+			mPreviousNodeId{gCurrentGpuNodeId},
+			mPreviousDepth{gCurrentGpuDepth}
+		{
+			GpuDatabase& db = gGpuDatabase;
+			if (db.mDevice == VK_NULL_HANDLE)
+				return;
+
+			GpuFrame& frame = db.mFrames[db.mCurrentFrame];
+			const std::size_t recordIndex = frame.mRecordCount.fetch_add(1u, std::memory_order_relaxed);
+			if (recordIndex >= gMaxGpuScopesPerFrame)
+				return;
+
+			frame.mRecords[recordIndex] = GpuScopeRecord{
+				.mNodeId = scopeInfo.mNodeId,
+				.mParentNodeId = gCurrentGpuNodeId,
+				.mDepth = gCurrentGpuDepth,
+			};
+
+			gCurrentGpuNodeId = scopeInfo.mNodeId;
+			gCurrentGpuDepth++;
+
+			// Both timestamps wait for the commands before them, so consecutive scopes don't overlap
+			mQueryPool = frame.mQueryPool;
+			mEndQuery = static_cast<std::uint32_t>(recordIndex * 2u + 1u);
+			vkCmdWriteTimestamp2(mCommandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, mQueryPool, mEndQuery - 1u);
+		}
+
+		inline ~GpuScopeGuard()
+		{
+			if (mQueryPool == VK_NULL_HANDLE)
+				return;
+
+			vkCmdWriteTimestamp2(mCommandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, mQueryPool, mEndQuery);
+			gCurrentGpuNodeId = mPreviousNodeId;
+			gCurrentGpuDepth = mPreviousDepth;
+		}
+
+		GpuScopeGuard(const GpuScopeGuard&) = delete;
+		GpuScopeGuard& operator=(const GpuScopeGuard&) = delete;
+	};
+}
+#endif
+
+namespace SimpleProfiler
+{
+	// Needs the synchronization2 and hostQueryReset features, GPU scopes are ignored when the queues have no timestamp support
+	inline void InitializeGpu([[maybe_unused]] VkDevice device,
+		[[maybe_unused]] const VkPhysicalDeviceLimits& limits,
+		[[maybe_unused]] const std::uint32_t timestampValidBits,
+		[[maybe_unused]] const std::size_t frameCount)
+	{
+#ifdef SIMPLE_PROFILER_ENABLED
+		Private::GpuDatabase& db = Private::gGpuDatabase;
+		assert(frameCount <= gMaxGpuFrames);
+
+		if (timestampValidBits == 0u)
+			return;
+
+		const VkQueryPoolCreateInfo queryPoolCreateInfo{
+			.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+			.queryType = VK_QUERY_TYPE_TIMESTAMP,
+			.queryCount = static_cast<std::uint32_t>(gMaxGpuScopesPerFrame * 2u)
+		};
+
+		db.mFrameCount = std::min(frameCount, gMaxGpuFrames);
+		for (std::size_t i = 0; i < db.mFrameCount; ++i)
+		{
+			if (vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr, &db.mFrames[i].mQueryPool) != VK_SUCCESS)
+				return;
+
+			vkResetQueryPool(device, db.mFrames[i].mQueryPool, 0u, queryPoolCreateInfo.queryCount);
+			db.mFrames[i].mRecordCount = 0u;
+		}
+
+		db.mDevice = device;
+		db.mTimestampPeriodNs = static_cast<double>(limits.timestampPeriod);
+		db.mTimestampMask = timestampValidBits >= 64u ? ~0ull : ((1ull << timestampValidBits) - 1u);
+		db.mCurrentFrame = 0u;
+#endif
+	}
+
+	inline void DestroyGpu([[maybe_unused]] VkDevice device)
+	{
+#ifdef SIMPLE_PROFILER_ENABLED
+		Private::GpuDatabase& db = Private::gGpuDatabase;
+
+		for (Private::GpuFrame& frame : db.mFrames)
+		{
+			if (frame.mQueryPool != VK_NULL_HANDLE)
+				vkDestroyQueryPool(device, frame.mQueryPool, nullptr);
+
+			frame.mQueryPool = VK_NULL_HANDLE;
+		}
+
+		db.mDevice = VK_NULL_HANDLE;
+#endif
+	}
+
+	// Call once the command buffers the frame was last recorded into have completed, and before it's recorded again
+	// Reads back the times of its previous use and makes its queries available to the GPU scopes of the new one
+	inline void BeginGpuFrame([[maybe_unused]] const std::size_t frameIndex)
+	{
+#ifdef SIMPLE_PROFILER_ENABLED
+		Private::GpuDatabase& db = Private::gGpuDatabase;
+		if (db.mDevice == VK_NULL_HANDLE)
+			return;
+
+		Private::GpuFrame& frame = db.mFrames[frameIndex];
+		const std::size_t recordCount = std::min(frame.mRecordCount.load(std::memory_order_relaxed), gMaxGpuScopesPerFrame);
+
+		for (ScopeInfo& node : db.mNodes)
+		{
+			node.mTimeUs = -1;
+			node.mCallCount = 0u;
+		}
+
+		// Value and availability of every query, scopes of command buffers that were never submitted stay unavailable
+		std::array<std::uint64_t, gMaxGpuScopesPerFrame * 4u> results{};
+		if (recordCount > 0u)
+		{
+			vkGetQueryPoolResults(db.mDevice, frame.mQueryPool, 0u, static_cast<std::uint32_t>(recordCount * 2u), sizeof(results), results.data(),
+				sizeof(std::uint64_t) * 2u, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		}
+
+		// A scope that runs several times per frame adds up, like the draw lists recorded by both occlusion culling passes
+		for (std::size_t i = 0; i < recordCount; ++i)
+		{
+			const std::uint64_t* begin = &results[i * 4u];
+			const std::uint64_t* end = &results[i * 4u + 2u];
+			if (begin[1] == 0u || end[1] == 0u)
+				continue;
+
+			const Private::GpuScopeRecord& record = frame.mRecords[i];
+			ScopeInfo& node = db.mNodes[record.mNodeId];
+			const double timeUs = static_cast<double>((end[0] - begin[0]) & db.mTimestampMask) * db.mTimestampPeriodNs / 1000.0;
+
+			node.mTimeUs = node.mTimeUs < 0.0 ? timeUs : node.mTimeUs + timeUs;
+			node.mCallCount++;
+			node.mParentNodeId = record.mParentNodeId;
+			node.mDepth = record.mDepth;
+		}
+
+		vkResetQueryPool(db.mDevice, frame.mQueryPool, 0u, static_cast<std::uint32_t>(gMaxGpuScopesPerFrame * 2u));
+		frame.mRecordCount.store(0u, std::memory_order_relaxed);
+		db.mCurrentFrame = frameIndex;
+#endif
+	}
+
+	// Times of the frame last passed to BeginGpuFrame, scopes it didn't run have a negative time
+	[[nodiscard]] inline std::span<const ScopeInfo> GetGpuScopeInfos()
+	{
+#ifdef SIMPLE_PROFILER_ENABLED
+		return std::span<const ScopeInfo>{Private::gGpuDatabase.mNodes, Private::gGpuDatabase.mNodeCount.load(std::memory_order_acquire)};
+#else
+		return {};
+#endif
+	}
+}
+
+#ifdef SIMPLE_PROFILER_ENABLED
+
+#define SIMPLE_PROFILER_GPU_SCOPE(commandBuffer, label) \
+\
+static const auto& SIMPLE_PROFILER_PRIVATE_UNIQUE_NAME( \
+    sfProfilerGpuScopeInfo) = ::SimpleProfiler::Private::gGpuDatabase.InitNode((label), __FILE__, __func__, __LINE__); \
+ \
+const ::SimpleProfiler::Private::GpuScopeGuard SIMPLE_PROFILER_PRIVATE_UNIQUE_NAME(sfProfilerGpuScopeGuard)( \
+(commandBuffer), SIMPLE_PROFILER_PRIVATE_UNIQUE_NAME(sfProfilerGpuScopeInfo))
+
+#else
+
+#define SIMPLE_PROFILER_GPU_SCOPE(commandBuffer, label) (void)0
+
+#endif
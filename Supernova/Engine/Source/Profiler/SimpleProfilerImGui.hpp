@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Profiler/SimpleProfiler.hpp"
+#include "Profiler/SimpleProfilerGpu.hpp"
 #include "Profiler/SimpleSampler.hpp"
 
 #define IMGUI_DEFINE_MATH_OPERATORS
@@ -8,12 +9,19 @@
 #include <vector>
 #include <span>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
 
 namespace SimpleProfiler::Private
 {
 	using ChildrenMap = std::vector<std::vector<SimpleProfiler::NodeId>>;
 	using SamplerVec = std::vector<Sampler>;
-	
+	using Percentiles = std::array<double, 3>; // p50, p95 and p99 in ms
+
+	inline constexpr std::array<double, 3> gPercentileRanks{50.0, 95.0, 99.0};
+
 	[[nodiscard]] inline double CalcPercentage(const double aPart, const double aTotal)
 	{
 		return aTotal == 0 ? 0.0 : (aPart * 100.0) / aTotal;
@@ -24,8 +32,23 @@ namespace SimpleProfiler::Private
 		return aScopeInfo.mParentNodeId == SimpleProfiler::gNullNode ? 0.0 : CalcPercentage(aScopeInfo.mTimeUs, aScopeInfos[aScopeInfo.mParentNodeId].mTimeUs);
 	}
 
-	[[nodiscard]] inline int CalcDelta(const SamplerVec& aTimeSamplers,
+	// Sorting compares nodes many times per frame, so the percentiles are taken once per frame
+	inline void UpdatePercentiles(const std::span<const Sampler> aTimeSamplers, const std::size_t aNodeCount, std::vector<Percentiles>& aPercentiles)
+	{
+		aPercentiles.resize(aNodeCount);
+
+		for (std::size_t i = 0; i < aNodeCount; ++i)
+			aTimeSamplers[i].GetPercentiles(gPercentileRanks, aPercentiles[i]);
+	}
+
+	[[nodiscard]] inline int CompareValues(const double aValueA, const double aValueB)
+	{
+		return (aValueA > aValueB) ? 1 : (aValueA < aValueB) ? -1 : 0;
+	}
+
+	[[nodiscard]] inline int CalcDelta(const std::span<const Sampler> aTimeSamplers,
 		const SamplerVec& aPercentSamplers,
+		const std::span<const Percentiles> aPercentiles,
 		const SimpleProfiler::ScopeInfo& aInfoA,
 		const SimpleProfiler::ScopeInfo& aInfoB,
 		const unsigned int aColumnUserID)
@@ -34,20 +57,10 @@ namespace SimpleProfiler::Private
 			return aInfoA.mLabebl.compare(aInfoB.mLabebl);
 
 		if (aColumnUserID == 1u) // Sort by time
-		{
-			const double timeA = aTimeSamplers[aInfoA.mNodeId].GetAverage();
-			const double timeB = aTimeSamplers[aInfoB.mNodeId].GetAverage();
-
-			return (timeA > timeB) ? 1 : (timeA < timeB) ? -1 : 0;
-		}
+			return CompareValues(aTimeSamplers[aInfoA.mNodeId].GetAverage(), aTimeSamplers[aInfoB.mNodeId].GetAverage());
 
 		if (aColumnUserID == 2u) // Sort by percent
-		{
-			const double percentA = aPercentSamplers[aInfoA.mNodeId].GetAverage();
-			const double percentB = aPercentSamplers[aInfoB.mNodeId].GetAverage();
-
-			return (percentA > percentB) ? 1 : (percentA < percentB) ? -1 : 0;
-		}
+			return CompareValues(aPercentSamplers[aInfoA.mNodeId].GetAverage(), aPercentSamplers[aInfoB.mNodeId].GetAverage());
 
 		if (aColumnUserID == 3u) // Sort by location
 		{
@@ -56,11 +69,21 @@ namespace SimpleProfiler::Private
 			return delta == 0 ? aInfoA.mLine - aInfoB.mLine : delta;
 		}
 
+		if (aColumnUserID >= 4u && aColumnUserID <= 6u) // Sort by p50, p95 or p99
+		{
+			const std::size_t percentileIndex = aColumnUserID - 4u;
+			return CompareValues(aPercentiles[aInfoA.mNodeId][percentileIndex], aPercentiles[aInfoB.mNodeId][percentileIndex]);
+		}
+
+		if (aColumnUserID == 7u) // Sort by calls
+			return CompareValues(aInfoA.mCallCount, aInfoB.mCallCount);
+
 		return 0;
 	}
 
-	inline void RenderNode(const SamplerVec& timeSamplers,
+	inline void RenderNode(const std::span<const Sampler> timeSamplers,
 		const SamplerVec& percentSamplers,
+		const std::span<const Percentiles> percentiles,
 		SimpleProfiler::NodeId nodeId,
 		const std::span<const SimpleProfiler::ScopeInfo>& allNodes,
 		const ChildrenMap& childrenMap)
@@ -80,7 +103,7 @@ namespace SimpleProfiler::Private
 		}
 
 		constexpr const char spaces[33] = "                                ";
-		const char* spacesPtr = spaces + sizeof(spaces) - 1u - (info.mDepth * 2); // points to the null terminator
+		const char* spacesPtr = spaces + sizeof(spaces) - 1u - std::min<std::size_t>(info.mDepth * 2, sizeof(spaces) - 1u); // points to the null terminator
 
 		// We use the node's ID as a unique identifier for ImGui
 		const bool isNodeOpen = ImGui::TreeNodeEx(reinterpret_cast<void*>(nodeId), nodeFlags, "%s", info.mLabebl.data());
@@ -88,7 +111,16 @@ namespace SimpleProfiler::Private
 		ImGui::TableSetColumnIndex(1);
 		ImGui::Text("%s%.3f", spacesPtr, static_cast<double>(timeSamplers[nodeId].GetAverage())); // Already in ms
 
-		ImGui::TableSetColumnIndex(2);
+		for (std::size_t i = 0; i < gPercentileRanks.size(); ++i)
+		{
+			ImGui::TableSetColumnIndex(static_cast<int>(2u + i));
+			ImGui::Text("%s%.3f", spacesPtr, percentiles[nodeId][i]);
+		}
+
+		ImGui::TableSetColumnIndex(5);
+		ImGui::Text("%s%u", spacesPtr, info.mCallCount);
+
+		ImGui::TableSetColumnIndex(6);
 		if (info.mParentNodeId != SimpleProfiler::gNullNode)
 		{
 
@@ -100,22 +132,158 @@ namespace SimpleProfiler::Private
 		else
 			ImGui::Text(" "); // Root nodes have no parent
 
-		ImGui::TableSetColumnIndex(3);
+		ImGui::TableSetColumnIndex(7);
 
 		ImGui::PushStyleColor(ImGuiCol_Text, ImGui::GetStyle().Colors[ImGuiCol_TextDisabled]);
-		ImGui::Text("%s:%d", info.mFile.substr(info.mFile.rfind('/') + 1u).data(), info.mLine);
+		ImGui::Text("%s:%d", info.mFile.substr(info.mFile.find_last_of("/\\") + 1u).data(), info.mLine);
 		ImGui::PopStyleColor();
 
 		// Recurse into children if the node is open and has children
 		if (isNodeOpen && !children.empty())
 		{
 			for (const SimpleProfiler::NodeId childId : children)
-				RenderNode(timeSamplers, percentSamplers, childId, allNodes, childrenMap);
+				RenderNode(timeSamplers, percentSamplers, percentiles, childId, allNodes, childrenMap);
 
 			ImGui::TreePop(); // This is only needed if the node was not a leaf
 		}
 	}
 
+	inline void SortNodes(const ImGuiTableSortSpecs* aSpecs,
+		const std::span<const Sampler> aTimeSamplers,
+		const SamplerVec& aPercentSamplers,
+		const std::span<const Percentiles> aPercentiles,
+		const std::span<const SimpleProfiler::ScopeInfo>& aScopeInfos,
+		ChildrenMap& aChildrenMap,
+		std::vector<SimpleProfiler::NodeId>& aRootNodes)
+	{
+		const auto nodeComparer = [&](const SimpleProfiler::NodeId a, const SimpleProfiler::NodeId b) -> bool
+			{
+				const auto& infoA = aScopeInfos[a];
+				const auto& infoB = aScopeInfos[b];
+
+				for (int i = 0; i < aSpecs->SpecsCount; ++i)
+				{
+					const ImGuiTableColumnSortSpecs* sortSpec = &aSpecs->Specs[i];
+					const int delta = CalcDelta(aTimeSamplers, aPercentSamplers, aPercentiles, infoA, infoB, sortSpec->ColumnUserID);
+
+					if (delta == 0)
+						continue;
+
+					return (sortSpec->SortDirection == ImGuiSortDirection_Ascending) ? (delta < 0) : (delta > 0);
+				}
+
+				return false;
+			};
+
+		for (auto& vec : aChildrenMap)
+			std::sort(vec.begin(), vec.end(), nodeComparer);
+
+		std::sort(aRootNodes.begin(), aRootNodes.end(), nodeComparer);
+	}
+
+	// GPU scopes are shown below the CPU ones, under a row with the time of all top-level GPU scopes
+	inline void RenderGpuNodes(const ImGuiTableSortSpecs* aSpecs)
+	{
+		const std::span<const SimpleProfiler::ScopeInfo> gpuScopeInfos = SimpleProfiler::GetGpuScopeInfos();
+
+		if (gpuScopeInfos.empty())
+			return;
+
+		static ChildrenMap childrenMap(SimpleProfiler::gMaxNodes);
+		static std::vector<SimpleProfiler::NodeId> rootNodes;
+		static SamplerVec nodeTimeSamplers(SimpleProfiler::gMaxNodes, Sampler{SimpleProfiler::gFrameHistorySize});
+		static SamplerVec nodePercentSamplers(SimpleProfiler::gMaxNodes, Sampler{64u});
+		static std::vector<Percentiles> nodePercentiles;
+		static Sampler gpuTimeSampler{SimpleProfiler::gFrameHistorySize};
+
+		SimpleProfiler::PopulateNodes(gpuScopeInfos, childrenMap, rootNodes);
+
+		double gpuTimeUs = 0.0;
+		for (SimpleProfiler::NodeId i = 0; i < static_cast<SimpleProfiler::NodeId>(gpuScopeInfos.size()); ++i)
+		{
+			if (gpuScopeInfos[i].mTimeUs < 0.0)
+				continue;
+
+			nodeTimeSamplers[i].Record(static_cast<float>(gpuScopeInfos[i].mTimeUs) / 1000.0f);
+			nodePercentSamplers[i].Record(static_cast<float>(CalcNodePercentage(gpuScopeInfos, gpuScopeInfos[i])));
+		}
+
+		for (const SimpleProfiler::NodeId rootId : rootNodes)
+			gpuTimeUs += gpuScopeInfos[rootId].mTimeUs;
+
+		gpuTimeSampler.Record(static_cast<float>(gpuTimeUs) / 1000.0f);
+
+		UpdatePercentiles(nodeTimeSamplers, gpuScopeInfos.size(), nodePercentiles);
+
+		if (aSpecs)
+			SortNodes(aSpecs, nodeTimeSamplers, nodePercentSamplers, nodePercentiles, gpuScopeInfos, childrenMap, rootNodes);
+
+		Percentiles gpuTimePercentiles{};
+		gpuTimeSampler.GetPercentiles(gPercentileRanks, gpuTimePercentiles);
+
+		ImGui::TableNextRow();
+
+		ImGui::TableSetColumnIndex(0);
+		const bool isGpuOpen = ImGui::TreeNodeEx("GPU", ImGuiTreeNodeFlags_SpanAvailWidth | ImGuiTreeNodeFlags_DefaultOpen);
+
+		ImGui::TableSetColumnIndex(1);
+		ImGui::Text("%.3f", static_cast<double>(gpuTimeSampler.GetAverage()));
+
+		for (std::size_t i = 0; i < gPercentileRanks.size(); ++i)
+		{
+			ImGui::TableSetColumnIndex(static_cast<int>(2u + i));
+			ImGui::Text("%.3f", gpuTimePercentiles[i]);
+		}
+
+		for (int column = 5; column < 8; ++column)
+		{
+			ImGui::TableSetColumnIndex(column);
+			ImGui::Text(" ");
+		}
+
+		if (!isGpuOpen)
+			return;
+
+		// The node IDs of the GPU scopes restart at zero, so they get their own ID scope
+		ImGui::PushID("GpuScopes");
+
+		for (const auto rootId : rootNodes)
+			RenderNode(nodeTimeSamplers, nodePercentSamplers, nodePercentiles, rootId, gpuScopeInfos, childrenMap);
+
+		ImGui::PopID();
+		ImGui::TreePop();
+	}
+
+	// Frame time distribution and the trace capture controls, above the scope table
+	inline void RenderFrameSummary()
+	{
+		const Sampler& frameTimeHistory = SimpleProfiler::GetFrameTimeHistory();
+
+		Percentiles frameTimePercentiles{};
+		frameTimeHistory.GetPercentiles(gPercentileRanks, frameTimePercentiles);
+
+		ImGui::Text("Frame (ms): avg %.3f  p50 %.3f  p95 %.3f  p99 %.3f  over %zu frames",
+			frameTimeHistory.GetAverage(), frameTimePercentiles[0], frameTimePercentiles[1], frameTimePercentiles[2], frameTimeHistory.Size());
+
+		if (const std::uint64_t droppedEventCount = SimpleProfiler::GetDroppedEventCount(); droppedEventCount > 0u)
+			ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.2f, 1.0f), "%llu scopes dropped, a thread finished more than %zu in a frame",
+				static_cast<unsigned long long>(droppedEventCount), SimpleProfiler::gMaxThreadEvents);
+
+		if (SimpleProfiler::IsCapturingTrace())
+		{
+			ImGui::BeginDisabled();
+			ImGui::Button("Capturing trace...");
+			ImGui::EndDisabled();
+		}
+		else if (ImGui::Button("Capture 10 s trace"))
+			SimpleProfiler::StartTraceCapture(10.0, "SimpleProfilerTrace.json");
+
+		if (const std::filesystem::path lastTracePath = SimpleProfiler::GetLastTracePath(); !lastTracePath.empty())
+		{
+			ImGui::SameLine();
+			ImGui::TextDisabled("Last trace: %s", lastTracePath.string().c_str());
+		}
+	}
 }
 
 namespace SimpleProfiler
@@ -126,65 +294,120 @@ namespace SimpleProfiler
 
 		if (scopeInfos.empty())
 		{
-			ImGui::Text("No profiling data captured for this thread.");
+			ImGui::Text("No profiling data captured.");
 			return;
 		}
 
-		static thread_local Private::ChildrenMap childrenMap(SimpleProfiler::gMaxNodes);
-		static thread_local std::vector<SimpleProfiler::NodeId> rootNodes;
-		static thread_local Private::SamplerVec nodeTimeSamplers(SimpleProfiler::gMaxNodes, Sampler{64u});
-		static thread_local Private::SamplerVec nodePercentSamplers(SimpleProfiler::gMaxNodes, Sampler{64u});
+		Private::RenderFrameSummary();
+
+		static Private::ChildrenMap childrenMap(SimpleProfiler::gMaxNodes);
+		static std::vector<SimpleProfiler::NodeId> rootNodes;
+		static Private::SamplerVec nodePercentSamplers(SimpleProfiler::gMaxNodes, Sampler{64u});
+		static std::vector<Private::Percentiles> nodePercentiles;
+
+		// The time histories are kept by NewFrame, only the share of the parent is sampled here
+		const std::span<const Sampler> nodeTimeSamplers = SimpleProfiler::GetScopeHistories();
 
 		SimpleProfiler::PopulateNodes(scopeInfos, childrenMap, rootNodes); // Clears as the first step
 
 		for (SimpleProfiler::NodeId i = 0; i < static_cast<SimpleProfiler::NodeId>(scopeInfos.size()); ++i)
 		{
-			nodeTimeSamplers[i].Record(static_cast<float>(scopeInfos[i].mTimeUs) / 1000.0f);
-			nodePercentSamplers[i].Record(static_cast<float>(Private::CalcNodePercentage(scopeInfos, scopeInfos[i])));
+			if (scopeInfos[i].mTimeUs >= 0.0)
+				nodePercentSamplers[i].Record(static_cast<float>(Private::CalcNodePercentage(scopeInfos, scopeInfos[i])));
 		}
 
+		Private::UpdatePercentiles(nodeTimeSamplers, scopeInfos.size(), nodePercentiles);
+
 		if (!ImGui::BeginTable("ProfilerTreeView",
-			4,
+			8,
 			ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable |
 			ImGuiTableFlags_Sortable))
 			return;
 
 		ImGui::TableSetupColumn("Scope", ImGuiTableColumnFlags_WidthStretch | ImGuiTableColumnFlags_DefaultSort, 180.0f, 0);
 		ImGui::TableSetupColumn("Time (ms)", ImGuiTableColumnFlags_WidthStretch, 60.0f, 1);
+		ImGui::TableSetupColumn("p50", ImGuiTableColumnFlags_WidthStretch, 50.0f, 4);
+		ImGui::TableSetupColumn("p95", ImGuiTableColumnFlags_WidthStretch, 50.0f, 5);
+		ImGui::TableSetupColumn("p99", ImGuiTableColumnFlags_WidthStretch, 50.0f, 6);
+		ImGui::TableSetupColumn("Calls", ImGuiTableColumnFlags_WidthStretch, 40.0f, 7);
 		ImGui::TableSetupColumn("% of Parent", ImGuiTableColumnFlags_WidthStretch, 60.0f, 2);
 		ImGui::TableSetupColumn("Location", ImGuiTableColumnFlags_WidthStretch, 120.0f, 3);
 
 		ImGui::TableHeadersRow();
 
-		if (ImGuiTableSortSpecs* specs = ImGui::TableGetSortSpecs())
-		{
-			const auto nodeComparer = [&](const SimpleProfiler::NodeId a, const SimpleProfiler::NodeId b) -> bool
-				{
-					const auto& infoA = scopeInfos[a];
-					const auto& infoB = scopeInfos[b];
+		const ImGuiTableSortSpecs* specs = ImGui::TableGetSortSpecs();
+		if (specs)
+			Private::SortNodes(specs, nodeTimeSamplers, nodePercentSamplers, nodePercentiles, scopeInfos, childrenMap, rootNodes);
 
-					for (int i = 0; i < specs->SpecsCount; ++i)
-					{
-						const ImGuiTableColumnSortSpecs* sortSpec = &specs->Specs[i];
-						const int delta = Private::CalcDelta(nodeTimeSamplers, nodePercentSamplers, infoA, infoB, sortSpec->ColumnUserID);
+		for (const auto rootId : rootNodes)
+			Private::RenderNode(nodeTimeSamplers, nodePercentSamplers, nodePercentiles, rootId, scopeInfos, childrenMap);
 
-						if (delta == 0)
-							continue;
+		Private::RenderGpuNodes(specs);
 
-						return (sortSpec->SortDirection == ImGuiSortDirection_Ascending) ? (delta < 0) : (delta > 0);
-					}
+		ImGui::EndTable();
+	}
 
-					return false;
-				};
+	// Time each job system thread has spent running jobs, averaged over the last frames the view was shown
+	inline void ShowImguiThreadActivity()
+	{
+		const std::span<const ThreadActivity> threadActivities = SimpleProfiler::GetThreadActivities();
+
+		if (threadActivities.empty())
+		{
+			ImGui::Text("No job system threads registered.");
+			return;
+		}
 
-			for (auto& vec : childrenMap)
-				std::sort(vec.begin(), vec.end(), nodeComparer);
+		static std::vector<std::uint64_t> lastBusyTimesNs;
+		static std::vector<std::uint64_t> lastJobCounts;
+		static Private::SamplerVec busyTimeSamplers;
+		static Private::SamplerVec jobCountSamplers;
 
-			std::sort(rootNodes.begin(), rootNodes.end(), nodeComparer);
+		if (lastBusyTimesNs.size() != threadActivities.size())
+		{
+			lastBusyTimesNs.assign(threadActivities.size(), 0u);
+			lastJobCounts.assign(threadActivities.size(), 0u);
+			busyTimeSamplers = Private::SamplerVec(threadActivities.size(), Sampler{64u});
+			jobCountSamplers = Private::SamplerVec(threadActivities.size(), Sampler{64u});
 		}
 
-		for (const auto rootId : rootNodes)
-			Private::RenderNode(nodeTimeSamplers, nodePercentSamplers, rootId, scopeInfos, childrenMap);
+		for (std::size_t i = 0; i < threadActivities.size(); ++i)
+		{
+			const std::uint64_t busyTimeNs = threadActivities[i].mBusyTimeNs.load(std::memory_order_relaxed);
+			const std::uint64_t jobCount = threadActivities[i].mJobCount.load(std::memory_order_relaxed);
+
+			busyTimeSamplers[i].Record(static_cast<float>(busyTimeNs - lastBusyTimesNs[i]) / 1000000.0f);
+			jobCountSamplers[i].Record(static_cast<float>(jobCount - lastJobCounts[i]));
+
+			lastBusyTimesNs[i] = busyTimeNs;
+			lastJobCounts[i] = jobCount;
+		}
+
+		if (!ImGui::BeginTable("ProfilerThreadView", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable))
+			return;
+
+		ImGui::TableSetupColumn("Thread", ImGuiTableColumnFlags_WidthStretch, 180.0f);
+		ImGui::TableSetupColumn("Busy (ms/frame)", ImGuiTableColumnFlags_WidthStretch, 60.0f);
+		ImGui::TableSetupColumn("Jobs/frame", ImGuiTableColumnFlags_WidthStretch, 60.0f);
+
+		ImGui::TableHeadersRow();
+
+		for (std::size_t i = 0; i < threadActivities.size(); ++i)
+		{
+			ImGui::TableNextRow();
+
+			ImGui::TableSetColumnIndex(0);
+			if (i == 0)
+				ImGui::Text("Main");
+			else
+				ImGui::Text("Worker %zu", i);
+
+			ImGui::TableSetColumnIndex(1);
+			ImGui::Text("%.3f", busyTimeSamplers[i].GetAverage());
+
+			ImGui::TableSetColumnIndex(2);
+			ImGui::Text("%.1f", jobCountSamplers[i].GetAverage());
+		}
 
 		ImGui::EndTable();
 	}
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <span>
 #include <vector>
 
 class Sampler
@@ -44,6 +48,29 @@ public:
 		return mData.data();
 	}
 
+	// Nearest-rank percentiles of the valid samples, with the percentiles in [0, 100]
+	void GetPercentiles(const std::span<const double> aPercentiles, const std::span<double> aTarget) const
+	{
+		assert(aPercentiles.size() == aTarget.size());
+
+		if (mSize == 0u)
+		{
+			std::fill(aTarget.begin(), aTarget.end(), 0.0);
+			return;
+		}
+
+		// One sorted copy serves every percentile
+		std::vector<float> sorted(mData.begin(), mData.begin() + mSize);
+		std::sort(sorted.begin(), sorted.end());
+
+		for (std::size_t i = 0u; i < aPercentiles.size(); ++i)
+		{
+			const double rank = std::ceil(aPercentiles[i] / 100.0 * static_cast<double>(mSize));
+			const std::size_t index = std::min(static_cast<std::size_t>(std::max(rank, 1.0)) - 1u, mSize - 1u);
+			aTarget[i] = static_cast<double>(sorted[index]);
+		}
+	}
+
 	void Clear()
 	{
 		for (float& x : mData)